@@ -100,26 +100,22 @@ static void data_callback(ma_device* device, void* output, const void* input,
   float* output_buffer = static_cast<float*>(output);
   ma_uint32 samples_needed = frame_count * device->playback.channels;
 
-  if (audio_output) {
-    std::lock_guard<std::mutex> lock(audio_output->buffer_mutex_);
-
+  if (audio_output && audio_output->ring_) {
     // Consume from buffer if available
-    size_t available = audio_output->audio_buffer_.size();
-    size_t to_copy = std::min(static_cast<size_t>(samples_needed), available);
-
-    if (to_copy > 0) {
-      memcpy(output_buffer, audio_output->audio_buffer_.data(),
-             to_copy * sizeof(float));
-      audio_output->audio_buffer_.erase(
-          audio_output->audio_buffer_.begin(),
-          audio_output->audio_buffer_.begin() + to_copy);
-    }
+    size_t frames = audio_output->ring_->Read(output_buffer, frame_count);
+    size_t to_copy = frames * device->playback.channels;
 
     // Fill remainder with silence if buffer underrun
     if (to_copy < samples_needed) {
       memset(output_buffer + to_copy, 0,
              (samples_needed - to_copy) * sizeof(float));
     }
+
+    // Wake up the engine if it is waiting for the device to render
+    // the next block.
+    if (audio_output->waiting_.load(std::memory_order_seq_cst)) {
+      audio_output->space_.Post();
+    }
   } else {
     // No audio_output, output silence
     memset(output_buffer, 0, samples_needed * sizeof(float));
@@ -148,6 +144,10 @@ absl::Status AudioOutput::Init(int sample_rate, int channels, int buffer_size,
   config.pUserData = this;
   config.periodSizeInFrames = buffer_size;
 
+  channels_ = channels;
+  ring_ = std::make_unique<AudioRingBuffer>(kRingBlocks * buffer_size,
+                                            channels);
+
   if (!device_name.empty()) {
     if (ma_context_init(nullptr, 0, nullptr, &context_) == MA_SUCCESS) {
       context_initialized_ = true;
@@ -222,20 +222,72 @@ absl::Status AudioOutput::Stop() {
   return absl::OkStatus();
 }
 
+size_t AudioOutput::BufferedFrames() {
+  if (!ring_) {
+    return 0;
+  }
+
+  return ring_->Available();
+}
+
+bool AudioOutput::WaitForSpace(size_t max_frames, absl::Duration timeout) {
+  if (!ring_) {
+    return true;
+  }
+
+  const absl::Time deadline = absl::Now() + timeout;
+
+  // Published before checking the ring: either the callback sees the
+  // flag and posts, or we see what it consumed. Posts left over from
+  // a previous wait only cause an extra check.
+  waiting_.store(true, std::memory_order_seq_cst);
+  bool ready = ring_->Available() <= max_frames;
+  while (!ready) {
+    const absl::Duration left = deadline - absl::Now();
+    const bool posted = left > absl::ZeroDuration() && space_.WaitFor(left);
+    ready = ring_->Available() <= max_frames;
+    if (!posted) {
+      break;
+    }
+  }
+  waiting_.store(false, std::memory_order_relaxed);
+
+  return ready;
+}
+
+uint64_t AudioOutput::Underruns() const {
+  return ring_ ? ring_->Underruns() : 0;
+}
+
+uint64_t AudioOutput::Overruns() const { return ring_ ? ring_->Overruns() : 0; }
+
 absl::Status AudioOutput::PushAudioBuffer(AudioBuffer& buffer) {
   auto size = buffer.Size();
   if (size == 0) {
     return absl::OkStatus();
   }
 
-  std::lock_guard<std::mutex> lock(buffer_mutex_);
+  if (!ring_) {
+    return absl::FailedPreconditionError("Audio output not initialized");
+  }
+
+  // Only grows on the first push, blocks all have the same size.
+  if (interleaved_.size() < size * kNumChannels) {
+    interleaved_.resize(size * kNumChannels);
+  }
 
   // Interleave the audio data and append to buffer
+  const float* left = buffer.GetChannel(kLeftChannel);
+  const float* right = buffer.GetChannel(kRightChannel);
   for (size_t i = 0; i < size; i++) {
-    audio_buffer_.push_back(buffer.GetChannel(kLeftChannel)[i]);
-    audio_buffer_.push_back(buffer.GetChannel(kRightChannel)[i]);
+    interleaved_[i * kNumChannels] = left[i];
+    interleaved_[i * kNumChannels + 1] = right[i];
   }
 
+  // Frames that don't fit are dropped and accounted as overruns, we
+  // don't want to log from the DSP thread on each block.
+  ring_->Write(interleaved_.data(), size);
+
   return absl::OkStatus();
 }
 
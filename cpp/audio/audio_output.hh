@@ -1,14 +1,18 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
-#include <mutex>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "absl/time/time.h"
+#include "audio/audio_ring_buffer.hh"
 #include "core/common.hh"
 #include "miniaudio.h"
+#include "utils/semaphore.hh"
 
 namespace soir {
 
@@ -31,6 +35,11 @@ absl::StatusOr<std::vector<Device>> GetAudioInDevices();
 
 class AudioOutput : public SampleConsumer {
  public:
+  // Capacity of the ring between the engine and the device, in
+  // blocks. The engine never queues that much when driven by the
+  // device clock, this only matters with the wall clock.
+  static constexpr int kRingBlocks = 32;
+
   AudioOutput();
   ~AudioOutput();
 
@@ -41,15 +50,34 @@ class AudioOutput : public SampleConsumer {
 
   absl::Status PushAudioBuffer(AudioBuffer& buffer) override;
 
+  // Number of frames pushed but not yet consumed by the device.
+  size_t BufferedFrames();
+
+  // Blocks until at most max_frames are buffered, this is used by
+  // the engine to be driven by the clock of the device. Returns
+  // false if the timeout expired first.
+  bool WaitForSpace(size_t max_frames, absl::Duration timeout);
+
+  // Number of times the device asked for more frames than buffered,
+  // and of pushed blocks that didn't fit in the ring.
+  uint64_t Underruns() const;
+  uint64_t Overruns() const;
+
   // Buffer for storing pushed audio data (public for callback access)
-  std::mutex buffer_mutex_;
-  std::vector<float> audio_buffer_;
+  std::unique_ptr<AudioRingBuffer> ring_;
+
+  // The device callback only posts space_ while the engine is waiting
+  // for space, posting never blocks so the callback stays wait-free.
+  utils::Semaphore space_;
+  std::atomic<bool> waiting_ = false;
 
  private:
   ma_context context_;
   bool context_initialized_ = false;
   ma_device* device_ = nullptr;
   ma_device_id selected_device_id_;
+  int channels_ = kNumChannels;
+  std::vector<float> interleaved_;
   bool initialized_ = false;
 };
 
@@ -0,0 +1,99 @@
+#include "audio/audio_ring_buffer.hh"
+
+#include <algorithm>
+#include <cstring>
+
+namespace soir {
+namespace audio {
+
+namespace {
+
+size_t NextPowerOfTwo(size_t n) {
+  size_t p = 1;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+}  // namespace
+
+AudioRingBuffer::AudioRingBuffer(size_t capacity_frames, int channels)
+    : capacity_(NextPowerOfTwo(std::max<size_t>(capacity_frames, 1))),
+      mask_(capacity_ - 1),
+      channels_(channels),
+      frames_(capacity_ * channels) {}
+
+size_t AudioRingBuffer::Write(const float* frames, size_t num_frames) {
+  const uint64_t write = write_.load(std::memory_order_relaxed);
+  const uint64_t read = read_.load(std::memory_order_acquire);
+
+  const size_t free = capacity_ - static_cast<size_t>(write - read);
+  const size_t n = std::min(num_frames, free);
+
+  if (n < num_frames) {
+    overruns_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  const size_t start = write & mask_;
+  const size_t first = std::min(n, capacity_ - start);
+
+  std::memcpy(&frames_[start * channels_], frames,
+              first * channels_ * sizeof(float));
+  std::memcpy(&frames_[0], frames + first * channels_,
+              (n - first) * channels_ * sizeof(float));
+
+  write_.store(write + n, std::memory_order_release);
+
+  return n;
+}
+
+size_t AudioRingBuffer::Read(float* frames, size_t num_frames) {
+  const uint64_t read = read_.load(std::memory_order_relaxed);
+  const uint64_t write = write_.load(std::memory_order_acquire);
+
+  const size_t available = static_cast<size_t>(write - read);
+  const size_t n = std::min(num_frames, available);
+
+  if (n < num_frames) {
+    underruns_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  const size_t start = read & mask_;
+  const size_t first = std::min(n, capacity_ - start);
+
+  std::memcpy(frames, &frames_[start * channels_],
+              first * channels_ * sizeof(float));
+  std::memcpy(frames + first * channels_, &frames_[0],
+              (n - first) * channels_ * sizeof(float));
+
+  // Sequentially consistent so that a producer about to sleep on the
+  // consumer (see AudioOutput::WaitForSpace) can't miss this update.
+  read_.store(read + n, std::memory_order_seq_cst);
+
+  return n;
+}
+
+size_t AudioRingBuffer::Available() const {
+  // Read index first: it never goes past the write index so the
+  // difference can't wrap when loaded from a third thread.
+  const uint64_t read = read_.load(std::memory_order_seq_cst);
+  const uint64_t write = write_.load(std::memory_order_acquire);
+
+  return static_cast<size_t>(write - read);
+}
+
+size_t AudioRingBuffer::Capacity() const { return capacity_; }
+
+int AudioRingBuffer::Channels() const { return channels_; }
+
+uint64_t AudioRingBuffer::Underruns() const {
+  return underruns_.load(std::memory_order_relaxed);
+}
+
+uint64_t AudioRingBuffer::Overruns() const {
+  return overruns_.load(std::memory_order_relaxed);
+}
+
+}  // namespace audio
+}  // namespace soir
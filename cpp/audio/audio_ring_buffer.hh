@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace soir {
+namespace audio {
+
+// Fixed-capacity lock-free ring of interleaved audio frames, with a
+// single producer (the DSP engine) and a single consumer (the audio
+// device callback).
+//
+// Both sides only copy with at most two memcpy (before and after the
+// wrap point) and never block nor allocate, so the consumer is
+// wait-free and can safely run on the real-time audio thread.
+class AudioRingBuffer {
+ public:
+  // Capacity is rounded up to the next power of two frames.
+  AudioRingBuffer(size_t capacity_frames, int channels);
+
+  AudioRingBuffer(const AudioRingBuffer&) = delete;
+  AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+  // Producer side: writes up to num_frames interleaved frames and
+  // returns the number of frames written. Frames that don't fit are
+  // dropped and counted as an overrun.
+  size_t Write(const float* frames, size_t num_frames);
+
+  // Consumer side: reads up to num_frames interleaved frames and
+  // returns the number of frames read. Reading less than requested
+  // is counted as an underrun.
+  size_t Read(float* frames, size_t num_frames);
+
+  // Number of frames written but not yet read, this is exact from
+  // either side and an approximation from any other thread.
+  size_t Available() const;
+
+  size_t Capacity() const;
+  int Channels() const;
+
+  uint64_t Underruns() const;
+  uint64_t Overruns() const;
+
+ private:
+  const size_t capacity_;
+  const size_t mask_;
+  const int channels_;
+  std::vector<float> frames_;
+
+  // Indices grow monotonically and are masked on access, they are
+  // kept on separate cache lines so that both sides don't invalidate
+  // each other's line on every update.
+  alignas(64) std::atomic<uint64_t> read_ = 0;
+  alignas(64) std::atomic<uint64_t> write_ = 0;
+
+  alignas(64) std::atomic<uint64_t> underruns_ = 0;
+  std::atomic<uint64_t> overruns_ = 0;
+};
+
+}  // namespace audio
+}  // namespace soir
@@ -0,0 +1,133 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+
+#include "core/common.hh"
+#include "core/controls.hh"
+
+// Cost of reading a control from N DSP threads at once while it is
+// updated, once per 480 reads (the rate of updates against samples).
+// Compares the shared mutex controls used to take on each read, the
+// sequence lock they use now and a double-buffered atomic snapshot.
+
+namespace soir {
+namespace {
+
+constexpr int kReadsPerUpdate = kSampleRate / kControlsFrequencyUpdate;
+constexpr SampleTick kRampSamples = kSampleRate / kControlsFrequencyUpdate;
+
+float Interpolate(SampleTick tick, SampleTick from, SampleTick to,
+                  float initial, float target) {
+  if (tick >= to) {
+    return target;
+  }
+  const float progress = static_cast<float>(tick - from) / (to - from);
+  return initial + (target - initial) * progress;
+}
+
+// Replica of the previous Control.
+class MutexControl {
+ public:
+  void SetTargetValue(SampleTick tick, float target) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    initial_ = target_;
+    target_ = target;
+    from_ = tick;
+    to_ = tick + kRampSamples;
+  }
+
+  float GetValue(SampleTick tick) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return Interpolate(tick, from_, to_, initial_, target_);
+  }
+
+ private:
+  std::shared_mutex mutex_;
+  SampleTick from_ = 0;
+  SampleTick to_ = 0;
+  float initial_ = 0.0f;
+  float target_ = 0.0f;
+};
+
+// The writer fills the buffer readers don't use then publishes it.
+// Reads are wait-free but a reader still reading a buffer when it's
+// written again, two updates later, gets a torn state.
+class SnapshotControl {
+ public:
+  void SetTargetValue(SampleTick tick, float target) {
+    const int current = current_.load(std::memory_order_relaxed);
+    const State& previous = states_[current];
+    State& next = states_[1 - current];
+
+    next.initial_.store(previous.target_.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+    next.target_.store(target, std::memory_order_relaxed);
+    next.from_.store(tick, std::memory_order_relaxed);
+    next.to_.store(tick + kRampSamples, std::memory_order_relaxed);
+
+    current_.store(1 - current, std::memory_order_release);
+  }
+
+  float GetValue(SampleTick tick) const {
+    const State& state = states_[current_.load(std::memory_order_acquire)];
+    return Interpolate(tick, state.from_.load(std::memory_order_relaxed),
+                       state.to_.load(std::memory_order_relaxed),
+                       state.initial_.load(std::memory_order_relaxed),
+                       state.target_.load(std::memory_order_relaxed));
+  }
+
+ private:
+  struct State {
+    std::atomic<SampleTick> from_ = 0;
+    std::atomic<SampleTick> to_ = 0;
+    std::atomic<float> initial_ = 0.0f;
+    std::atomic<float> target_ = 0.0f;
+  };
+
+  std::array<State, 2> states_;
+  std::atomic<int> current_ = 0;
+};
+
+// Shared by the threads of a benchmark, thread 0 also updates it.
+template <typename T>
+void BM_ControlRead(benchmark::State& state) {
+  static T* control = nullptr;
+  if (state.thread_index() == 0) {
+    control = new T();
+  }
+
+  SampleTick tick = 0;
+  float sum = 0.0f;
+
+  for (auto _ : state) {
+    for (int i = 0; i < kReadsPerUpdate; ++i) {
+      sum += control->GetValue(tick + i);
+    }
+    if (state.thread_index() == 0) {
+      control->SetTargetValue(tick, static_cast<float>(tick % 1000));
+    }
+    tick += kReadsPerUpdate;
+  }
+  benchmark::DoNotOptimize(sum);
+
+  state.SetItemsProcessed(state.iterations() * kReadsPerUpdate);
+
+  if (state.thread_index() == 0) {
+    delete control;
+    control = nullptr;
+  }
+}
+
+BENCHMARK_TEMPLATE(BM_ControlRead, MutexControl)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ControlRead, Control)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ControlRead, SnapshotControl)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace soir
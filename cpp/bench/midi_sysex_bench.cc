@@ -0,0 +1,133 @@
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "core/midi_sysex.hh"
+
+// Cost of decoding the sysex payloads received by the DSP threads
+// for each sample trigger and each controls update: the JSON text
+// payloads they used to carry against the binary layouts.
+
+namespace soir {
+namespace {
+
+constexpr char kPlayJson[] =
+    R"({"pack": "808", "name": "kick", "start": 0.0, "end": 1.0,)"
+    R"( "pan": "lfo", "attack": 0.0, "decay": 0.0, "level": 1.0,)"
+    R"( "release": 0.0, "rate": 1.0, "amp": 0.8, "voices": 0, "choke": 0})";
+
+void BM_SamplerPlayJson(benchmark::State& state) {
+  const std::string payload = kPlayJson;
+
+  for (auto _ : state) {
+    auto params = nlohmann::json::parse(payload, nullptr, false);
+
+    SamplerPlayPayload play;
+    play.start_ = params["start"].get<float>();
+    play.end_ = params["end"].get<float>();
+    play.rate_ = params["rate"].get<float>();
+    play.attack_ = params["attack"].get<float>();
+    play.decay_ = params["decay"].get<float>();
+    play.level_ = params["level"].get<float>();
+    play.release_ = params["release"].get<float>();
+    play.amp_.value_ = params["amp"].get<float>();
+    auto pan = params["pan"].get<std::string>();
+    auto pack = params["pack"].get<std::string>();
+    auto name = params["name"].get<std::string>();
+
+    benchmark::DoNotOptimize(play);
+    benchmark::DoNotOptimize(pan);
+    benchmark::DoNotOptimize(pack);
+    benchmark::DoNotOptimize(name);
+  }
+}
+
+BENCHMARK(BM_SamplerPlayJson);
+
+void BM_SamplerPlayBinary(benchmark::State& state) {
+  SamplerPlayPayload play;
+  play.sample_ = 12;
+  play.pan_ = {3, 0.0f};
+  play.amp_ = {-1, 0.8f};
+
+  const std::string bytes = MidiSysexInstruction::Serialize(
+      MidiSysexType::SAMPLER_PLAY, play.Encode());
+  const auto* data = reinterpret_cast<const uint8_t*>(bytes.data());
+
+  for (auto _ : state) {
+    MidiSysexInstruction inst;
+    inst.ParseFromBytes(data, bytes.size());
+
+    SamplerPlayPayload decoded;
+    decoded.Decode(inst.payload, inst.payload_size);
+
+    benchmark::DoNotOptimize(decoded);
+  }
+}
+
+BENCHMARK(BM_SamplerPlayBinary);
+
+void BM_ControlsUpdateJson(benchmark::State& state) {
+  const int num_controls = state.range(0);
+
+  nlohmann::json knobs;
+  for (int i = 0; i < num_controls; ++i) {
+    knobs["knob_" + std::to_string(i)] = 0.5f + i;
+  }
+  const std::string payload = nlohmann::json({{"knobs", knobs}}).dump();
+
+  for (auto _ : state) {
+    std::map<std::string, float> values;
+    auto params = nlohmann::json::parse(payload, nullptr, false);
+    for (auto& [name, value] : params["knobs"].items()) {
+      values[name] = value.get<float>();
+    }
+
+    benchmark::DoNotOptimize(values);
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_controls);
+}
+
+BENCHMARK(BM_ControlsUpdateJson)->Arg(8)->Arg(64);
+
+void BM_ControlsUpdateBinary(benchmark::State& state) {
+  const int num_controls = state.range(0);
+
+  std::vector<ControlsUpdatePayload::Pair> values;
+  for (int i = 0; i < num_controls; ++i) {
+    values.push_back({i, 1, 0.5f + i});
+  }
+
+  const std::string bytes = MidiSysexInstruction::Serialize(
+      MidiSysexType::UPDATE_CONTROLS, ControlsUpdatePayload::Encode(values));
+  const auto* data = reinterpret_cast<const uint8_t*>(bytes.data());
+
+  for (auto _ : state) {
+    MidiSysexInstruction inst;
+    inst.ParseFromBytes(data, bytes.size());
+
+    ControlsUpdatePayload update;
+    update.Decode(inst.payload, inst.payload_size);
+
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < update.Size(); ++i) {
+      ControlsUpdatePayload::Pair pair;
+      update.Get(i, &pair);
+      sum += pair.value_;
+    }
+
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_controls);
+}
+
+BENCHMARK(BM_ControlsUpdateBinary)->Arg(8)->Arg(64);
+
+}  // namespace
+}  // namespace soir
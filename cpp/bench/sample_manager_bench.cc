@@ -0,0 +1,99 @@
+#include <AudioFile.h>
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "core/common.hh"
+#include "core/sample_manager.hh"
+#include "utils/config.hh"
+
+// Startup cost of loading a synthetic pack of 2000 short stereo
+// files, by number of loader threads, with and without a warm
+// sample cache.
+
+namespace soir {
+namespace {
+
+constexpr int kNumFiles = 2000;
+constexpr int kFileLength = kSampleRate / 4;
+
+std::filesystem::path BenchDirectory() {
+  return std::filesystem::temp_directory_path() / "soir-bench-pack";
+}
+
+void WriteBenchPack() {
+  const auto dir = BenchDirectory();
+  if (std::filesystem::exists(dir / "bench.pack.json")) {
+    return;
+  }
+  std::filesystem::create_directories(dir);
+
+  AudioFile<float> audio_file;
+  audio_file.setNumChannels(2);
+  audio_file.setNumSamplesPerChannel(kFileLength);
+  audio_file.setSampleRate(kSampleRate);
+  audio_file.setBitDepth(16);
+
+  std::ofstream pack(dir / "bench.pack.json");
+  pack << R"({"samples": [)";
+  for (int f = 0; f < kNumFiles; ++f) {
+    for (int i = 0; i < kFileLength; ++i) {
+      audio_file.samples[0][i] = std::sin(i * 0.001f * (f + 1));
+      audio_file.samples[1][i] = std::cos(i * 0.001f * (f + 1));
+    }
+
+    const std::string file = "s" + std::to_string(f) + ".wav";
+    audio_file.save((dir / file).string());
+
+    pack << (f ? ", " : "") << R"({"name": ")" << file << R"(", "path": ")"
+         << file << R"("})";
+  }
+  pack << "]}";
+}
+
+void BM_LoadPack(benchmark::State& state) {
+  const int threads = state.range(0);
+  const bool cached = state.range(1);
+
+  WriteBenchPack();
+
+  const auto dir = BenchDirectory();
+  const std::string cache_dir =
+      cached ? (dir / "cache").string() : std::string();
+  utils::Config config(R"({"dsp": {"sample_directory": ")" + dir.string() +
+                       R"(", "sample_cache_directory": ")" + cache_dir +
+                       R"(", "sample_loader_threads": )" +
+                       std::to_string(threads) +
+                       R"(, "sample_packs": ["bench"]}})");
+
+  if (cached) {
+    SampleManager warmup;
+    if (!warmup.Init(config).ok()) {
+      state.SkipWithError("Unable to load pack");
+      return;
+    }
+  }
+
+  for (auto _ : state) {
+    SampleManager sample_manager;
+    if (!sample_manager.Init(config).ok()) {
+      state.SkipWithError("Unable to load pack");
+      return;
+    }
+    benchmark::DoNotOptimize(sample_manager.GetPack("bench"));
+  }
+
+  state.SetItemsProcessed(state.iterations() * kNumFiles);
+}
+
+BENCHMARK(BM_LoadPack)
+    ->ArgNames({"threads", "cached"})
+    ->ArgsProduct({{1, 2, 4, 8, 0}, {0, 1}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace soir
@@ -0,0 +1,182 @@
+#include <AudioFile.h>
+#include <absl/status/statusor.h>
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "audio/audio_buffer.hh"
+#include "core/common.hh"
+#include "core/controls.hh"
+#include "core/midi_stack.hh"
+#include "core/midi_sysex.hh"
+#include "core/sample_manager.hh"
+#include "inst/sampler.hh"
+
+// Renders blocks of a sampler with N overlapping voices of a mono or
+// a stereo sample, this is the typical load of a drum-heavy loop.
+// Samples are stored as float32, int16 or int24: the cost of decoding
+// them while they play is reported along with the memory they take.
+// The interpolation kernels are compared on 64 voices.
+
+namespace soir {
+namespace {
+
+constexpr int kSampleLength = 10 * kSampleRate;
+
+constexpr const char* kFormats[] = {"float32", "int16", "int24"};
+
+absl::StatusOr<SampleHandle> LoadBenchPack(SampleManager* sample_manager,
+                                           int channels, int format) {
+  const auto dir = std::filesystem::temp_directory_path() / "soir-bench";
+  std::filesystem::create_directories(dir);
+
+  AudioFile<float> audio_file;
+  audio_file.setNumChannels(channels);
+  audio_file.setNumSamplesPerChannel(kSampleLength);
+  audio_file.setSampleRate(kSampleRate);
+  for (int i = 0; i < kSampleLength; ++i) {
+    audio_file.samples[0][i] = std::sin(i * 0.01f);
+    if (channels > 1) {
+      audio_file.samples[1][i] = std::cos(i * 0.01f);
+    }
+  }
+  audio_file.save((dir / "long.wav").string());
+
+  std::ofstream pack(dir / "bench.pack.json");
+  pack << R"({"samples": [{"name": "long", "path": "long.wav"}]})";
+  pack.close();
+
+  utils::Config config(R"({"dsp": {"sample_directory": ")" + dir.string() +
+                       R"(", "sample_format": ")" + kFormats[format] +
+                       R"(", "sample_packs": ["bench"]}})");
+
+  auto status = sample_manager->Init(config);
+  if (!status.ok()) {
+    return status;
+  }
+
+  return sample_manager->GetSampleHandle("bench", "long");
+}
+
+MidiEventAt PlayEvent(SampleTick tick, SampleHandle sample, float rate) {
+  SamplerPlayPayload play;
+  play.sample_ = sample;
+  play.rate_ = rate;
+
+  const std::string serialized = MidiSysexInstruction::Serialize(
+      MidiSysexType::SAMPLER_PLAY, play.Encode());
+
+  libremidi::midi_bytes bytes;
+  bytes.push_back(
+      static_cast<unsigned char>(libremidi::message_type::SYSTEM_EXCLUSIVE));
+  bytes.insert(bytes.end(), serialized.begin(), serialized.end());
+
+  MidiEventAt event(1, libremidi::message(bytes, 0), absl::Now());
+  event.SetTick(tick);
+  return event;
+}
+
+// Voices last at least 5 seconds, the sampler is restarted with a
+// new batch of voices every 200 blocks so that all of them always
+// play.
+constexpr int kBlocksPerBatch = 200;
+
+void TriggerVoices(inst::Sampler* sampler, SampleTick tick,
+                   SampleHandle sample, int num_voices, AudioBuffer* buffer) {
+  MidiBlock events;
+  events.Reset(tick);
+  for (int i = 0; i < num_voices; ++i) {
+    events.Push(PlayEvent(tick, sample, 0.5f + (i % 7) * 0.25f));
+  }
+  buffer->Reset();
+  sampler->Render(tick, events, *buffer);
+}
+
+// Renders blocks of the sampler until the end of the benchmark.
+void RenderVoices(benchmark::State& state, SampleManager* sample_manager,
+                  SampleHandle sample, int num_voices,
+                  const std::string& settings) {
+  Controls controls;
+  AudioBuffer buffer(kBlockSize);
+  MidiBlock empty;
+  std::unique_ptr<inst::Sampler> sampler;
+  SampleTick tick = 0;
+  int blocks = 0;
+
+  for (auto _ : state) {
+    if (blocks++ % kBlocksPerBatch == 0) {
+      state.PauseTiming();
+      sampler = std::make_unique<inst::Sampler>();
+      sampler->Init(settings, sample_manager, &controls).IgnoreError();
+      TriggerVoices(sampler.get(), tick, sample, num_voices, &buffer);
+      tick += kBlockSize;
+      state.ResumeTiming();
+    }
+
+    empty.Reset(tick);
+    buffer.Reset();
+    sampler->Render(tick, empty, buffer);
+    benchmark::DoNotOptimize(buffer.GetChannel(kLeftChannel));
+    tick += kBlockSize;
+  }
+
+  state.SetItemsProcessed(state.iterations() * num_voices * kBlockSize);
+}
+
+void BM_SamplerVoices(benchmark::State& state) {
+  const int num_voices = state.range(0);
+  const int channels = state.range(1);
+  const int format = state.range(2);
+
+  SampleManager sample_manager;
+
+  auto sample = LoadBenchPack(&sample_manager, channels, format);
+  if (!sample.ok()) {
+    state.SkipWithError("Unable to load the bench pack");
+    return;
+  }
+  state.SetLabel(kFormats[format]);
+  state.counters["sample_kb"] =
+      sample_manager.GetSample(*sample)->MemoryUsage() / 1024.0;
+
+  RenderVoices(state, &sample_manager, *sample, num_voices,
+               R"({"max_voices": 256})");
+}
+
+BENCHMARK(BM_SamplerVoices)
+    ->ArgNames({"voices", "channels", "format"})
+    ->ArgsProduct({{16, 64, 128}, {1, 2}, {0, 1, 2}})
+    ->Unit(benchmark::kMicrosecond);
+
+// Cost of each interpolation kernel, voices are played at rates from
+// 0.5 to 2.
+void BM_SamplerInterpolation(benchmark::State& state) {
+  constexpr const char* kInterpolations[] = {"linear", "hermite", "sinc"};
+  const int interpolation = state.range(0);
+  const int channels = state.range(1);
+
+  SampleManager sample_manager;
+
+  auto sample = LoadBenchPack(&sample_manager, channels, 0);
+  if (!sample.ok()) {
+    state.SkipWithError("Unable to load the bench pack");
+    return;
+  }
+  state.SetLabel(kInterpolations[interpolation]);
+
+  RenderVoices(state, &sample_manager, *sample, 64,
+               std::string(R"({"max_voices": 256, "interpolation": ")") +
+                   kInterpolations[interpolation] + R"("})");
+}
+
+BENCHMARK(BM_SamplerInterpolation)
+    ->ArgNames({"interpolation", "channels"})
+    ->ArgsProduct({{0, 1, 2}, {1, 2}})
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace soir
@@ -0,0 +1,150 @@
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "core/common.hh"
+#include "core/worker_pool.hh"
+
+// Compares the wall time of rendering one block of N tracks with the
+// legacy model (one thread per track woken by a condition variable,
+// then joined one at a time) against the DSP worker pool.
+
+namespace soir {
+namespace {
+
+// Synthetic track load: a few passes of a one-pole filter over a
+// block, roughly what a sampler with a couple of FX costs.
+struct FakeTrack {
+  float buffer_[kBlockSize];
+  float state_ = 0.0f;
+
+  void Render() {
+    for (int pass = 0; pass < 32; ++pass) {
+      for (int i = 0; i < kBlockSize; ++i) {
+        state_ = state_ * 0.99f + static_cast<float>(i) * 0.01f;
+        buffer_[i] = state_;
+      }
+    }
+    benchmark::DoNotOptimize(buffer_);
+  }
+
+  static void RenderJob(void* arg) { static_cast<FakeTrack*>(arg)->Render(); }
+};
+
+// Replica of the previous Track threading model.
+class ThreadedTrack {
+ public:
+  ThreadedTrack() {
+    thread_ = std::thread([this]() { Loop(); });
+  }
+
+  ~ThreadedTrack() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+      work_cv_.notify_one();
+    }
+    thread_.join();
+  }
+
+  void RenderAsync() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_work_ = true;
+    work_done_ = false;
+    work_cv_.notify_one();
+  }
+
+  void Join() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [this]() { return work_done_; });
+  }
+
+ private:
+  void Loop() {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_cv_.wait(lock, [this]() { return has_work_ || stop_; });
+        if (stop_) {
+          return;
+        }
+        has_work_ = false;
+      }
+
+      track_.Render();
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        work_done_ = true;
+        done_cv_.notify_one();
+      }
+    }
+  }
+
+  FakeTrack track_;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  bool stop_ = false;
+  bool has_work_ = false;
+  bool work_done_ = true;
+};
+
+void BM_PerTrackThreads(benchmark::State& state) {
+  std::vector<std::unique_ptr<ThreadedTrack>> tracks;
+  for (int i = 0; i < state.range(0); ++i) {
+    tracks.push_back(std::make_unique<ThreadedTrack>());
+  }
+
+  for (auto _ : state) {
+    for (auto& track : tracks) {
+      track->RenderAsync();
+    }
+    for (auto& track : tracks) {
+      track->Join();
+    }
+  }
+}
+
+void BM_WorkerPool(benchmark::State& state) {
+  std::vector<FakeTrack> tracks(state.range(0));
+  WorkerPool pool;
+
+  if (!pool.Start(0, true).ok()) {
+    state.SkipWithError("Unable to start worker pool");
+    return;
+  }
+
+  for (auto _ : state) {
+    for (auto& track : tracks) {
+      pool.Submit({&FakeTrack::RenderJob, &track});
+    }
+    pool.Wait();
+  }
+
+  pool.Stop().IgnoreError();
+}
+
+BENCHMARK(BM_PerTrackThreads)
+    ->Arg(8)
+    ->Arg(40)
+    ->Arg(60)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_WorkerPool)
+    ->Arg(8)
+    ->Arg(40)
+    ->Arg(60)
+    ->UseRealTime()
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace soir
+
+BENCHMARK_MAIN();
@@ -7,8 +7,11 @@
 #include "absl/log/log.h"
 #include "audio/audio_output.hh"
 #include "bindings/bind.hh"
+#include "core/controls.hh"
+#include "core/dsp_stats.hh"
 #include "core/engine.hh"
 #include "core/level_meter.hh"
+#include "core/midi_sysex.hh"
 #include "core/track.hh"
 #include "inst/external.hh"
 #include "rt/runtime.hh"
@@ -23,6 +26,12 @@ namespace {
 soir::rt::Runtime* gRt_ = nullptr;
 soir::Engine* gDsp_ = nullptr;
 
+py::dict DurationToDict(const soir::DurationSummary& d) {
+  return py::dict("count"_a = d.count, "last_us"_a = d.last_us,
+                  "mean_us"_a = d.mean_us, "p50_us"_a = d.p50_us,
+                  "p99_us"_a = d.p99_us, "max_us"_a = d.max_us);
+}
+
 }  // namespace
 
 namespace soir {
@@ -227,22 +236,59 @@ void Bind::PyRt(py::module_& m) {
          [](const std::string& track, uint8_t channel, uint8_t cc,
             uint8_t value) { gRt_->MidiCC(track, channel, cc, value); });
   rt.def("midi_sysex_sample_play_",
-         [](const std::string& track, const std::string& p) {
+         [](const std::string& track, const py::bytes& p) {
            gRt_->MidiSysex(track, MidiSysexType::SAMPLER_PLAY, p);
          });
   rt.def("midi_sysex_sample_stop_",
-         [](const std::string& track, const std::string& p) {
+         [](const std::string& track, const py::bytes& p) {
            gRt_->MidiSysex(track, MidiSysexType::SAMPLER_STOP, p);
          });
 
   rt.def("controls_get_frequency_update_",
          []() { return kControlsFrequencyUpdate; });
 
-  rt.def("midi_sysex_update_controls_", [](const std::string& p) {
+  rt.def("midi_sysex_update_controls_", [](const py::bytes& p) {
     gRt_->MidiSysex(std::string(kInternalControls),
                     MidiSysexType::UPDATE_CONTROLS, p);
   });
 
+  rt.def("midi_sysex_control_modulator_", [](const py::bytes& p) {
+    gRt_->MidiSysex(std::string(kInternalControls),
+                    MidiSysexType::CONTROL_MODULATOR, p);
+  });
+
+  rt.def("controls_get_max_", []() { return kMaxControls; });
+  rt.def("controls_get_max_update_pairs_",
+         []() { return ControlsUpdatePayload::kMaxPairs; });
+
+  // Returns the generation of the control, see Controls::Register.
+  rt.def("register_control_", [](ControlId id, const std::string& name) {
+    auto status = gDsp_->GetControls()->Register(id, name);
+    if (!status.ok()) {
+      throw std::runtime_error(std::string(status.message()));
+    }
+    return gDsp_->GetControls()->GetGeneration(id);
+  });
+
+  rt.def("release_control_",
+         [](ControlId id) { gDsp_->GetControls()->Release(id); });
+
+  rt.def("get_control_value_",
+         [](ControlId id) { return gDsp_->GetControls()->GetValue(id); });
+
+  rt.def("set_control_smoothing_",
+         [](ControlId id, const std::string& smoothing) {
+           Smoothing parsed;
+           auto status = ParseSmoothing(smoothing, &parsed);
+           if (!status.ok()) {
+             throw std::runtime_error(std::string(status.message()));
+           }
+           Control* control = gDsp_->GetControls()->GetControl(id);
+           if (control) {
+             control->SetSmoothing(parsed);
+           }
+         });
+
   rt.def("get_packs_",
          []() { return gDsp_->GetSampleManager().GetPackNames(); });
   rt.def("get_samples_", [](const std::string& p) {
@@ -254,6 +300,10 @@ void Bind::PyRt(py::module_& m) {
 
     return pack->GetSampleNames();
   });
+  rt.def("get_sample_handle_",
+         [](const std::string& pack, const std::string& name) {
+           return gDsp_->GetSampleManager().GetSampleHandle(pack, name);
+         });
 
   rt.def("get_code_", []() { return gRt_->GetCode(); });
 
@@ -358,6 +408,32 @@ void Bind::PyRt(py::module_& m) {
         "rms_left"_a = levels.rms_left, "rms_right"_a = levels.rms_right);
   });
 
+  rt.def("get_dsp_stats_", []() {
+    auto stats = gDsp_->GetDspStats();
+
+    py::dict tracks;
+    for (const auto& [name, track] : stats.tracks) {
+      py::dict fxs;
+      for (const auto& [fx_name, fx] : track.fxs) {
+        fxs[py::str(fx_name)] = DurationToDict(fx);
+      }
+      tracks[py::str(name)] =
+          py::dict("render"_a = DurationToDict(track.render), "fxs"_a = fxs);
+    }
+
+    return py::dict("block_us"_a = stats.block_us,
+                    "render"_a = DurationToDict(stats.render),
+                    "load"_a = stats.load, "load_avg"_a = stats.load_avg,
+                    "deadline_misses"_a = stats.deadline_misses,
+                    "underruns"_a = stats.underruns,
+                    "overruns"_a = stats.overruns,
+                    "realtime_priority"_a = stats.realtime_priority,
+                    "realtime_threads"_a = stats.realtime_threads,
+                    "cpu_affinity"_a = stats.cpu_affinity,
+                    "memory_locked"_a = stats.memory_locked,
+                    "tracks"_a = tracks);
+  });
+
   rt.def("pump_ui_events_", []() { soir::vst::EditorWindow::PumpEvents(); });
 
   rt.def("vst_open_fx_editor_",
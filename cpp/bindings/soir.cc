@@ -17,9 +17,26 @@ void Bind::PySoir(py::module_& m) {
       .def(py::init<>())
       .def(
           "init",
-          [](Soir& self, const std::string& cfg_path) {
-            py::gil_scoped_release release;
-            auto status = self.Init(cfg_path);
+          [](Soir& self, const std::string& cfg_path,
+             const py::object& progress) {
+            if (!progress.is_none()) {
+              self.SetSampleLoadProgress([&progress](int loaded, int total) {
+                py::gil_scoped_acquire acquire;
+                try {
+                  progress(loaded, total);
+                } catch (const py::error_already_set& e) {
+                  LOG(WARNING) << "Sample load progress failed: " << e.what();
+                }
+              });
+            }
+
+            absl::Status status;
+            {
+              py::gil_scoped_release release;
+              status = self.Init(cfg_path);
+            }
+            self.SetSampleLoadProgress(nullptr);
+
             if (!status.ok()) {
               LOG(ERROR) << "Failed to initialize Soir: " << status.message();
               return false;
@@ -27,7 +44,9 @@ void Bind::PySoir(py::module_& m) {
 
             return true;
           },
-          py::arg("config"), "Initialize Soir with configuration")
+          py::arg("config"), py::arg("progress") = py::none(),
+          "Initialize Soir with configuration, progress is called with "
+          "the number of samples loaded and the total")
       .def(
           "start",
           [](Soir& self) {
@@ -66,7 +85,22 @@ void Bind::PySoir(py::module_& m) {
 
             return true;
           },
-          py::arg("code"), "Update the live code");
+          py::arg("code"), "Update the live code")
+      .def(
+          "render_offline",
+          [](Soir& self, const std::string& code, float seconds,
+             const std::string& path) {
+            py::gil_scoped_release release;
+            auto status = self.RenderOffline(code, seconds, path);
+            if (!status.ok()) {
+              LOG(ERROR) << "Failed to render offline: " << status.message();
+              return false;
+            }
+
+            return true;
+          },
+          py::arg("code"), py::arg("seconds"), py::arg("path"),
+          "Render code to a WAV file faster than real-time");
 }
 
 }  // namespace bindings
@@ -1,18 +1,30 @@
 #include "core/adsr.hh"
 
+#include <algorithm>
+
 #include "core/common.hh"
 
 namespace soir {
 
+namespace {
+
+// Number of samples of a stage, at least one so that a stage of 0ms
+// which is already running completes on its next sample.
+float Samples(float ms) {
+  return std::max(kSampleRate * (ms / 1000.0f), 1.0f);
+}
+
+}  // namespace
+
 absl::Status ADSR::Init(float a, float d, float r, float level) {
   if (a < 0.0) {
-    return absl::InvalidArgumentError("Attack must be > 0");
+    return absl::InvalidArgumentError("Attack must not be negative");
   }
   if (d < 0.0) {
-    return absl::InvalidArgumentError("Decay must be > 0");
+    return absl::InvalidArgumentError("Decay must not be negative");
   }
   if (r < 0.0) {
-    return absl::InvalidArgumentError("Release must be > 0");
+    return absl::InvalidArgumentError("Release must not be negative");
   }
   if (level < 0.0 || level > 1.0) {
     return absl::InvalidArgumentError("Sustain level not in [0,1]");
@@ -23,30 +35,18 @@ absl::Status ADSR::Init(float a, float d, float r, float level) {
   sustainLevel_ = level;
   releaseMs_ = r;
 
-  if (attackMs_) {
-    // Attack will move the enveloppe linearly between 0.0f to 1.0f
-    // from sample 0 to sample N. We compute here the increment of the
-    // envelope;
-    const float n = kSampleRate * (attackMs_ / 1000.0f);
-
-    attackInc_ = 1.0f / n;
-  }
-
-  if (decayMs_) {
-    // Decay kicks in the moment the attack phase completes, it starts
-    // from 1.0 towards sustain level.
-    const float n = kSampleRate * (decayMs_ / 1000.0f);
-
-    decayDec_ = (1.0f - sustainLevel_) / n;
-  }
+  // Attack will move the enveloppe linearly between 0.0f to 1.0f
+  // from sample 0 to sample N. We compute here the increment of the
+  // envelope;
+  attackInc_ = 1.0f / Samples(attackMs_);
 
-  if (releaseMs_) {
-    // Release will move the envelope linearly between sustain to 0.0f
-    // whenever a note off event is triggered.
-    const float n = kSampleRate * (releaseMs_ / 1000.0f);
+  // Decay kicks in the moment the attack phase completes, it starts
+  // from 1.0 towards sustain level.
+  decayDec_ = (1.0f - sustainLevel_) / Samples(decayMs_);
 
-    releaseDec_ = sustainLevel_ / n;
-  }
+  // Release will move the envelope linearly from its level when the
+  // note off event was triggered to 0.0f.
+  releaseDec_ = releaseLevel_ / Samples(releaseMs_);
 
   return absl::OkStatus();
 }
@@ -57,13 +57,14 @@ void ADSR::Reset() {
 }
 
 void ADSR::NoteOn() {
+  // Stages of 0ms are skipped.
   if (attackMs_ > 0.0f) {
     envelope_ = 0.0f;
     currentState_ = ATTACK;
     return;
   }
 
-  if (decayMs_ >= 0.0f) {
+  if (decayMs_ > 0.0f) {
     envelope_ = 1.0f;
     currentState_ = DECAY;
     return;
@@ -78,7 +79,9 @@ void ADSR::NoteOff() {
     return;
   }
 
-  if (releaseMs_ >= 0.0) {
+  if (releaseMs_ > 0.0f) {
+    releaseLevel_ = envelope_;
+    releaseDec_ = releaseLevel_ / Samples(releaseMs_);
     currentState_ = RELEASING;
     return;
   }
@@ -126,4 +129,25 @@ float ADSR::GetNextEnvelope() {
   return envelope_;
 }
 
+void ADSR::Fill(float* envelope, int n) {
+  int i = 0;
+
+  while (i < n) {
+    switch (currentState_) {
+      case NONE:
+        std::fill(envelope + i, envelope + n, envelope_);
+        return;
+
+      case SUSTAIN:
+        envelope_ = sustainLevel_;
+        std::fill(envelope + i, envelope + n, envelope_);
+        return;
+
+      default:
+        envelope[i++] = GetNextEnvelope();
+        break;
+    }
+  }
+}
+
 }  // namespace soir
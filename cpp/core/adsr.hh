@@ -11,6 +11,9 @@ namespace soir {
 //
 // To avoid glitches, care must be taken to properly call NoteOff
 // before the end of the audio buffer if it's not ending smoothly.
+//
+// Stages of 0ms are instant jumps, and the release goes to 0 from
+// wherever the envelope was on NoteOff.
 class ADSR {
  public:
   // Can be called multiple times while playing: it will only affect
@@ -23,6 +26,11 @@ class ADSR {
   void NoteOn();
   void NoteOff();
   float GetNextEnvelope();
+
+  // Writes the next n values of the envelope, this is the same as
+  // calling GetNextEnvelope n times but constant phases are filled
+  // at once.
+  void Fill(float* envelope, int n);
   float GetSustainLevel() const { return sustainLevel_; }
 
  private:
@@ -35,6 +43,7 @@ class ADSR {
   float releaseMs_ = 100.0;
 
   float envelope_ = 0;
+  float releaseLevel_ = 0.0f;
   float attackInc_ = 0.0f;
   float decayDec_ = 0.0f;
   float releaseDec_ = 0.0f;
@@ -2,6 +2,7 @@
 
 #include <absl/status/status.h>
 
+#include <cstddef>
 #include <string_view>
 
 namespace soir {
@@ -48,6 +49,34 @@ using SampleTick = uint64_t;
 // defined here.
 static constexpr std::string_view kInternalControls = "soir_internal_controls";
 
+// Integer ID of a track, resolved once from its name by the engine
+// so that routing MIDI events on the DSP side doesn't involve any
+// string lookup. IDs are stable for the whole lifetime of the
+// engine, the internal controls track always has the ID 0.
+using TrackId = int32_t;
+static constexpr TrackId kInternalControlsTrackId = 0;
+
+// Integer ID of a control, resolved once from its name by Controls so
+// that control references in MIDI events are plain integers. IDs are
+// stable for the whole lifetime of the controls.
+using ControlId = int32_t;
+static constexpr ControlId kInvalidControlId = -1;
+
+// Maximum number of distinct control names during a session.
+static constexpr int kMaxControls = 4096;
+
+// Maximum number of tracks at once, each of them owns a
+// pre-allocated MIDI queue. IDs of removed tracks are reused.
+static constexpr int kMaxTracks = 256;
+
+// Maximum number of MIDI events pending per track between two
+// blocks, extra events are dropped.
+static constexpr int kMidiQueueCapacity = 1024;
+
+// Maximum size in bytes of a MIDI event, including sysex instructions
+// whose bytes are stored inline in the queues.
+static constexpr size_t kMaxMidiEventSize = 128;
+
 // Audio constants
 static constexpr int kSampleRate = 48000;
 static constexpr int kNumChannels = 2;
@@ -65,6 +94,10 @@ static constexpr int kBlockSize = 512;
 // that we can increase block size without affecting scheduling.
 static constexpr int kMidiExtChunkSize = 128;
 
+// Number of blocks of audio input from external devices which can be
+// queued before the DSP thread renders them.
+static constexpr int kExternalInputBlocks = 8;
+
 // Number of blocks between scheduling and actual processing (~70ms),
 // this is in case we have heavy processing in the code loops. This number
 // *needs* to be higher than the kMidiDeviceDelay parameter, which schedules
@@ -72,6 +105,10 @@ static constexpr int kMidiExtChunkSize = 128;
 // audio device we get something accurate.
 static constexpr int kBlockProcessingDelay = 7;
 
+// Number of blocks rendered ahead of the audio device when the engine
+// is driven by the device clock (~32ms), this is the output latency.
+static constexpr int kDefaultPrerenderBlocks = 3;
+
 // Frequency bounds
 // Hz (lower bound of human hearing)
 static constexpr float kMinFreq = 20.0f;
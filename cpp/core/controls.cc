@@ -1,106 +1,437 @@
 #include "core/controls.hh"
 
 #include <absl/log/log.h>
+#include <absl/strings/str_format.h>
 
-#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cmath>
+#include <memory>
 
 #include "core/midi_sysex.hh"
 
 namespace soir {
 
+namespace {
+
+constexpr SampleTick kRampTicks = kSampleRate / kControlsFrequencyUpdate;
+
+// One-pole ramps are e^-3 (5%) away from the target at the end of the
+// ramp, and snap to it once e^-24 away.
+constexpr float kOnePoleDecay = -3.0f;
+constexpr SampleTick kOnePoleRamps = 8;
+
+}  // namespace
+
+absl::Status ParseSmoothing(const std::string& name, Smoothing* smoothing) {
+  if (name == "linear") {
+    *smoothing = Smoothing::LINEAR;
+  } else if (name == "one_pole") {
+    *smoothing = Smoothing::ONE_POLE;
+  } else if (name == "cubic") {
+    *smoothing = Smoothing::CUBIC;
+  } else {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Unknown control smoothing: %s", name));
+  }
+  return absl::OkStatus();
+}
+
 Control::Control() {}
 
+void Control::SetSmoothing(Smoothing smoothing) {
+  smoothing_.store(smoothing, std::memory_order_relaxed);
+}
+
 void Control::SetTargetValue(SampleTick tick, float target) {
-  std::unique_lock<std::shared_mutex> lock(mutex_);
+  SetTargetValue(tick, target, kRampTicks);
+}
+
+void Control::SetTargetValue(SampleTick tick, float target,
+                             SampleTick duration) {
+  duration = std::max<SampleTick>(duration, 1);
+
+  // This is the only writer, the state can't change while it's read.
+  const State current = Load();
+  const float value = ValueAt(current, tick);
+  const float delta = target - value;
+
+  State next;
+  next.fromTick_ = tick;
+  next.toTick_ = tick + duration;
+  next.smoothing_ = smoothing_.load(std::memory_order_relaxed);
+  next.initialValue_ = value;
+  next.targetValue_ = target;
+
+  switch (next.smoothing_) {
+    case Smoothing::ONE_POLE:
+      next.toTick_ = tick + kOnePoleRamps * duration;
+      next.c1_ = kOnePoleDecay / duration;
+      break;
+
+    case Smoothing::CUBIC: {
+      // Hermite cubic over u = ticks / duration which ends with the
+      // slope of a line to the target. The starting slope is limited
+      // as by Fritsch-Carlson so that the ramp stays monotonic.
+      float slope = SlopeAt(current, tick) * duration;
+      if (slope * delta <= 0.0f) {
+        slope = 0.0f;
+      } else if (std::fabs(slope) > 3.0f * std::fabs(delta)) {
+        slope = 3.0f * delta;
+      }
 
-  initialValue_ = targetValue_;
-  targetValue_ = target;
+      const float ticks = duration;
+      next.c1_ = slope / ticks;
+      next.c2_ = (2.0f * delta - 2.0f * slope) / (ticks * ticks);
+      next.c3_ = (slope - delta) / (ticks * ticks * ticks);
+      break;
+    }
+
+    default:
+      next.c1_ = delta / duration;
+      break;
+  }
+
+  Store(next);
+}
+
+void Control::Reset() { Store(State()); }
+
+void Control::Store(const State& state) {
+  const uint32_t sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  fromTick_.store(state.fromTick_, std::memory_order_relaxed);
+  toTick_.store(state.toTick_, std::memory_order_relaxed);
+  rampSmoothing_.store(state.smoothing_, std::memory_order_relaxed);
+  initialValue_.store(state.initialValue_, std::memory_order_relaxed);
+  targetValue_.store(state.targetValue_, std::memory_order_relaxed);
+  c1_.store(state.c1_, std::memory_order_relaxed);
+  c2_.store(state.c2_, std::memory_order_relaxed);
+  c3_.store(state.c3_, std::memory_order_relaxed);
 
-  fromTick_ = tick;
-  toTick_ = tick + kSampleRate / kControlsFrequencyUpdate;
+  sequence_.store(sequence + 2, std::memory_order_release);
 }
 
-float Control::GetValue(SampleTick tick) {
-  std::shared_lock<std::shared_mutex> lock(mutex_);
+Control::State Control::Load() const {
+  State state;
 
-  if (tick >= toTick_) {
-    return targetValue_;
+  uint32_t before;
+  uint32_t after;
+  do {
+    before = sequence_.load(std::memory_order_acquire);
+
+    state.fromTick_ = fromTick_.load(std::memory_order_relaxed);
+    state.toTick_ = toTick_.load(std::memory_order_relaxed);
+    state.smoothing_ = rampSmoothing_.load(std::memory_order_relaxed);
+    state.initialValue_ = initialValue_.load(std::memory_order_relaxed);
+    state.targetValue_ = targetValue_.load(std::memory_order_relaxed);
+    state.c1_ = c1_.load(std::memory_order_relaxed);
+    state.c2_ = c2_.load(std::memory_order_relaxed);
+    state.c3_ = c3_.load(std::memory_order_relaxed);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = sequence_.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
+
+  return state;
+}
+
+float Control::ValueAt(const State& state, SampleTick tick) {
+  if (tick >= state.toTick_) {
+    return state.targetValue_;
+  }
+  if (tick <= state.fromTick_) {
+    return state.initialValue_;
   }
 
-  const float progress = (tick - fromTick_) / (toTick_ - fromTick_);
+  const float t = static_cast<float>(tick - state.fromTick_);
 
-  return initialValue_ + (targetValue_ - initialValue_) * progress;
+  if (state.smoothing_ == Smoothing::ONE_POLE) {
+    return state.targetValue_ + (state.initialValue_ - state.targetValue_) *
+                                    std::exp(state.c1_ * t);
+  }
+
+  return state.initialValue_ +
+         t * (state.c1_ + t * (state.c2_ + t * state.c3_));
+}
+
+float Control::SlopeAt(const State& state, SampleTick tick) {
+  if (tick >= state.toTick_ || tick < state.fromTick_) {
+    return 0.0f;
+  }
+
+  const float t = static_cast<float>(tick - state.fromTick_);
+
+  if (state.smoothing_ == Smoothing::ONE_POLE) {
+    return (state.initialValue_ - state.targetValue_) * state.c1_ *
+           std::exp(state.c1_ * t);
+  }
+
+  return state.c1_ + t * (2.0f * state.c2_ + 3.0f * t * state.c3_);
+}
+
+float Control::GetValue(SampleTick tick) const {
+  return ValueAt(Load(), tick);
+}
+
+void Control::Ramp(SampleTick start, int n, float* out) const {
+  const State state = Load();
+
+  // Number of ticks before the ramp, and before its end.
+  int before = 0;
+  if (start < state.fromTick_) {
+    before = static_cast<int>(std::min<SampleTick>(state.fromTick_ - start, n));
+  }
+  int end = before;
+  if (start < state.toTick_) {
+    end = static_cast<int>(std::min<SampleTick>(state.toTick_ - start, n));
+  }
+
+  std::fill(out, out + before, state.initialValue_);
+
+  const SampleTick offset = start + before - state.fromTick_;
+  if (state.smoothing_ == Smoothing::ONE_POLE) {
+    // The distance to the target decays by the same factor each tick.
+    const float decay = std::exp(state.c1_);
+    float distance = (state.initialValue_ - state.targetValue_) *
+                     std::exp(state.c1_ * offset);
+    for (int i = before; i < end; ++i) {
+      out[i] = state.targetValue_ + distance;
+      distance *= decay;
+    }
+  } else {
+    for (int i = before; i < end; ++i) {
+      const float t = static_cast<float>(offset + (i - before));
+      out[i] = state.initialValue_ +
+               t * (state.c1_ + t * (state.c2_ + t * state.c3_));
+    }
+  }
+
+  // Past the end of the ramp the value is the target.
+  std::fill(out + end, out + n, state.targetValue_);
 }
 
 absl::Status Controls::Init() { return absl::OkStatus(); }
 
-Controls::Controls() {}
+Controls::Controls()
+    : slots_(std::make_unique<Slot[]>(kMaxControls)),
+      modulators_(std::make_unique<Modulator[]>(kMaxControls)),
+      resets_(kMaxControls),
+      names_(kMaxControls) {
+  modulated_.reserve(kMaxControls);
+  midi_stack_.Reserve(kMidiQueueCapacity);
+  events_.Reserve(kMidiQueueCapacity);
+}
+
+void Controls::SetBPM(float bpm) {
+  bpm_.store(bpm, std::memory_order_relaxed);
+}
 
-std::shared_ptr<Control> Controls::GetControl(const std::string& id) {
-  std::shared_lock<std::shared_mutex> lock(mutex_);
+float Controls::GetValue(ControlId id) const {
+  const Control* control = GetControl(id);
+  if (!control) {
+    return 0.0f;
+  }
 
-  auto it = controls_.find(id);
-  if (it == controls_.end()) {
-    return nullptr;
+  return control->GetValue(current_.load(std::memory_order_relaxed));
+}
+
+absl::Status Controls::Register(ControlId id, const std::string& name) {
+  if (id < 0 || id >= kMaxControls) {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Invalid ID %d for control %s", id, name));
+  }
+
+  std::scoped_lock<std::mutex> lock(mutex_);
+
+  Slot& slot = slots_[id];
+  if (slot.registered_.load(std::memory_order_relaxed) &&
+      names_[id] == name) {
+    return absl::OkStatus();
+  }
+
+  // The previous ID of the name and the previous name of the ID.
+  auto it = ids_.find(name);
+  if (it != ids_.end() && it->second != id) {
+    slots_[it->second].registered_.store(false, std::memory_order_relaxed);
+    names_[it->second].clear();
+  }
+  if (!names_[id].empty()) {
+    ids_.erase(names_[id]);
+  }
+
+  ids_[name] = id;
+  names_[id] = name;
+
+  slot.generation_.fetch_add(1, std::memory_order_relaxed);
+  slot.registered_.store(true, std::memory_order_release);
+
+  if (!resets_.try_enqueue(id)) {
+    LOG(WARNING) << "Too many controls registered at once, " << name
+                 << " starts from the value of the previous control";
+  }
+
+  return absl::OkStatus();
+}
+
+void Controls::Release(ControlId id) {
+  if (id < 0 || id >= kMaxControls) {
+    return;
+  }
+
+  std::scoped_lock<std::mutex> lock(mutex_);
+
+  slots_[id].registered_.store(false, std::memory_order_relaxed);
+  ids_.erase(names_[id]);
+  names_[id].clear();
+}
+
+ControlId Controls::GetControlId(const std::string& name) {
+  std::scoped_lock<std::mutex> lock(mutex_);
+
+  auto it = ids_.find(name);
+  if (it == ids_.end()) {
+    return kInvalidControlId;
   }
 
   return it->second;
 }
 
-void Controls::AddEvents(const std::list<MidiEventAt>& events) {
-  midi_stack_.AddEvents(events);
+std::string Controls::GetControlName(ControlId id) {
+  if (id < 0 || id >= kMaxControls) {
+    return "";
+  }
+
+  std::scoped_lock<std::mutex> lock(mutex_);
+  return names_[id];
+}
+
+Control* Controls::GetControl(ControlId id) const {
+  if (id < 0 || id >= kMaxControls ||
+      !slots_[id].registered_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+
+  return &slots_[id].control_;
+}
+
+uint32_t Controls::GetGeneration(ControlId id) const {
+  if (id < 0 || id >= kMaxControls) {
+    return 0;
+  }
+
+  return slots_[id].generation_.load(std::memory_order_acquire);
+}
+
+Control* Controls::GetControl(ControlId id, uint32_t generation) const {
+  if (id < 0 || id >= kMaxControls ||
+      slots_[id].generation_.load(std::memory_order_relaxed) != generation) {
+    return nullptr;
+  }
+
+  return &slots_[id].control_;
+}
+
+void Controls::TakeEvents(std::vector<MidiEventAt>* events) {
+  midi_stack_.TakeEvents(events);
 }
 
 void Controls::Update(SampleTick current) {
-  std::list<MidiEventAt> events;
+  // New controls start from scratch, before their first update.
+  ControlId id;
+  while (resets_.try_dequeue(id)) {
+    slots_[id].control_.Reset();
+  }
 
-  midi_stack_.EventsAtTick(current, events);
+  midi_stack_.PopBlock(current, 1, &events_);
 
-  for (auto& event : events) {
+  for (const auto& event : events_) {
     ProcessEvent(event);
   }
+
+  current_.store(current, std::memory_order_relaxed);
+  const float bpm = bpm_.load(std::memory_order_relaxed);
+
+  for (std::size_t i = 0; i < modulated_.size();) {
+    const ControlId id = modulated_[i];
+    Modulator& modulator = modulators_[id];
+
+    // Modulators of controls released, or replaced, stop with them.
+    Control* control = GetControl(id);
+    if (!control || GetGeneration(id) != modulator.Generation()) {
+      modulator.Init(ControlModulatorPayload());
+      modulated_[i] = modulated_.back();
+      modulated_.pop_back();
+      continue;
+    }
+
+    control->SetTargetValue(current, modulator.Next(bpm, scratch_.data()),
+                            kBlockSize);
+    ++i;
+  }
+}
+
+void Controls::SetModulator(const ControlModulatorPayload& payload) {
+  const ControlId id = payload.control_;
+  if (!GetControl(id) || GetGeneration(id) != payload.generation_) {
+    return;
+  }
+
+  Modulator& modulator = modulators_[id];
+  const bool was_active = modulator.IsActive();
+  modulator.Init(payload);
+
+  if (modulator.IsActive() && !was_active) {
+    modulated_.push_back(id);
+  } else if (!modulator.IsActive() && was_active) {
+    modulated_.erase(std::find(modulated_.begin(), modulated_.end(), id));
+  }
 }
 
-void Controls::ProcessEvent(MidiEventAt& event_at) {
-  auto msg = event_at.Msg();
-  auto type = msg.get_message_type();
+void Controls::ProcessEvent(const MidiEventAt& event_at) {
+  auto type = event_at.Type();
 
   if (type != libremidi::message_type::SYSTEM_EXCLUSIVE) {
     return;
   }
 
   MidiSysexInstruction sysex;
-  if (!sysex.ParseFromBytes(msg.bytes.data() + 1, msg.bytes.size() - 1)) {
+  if (!sysex.ParseFromBytes(event_at.Bytes() + 1, event_at.Size() - 1)) {
     LOG(WARNING) << "Failed to parse sysex message in controls update";
     return;
   }
+  if (sysex.type == MidiSysexType::CONTROL_MODULATOR) {
+    ControlModulatorPayload payload;
+    if (!payload.Decode(sysex.payload, sysex.payload_size)) {
+      LOG(WARNING) << "Invalid control modulator payload";
+      return;
+    }
+    SetModulator(payload);
+    return;
+  }
   if (sysex.type != MidiSysexType::UPDATE_CONTROLS) {
     return;
   }
 
-  std::map<std::string, float> values;
-  auto params = nlohmann::json::parse(sysex.json_payload, nullptr, false);
-  for (auto& [name, value] : params["knobs"].items()) {
-    values[name] = value.get<float>();
+  ControlsUpdatePayload update;
+  if (!update.Decode(sysex.payload, sysex.payload_size)) {
+    LOG(WARNING) << "Invalid controls update payload";
+    return;
   }
 
-  std::unique_lock<std::shared_mutex> lock(mutex_);
+  // Controls are registered when they are created, so that updates
+  // don't have to lock nor allocate. Updates of released controls, or
+  // of the previous control of a reused ID, still queued, are dropped.
+  for (uint32_t i = 0; i < update.Size(); ++i) {
+    ControlsUpdatePayload::Pair pair;
+    update.Get(i, &pair);
 
-  for (auto& v : values) {
-    auto& name = v.first;
-    auto target = v.second;
-    auto it = controls_.find(name);
-    if (it == controls_.end()) {
-      it = controls_.emplace(name, std::make_shared<Control>()).first;
+    Control* control = GetControl(pair.control_);
+    if (control && GetGeneration(pair.control_) == pair.generation_) {
+      control->SetTargetValue(event_at.Tick(), pair.value_);
     }
-
-    it->second->SetTargetValue(event_at.Tick(), target);
   }
-
-  // Here eventually we could GC all names that weren't found. It's
-  // not clear though how we can properly handle this since we need
-  // the DSP code to ack it doesn't use any legacy knob that we are
-  // deleting.
 }
 
 }  // namespace soir
@@ -1,63 +1,211 @@
 #pragma once
 
 #include <absl/status/status.h>
+#include <readerwriterqueue.h>
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <map>
 #include <memory>
 #include <mutex>
-#include <shared_mutex>
+#include <string>
+#include <vector>
 
 #include "core/common.hh"
 #include "core/midi_stack.hh"
+#include "core/midi_sysex.hh"
+#include "core/modulator.hh"
 
 namespace soir {
 
+// How a control moves from its value to a new target. Ramps last
+// until the next update, 1 / kControlsFrequencyUpdate seconds.
+enum class Smoothing {
+  // Straight line to the target.
+  LINEAR,
+  // Exponential approach of the target, 95% of the way at the end of
+  // the ramp, it lags behind but has no corners.
+  ONE_POLE,
+  // Cubic which starts with the slope of the previous ramp, limited so
+  // that it never overshoots the target.
+  CUBIC,
+};
+
+absl::Status ParseSmoothing(const std::string& name, Smoothing* smoothing);
+
 // A control that is interpolated over time.
+//
+// Its state is published through a sequence lock: the writer bumps the
+// sequence to an odd value, updates the state and bumps it back to an
+// even value, readers retry if the sequence was odd or changed while
+// they read. Reads never block nor write shared memory, so the DSP
+// threads reading a control don't contend on its cache line, and only
+// retry while an update is being written, that is at most
+// kControlsFrequencyUpdate times per second.
 class Control {
  public:
   Control();
 
+  // Applies from the next target, can be called from any thread.
+  void SetSmoothing(Smoothing smoothing);
+
   // This is meant to be used by the RT thread to update the target
-  // value of the knob against which we interpolate.
+  // value of the knob against which we interpolate. The ramp starts
+  // from the current value of the control. Only one thread may update
+  // a control.
   void SetTargetValue(SampleTick tick, float target);
 
-  // Returns the interpolated value at the given tick. This takes a
-  // shared lock on each read:
-  //
-  // --> 48 000 * number of parameters * numbers of usages
-  //
-  // This may be heavy, let's maybe benchmark this at some point and
-  // maybe consider an atomic alternative if it's too slow or some
-  // other trick.
-  float GetValue(SampleTick tick);
+  // Same with a ramp of the given number of ticks instead of the
+  // period of the updates.
+  void SetTargetValue(SampleTick tick, float target, SampleTick duration);
 
- private:
-  std::shared_mutex mutex_;
+  // Moves the control back to 0 without a ramp, from the thread
+  // updating it.
+  void Reset();
+
+  // Returns the interpolated value at the given tick, lock-free.
+  float GetValue(SampleTick tick) const;
 
-  SampleTick fromTick_ = 0;
-  SampleTick toTick_ = 0;
+  // Writes the interpolated values of the n ticks from start into out,
+  // the state of the control is only read once.
+  void Ramp(SampleTick start, int n, float* out) const;
 
-  float initialValue_ = 0.0f;
-  float targetValue_ = 0.0f;
+ private:
+  // A ramp from initialValue_ at fromTick_, which holds targetValue_
+  // from toTick_. Coefficients are per tick since fromTick_: those of
+  // the polynomial for linear and cubic ramps, the log of the decay
+  // of the distance to the target in c1_ for one-pole ones.
+  struct State {
+    SampleTick fromTick_ = 0;
+    SampleTick toTick_ = 0;
+    Smoothing smoothing_ = Smoothing::LINEAR;
+    float initialValue_ = 0.0f;
+    float targetValue_ = 0.0f;
+    float c1_ = 0.0f;
+    float c2_ = 0.0f;
+    float c3_ = 0.0f;
+  };
+
+  // Reads a coherent state, retrying while it's being written.
+  State Load() const;
+  void Store(const State& state);
+
+  static float ValueAt(const State& state, SampleTick tick);
+  static float SlopeAt(const State& state, SampleTick tick);
+
+  std::atomic<Smoothing> smoothing_ = Smoothing::LINEAR;
+
+  // Fields are atomics so that reading them while they are written
+  // isn't a data race, the sequence tells whether they are coherent.
+  std::atomic<uint32_t> sequence_ = 0;
+
+  std::atomic<SampleTick> fromTick_ = 0;
+  std::atomic<SampleTick> toTick_ = 0;
+  std::atomic<Smoothing> rampSmoothing_ = Smoothing::LINEAR;
+
+  std::atomic<float> initialValue_ = 0.0f;
+  std::atomic<float> targetValue_ = 0.0f;
+  std::atomic<float> c1_ = 0.0f;
+  std::atomic<float> c2_ = 0.0f;
+  std::atomic<float> c3_ = 0.0f;
 };
 
 // A collection of controls that can be used to control the DSP.
+//
+// Controls live in a flat table indexed by IDs which are assigned by
+// the Python side when it creates them, so that the DSP threads only
+// ever index the table: no string lookup, lock nor reference count.
+// Slots are never freed, a released ID can be registered again for a
+// new control, which bumps the generation of its slot so that the
+// parameters still referring to the previous control stop using it.
+//
+// Controls are either updated from Python, with UPDATE_CONTROLS
+// messages, or by a native modulator set with a CONTROL_MODULATOR
+// message and evaluated at each Update().
 class Controls {
  public:
   Controls();
 
   absl::Status Init();
 
-  void AddEvents(const std::list<MidiEventAt>& events);
+  // Moves the events to the controls stack, see MidiStack::TakeEvents.
+  void TakeEvents(std::vector<MidiEventAt>* events);
+
+  // Processes the events of the block starting at current, then moves
+  // the modulated controls to the values of their modulators at the
+  // end of the block.
   void Update(SampleTick current);
-  std::shared_ptr<Control> GetControl(const std::string& name);
+
+  // Tempo of the modulators synced to beats, can be called from any
+  // thread.
+  void SetBPM(float bpm);
+
+  // Lock-free, value of a control at the last update, 0 for IDs which
+  // aren't registered.
+  float GetValue(ControlId id) const;
+
+  // Registers a control under an ID in [0, kMaxControls), replacing
+  // the control which had this ID if its name differs. The new
+  // control starts from 0, it is reset before the next update is
+  // processed. Called when controls are created, not from the DSP
+  // threads.
+  absl::Status Register(ControlId id, const std::string& name);
+
+  // Releases the ID of a control which isn't used anymore. Parameters
+  // referring to it keep its last value, also once the ID is registered
+  // again.
+  void Release(ControlId id);
+
+  // Returns the ID of a registered control, kInvalidControlId if there
+  // is none. Not meant for the DSP threads.
+  ControlId GetControlId(const std::string& name);
+  std::string GetControlName(ControlId id);
+
+  // Lock-free, returns nullptr for IDs which aren't registered.
+  Control* GetControl(ControlId id) const;
+
+  // Lock-free, the generation of the slot of an ID.
+  uint32_t GetGeneration(ControlId id) const;
+
+  // Lock-free, returns the control of an ID as long as its slot is
+  // still at the given generation, nullptr otherwise.
+  Control* GetControl(ControlId id, uint32_t generation) const;
 
  private:
-  void ProcessEvent(MidiEventAt& event_at);
+  struct Slot {
+    Control control_;
+    std::atomic<uint32_t> generation_ = 0;
+    std::atomic<bool> registered_ = false;
+  };
+
+  void ProcessEvent(const MidiEventAt& event_at);
+  void SetModulator(const ControlModulatorPayload& payload);
+
+  std::unique_ptr<Slot[]> slots_;
+
+  // Only used by the DSP thread updating the controls: modulators by
+  // ID and the IDs of the active ones.
+  std::unique_ptr<Modulator[]> modulators_;
+  std::vector<ControlId> modulated_;
+  std::array<float, kBlockSize> scratch_;
+
+  std::atomic<float> bpm_ = 120.0f;
+  std::atomic<SampleTick> current_ = 0;
+
+  // IDs registered for a new control, pushed under mutex_. Their
+  // control is reset by the thread updating controls, which is the
+  // only one writing them.
+  moodycamel::ReaderWriterQueue<ControlId> resets_;
+
+  // Names of the registered controls, only used outside of the DSP
+  // threads.
+  std::mutex mutex_;
+  std::map<std::string, ControlId> ids_;
+  std::vector<std::string> names_;
 
-  std::shared_mutex mutex_;
-  std::map<std::string, std::shared_ptr<Control>> controls_;
   MidiStack midi_stack_;
+  MidiBlock events_;
 };
 
 }  // namespace soir
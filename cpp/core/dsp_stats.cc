@@ -0,0 +1,110 @@
+#include "core/dsp_stats.hh"
+
+#include <algorithm>
+#include <chrono>
+
+namespace soir {
+
+namespace {
+
+// Single writer: a plain load and store is enough and avoids the
+// cost of a locked read-modify-write.
+template <typename T>
+void Add(std::atomic<T>& value, T n) {
+  value.store(value.load(std::memory_order_relaxed) + n,
+              std::memory_order_relaxed);
+}
+
+}  // namespace
+
+int64_t DurationStats::NowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int DurationStats::Bucket(uint64_t us) {
+  if (us < 8) {
+    return static_cast<int>(us);
+  }
+
+  // Index of the highest bit set (>= 3), and the two bits below it
+  // to split each octave in four.
+  int msb = 63;
+  while (!(us >> msb)) {
+    --msb;
+  }
+  const int sub = static_cast<int>((us >> (msb - 2)) & 3);
+
+  return std::min(4 * (msb - 1) + sub, kNumBuckets - 1);
+}
+
+uint64_t DurationStats::BucketLowerBound(int bucket) {
+  if (bucket < 8) {
+    return bucket;
+  }
+
+  const int msb = bucket / 4 + 1;
+  const int sub = bucket % 4;
+
+  return static_cast<uint64_t>(4 + sub) << (msb - 2);
+}
+
+void DurationStats::Record(int64_t duration_ns) {
+  duration_ns = std::max<int64_t>(duration_ns, 0);
+
+  Add<uint64_t>(count_, 1);
+  Add<uint64_t>(sum_ns_, duration_ns);
+  last_ns_.store(duration_ns, std::memory_order_relaxed);
+  if (duration_ns > max_ns_.load(std::memory_order_relaxed)) {
+    max_ns_.store(duration_ns, std::memory_order_relaxed);
+  }
+
+  Add<uint64_t>(buckets_[Bucket(duration_ns / 1000)], 1);
+}
+
+DurationSummary DurationStats::Read() const {
+  DurationSummary summary;
+
+  summary.count = count_.load(std::memory_order_relaxed);
+  if (summary.count == 0) {
+    return summary;
+  }
+
+  summary.last_us = last_ns_.load(std::memory_order_relaxed) / 1000.0f;
+  summary.max_us = max_ns_.load(std::memory_order_relaxed) / 1000.0f;
+  summary.mean_us =
+      sum_ns_.load(std::memory_order_relaxed) / 1000.0f / summary.count;
+
+  // Percentiles are the upper bound of the bucket they fall in, the
+  // total is recomputed as buckets may be ahead of the count.
+  std::array<uint64_t, kNumBuckets> buckets;
+  uint64_t total = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += buckets[i];
+  }
+
+  // Nearest rank: the smallest value with at least the given per
+  // mille of the values below or equal to it.
+  auto percentile = [&](uint64_t permille) {
+    const uint64_t rank =
+        std::max<uint64_t>(1, (permille * total + 999) / 1000);
+    uint64_t seen = 0;
+    for (int i = 0; i < kNumBuckets - 1; ++i) {
+      seen += buckets[i];
+      if (seen >= rank) {
+        return std::min(static_cast<float>(BucketLowerBound(i + 1)),
+                        summary.max_us);
+      }
+    }
+    return summary.max_us;
+  };
+
+  summary.p50_us = percentile(500);
+  summary.p99_us = percentile(990);
+
+  return summary;
+}
+
+}  // namespace soir
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace soir {
+
+// Summary of recorded durations, in microseconds.
+struct DurationSummary {
+  uint64_t count = 0;
+  float last_us = 0.0f;
+  float mean_us = 0.0f;
+  float p50_us = 0.0f;
+  float p99_us = 0.0f;
+  float max_us = 0.0f;
+};
+
+// Lock-free histogram of durations. It is written by a single thread
+// at a time (the DSP thread rendering what is measured) with relaxed
+// loads and stores only, so that it is cheap enough to always stay
+// on, and can be read from any thread. Reads are not consistent
+// across fields, which is fine for monitoring.
+//
+// Buckets are a quarter of octave wide over microseconds, so that
+// percentiles are within ~20% of the actual value, up to ~1s.
+class DurationStats {
+ public:
+  static constexpr int kNumBuckets = 80;
+
+  // Monotonic clock used to measure durations.
+  static int64_t NowNs();
+
+  void Record(int64_t duration_ns);
+  DurationSummary Read() const;
+
+ private:
+  static int Bucket(uint64_t us);
+  static uint64_t BucketLowerBound(int bucket);
+
+  std::atomic<uint64_t> count_ = 0;
+  std::atomic<uint64_t> sum_ns_ = 0;
+  std::atomic<int64_t> last_ns_ = 0;
+  std::atomic<int64_t> max_ns_ = 0;
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_ = {};
+};
+
+struct TrackStats {
+  DurationSummary render;
+  std::map<std::string, DurationSummary> fxs;
+};
+
+// Statistics of the DSP engine, rendering durations are compared to
+// the duration of a block of audio: going above means the engine
+// can't keep up with real-time.
+struct DspStats {
+  float block_us = 0.0f;
+
+  // Rendering of whole blocks, load is the last render duration
+  // over the block duration, load_avg is smoothed over ~1 second.
+  DurationSummary render;
+  float load = 0.0f;
+  float load_avg = 0.0f;
+
+  // Blocks which took longer than a block duration to render (only
+  // in real-time mode), along with xruns seen by the audio device.
+  uint64_t deadline_misses = 0;
+  uint64_t underruns = 0;
+  uint64_t overruns = 0;
+
+  // Scheduling of the DSP threads as applied, threads which couldn't
+  // get the real-time priority are not counted.
+  int realtime_priority = 0;
+  int realtime_threads = 0;
+  std::vector<int> cpu_affinity;
+  bool memory_locked = false;
+
+  std::map<std::string, TrackStats> tracks;
+};
+
+}  // namespace soir
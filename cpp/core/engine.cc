@@ -2,13 +2,35 @@
 
 #include <absl/log/log.h>
 
+#include <chrono>
+
 #include "audio/audio_recorder.hh"
 #include "audio/pcm_stream.hh"
+#include "utils/realtime.hh"
+#include "utils/rt_alloc.hh"
 #include "vst/vst_host.hh"
 
 namespace soir {
 
-Engine::Engine() {}
+namespace {
+
+constexpr int64_t kBlockDurationNs =
+    (1000000000LL * kBlockSize) / kSampleRate;
+
+// Smoothing factor of the average load, over about a second worth
+// of blocks.
+constexpr float kLoadAvgAlpha = static_cast<float>(kBlockSize) / kSampleRate;
+
+}  // namespace
+
+Engine::Engine()
+    : buffer_(kBlockSize),
+      sample_manager_(std::make_unique<SampleManager>()),
+      tracks_(std::make_shared<TrackSet>()) {
+  rt_tracks_.store(tracks_.get());
+  active_jobs_.reserve(kMaxTracks);
+  controls_events_.reserve(kMidiQueueCapacity);
+}
 
 Engine::~Engine() {}
 
@@ -17,6 +39,49 @@ absl::Status Engine::Init(const utils::Config& config) {
 
   current_tick_ = 0;
 
+  // The internal controls track is registered first so that it gets
+  // the ID 0 which both sides agree on.
+  auto id = RegisterTrackId(std::string(kInternalControls));
+  if (!id.ok()) {
+    return id.status();
+  }
+
+  num_workers_ = config.GetOrDefault<int>("dsp.workers", 0);
+  pin_workers_ = config.GetOrDefault<bool>("dsp.pin_workers", true);
+
+  const std::string clock =
+      config.GetOrDefault<std::string>("dsp.clock", "device");
+  if (clock == "device") {
+    clock_ = Clock::DEVICE;
+  } else if (clock == "wall") {
+    clock_ = Clock::WALL;
+  } else {
+    return absl::InvalidArgumentError("Unknown DSP clock: " + clock);
+  }
+
+  prerender_blocks_ = std::max(1, config.GetOrDefault<int>(
+                                      "dsp.prerender_blocks",
+                                      kDefaultPrerenderBlocks));
+
+  utils::RealtimeSettings rt_settings;
+  rt_settings.priority_ = config.GetOrDefault<int>("dsp.realtime_priority", 0);
+  rt_settings.cpus_ =
+      config.GetOrDefault<std::vector<int>>("dsp.cpu_affinity", {});
+  rt_settings.mlock_ = config.GetOrDefault<bool>("dsp.mlock", false);
+  utils::SetRealtimeSettings(rt_settings);
+
+  // Memory is locked before samples are loaded so that they are
+  // locked as well, this is not fatal as it usually only requires
+  // to raise the memlock limit.
+  if (rt_settings.mlock_) {
+    auto status = utils::LockMemory();
+    if (!status.ok()) {
+      LOG(WARNING) << "Memory isn't locked: " << status;
+    } else {
+      LOG(INFO) << "Memory locked";
+    }
+  }
+
   audio_output_enabled_ = config.Get<bool>("dsp.enable_output");
   const std::string raw_device =
       config.GetOrDefault<std::string>("dsp.audio_output_device", "");
@@ -25,7 +90,7 @@ absl::Status Engine::Init(const utils::Config& config) {
     audio_output_enabled_ = false;
   }
 
-  audio_output_ = std::make_unique<audio::AudioOutput>();
+  audio_output_ = std::make_shared<audio::AudioOutput>();
   if (audio_output_enabled_) {
     const std::string miniaudio_device =
         (audio_output_device_ == "default") ? "" : audio_output_device_;
@@ -39,7 +104,6 @@ absl::Status Engine::Init(const utils::Config& config) {
     LOG(INFO) << "Audio output disabled";
   }
 
-  sample_manager_ = std::make_unique<SampleManager>();
   auto status = sample_manager_->Init(config);
   if (!status.ok()) {
     LOG(ERROR) << "Failed to initialize sample manager: " << status;
@@ -91,6 +155,12 @@ absl::Status Engine::Start() {
   // the engine: tracks are added through the SetupTracks method from
   // Python.
 
+  auto status = workers_.Start(num_workers_, pin_workers_);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to start DSP workers: " << status;
+    return status;
+  }
+
   thread_ = std::thread([this]() {
     auto status = Run();
     if (!status.ok()) {
@@ -113,12 +183,27 @@ absl::Status Engine::Start() {
   return absl::OkStatus();
 }
 
+absl::Status Engine::StartOffline(TimeSource* time_source) {
+  LOG(INFO) << "Starting engine for offline rendering";
+
+  time_source_ = time_source;
+  offline_ = true;
+
+  auto status = workers_.Start(num_workers_, pin_workers_);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to start DSP workers: " << status;
+    return status;
+  }
+
+  return absl::OkStatus();
+}
+
 absl::Status Engine::Stop() {
   LOG(INFO) << "Stopping engine";
 
   RemoveConsumer(pcm_stream_.get());
 
-  if (audio_output_.get() != nullptr && audio_output_enabled_) {
+  if (!offline_ && audio_output_.get() != nullptr && audio_output_enabled_) {
     auto status = audio_output_->Stop();
     if (!status.ok()) {
       LOG(ERROR) << "Failed to stop audio output: " << status;
@@ -128,6 +213,8 @@ absl::Status Engine::Stop() {
     RemoveConsumer(audio_output_.get());
   }
 
+  time_source_ = GetSystemTimeSource();
+
   {
     std::unique_lock<std::mutex> lock(mutex_);
     stop_ = true;
@@ -138,15 +225,24 @@ absl::Status Engine::Stop() {
     thread_.join();
   }
 
+  auto status = workers_.Stop();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to stop DSP workers: " << status;
+  }
+
   {
-    std::scoped_lock<std::mutex> lock(tracks_mutex_);
-    for (auto& it : tracks_) {
+    std::scoped_lock<std::mutex> setup_lock(setup_tracks_mutex_);
+    auto tracks = PublishTrackSet(std::make_shared<TrackSet>());
+    for (auto& it : tracks->tracks_) {
       auto status = it.second->Stop();
       if (!status.ok()) {
-        LOG(ERROR) << "Failed to stop track thread: " << status;
+        LOG(ERROR) << "Failed to stop track: " << status;
       }
     }
-    tracks_.clear();
+  }
+
+  if (utils::RtAllocCheckEnabled()) {
+    LOG(INFO) << "Allocations on the DSP path: " << utils::RtAllocCount();
   }
 
   LOG(INFO) << "Engine stopped";
@@ -168,8 +264,8 @@ void Engine::RemoveConsumer(SampleConsumer* consumer) {
   consumers_.remove(consumer);
 }
 
-void Engine::SetTicks(std::list<MidiEventAt>& events) {
-  auto now = absl::Now();
+void Engine::SetTicks(std::vector<MidiEventAt>& events) {
+  auto now = time_source_->Now();
 
   for (auto& e : events) {
     auto diff_us = absl::ToInt64Microseconds(e.At() - now);
@@ -186,119 +282,366 @@ void Engine::SetTicks(std::list<MidiEventAt>& events) {
   }
 }
 
+void Engine::TrackJob::Render(void* arg) {
+  auto job = static_cast<TrackJob*>(arg);
+
+  utils::RtScope rt_scope;
+  job->track_->Render(job->tick_, &job->events_);
+}
+
+absl::StatusOr<TrackId> Engine::RegisterTrackId(const std::string& name) {
+  std::scoped_lock<std::mutex> lock(track_ids_mutex_);
+
+  auto it = track_ids_.find(name);
+  if (it != track_ids_.end()) {
+    return it->second;
+  }
+
+  // Reuse the oldest retired ID whose queue was drained.
+  const uint64_t blocks = rt_blocks_.load(std::memory_order_acquire);
+  if (!retired_track_ids_.empty() &&
+      retired_track_ids_.front().block_ < blocks) {
+    const TrackId id = retired_track_ids_.front().id_;
+    retired_track_ids_.erase(retired_track_ids_.begin());
+    track_ids_[name] = id;
+    return id;
+  }
+
+  const TrackId id = num_track_ids_.load(std::memory_order_relaxed);
+  if (id >= kMaxTracks) {
+    return absl::ResourceExhaustedError("Too many tracks, unable to register " +
+                                        name);
+  }
+
+  midi_queues_[id] = std::make_unique<MidiQueue>(kMidiQueueCapacity);
+  track_jobs_[id].events_.reserve(kMidiQueueCapacity);
+  track_ids_[name] = id;
+
+  // Publishes the queue to the RT and DSP threads.
+  num_track_ids_.store(id + 1, std::memory_order_release);
+
+  return id;
+}
+
+void Engine::RetireTrackIds(const std::map<std::string, TrackId>& ids) {
+  std::scoped_lock<std::mutex> lock(track_ids_mutex_);
+
+  const uint64_t block = rt_blocks_.load(std::memory_order_acquire);
+  bool retired = false;
+
+  for (auto it = track_ids_.begin(); it != track_ids_.end();) {
+    if (it->second == kInternalControlsTrackId || ids.count(it->first)) {
+      ++it;
+      continue;
+    }
+    retired_track_ids_.push_back({it->second, block});
+    it = track_ids_.erase(it);
+    retired = true;
+  }
+
+  if (retired) {
+    track_ids_version_.fetch_add(1, std::memory_order_release);
+  }
+}
+
+uint64_t Engine::GetTrackIdsVersion() const {
+  return track_ids_version_.load(std::memory_order_acquire);
+}
+
+absl::StatusOr<TrackId> Engine::GetTrackId(const std::string& name) {
+  std::scoped_lock<std::mutex> lock(track_ids_mutex_);
+
+  auto it = track_ids_.find(name);
+  if (it == track_ids_.end()) {
+    return absl::NotFoundError("Track not found: " + name);
+  }
+
+  return it->second;
+}
+
 void Engine::PushMidiEvent(const MidiEventAt& e) {
-  std::scoped_lock<std::mutex> lock(msgs_mutex_);
+  const TrackId id = e.Track();
 
-  msgs_by_track_[e.Track()].push_back(e);
+  if (id < 0 || id >= num_track_ids_.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  if (!midi_queues_[id]->try_enqueue(e)) {
+    LOG(WARNING) << "MIDI queue of track " << id << " is full, dropping event";
+  }
+}
+
+void Engine::DrainMidiEvents(TrackId id, std::vector<MidiEventAt>* events) {
+  auto& queue = midi_queues_[id];
+
+  while (auto e = queue->peek()) {
+    if (events != nullptr) {
+      events->push_back(*e);
+    }
+    queue->pop();
+  }
+}
+
+std::shared_ptr<audio::AudioOutput> Engine::GetAudioOutput() {
+  std::scoped_lock<std::mutex> lock(audio_reload_mutex_);
+  if (!audio_output_enabled_) {
+    return nullptr;
+  }
+  return audio_output_;
+}
+
+bool Engine::WaitNextBlock(absl::Time next_block_at,
+                           std::shared_ptr<audio::AudioOutput>* output,
+                           bool* device_clocked) {
+  *device_clocked = false;
+  *output = GetAudioOutput();
+
+  const absl::Duration block_duration =
+      absl::Microseconds((1e6 * kBlockSize) / kSampleRate);
+
+  // Render a new block as soon as the device made room for it, the
+  // timeout is only there to check regularly if we are stopping or
+  // if the output was reloaded in between.
+  while (clock_ == Clock::DEVICE && *output != nullptr) {
+    const size_t max_frames = (prerender_blocks_ - 1) * kBlockSize;
+    const bool ready = (*output)->WaitForSpace(max_frames, block_duration);
+
+    {
+      std::scoped_lock<std::mutex> lock(mutex_);
+      if (stop_) {
+        return false;
+      }
+      if (ready) {
+        *device_clocked = true;
+        return true;
+      }
+    }
+
+    *output = GetAudioOutput();
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait_until(lock, absl::ToChronoTime(next_block_at),
+                 [this]() { return stop_; });
+
+  return !stop_;
 }
 
 absl::Status Engine::Run() {
   SOIR_TRACING_ZONE_COLOR("dsp::run", SOIR_BLUE);
 
-  LOG(INFO) << "Engine running";
+  LOG(INFO) << "Engine running with "
+            << (clock_ == Clock::DEVICE ? "device" : "wall") << " clock";
+
+  utils::EnterRealtime("DSP engine");
 
-  AudioBuffer buffer(kBlockSize);
   absl::Duration block_duration =
       absl::Microseconds((1e6 * kBlockSize) / kSampleRate);
   absl::Time next_block_at = absl::Now();
   absl::Time initial_time = next_block_at;
   uint64_t block_count = 0;
+  bool device_clocked = false;
+  std::shared_ptr<audio::AudioOutput> output;
 
   while (true) {
     {
       SOIR_TRACING_ZONE_COLOR("dsp::wait", SOIR_BLUE);
 
-      std::unique_lock<std::mutex> lock(mutex_);
-      cv_.wait_until(lock, absl::ToChronoTime(next_block_at),
-                     [this]() { return stop_; });
-      if (stop_) {
+      if (!WaitNextBlock(next_block_at, &output, &device_clocked)) {
         break;
       }
     }
 
-    std::map<std::string, std::list<MidiEventAt>> events;
-    {
-      SOIR_TRACING_ZONE_COLOR("dsp:swap-midi", SOIR_BLUE);
+    RenderBlock();
+    RecordXruns(output);
 
-      std::lock_guard<std::mutex> lock(msgs_mutex_);
-      events.swap(msgs_by_track_);
+    // When paced by the device, keep the wall clock in sync so that
+    // falling back to it (output disabled) doesn't burst rendering
+    // to catch up.
+    if (device_clocked) {
+      initial_time = absl::Now();
+      block_count = 0;
     }
 
-    // Update knobs prior to rendering so it uses up-to-date values.
-    //
-    // This is important as some of the DSP code can be bound to the
-    // knob values which aren't yet created.
-    {
-      SOIR_TRACING_ZONE_COLOR("dsp::controls-update", SOIR_BLUE);
+    block_count++;
+    next_block_at = initial_time + block_count * block_duration;
+
+    SOIR_TRACING_FRAME("dsp::frame");
+  }
+
+  return absl::OkStatus();
+}
+
+void Engine::RenderBlock() {
+  const int64_t start = DurationStats::NowNs();
+
+  {
+    // Nothing in there allocates, consumers are left out as the
+    // recorder grows its file buffer by design.
+    utils::RtScope rt_scope;
+    RenderTracks();
+  }
+
+  current_tick_ += kBlockSize;
 
-      auto evlist = events[std::string(kInternalControls)];
-      SetTicks(evlist);
-      controls_->AddEvents(evlist);
-      controls_->Update(current_tick_);
+  {
+    SOIR_TRACING_ZONE_COLOR("dsp::output", SOIR_BLUE);
+    std::lock_guard<std::mutex> lock(consumers_mutex_);
+    for (auto consumer : consumers_) {
+      auto status = consumer->PushAudioBuffer(buffer_);
+      if (!status.ok()) {
+        LOG(WARNING) << "Failed to push samples to consumer: " << status;
+      }
     }
+  }
+
+  RecordBlockStats(DurationStats::NowNs() - start);
+}
+
+void Engine::RecordBlockStats(int64_t render_ns) {
+  render_stats_.Record(render_ns);
+
+  const float load = static_cast<float>(render_ns) / kBlockDurationNs;
+  const float load_avg = load_avg_.load(std::memory_order_relaxed);
+  load_.store(load, std::memory_order_relaxed);
+  load_avg_.store(load_avg + kLoadAvgAlpha * (load - load_avg),
+                  std::memory_order_relaxed);
+
+  // Offline rendering has no deadline, it goes as fast as it can.
+  if (!offline_ && render_ns > kBlockDurationNs) {
+    deadline_misses_.store(deadline_misses_.load(std::memory_order_relaxed) + 1,
+                           std::memory_order_relaxed);
+  }
+}
+
+void Engine::RecordXruns(const std::shared_ptr<audio::AudioOutput>& output) {
+  if (output != xrun_output_) {
+    xrun_output_ = output;
+    underruns_base_ = underruns_.load(std::memory_order_relaxed);
+    overruns_base_ = overruns_.load(std::memory_order_relaxed);
+  }
+
+  if (output == nullptr) {
+    return;
+  }
+
+  underruns_.store(underruns_base_ + output->Underruns(),
+                   std::memory_order_relaxed);
+  overruns_.store(overruns_base_ + output->Overruns(),
+                  std::memory_order_relaxed);
+}
+
+void Engine::RenderTracks() {
+  // Update knobs prior to rendering so it uses up-to-date values.
+  //
+  // This is important as some of the DSP code can be bound to the
+  // knob values which aren't yet created.
+  {
+    SOIR_TRACING_ZONE_COLOR("dsp::controls-update", SOIR_BLUE);
+
+    DrainMidiEvents(kInternalControlsTrackId, &controls_events_);
+    SetTicks(controls_events_);
+    controls_->TakeEvents(&controls_events_);
+    controls_->Update(current_tick_);
+  }
+
+  {
+    SOIR_TRACING_ZONE_COLOR("dsp::tracks-async-render", SOIR_BLUE);
+
+    // Reset the output buffer before collecting results
+    buffer_.Reset();
 
     {
-      SOIR_TRACING_ZONE_COLOR("dsp::tracks-async-render", SOIR_BLUE);
-
-      // Kick off all track rendering operations in parallel
-      {
-        std::scoped_lock<std::mutex> lock(tracks_mutex_);
-        for (auto& it : tracks_) {
-          auto track = it.second.get();
-          auto evlist = events[track->GetTrackName()];
-          SetTicks(evlist);
-          track->RenderAsync(current_tick_, evlist);
+      // Announce the set we are about to use, and check it's still
+      // the current one so that a publisher waiting for us can't
+      // miss it.
+      const TrackSet* tracks = rt_tracks_.load(std::memory_order_acquire);
+      while (true) {
+        rt_hazard_.store(tracks, std::memory_order_seq_cst);
+        const TrackSet* current = rt_tracks_.load(std::memory_order_seq_cst);
+        if (current == tracks) {
+          break;
+        }
+        tracks = current;
+      }
+
+      // IDs are registered before tracks are published, so all the
+      // tracks of the set have an ID below this bound.
+      const int num_track_ids = num_track_ids_.load(std::memory_order_acquire);
+
+      // Kick off all track rendering operations in parallel.
+      active_jobs_.clear();
+      for (TrackId id = kInternalControlsTrackId + 1; id < num_track_ids;
+           ++id) {
+        auto track = tracks->by_id_[id];
+
+        // The track was removed, drop whatever is left in its queue.
+        if (track == nullptr) {
+          DrainMidiEvents(id, nullptr);
+          continue;
         }
+
+        TrackJob* job = &track_jobs_[id];
+        job->track_ = track;
+        job->tick_ = current_tick_;
+        DrainMidiEvents(id, &job->events_);
+        SetTicks(job->events_);
+        active_jobs_.push_back(job);
       }
 
-      // Reset the output buffer before collecting results
-      buffer.Reset();
+      for (auto job : active_jobs_) {
+        workers_.Submit({&TrackJob::Render, job});
+      }
+      workers_.Wait();
 
       // Join all track rendering operations, order is not important
       // as it's just an addition (TRACK(A) + TRACK(B) = TRACK(B) +
       // TRACK(A)).
-      {
-        SOIR_TRACING_ZONE_COLOR("dsp::tracks-join", SOIR_BLUE);
-        std::scoped_lock<std::mutex> lock(tracks_mutex_);
-        for (auto& it : tracks_) {
-          auto track = it.second.get();
-          track->Join(buffer);
-        }
+      SOIR_TRACING_ZONE_COLOR("dsp::tracks-join", SOIR_BLUE);
+      for (auto job : active_jobs_) {
+        job->track_->Join(buffer_);
       }
 
-      master_meter_.Process(buffer.GetChannel(kLeftChannel),
-                            buffer.GetChannel(kRightChannel), buffer.Size());
+      rt_blocks_.fetch_add(1, std::memory_order_release);
+      rt_hazard_.store(nullptr, std::memory_order_release);
     }
 
-    current_tick_ += kBlockSize;
+    master_meter_.Process(buffer_.GetChannel(kLeftChannel),
+                          buffer_.GetChannel(kRightChannel), buffer_.Size());
+  }
+}
 
-    {
-      SOIR_TRACING_ZONE_COLOR("dsp::output", SOIR_BLUE);
-      std::lock_guard<std::mutex> lock(consumers_mutex_);
-      for (auto consumer : consumers_) {
-        auto status = consumer->PushAudioBuffer(buffer);
-        if (!status.ok()) {
-          LOG(WARNING) << "Failed to push samples to consumer: " << status;
-        }
-      }
-    }
+std::shared_ptr<const Engine::TrackSet> Engine::GetTrackSet() {
+  std::scoped_lock<std::mutex> lock(tracks_mutex_);
+  return tracks_;
+}
 
-    block_count++;
-    next_block_at = initial_time + block_count * block_duration;
+std::shared_ptr<const Engine::TrackSet> Engine::PublishTrackSet(
+    std::shared_ptr<const TrackSet> tracks) {
+  std::shared_ptr<const TrackSet> previous;
+  {
+    std::scoped_lock<std::mutex> lock(tracks_mutex_);
+    previous = tracks_;
+    tracks_ = tracks;
+    rt_tracks_.store(tracks.get(), std::memory_order_seq_cst);
+  }
 
-    SOIR_TRACING_FRAME("dsp::frame");
+  // Grace period: once the DSP thread stopped using the previous
+  // set it can only load the new one, so the previous set (and the
+  // tracks only it holds) can be released outside of the DSP path.
+  // This is at most the rendering of one block.
+  while (rt_hazard_.load(std::memory_order_seq_cst) == previous.get()) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
   }
 
-  return absl::OkStatus();
+  return previous;
 }
 
 absl::Status Engine::GetTracks(std::list<Track::Settings>* response) {
-  std::scoped_lock<std::mutex> lock(tracks_mutex_);
-
-  for (auto& it : tracks_) {
-    auto track = it.second.get();
+  auto tracks = GetTrackSet();
 
-    response->push_back(track->GetSettings());
+  for (auto& it : tracks->settings_) {
+    response->push_back(it.second);
   }
 
   return absl::OkStatus();
@@ -309,72 +652,70 @@ absl::Status Engine::SetupTracks(const std::list<Track::Settings>& settings) {
   // following design described below is not atomic.
   std::scoped_lock<std::mutex> setup_lock(setup_tracks_mutex_);
 
-  // We have here a somewhat complex design: initializing a track can
-  // take time We don't want to block the engine thread for that. So
-  // we take twice the tracks lock: 1st time to know what we have to
-  // do (add new tracks, initialize instruments, initialize effects,
-  // ...), then we prepare everything, and take the lock to update the
-  // tracks with everything pre-loaded.
-
-  // Use maps here to ensure we don't override the same track multiple
-  // times.
-  std::map<std::string, Track::Settings> tracks_to_add;
-  std::map<std::string, Track::Settings> tracks_to_update;
-
-  // Check what we need to do.
-  {
-    std::scoped_lock<std::mutex> lock(tracks_mutex_);
-    for (auto& track_settings : settings) {
-      auto name = track_settings.name_;
-      auto it = tracks_.find(name);
-
-      if (it == tracks_.end() || !it->second->CanFastUpdate(track_settings)) {
-        tracks_to_add[name] = track_settings;
-      } else {
-        tracks_to_update[name] = track_settings;
-      }
+  // Initializing a track can take time and we don't want to block
+  // the engine thread for that. We build a new set of tracks out of
+  // the current one: tracks that can be updated in place are shared
+  // by both sets, others are created and initialized upfront, then
+  // the new set is published at once.
+
+  // Resolve IDs first so that the RT engine can route events to the
+  // new tracks as soon as they are published.
+  std::map<std::string, TrackId> ids;
+  for (auto& track_settings : settings) {
+    auto id = RegisterTrackId(track_settings.name_);
+    if (!id.ok()) {
+      LOG(ERROR) << "Failed to register track: " << id.status();
+      return id.status();
     }
+    ids[track_settings.name_] = *id;
   }
 
-  std::map<std::string, std::unique_ptr<Track>> updated_tracks;
+  auto current = GetTrackSet();
+  auto tracks = std::make_shared<TrackSet>();
+
+  // Use a map here to ensure we don't override the same track
+  // multiple times.
+  std::map<std::string, Track::Settings> tracks_to_update;
 
   // Perform slow operations here.
-  for (auto& track : tracks_to_add) {
-    auto new_track = std::make_unique<Track>();
-    auto status = new_track->Init(track.second, sample_manager_.get(),
-                                  controls_.get(), vst_host_.get());
-    if (!status.ok()) {
-      LOG(ERROR) << "Failed to initialize track: " << status;
-      return status;
+  for (auto& track_settings : settings) {
+    const auto& name = track_settings.name_;
+    auto it = current->tracks_.find(name);
+
+    if (it != current->tracks_.end() &&
+        it->second->CanFastUpdate(track_settings)) {
+      tracks->tracks_[name] = it->second;
+      tracks_to_update[name] = track_settings;
+      continue;
     }
 
-    // Start the track's processing thread
-    status = new_track->Start();
+    auto new_track = std::make_shared<Track>();
+    auto status = new_track->Init(track_settings, sample_manager_.get(),
+                                  controls_.get(), vst_host_.get());
     if (!status.ok()) {
-      LOG(ERROR) << "Failed to start new track thread: " << status;
+      LOG(ERROR) << "Failed to initialize track: " << status;
       return status;
     }
 
-    updated_tracks[track.first] = std::move(new_track);
+    tracks->tracks_[name] = std::move(new_track);
   }
 
-  // Update the layout without holding the lock for too long.
-  {
-    std::scoped_lock<std::mutex> lock(tracks_mutex_);
-    for (auto& track_request : tracks_to_update) {
-      auto name = track_request.first;
-      auto& track = tracks_[name];
-
-      // This can't fail otherwise the design is not atomic, we don't
-      // want partial upgrades to be possible.
-      track->FastUpdate(track_request.second);
-
-      updated_tracks[name] = std::move(track);
-    }
+  // This can't fail otherwise the design is not atomic, we don't
+  // want partial upgrades to be possible. A fast update only
+  // contends with the rendering of the track it updates.
+  for (auto& [name, track_settings] : tracks_to_update) {
+    tracks->tracks_[name]->FastUpdate(track_settings);
+  }
 
-    tracks_.swap(updated_tracks);
+  for (auto& [name, track] : tracks->tracks_) {
+    tracks->settings_[name] = track->GetSettings();
+    tracks->by_id_[ids[name]] = track.get();
   }
 
+  // Removed tracks are released here, along with the previous set.
+  PublishTrackSet(std::move(tracks));
+  RetireTrackIds(ids);
+
   return absl::OkStatus();
 }
 
@@ -383,20 +724,45 @@ SampleManager& Engine::GetSampleManager() { return *sample_manager_; }
 Levels Engine::GetMasterLevels() const { return master_meter_.GetLevels(); }
 
 std::map<std::string, Levels> Engine::GetAllTrackLevels() {
-  std::scoped_lock<std::mutex> lock(tracks_mutex_);
+  auto tracks = GetTrackSet();
   std::map<std::string, Levels> result;
-  for (const auto& it : tracks_) {
+  for (const auto& it : tracks->tracks_) {
     result[it.first] = it.second->GetLevels();
   }
   return result;
 }
 
+DspStats Engine::GetDspStats() {
+  DspStats stats;
+
+  stats.block_us = kBlockDurationNs / 1000.0f;
+  stats.render = render_stats_.Read();
+  stats.load = load_.load(std::memory_order_relaxed);
+  stats.load_avg = load_avg_.load(std::memory_order_relaxed);
+  stats.deadline_misses = deadline_misses_.load(std::memory_order_relaxed);
+  stats.underruns = underruns_.load(std::memory_order_relaxed);
+  stats.overruns = overruns_.load(std::memory_order_relaxed);
+
+  const auto& rt_settings = utils::GetRealtimeSettings();
+  stats.realtime_priority = rt_settings.priority_;
+  stats.realtime_threads = utils::RealtimeThreadCount();
+  stats.cpu_affinity = rt_settings.cpus_;
+  stats.memory_locked = utils::MemoryLocked();
+
+  auto tracks = GetTrackSet();
+  for (const auto& it : tracks->tracks_) {
+    it.second->GetStats(&stats.tracks[it.first]);
+  }
+
+  return stats;
+}
+
 absl::Status Engine::OpenVstFxEditor(const std::string& track_name,
                                      const std::string& fx_name) {
-  std::scoped_lock<std::mutex> lock(tracks_mutex_);
+  auto tracks = GetTrackSet();
 
-  auto it = tracks_.find(track_name);
-  if (it == tracks_.end()) {
+  auto it = tracks->tracks_.find(track_name);
+  if (it == tracks->tracks_.end()) {
     return absl::NotFoundError("Track not found: " + track_name);
   }
 
@@ -405,10 +771,10 @@ absl::Status Engine::OpenVstFxEditor(const std::string& track_name,
 
 absl::Status Engine::CloseVstFxEditor(const std::string& track_name,
                                       const std::string& fx_name) {
-  std::scoped_lock<std::mutex> lock(tracks_mutex_);
+  auto tracks = GetTrackSet();
 
-  auto it = tracks_.find(track_name);
-  if (it == tracks_.end()) {
+  auto it = tracks->tracks_.find(track_name);
+  if (it == tracks->tracks_.end()) {
     return absl::NotFoundError("Track not found: " + track_name);
   }
 
@@ -416,10 +782,10 @@ absl::Status Engine::CloseVstFxEditor(const std::string& track_name,
 }
 
 absl::Status Engine::OpenVstInstEditor(const std::string& track_name) {
-  std::scoped_lock<std::mutex> lock(tracks_mutex_);
+  auto tracks = GetTrackSet();
 
-  auto it = tracks_.find(track_name);
-  if (it == tracks_.end()) {
+  auto it = tracks->tracks_.find(track_name);
+  if (it == tracks->tracks_.end()) {
     return absl::NotFoundError("Track not found: " + track_name);
   }
 
@@ -427,10 +793,10 @@ absl::Status Engine::OpenVstInstEditor(const std::string& track_name) {
 }
 
 absl::Status Engine::CloseVstInstEditor(const std::string& track_name) {
-  std::scoped_lock<std::mutex> lock(tracks_mutex_);
+  auto tracks = GetTrackSet();
 
-  auto it = tracks_.find(track_name);
-  if (it == tracks_.end()) {
+  auto it = tracks->tracks_.find(track_name);
+  if (it == tracks->tracks_.end()) {
     return absl::NotFoundError("Track not found: " + track_name);
   }
 
@@ -479,6 +845,10 @@ absl::Status Engine::SetAudioOutput(const std::string& device) {
       LOG(WARNING) << "Failed to stop audio output during reload: "
                    << stop_status;
     }
+
+    // Until the new device is up, the engine falls back to the wall
+    // clock.
+    audio_output_enabled_ = false;
   }
 
   if (device == "none") {
@@ -490,7 +860,7 @@ absl::Status Engine::SetAudioOutput(const std::string& device) {
   // "default" means let miniaudio pick; pass "" to signal that.
   const std::string miniaudio_device = (device == "default") ? "" : device;
 
-  audio_output_ = std::make_unique<audio::AudioOutput>();
+  audio_output_ = std::make_shared<audio::AudioOutput>();
 
   auto status = audio_output_->Init(kSampleRate, kNumChannels, kBlockSize,
                                     miniaudio_device);
@@ -1,21 +1,29 @@
 #pragma once
 
 #include <absl/status/status.h>
+#include <absl/status/statusor.h>
+#include <readerwriterqueue.h>
 
+#include <array>
+#include <atomic>
 #include <condition_variable>
 #include <list>
 #include <map>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "audio/audio_output.hh"
 #include "audio/audio_recorder.hh"
 #include "audio/pcm_stream.hh"
 #include "core/common.hh"
 #include "core/controls.hh"
+#include "core/dsp_stats.hh"
 #include "core/level_meter.hh"
 #include "core/sample_manager.hh"
+#include "core/time_source.hh"
 #include "core/track.hh"
+#include "core/worker_pool.hh"
 #include "utils/config.hh"
 
 namespace soir {
@@ -23,12 +31,21 @@ namespace vst {
 class VstHost;
 }  // namespace vst
 
-// First implementation is stupid and does not take
-// into account lag. The timing precision of MIDI
-// events is capped to a block size, we'll late see
-// how to achieve intra-block precision
+// Renders blocks of audio out of the tracks. MIDI events are
+// sample-accurate: each track keeps events until the block they
+// are due in, and instruments render in spans between events.
 class Engine {
  public:
+  // Clock pacing the rendering of blocks:
+  //
+  // - DEVICE: the audio device is the master clock, a block is
+  //   rendered each time the device consumed one so that at most
+  //   dsp.prerender_blocks are queued, latency is bounded and the
+  //   engine never drifts from the device,
+  // - WALL: blocks are rendered on the system clock, this is used
+  //   when the audio output is disabled.
+  enum class Clock { DEVICE, WALL };
+
   Engine();
   ~Engine();
 
@@ -36,8 +53,32 @@ class Engine {
   absl::Status Start();
   absl::Status Stop();
 
+  // Offline rendering: only the DSP workers are started, there is no
+  // engine thread nor audio output. The caller renders blocks back
+  // to back with RenderBlock() as fast as the CPU allows, time being
+  // provided by the given source (usually a virtual one advanced by
+  // the caller). The engine is stopped as usual with Stop().
+  absl::Status StartOffline(TimeSource* time_source);
+
+  // Renders the next block and pushes it to the consumers, this is
+  // called from the engine thread in real-time mode.
+  void RenderBlock();
+
   void RegisterConsumer(SampleConsumer* consumer);
   void RemoveConsumer(SampleConsumer* consumer);
+
+  // Returns the ID of a track previously registered by SetupTracks
+  // (or the internal controls track). This takes a lock so callers
+  // are expected to cache the result as long as GetTrackIdsVersion
+  // doesn't change, IDs of removed tracks are reused.
+  absl::StatusOr<TrackId> GetTrackId(const std::string& name);
+
+  // Changes each time tracks are removed, without locking.
+  uint64_t GetTrackIdsVersion() const;
+
+  // Queues a MIDI event for the track of the event without locking
+  // nor allocating. This must always be called from the same thread
+  // (the RT engine), each track queue has a single producer.
   void PushMidiEvent(const MidiEventAt& event);
 
   absl::Status SetupTracks(const std::list<Track::Settings>& settings);
@@ -46,11 +87,17 @@ class Engine {
   Controls* GetControls();
   vst::VstHost* GetVstHost();
 
+  // The sample manager exists before Init() so that it can be set up
+  // before packs are loaded.
   SampleManager& GetSampleManager();
 
   Levels GetMasterLevels() const;
   std::map<std::string, Levels> GetAllTrackLevels();
 
+  // Rendering statistics, this can be called from any thread while
+  // the engine is running.
+  DspStats GetDspStats();
+
   absl::Status OpenVstFxEditor(const std::string& track_name,
                                const std::string& fx_name);
   absl::Status CloseVstFxEditor(const std::string& track_name,
@@ -69,13 +116,59 @@ class Engine {
 
  private:
   absl::Status Run();
-  void SetTicks(std::list<MidiEventAt>& events);
 
-  // Helper to print some statistics about CPU usage.
-  void Stats(const absl::Time& next_block_at,
-             const absl::Duration& block_duration) const;
+  // Updates the controls and renders all the tracks of the current
+  // block into buffer_, this runs without allocating.
+  void RenderTracks();
+
+  void SetTicks(std::vector<MidiEventAt>& events);
+
+  // Returns the audio output if it is enabled, the reference is taken
+  // under audio_reload_mutex_ which is released right away.
+  std::shared_ptr<audio::AudioOutput> GetAudioOutput();
+
+  // Blocks until the next block has to be rendered, device_clocked
+  // is set if the audio device paced the block. Output is set to the
+  // audio output in use, if any. Returns false if the engine is
+  // stopping.
+  bool WaitNextBlock(absl::Time next_block_at,
+                     std::shared_ptr<audio::AudioOutput>* output,
+                     bool* device_clocked);
+
+  using MidiQueue = moodycamel::ReaderWriterQueue<MidiEventAt>;
+
+  absl::StatusOr<TrackId> RegisterTrackId(const std::string& name);
+  void RetireTrackIds(const std::map<std::string, TrackId>& ids);
+  void DrainMidiEvents(TrackId id, std::vector<MidiEventAt>* events);
+
+  // Render job of a track for the current block, submitted to the
+  // DSP workers. Jobs are indexed by track ID and their storage is
+  // reserved when the ID is registered, so that the render path
+  // doesn't allocate.
+  struct TrackJob {
+    Track* track_ = nullptr;
+    SampleTick tick_ = 0;
+    std::vector<MidiEventAt> events_;
+
+    static void Render(void* job);
+  };
+
+  // Records how long the current block took to render, compared to
+  // the duration of a block.
+  void RecordBlockStats(int64_t render_ns);
+
+  // Publishes the xruns of the audio output in use, this is called
+  // from the engine thread after each block.
+  void RecordXruns(const std::shared_ptr<audio::AudioOutput>& output);
 
   SampleTick current_tick_;
+  TimeSource* time_source_ = GetSystemTimeSource();
+  bool offline_ = false;
+  AudioBuffer buffer_;
+
+  // Declared before the tracks so that it outlives the samplers, which
+  // pin the samples they play.
+  std::unique_ptr<SampleManager> sample_manager_;
 
   // The main thread of the DSP engine, processes blocks of audio
   // samples in an infinite loop.
@@ -87,29 +180,98 @@ class Engine {
   // Consumers can be registered at start if the audio output is
   // enabled. They are fed with audio samples from the DSP engine.
   std::mutex consumers_mutex_;
+  Clock clock_ = Clock::DEVICE;
+  int prerender_blocks_ = kDefaultPrerenderBlocks;
   bool audio_output_enabled_ = false;
   std::string audio_output_device_;
+  // Guards the output and whether it is enabled. The output is shared
+  // so that the engine thread can wait on the device without holding
+  // the lock, a reloaded output stays alive until it is done with it.
   std::mutex audio_reload_mutex_;
-  std::unique_ptr<audio::AudioOutput> audio_output_;
+  std::shared_ptr<audio::AudioOutput> audio_output_;
   std::unique_ptr<AudioRecorder> audio_recorder_;
   std::unique_ptr<audio::PcmStream> pcm_stream_;
   std::list<SampleConsumer*> consumers_;
 
-  // Tracks are created/updated by the Runtime engine, and locked
-  // during the processing of a block.
+  // Immutable set of tracks. A track is shared by all the sets it
+  // belongs to (it is kept across fast updates) and destroyed with
+  // the last of them, never on the DSP thread.
+  struct TrackSet {
+    std::map<std::string, std::shared_ptr<Track>> tracks_;
+    std::map<std::string, Track::Settings> settings_;
+    std::array<Track*, kMaxTracks> by_id_ = {};
+  };
+
+  // Returns the current set of tracks, for readers outside of the
+  // DSP path.
+  std::shared_ptr<const TrackSet> GetTrackSet();
+
+  // Publishes a new set of tracks and waits until the DSP thread is
+  // done with the previous one, which is returned. Publishers must
+  // hold setup_tracks_mutex_.
+  std::shared_ptr<const TrackSet> PublishTrackSet(
+      std::shared_ptr<const TrackSet> tracks);
+
+  // Tracks are created/updated by the Runtime engine, which builds
+  // a new set and swaps it in (RCU-style): the DSP thread loads the
+  // set through rt_tracks_ and announces it uses it in rt_hazard_,
+  // so that it never takes a lock to iterate tracks. Other readers
+  // copy tracks_ under tracks_mutex_, which the DSP never takes.
   std::mutex setup_tracks_mutex_;
   std::mutex tracks_mutex_;
-  std::map<std::string, std::unique_ptr<Track>> tracks_;
+  std::shared_ptr<const TrackSet> tracks_;
+  std::atomic<const TrackSet*> rt_tracks_ = nullptr;
+  std::atomic<const TrackSet*> rt_hazard_ = nullptr;
   std::unique_ptr<Controls> controls_;
 
+  // Tracks are rendered in parallel by a fixed pool of workers, the
+  // number of workers is configurable via dsp.workers.
+  int num_workers_ = 0;
+  bool pin_workers_ = true;
+  WorkerPool workers_;
+  std::array<TrackJob, kMaxTracks> track_jobs_;
+  std::vector<TrackJob*> active_jobs_;
+
   // MIDI events are pushed by the RT engine and consumed by the DSP
-  // engine upon each block processing at the beginning.
-  std::mutex msgs_mutex_;
-  std::map<std::string, std::list<MidiEventAt>> msgs_by_track_;
+  // engine upon each block processing at the beginning. Each track
+  // ID owns a SPSC queue created when the ID is registered, queues
+  // are never released before the engine so the DSP thread only
+  // needs to know how many IDs are published.
+  std::mutex track_ids_mutex_;
+  std::map<std::string, TrackId> track_ids_;
+  std::array<std::unique_ptr<MidiQueue>, kMaxTracks> midi_queues_;
+  std::atomic<int> num_track_ids_ = 0;
+  std::atomic<uint64_t> track_ids_version_ = 0;
+
+  // IDs of removed tracks are retired once the set without them is
+  // published, they are reused after the DSP thread completed a
+  // block with that set (or a later one) which dropped the events
+  // left in their queue. rt_blocks_ counts the completed blocks.
+  struct RetiredTrackId {
+    TrackId id_;
+    uint64_t block_;
+  };
+  std::vector<RetiredTrackId> retired_track_ids_;
+  std::atomic<uint64_t> rt_blocks_ = 0;
+  std::vector<MidiEventAt> controls_events_;
 
-  std::unique_ptr<SampleManager> sample_manager_;
   std::unique_ptr<vst::VstHost> vst_host_;
   LevelMeter master_meter_;
+
+  // Written by the thread rendering blocks only, without locks.
+  DurationStats render_stats_;
+  std::atomic<float> load_ = 0.0f;
+  std::atomic<float> load_avg_ = 0.0f;
+  std::atomic<uint64_t> deadline_misses_ = 0;
+
+  // Xruns of all the outputs used so far, readable without taking
+  // audio_reload_mutex_. The counters of an output start from zero,
+  // the ones of the outputs it replaced are kept in the bases.
+  std::atomic<uint64_t> underruns_ = 0;
+  std::atomic<uint64_t> overruns_ = 0;
+  std::shared_ptr<audio::AudioOutput> xrun_output_;
+  uint64_t underruns_base_ = 0;
+  uint64_t overruns_base_ = 0;
 };
 
 }  // namespace soir
@@ -2,6 +2,10 @@
 
 #include <absl/time/clock.h>
 
+#include <array>
+#include <cstdint>
+#include <cstring>
+
 #include <libremidi/libremidi.hpp>
 
 #include "core/common.hh"
@@ -10,25 +14,58 @@ namespace soir {
 
 // Goal of this class is to store a midi event with a timestamp and
 // map it to a tick on the rendering side.
+//
+// The bytes of the message are stored inline so that events can be
+// copied through the queues of the DSP threads without allocating,
+// messages larger than kMaxMidiEventSize are stored empty.
 class MidiEventAt {
  public:
-  MidiEventAt(const std::string& track, const libremidi::message& msg,
-              absl::Time at)
-      : track_(track), msg_(msg), at_(at), tick_(0) {}
+  MidiEventAt(TrackId track, const libremidi::message& msg, absl::Time at)
+      : MidiEventAt(track, msg.bytes.data(), msg.bytes.size(), at) {}
+
+  MidiEventAt(TrackId track, const uint8_t* bytes, size_t size, absl::Time at)
+      : track_(track), at_(at), tick_(0) {
+    if (size <= kMaxMidiEventSize) {
+      std::memcpy(bytes_.data(), bytes, size);
+      size_ = size;
+    }
+  }
 
-  const std::string& Track() const { return track_; }
-  const libremidi::message& Msg() const { return msg_; }
+  TrackId Track() const { return track_; }
+  const uint8_t* Bytes() const { return bytes_.data(); }
+  size_t Size() const { return size_; }
   const absl::Time At() const { return at_; }
   void SetTick(SampleTick tick) { tick_ = tick; }
   SampleTick Tick() const { return tick_; }
 
+  // Same as libremidi::message::get_message_type.
+  libremidi::message_type Type() const {
+    if (size_ == 0) {
+      return libremidi::message_type::INVALID;
+    }
+    if (bytes_[0] >= 0xF0) {
+      return static_cast<libremidi::message_type>(bytes_[0]);
+    }
+    return static_cast<libremidi::message_type>(bytes_[0] & 0xF0);
+  }
+
+  // Same as libremidi::message::get_channel, from 1 to 16 or 0 if
+  // this isn't a channel message.
+  int Channel() const {
+    if (size_ == 0 || bytes_[0] >= 0xF0) {
+      return 0;
+    }
+    return (bytes_[0] & 0x0F) + 1;
+  }
+
  private:
-  // Track name of the event, this is used to route the event to the
+  // Track ID of the event, this is used to route the event to the
   // correct track in the DSP. A track can control multiple MIDI
   // channels and is independent.
-  std::string track_;
+  TrackId track_;
 
-  libremidi::message msg_;
+  std::array<uint8_t, kMaxMidiEventSize> bytes_;
+  size_t size_ = 0;
 
   // This is set in a first time at the creation of the event, the
   // goal is to have something as close as possible as the live coding
@@ -2,29 +2,104 @@
 
 #include <absl/log/log.h>
 
+#include <algorithm>
+#include <utility>
+
 namespace soir {
 
+void MidiBlock::Reset(SampleTick start) {
+  start_ = start;
+  events_.clear();
+}
+
+void MidiBlock::Push(MidiEventAt event) {
+  events_.push_back(std::move(event));
+}
+
+void MidiBlock::Reserve(size_t capacity) { events_.reserve(capacity); }
+
+SampleTick MidiBlock::Start() const { return start_; }
+
+size_t MidiBlock::Size() const { return events_.size(); }
+
+bool MidiBlock::Empty() const { return events_.empty(); }
+
+const MidiEventAt& MidiBlock::At(size_t i) const { return events_[i]; }
+
+int MidiBlock::Offset(size_t i) const {
+  const SampleTick tick = events_[i].Tick();
+
+  if (tick <= start_) {
+    return 0;
+  }
+
+  return static_cast<int>(tick - start_);
+}
+
+std::vector<MidiEventAt>::const_iterator MidiBlock::begin() const {
+  return events_.begin();
+}
+
+std::vector<MidiEventAt>::const_iterator MidiBlock::end() const {
+  return events_.end();
+}
+
 MidiStack::MidiStack() {}
 
+void MidiStack::Insert(MidiEventAt event) {
+  auto it = std::upper_bound(sorted_events_.begin(), sorted_events_.end(),
+                             event.Tick(),
+                             [](SampleTick tick, const MidiEventAt& e) {
+                               return tick < e.Tick();
+                             });
+
+  sorted_events_.insert(it, std::move(event));
+}
+
 void MidiStack::AddEvents(const std::list<MidiEventAt>& events) {
-  for (auto event : events) {
-    auto it = sorted_events_.begin();
+  for (const auto& event : events) {
+    Insert(event);
+  }
+}
 
-    while (it != sorted_events_.end() && it->Tick() < event.Tick()) {
-      ++it;
-    }
+void MidiStack::AddEvents(const std::vector<MidiEventAt>& events) {
+  for (const auto& event : events) {
+    Insert(event);
+  }
+}
 
-    sorted_events_.insert(it, event);
+void MidiStack::TakeEvents(std::vector<MidiEventAt>* events) {
+  for (auto& event : *events) {
+    Insert(std::move(event));
   }
+
+  events->clear();
 }
 
+void MidiStack::Reserve(size_t capacity) { sorted_events_.reserve(capacity); }
+
 void MidiStack::EventsAtTick(SampleTick sample,
                              std::list<MidiEventAt>& events) {
   auto it = sorted_events_.begin();
   while (it != sorted_events_.end() && it->Tick() <= sample) {
     events.push_back(*it);
-    it = sorted_events_.erase(it);
+    ++it;
+  }
+
+  sorted_events_.erase(sorted_events_.begin(), it);
+}
+
+void MidiStack::PopBlock(SampleTick start, SampleTick size,
+                         MidiBlock* block) {
+  block->Reset(start);
+
+  auto it = sorted_events_.begin();
+  while (it != sorted_events_.end() && it->Tick() < start + size) {
+    block->Push(std::move(*it));
+    ++it;
   }
+
+  sorted_events_.erase(sorted_events_.begin(), it);
 }
 
 }  // namespace soir
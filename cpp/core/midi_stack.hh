@@ -1,21 +1,67 @@
 #pragma once
 
 #include <list>
+#include <vector>
 
 #include "core/common.hh"
 #include "core/midi_event.hh"
 
 namespace soir {
 
+// Events due in a block, sorted by tick. Instruments walk this flat
+// array and render contiguous spans of samples in between events so
+// that events are sample-accurate without polling on each sample.
+class MidiBlock {
+ public:
+  void Reset(SampleTick start);
+  void Push(MidiEventAt event);
+
+  // Preallocates room for the given number of events, so that
+  // blocks with fewer events don't allocate.
+  void Reserve(size_t capacity);
+
+  SampleTick Start() const;
+  size_t Size() const;
+  bool Empty() const;
+  const MidiEventAt& At(size_t i) const;
+
+  // Offset of the i-th event from the start of the block, events
+  // which are late are due at the beginning of the block.
+  int Offset(size_t i) const;
+
+  std::vector<MidiEventAt>::const_iterator begin() const;
+  std::vector<MidiEventAt>::const_iterator end() const;
+
+ private:
+  SampleTick start_ = 0;
+  std::vector<MidiEventAt> events_;
+};
+
 class MidiStack {
  public:
   MidiStack();
 
   void AddEvents(const std::list<MidiEventAt>& events);
+  void AddEvents(const std::vector<MidiEventAt>& events);
   void EventsAtTick(SampleTick sample, std::list<MidiEventAt>& events);
 
+  // Moves the events to the stack and clears the vector, its storage
+  // can then be reused. This doesn't allocate as long as the stack
+  // has room for the events (see Reserve).
+  void TakeEvents(std::vector<MidiEventAt>* events);
+
+  // Preallocates room for the given number of pending events.
+  void Reserve(size_t capacity);
+
+  // Moves all the events due before start + size to the block.
+  void PopBlock(SampleTick start, SampleTick size, MidiBlock* block);
+
  private:
-  std::list<MidiEventAt> sorted_events_;
+  void Insert(MidiEventAt event);
+
+  // Sorted by tick, events with the same tick are kept in the order
+  // they were added.
+  std::vector<MidiEventAt> sorted_events_;
 };
 
 }  // namespace soir
@@ -1,27 +1,212 @@
 #include "core/midi_sysex.hh"
 
+#include <cstring>
+
 namespace soir {
 
+namespace {
+
+// Fields are copied byte-wise, this assumes a little-endian host like
+// all the platforms we support.
+template <typename T>
+void Write(std::string* out, T v) {
+  out->append(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template <typename T>
+T Read(const uint8_t** data) {
+  T v;
+  std::memcpy(&v, *data, sizeof(T));
+  *data += sizeof(T);
+  return v;
+}
+
+void WriteParameter(std::string* out, const SysexParameter& p) {
+  Write(out, p.control_);
+  Write(out, p.value_);
+}
+
+SysexParameter ReadParameter(const uint8_t** data) {
+  SysexParameter p;
+  p.control_ = Read<int32_t>(data);
+  p.value_ = Read<float>(data);
+  return p;
+}
+
+}  // namespace
+
 bool MidiSysexInstruction::ParseFromBytes(const uint8_t* data, size_t size) {
-  if (size < 1) {
+  if (size < 2) {
     return false;
   }
 
   type = static_cast<MidiSysexType>(data[0]);
-
-  if (size > 1) {
-    json_payload =
-        std::string(reinterpret_cast<const char*>(data + 1), size - 1);
+  if (data[1] != kMidiSysexVersion) {
+    return false;
   }
 
+  payload = data + 2;
+  payload_size = size - 2;
+
   return true;
 }
 
-std::string MidiSysexInstruction::SerializeToBytes() const {
+std::string MidiSysexInstruction::Serialize(MidiSysexType type,
+                                            const std::string& payload) {
   std::string result;
+  result.reserve(2 + payload.size());
   result.push_back(static_cast<char>(type));
-  result += json_payload;
+  result.push_back(static_cast<char>(kMidiSysexVersion));
+  result += payload;
   return result;
 }
 
+std::string SamplerPlayPayload::Encode() const {
+  std::string out;
+  out.reserve(kSize);
+
+  Write(&out, sample_);
+  Write(&out, start_);
+  Write(&out, end_);
+  Write(&out, rate_);
+  Write(&out, attack_);
+  Write(&out, decay_);
+  Write(&out, level_);
+  Write(&out, release_);
+  WriteParameter(&out, pan_);
+  WriteParameter(&out, amp_);
+  Write(&out, voices_);
+  Write(&out, choke_);
+
+  return out;
+}
+
+bool SamplerPlayPayload::Decode(const uint8_t* data, size_t size) {
+  if (size != kSize) {
+    return false;
+  }
+
+  sample_ = Read<int32_t>(&data);
+  start_ = Read<float>(&data);
+  end_ = Read<float>(&data);
+  rate_ = Read<float>(&data);
+  attack_ = Read<float>(&data);
+  decay_ = Read<float>(&data);
+  level_ = Read<float>(&data);
+  release_ = Read<float>(&data);
+  pan_ = ReadParameter(&data);
+  amp_ = ReadParameter(&data);
+  voices_ = Read<int32_t>(&data);
+  choke_ = Read<int32_t>(&data);
+
+  return true;
+}
+
+std::string SamplerStopPayload::Encode() const {
+  std::string out;
+  Write(&out, sample_);
+  return out;
+}
+
+bool SamplerStopPayload::Decode(const uint8_t* data, size_t size) {
+  if (size != kSize) {
+    return false;
+  }
+
+  sample_ = Read<int32_t>(&data);
+
+  return true;
+}
+
+std::string ControlModulatorPayload::Encode() const {
+  std::string out;
+  out.reserve(kSize);
+
+  Write(&out, control_);
+  Write(&out, generation_);
+  Write(&out, type_);
+  Write(&out, shape_);
+  Write(&out, sync_);
+  Write(&out, retrigger_);
+  Write(&out, rate_);
+  Write(&out, phase_);
+  Write(&out, low_);
+  Write(&out, high_);
+  Write(&out, start_);
+  Write(&out, end_);
+  Write(&out, duration_);
+  Write(&out, attack_);
+  Write(&out, decay_);
+  Write(&out, sustain_);
+  Write(&out, release_);
+  Write(&out, gate_);
+
+  return out;
+}
+
+bool ControlModulatorPayload::Decode(const uint8_t* data, size_t size) {
+  if (size != kSize) {
+    return false;
+  }
+
+  control_ = Read<int32_t>(&data);
+  generation_ = Read<uint32_t>(&data);
+  type_ = Read<int32_t>(&data);
+  shape_ = Read<int32_t>(&data);
+  sync_ = Read<int32_t>(&data);
+  retrigger_ = Read<int32_t>(&data);
+  rate_ = Read<float>(&data);
+  phase_ = Read<float>(&data);
+  low_ = Read<float>(&data);
+  high_ = Read<float>(&data);
+  start_ = Read<float>(&data);
+  end_ = Read<float>(&data);
+  duration_ = Read<float>(&data);
+  attack_ = Read<float>(&data);
+  decay_ = Read<float>(&data);
+  sustain_ = Read<float>(&data);
+  release_ = Read<float>(&data);
+  gate_ = Read<float>(&data);
+
+  return true;
+}
+
+std::string ControlsUpdatePayload::Encode(const std::vector<Pair>& pairs) {
+  std::string out;
+  out.reserve(kHeaderSize + pairs.size() * kPairSize);
+
+  Write(&out, static_cast<uint32_t>(pairs.size()));
+  for (const auto& pair : pairs) {
+    Write(&out, pair.control_);
+    Write(&out, pair.generation_);
+    Write(&out, pair.value_);
+  }
+
+  return out;
+}
+
+bool ControlsUpdatePayload::Decode(const uint8_t* data, size_t size) {
+  if (size < kHeaderSize) {
+    return false;
+  }
+
+  const uint32_t count = Read<uint32_t>(&data);
+  if (size != kHeaderSize + count * kPairSize) {
+    return false;
+  }
+
+  data_ = data;
+  size_ = count;
+
+  return true;
+}
+
+void ControlsUpdatePayload::Get(uint32_t i, Pair* pair) const {
+  const uint8_t* data = data_ + i * kPairSize;
+
+  pair->control_ = Read<int32_t>(&data);
+  pair->generation_ = Read<uint32_t>(&data);
+  pair->value_ = Read<float>(&data);
+}
+
 }  // namespace soir
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "core/common.hh"
 
 namespace soir {
 
@@ -10,14 +15,138 @@ enum class MidiSysexType : uint8_t {
   UPDATE_CONTROLS = 1,
   SAMPLER_PLAY = 2,
   SAMPLER_STOP = 3,
+  CONTROL_MODULATOR = 4,
 };
 
+// Version of the binary layout of the payloads below, it has to be
+// bumped on any change and kept in sync with the Python encoders in
+// soir/rt/_helpers.py.
+static constexpr uint8_t kMidiSysexVersion = 2;
+
+// Internal sysex instruction: a type, a version and a payload whose
+// fixed binary layout depends on the type. Payloads are decoded in
+// place so that the DSP threads never allocate nor parse text.
+//
+// All fields are encoded in little-endian byte order.
 struct MidiSysexInstruction {
   MidiSysexType type = MidiSysexType::UNKNOWN;
-  std::string json_payload;
 
+  // Points into the parsed bytes, which must outlive the instruction.
+  const uint8_t* payload = nullptr;
+  size_t payload_size = 0;
+
+  // Fails if the version doesn't match kMidiSysexVersion.
   bool ParseFromBytes(const uint8_t* data, size_t size);
-  std::string SerializeToBytes() const;
+
+  // Returns the bytes of an instruction, without the leading sysex
+  // status byte.
+  static std::string Serialize(MidiSysexType type, const std::string& payload);
+};
+
+// Reference to a parameter: a control if control_ is set, or else a
+// constant value.
+struct SysexParameter {
+  int32_t control_ = -1;
+  float value_ = 0.0f;
+};
+
+// Payload of SAMPLER_PLAY, see Sampler::PlaySampleParameters.
+struct SamplerPlayPayload {
+  // Handle from SampleManager::GetSampleHandle.
+  int32_t sample_ = -1;
+
+  float start_ = 0.0f;
+  float end_ = 1.0f;
+  float rate_ = 1.0f;
+  float attack_ = 0.0f;
+  float decay_ = 0.0f;
+  float level_ = 1.0f;
+  float release_ = 0.0f;
+  SysexParameter pan_ = {-1, 0.0f};
+  SysexParameter amp_ = {-1, 1.0f};
+  int32_t voices_ = 0;
+  int32_t choke_ = 0;
+
+  static constexpr size_t kSize = 56;
+
+  std::string Encode() const;
+  bool Decode(const uint8_t* data, size_t size);
+};
+
+// Payload of SAMPLER_STOP.
+struct SamplerStopPayload {
+  int32_t sample_ = -1;
+
+  static constexpr size_t kSize = 4;
+
+  std::string Encode() const;
+  bool Decode(const uint8_t* data, size_t size);
+};
+
+// Payload of CONTROL_MODULATOR, see Modulator. Fields which don't
+// apply to the type of modulator are ignored.
+struct ControlModulatorPayload {
+  int32_t control_ = -1;
+  // Generation of the control the modulator is meant for, see
+  // Controls::GetGeneration.
+  uint32_t generation_ = 0;
+  int32_t type_ = 0;
+  // dsp::LFO::Type of LFOs.
+  int32_t shape_ = 0;
+  // Times and rates are in beats instead of seconds if set.
+  int32_t sync_ = 0;
+  // Restarts the modulator even if it was already of this type.
+  int32_t retrigger_ = 1;
+  float rate_ = 0.0f;
+  float phase_ = 0.0f;
+  float low_ = 0.0f;
+  float high_ = 1.0f;
+  float start_ = 0.0f;
+  float end_ = 0.0f;
+  float duration_ = 0.0f;
+  float attack_ = 0.0f;
+  float decay_ = 0.0f;
+  float sustain_ = 1.0f;
+  float release_ = 0.0f;
+  float gate_ = 0.0f;
+
+  static constexpr size_t kSize = 72;
+
+  std::string Encode() const;
+  bool Decode(const uint8_t* data, size_t size);
+};
+
+// Payload of UPDATE_CONTROLS: a count followed by as many pairs of
+// control ID, generation and target value. Decoding only validates the
+// size, the pairs are read in place.
+class ControlsUpdatePayload {
+ public:
+  // Generation of the control the value is meant for, see
+  // Controls::GetGeneration.
+  struct Pair {
+    int32_t control_ = -1;
+    uint32_t generation_ = 0;
+    float value_ = 0.0f;
+  };
+
+  static constexpr size_t kHeaderSize = 4;
+  static constexpr size_t kPairSize = 12;
+
+  // Maximum number of pairs that fit in a MIDI event, after the sysex
+  // status byte and the type and version of the instruction. Larger
+  // updates are split over multiple instructions.
+  static constexpr size_t kMaxPairs =
+      (kMaxMidiEventSize - 3 - kHeaderSize) / kPairSize;
+
+  static std::string Encode(const std::vector<Pair>& pairs);
+  bool Decode(const uint8_t* data, size_t size);
+
+  uint32_t Size() const { return size_; }
+  void Get(uint32_t i, Pair* pair) const;
+
+ private:
+  const uint8_t* data_ = nullptr;
+  uint32_t size_ = 0;
 };
 
 }  // namespace soir
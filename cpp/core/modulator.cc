@@ -0,0 +1,132 @@
+#include "core/modulator.hh"
+
+#include <algorithm>
+#include <cmath>
+
+#include "dsp/tools.hh"
+
+namespace soir {
+
+void Modulator::Init(const ControlModulatorPayload& settings) {
+  ModulatorType type = static_cast<ModulatorType>(settings.type_);
+  if (settings.type_ < 0 ||
+      settings.type_ > static_cast<int32_t>(ModulatorType::SAMPLE_HOLD)) {
+    type = ModulatorType::NONE;
+  }
+
+  const bool restart = settings.retrigger_ || type != type_;
+  settings_ = settings;
+  type_ = type;
+
+  if (!restart) {
+    return;
+  }
+
+  position_ = 0.0;
+
+  switch (type_) {
+    case ModulatorType::LFO: {
+      // Phase 0 starts cycles from their middle, rising.
+      float phase = std::fmod(settings_.phase_ + 0.5f, 1.0f);
+      if (phase < 0.0f) {
+        phase += 1.0f;
+      }
+      lfo_.SetPhase(phase);
+      break;
+    }
+
+    case ModulatorType::ENVELOPE:
+      // The note starts on the next block, once the stages are known.
+      adsr_.Reset();
+      triggered_ = true;
+      gated_ = false;
+      break;
+
+    case ModulatorType::SAMPLE_HOLD:
+      // Lehmer generators are stuck at 0, seeds must be odd.
+      random_.Seed(static_cast<uint32_t>(settings_.control_ + 1) * 2654435761u |
+                   1u);
+      step_ = 0;
+      held_ = random_.FBetween(settings_.low_, settings_.high_);
+      break;
+
+    default:
+      break;
+  }
+}
+
+float Modulator::Next(float bpm, float* scratch) {
+  // Units, seconds or beats, per second.
+  const float unit = settings_.sync_ ? bpm / 60.0f : 1.0f;
+  position_ += static_cast<double>(unit) * kBlockSize / kSampleRate;
+
+  switch (type_) {
+    case ModulatorType::LFO: {
+      // The LFO moves by a block at each render.
+      const float rate = std::clamp(settings_.rate_ * unit, 0.0f, kMaxLFORate);
+
+      dsp::LFO::Parameters params;
+      params.type_ = static_cast<dsp::LFO::Type>(
+          std::clamp(settings_.shape_, 0, static_cast<int>(dsp::LFO::SINE)));
+      params.frequency_ = rate * kBlockSize;
+      lfo_.Init(params);
+
+      return Scale(dsp::Unipolar(lfo_.Render()));
+    }
+
+    case ModulatorType::RAMP: {
+      float progress = 1.0f;
+      if (settings_.duration_ > 0.0f) {
+        progress = std::min(
+            static_cast<float>(position_ / settings_.duration_), 1.0f);
+      }
+      return settings_.start_ + (settings_.end_ - settings_.start_) * progress;
+    }
+
+    case ModulatorType::ENVELOPE:
+      // Settings are validated on the Python side.
+      adsr_
+          .Init(ToMs(settings_.attack_, bpm), ToMs(settings_.decay_, bpm),
+                ToMs(settings_.release_, bpm),
+                std::clamp(settings_.sustain_, 0.0f, 1.0f))
+          .IgnoreError();
+
+      if (triggered_) {
+        adsr_.NoteOn();
+        triggered_ = false;
+        gated_ = true;
+      }
+
+      if (gated_ && position_ >= settings_.gate_) {
+        adsr_.NoteOff();
+        gated_ = false;
+      }
+
+      adsr_.Fill(scratch, kBlockSize);
+      return Scale(scratch[kBlockSize - 1]);
+
+    case ModulatorType::SAMPLE_HOLD: {
+      const int64_t step =
+          static_cast<int64_t>(std::floor(position_ * settings_.rate_));
+      if (step != step_) {
+        step_ = step;
+        held_ = random_.FBetween(settings_.low_, settings_.high_);
+      }
+      return held_;
+    }
+
+    default:
+      return 0.0f;
+  }
+}
+
+float Modulator::ToMs(float time, float bpm) const {
+  const float seconds = settings_.sync_ ? time * 60.0f / bpm : time;
+  return std::max(seconds, 0.0f) * 1000.0f;
+}
+
+float Modulator::Scale(float unipolar) const {
+  return settings_.low_ + (settings_.high_ - settings_.low_) * unipolar;
+}
+
+}  // namespace soir
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+#include "core/adsr.hh"
+#include "core/common.hh"
+#include "core/midi_sysex.hh"
+#include "dsp/lfo.hh"
+#include "utils/fast_random.hh"
+
+namespace soir {
+
+enum class ModulatorType : int32_t {
+  // The control is updated from Python.
+  NONE = 0,
+  // Oscillates between low and high.
+  LFO = 1,
+  // Goes from start to end over a duration, then holds end.
+  RAMP = 2,
+  // ADSR envelope between low and high, released after gate.
+  ENVELOPE = 3,
+  // Random values between low and high, held for a period of rate.
+  SAMPLE_HOLD = 4,
+};
+
+// Native source of values for a control, defined once from Python and
+// evaluated once per block by Controls instead of being computed by
+// the Python update loop. Times are in seconds and rates in Hz, or in
+// beats and cycles per beat when synced to the tempo.
+//
+// Values are computed at the end of each block, the control ramps to
+// them over the block.
+class Modulator {
+ public:
+  // The modulator restarts unless retrigger_ is unset and it already
+  // was of the same type, in which case only its settings change.
+  void Init(const ControlModulatorPayload& settings);
+
+  bool IsActive() const { return type_ != ModulatorType::NONE; }
+  uint32_t Generation() const { return settings_.generation_; }
+
+  // Moves forward by a block and returns the value at its end, scratch
+  // must hold kBlockSize values.
+  float Next(float bpm, float* scratch);
+
+ private:
+  // Highest rate of an LFO evaluated once per block.
+  static constexpr float kMaxLFORate = kSampleRate / (2.0f * kBlockSize);
+
+  // Converts times in seconds or beats to milliseconds.
+  float ToMs(float time, float bpm) const;
+
+  float Scale(float unipolar) const;
+
+  ControlModulatorPayload settings_;
+  ModulatorType type_ = ModulatorType::NONE;
+
+  // Seconds or beats since the start.
+  double position_ = 0.0;
+
+  dsp::LFO lfo_;
+  ADSR adsr_;
+  bool triggered_ = false;
+  bool gated_ = false;
+  dsp::FastRandom random_;
+  int64_t step_ = 0;
+  float held_ = 0.0f;
+};
+
+}  // namespace soir
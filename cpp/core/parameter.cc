@@ -2,6 +2,9 @@
 
 #include <absl/log/log.h>
 
+#include <algorithm>
+#include <limits>
+
 #include "core/controls.hh"
 
 namespace soir {
@@ -17,25 +20,46 @@ Parameter::Parameter(float constant, float min, float max) {
 
 Parameter::Parameter(float constant) { SetConstant(constant); }
 
-float Parameter::GetValue(SampleTick tick) {
-  if (type_ == Type::KNOB) {
-    if (!knob_) {
-      // Because knob creation happens asynchronously via MIDI events
-      // that are scheduled from the RT thread, there is a possibility
-      // a control is defined in Python but not yet reflected in the
-      // DSP code. We lazily try to get it here, which has a cost
-      // (O(log(n)) but should only happen at worst once, because MIDI
-      // events are processed prior to rendering in the DSP thread.
-      knob_ = controls_->GetControl(controlName_);
-    }
-    if (knob_) {
-      return Clip(knob_->GetValue(tick));
-    }
+Control* Parameter::Resolve() const {
+  if (type_ != Type::KNOB) {
+    return nullptr;
+  }
+
+  return controls_->GetControl(id_, generation_);
+}
+
+float Parameter::GetValue(SampleTick tick) const {
+  Control* knob = Resolve();
+  if (knob) {
+    constant_ = knob->GetValue(tick);
   }
 
   return Clip(constant_);
 }
 
+void Parameter::Fill(SampleTick start, int n, float* out) const {
+  Control* knob = Resolve();
+  if (!knob) {
+    std::fill(out, out + n, Clip(constant_));
+    return;
+  }
+
+  knob->Ramp(start, n, out);
+  if (n > 0) {
+    constant_ = out[n - 1];
+  }
+
+  if (min_.has_value() || max_.has_value()) {
+    const float min = min_.value_or(-std::numeric_limits<float>::infinity());
+    const float max = max_.value_or(std::numeric_limits<float>::infinity());
+    for (int i = 0; i < n; ++i) {
+      out[i] = std::min(std::max(out[i], min), max);
+    }
+  }
+}
+
+bool Parameter::IsConstant() const { return Resolve() == nullptr; }
+
 float Parameter::Clip(float v) const {
   float ret = v;
 
@@ -53,8 +77,10 @@ float Parameter::Clip(float v) const {
 void Parameter::Reset() {
   type_ = Type::CONSTANT;
   constant_ = 0.0f;
-  controlName_.clear();
   controls_ = nullptr;
+  id_ = kInvalidControlId;
+  generation_ = 0;
+  name_.clear();
 }
 
 void Parameter::SetRange(float min, float max) {
@@ -70,23 +96,37 @@ void Parameter::SetConstant(float constant) {
 }
 
 void Parameter::SetControl(Controls* controls, const std::string& name) {
+  SetControl(controls, controls->GetControlId(name));
+  if (type_ == Type::KNOB) {
+    name_ = name;
+  }
+}
+
+void Parameter::SetControl(Controls* controls, ControlId id) {
   Reset();
 
-  knob_ = controls->GetControl(name);
-  type_ = Type::KNOB;
-  controlName_ = name;
-  controls_ = controls;
+  // The generation is read first, a control registered in between
+  // is then seen as replaced.
+  const uint32_t generation = controls->GetGeneration(id);
+  if (controls->GetControl(id)) {
+    type_ = Type::KNOB;
+    controls_ = controls;
+    id_ = id;
+    generation_ = generation;
+    constant_ = controls->GetValue(id);
+  }
 }
 
 Parameter Parameter::FromPyDict(Controls* c, py::dict& p, const char* n) {
   Parameter param;
   py::object ref = p[n];
 
-  // Here we assume the object is a control and has a name attribute. We might
+  // Here we assume the object is a control and has an id attribute. We might
   // want to improve this at some point if we have to handle other types of
   // objects as parameters.
-  if (py::isinstance<py::object>(ref) && py::hasattr(ref, "name_")) {
-    param.SetControl(c, py::getattr(ref, "name_").cast<std::string>());
+  if (py::isinstance<py::object>(ref) && py::hasattr(ref, "id_")) {
+    param.SetControl(
+        c, c->GetControlName(py::getattr(ref, "id_").cast<ControlId>()));
   } else {
     param.SetConstant(ref.cast<float>());
   }
@@ -118,13 +158,15 @@ Parameter Parameter::FromJSON(Controls* c, const nlohmann::json& p,
 }
 
 ParameterRaw Parameter::Raw() const {
-  switch (type_) {
-    case Type::KNOB:
-      return controlName_;
+  if (!name_.empty()) {
+    return name_;
+  }
 
-    default:
-      return Clip(constant_);
+  if (Resolve()) {
+    return controls_->GetControlName(id_);
   }
+
+  return Clip(constant_);
 }
 
 }  // namespace soir
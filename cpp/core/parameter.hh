@@ -4,6 +4,7 @@
 
 #include <nlohmann/json.hpp>
 #include <optional>
+#include <string>
 #include <variant>
 
 #include "core/common.hh"
@@ -25,15 +26,37 @@ using ParameterRaw = std::variant<std::string,  // Name of the control if knob
 // Wrapper around a parameter that can either be controlled by a knob
 // or set directly. This is meant to be initialized in rt bindings'
 // code and used in DSP code to provide smooth interpolated values.
+//
+// Knobs are referred to by the ID and generation of their control, so
+// that parameters are cheap to copy and resolving them is an index in
+// the controls table. A knob whose control was replaced by another one
+// holds the last value it read, and still reports the name of its
+// control if it was bound by name.
 class Parameter {
  public:
   Parameter();
   Parameter(float v);
   Parameter(float v, float min, float max);
 
-  float GetValue(SampleTick tick);
+  float GetValue(SampleTick tick) const;
+
+  // Writes the values of the n ticks from start into out, the control
+  // is only resolved and read once. Renderers fill their parameters
+  // into per-block arrays of kBlockSize values, then read them per
+  // sample.
+  void Fill(SampleTick start, int n, float* out) const;
+
+  // Whether the value doesn't depend on the tick, it can then be read
+  // once per block instead of being filled.
+  bool IsConstant() const;
+
   void SetConstant(float value);
-  void SetControl(Controls* controls, const std::string& value);
+  // A parameter referring to an unknown control is a constant. Not
+  // meant for the DSP threads, the name is kept for Raw().
+  void SetControl(Controls* controls, const std::string& name);
+  // Doesn't allocate nor lock, Raw() then only reports the name of the
+  // control while it's registered.
+  void SetControl(Controls* controls, ControlId id);
   void SetRange(float min, float max);
   ParameterRaw Raw() const;
 
@@ -45,6 +68,10 @@ class Parameter {
   void Reset();
   float Clip(float v) const;
 
+  // Returns the control of a knob, nullptr for constants and knobs
+  // whose control was replaced.
+  Control* Resolve() const;
+
   enum class Type {
     CONSTANT,
     KNOB,
@@ -52,11 +79,14 @@ class Parameter {
 
   Type type_ = Type::CONSTANT;
 
-  float constant_ = 0.0f;
+  // For knobs, the last value read from the control, written by the
+  // thread rendering the parameter.
+  mutable float constant_ = 0.0f;
 
   Controls* controls_ = nullptr;
-  std::string controlName_;
-  std::shared_ptr<Control> knob_ = nullptr;
+  ControlId id_ = kInvalidControlId;
+  uint32_t generation_ = 0;
+  std::string name_;
 
   std::optional<float> min_;
   std::optional<float> max_;
@@ -1,15 +1,216 @@
 #include "core/sample.hh"
 
+#include <absl/strings/str_format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
 #include "core/common.hh"
+#include "utils/realtime.hh"
 
 namespace soir {
 
+namespace {
+
+constexpr float kInt16Scale = 32767.0f;
+constexpr float kInt24Scale = 8388607.0f;
+
+int32_t Quantize(float value, float scale) {
+  return static_cast<int32_t>(
+      std::lrint(std::clamp(value, -1.0f, 1.0f) * scale));
+}
+
+}  // namespace
+
+absl::Status ParseSampleFormat(const std::string& name, SampleFormat* format) {
+  if (name == "float32") {
+    *format = SampleFormat::FLOAT32;
+  } else if (name == "int16") {
+    *format = SampleFormat::INT16;
+  } else if (name == "int24") {
+    *format = SampleFormat::INT24;
+  } else {
+    return absl::InvalidArgumentError(
+        absl::StrFormat("Unknown sample format: %s", name));
+  }
+  return absl::OkStatus();
+}
+
+const char* SampleFormatName(SampleFormat format) {
+  switch (format) {
+    case SampleFormat::INT16:
+      return "int16";
+    case SampleFormat::INT24:
+      return "int24";
+    default:
+      return "float32";
+  }
+}
+
+std::size_t SampleFormatBytes(SampleFormat format) {
+  switch (format) {
+    case SampleFormat::INT16:
+      return 2;
+    case SampleFormat::INT24:
+      return 3;
+    default:
+      return sizeof(float);
+  }
+}
+
+void EncodeSamples(const float* in, std::size_t count, SampleFormat format,
+                   uint8_t* out) {
+  switch (format) {
+    case SampleFormat::INT16:
+      for (std::size_t i = 0; i < count; ++i) {
+        const int16_t v = Quantize(in[i], kInt16Scale);
+        std::memcpy(out + 2 * i, &v, sizeof(v));
+      }
+      break;
+
+    case SampleFormat::INT24:
+      // Packed little-endian.
+      for (std::size_t i = 0; i < count; ++i) {
+        const int32_t v = Quantize(in[i], kInt24Scale);
+        out[3 * i] = v & 0xff;
+        out[3 * i + 1] = (v >> 8) & 0xff;
+        out[3 * i + 2] = (v >> 16) & 0xff;
+      }
+      break;
+
+    default:
+      std::memcpy(out, in, count * sizeof(float));
+      break;
+  }
+}
+
+void DecodeSamples(const uint8_t* in, std::size_t count, SampleFormat format,
+                   float* out) {
+  switch (format) {
+    case SampleFormat::INT16:
+      for (std::size_t i = 0; i < count; ++i) {
+        int16_t v;
+        std::memcpy(&v, in + 2 * i, sizeof(v));
+        out[i] = v * (1.0f / kInt16Scale);
+      }
+      break;
+
+    case SampleFormat::INT24:
+      for (std::size_t i = 0; i < count; ++i) {
+        const uint32_t u = in[3 * i] | (in[3 * i + 1] << 8) |
+                           (static_cast<uint32_t>(in[3 * i + 2]) << 16);
+        // Sign extension of the 24 bits value.
+        const int32_t v = static_cast<int32_t>(u << 8) >> 8;
+        out[i] = v * (1.0f / kInt24Scale);
+      }
+      break;
+
+    default:
+      std::memcpy(out, in, count * sizeof(float));
+      break;
+  }
+}
+
+std::size_t EncodedSize(std::size_t frames, int channels,
+                        SampleFormat format) {
+  return channels * (frames + 2 * kSampleGuardFrames) *
+         SampleFormatBytes(format);
+}
+
+std::vector<uint8_t> EncodeChannels(const std::vector<float>& data,
+                                    int channels, SampleFormat format) {
+  const std::size_t frames = data.size() / channels;
+  const std::size_t bytes = SampleFormatBytes(format);
+  const std::size_t stride = (frames + 2 * kSampleGuardFrames) * bytes;
+
+  // Zeros are silence in all formats.
+  std::vector<uint8_t> encoded(EncodedSize(frames, channels, format), 0);
+  for (int c = 0; c < channels; ++c) {
+    EncodeSamples(data.data() + c * frames, frames, format,
+                  encoded.data() + c * stride + kSampleGuardFrames * bytes);
+  }
+  return encoded;
+}
+
+void Sample::SetData(const std::vector<float>& data, int channels,
+                     SampleFormat format) {
+  mapping_.reset();
+  data_ = EncodeChannels(data, channels, format);
+
+  SetChannels(data_.data(), data.size() / channels, channels, format);
+}
+
+void Sample::SetData(std::unique_ptr<utils::MappedFile> mapping,
+                     const uint8_t* data, std::size_t frames, int channels,
+                     SampleFormat format) {
+  data_.clear();
+  data_.shrink_to_fit();
+  mapping_ = std::move(mapping);
+
+  SetChannels(data, frames, channels, format);
+}
+
+void Sample::ClearData() {
+  lb_ = {};
+  rb_ = {};
+  channels_ = 0;
+  frames_ = 0;
+  channel_data_ = {};
+  data_.clear();
+  data_.shrink_to_fit();
+  mapping_.reset();
+}
+
+std::size_t Sample::MemoryUsage() const {
+  return channels_ ? EncodedSize(frames_, channels_, format_) : 0;
+}
+
+void Sample::Decode(int channel, std::ptrdiff_t from, std::size_t count,
+                    float* out) const {
+  const std::ptrdiff_t bytes = SampleFormatBytes(format_);
+  DecodeSamples(channel_data_[channel] + from * bytes, count, format_, out);
+}
+
+void Sample::Prefault() const {
+  const std::size_t bytes = SampleFormatBytes(format_);
+  for (int c = 0; c < channels_; ++c) {
+    utils::Prefault(channel_data_[c] - kSampleGuardFrames * bytes,
+                    (frames_ + 2 * kSampleGuardFrames) * bytes);
+  }
+}
+
+void Sample::SetChannels(const uint8_t* data, std::size_t frames,
+                         int channels, SampleFormat format) {
+  channels_ = channels > 1 ? 2 : 1;
+  frames_ = frames;
+  format_ = format;
+
+  // Channels point to their first frame, past the guard.
+  const std::size_t bytes = SampleFormatBytes(format);
+  const std::size_t stride = (frames + 2 * kSampleGuardFrames) * bytes;
+  channel_data_[0] = data + kSampleGuardFrames * bytes;
+  channel_data_[1] = channels_ > 1 ? channel_data_[0] + stride
+                                   : channel_data_[0];
+
+  if (format == SampleFormat::FLOAT32) {
+    lb_ = absl::MakeConstSpan(
+        reinterpret_cast<const float*>(channel_data_[0]), frames);
+    rb_ = absl::MakeConstSpan(
+        reinterpret_cast<const float*>(channel_data_[1]), frames);
+  } else {
+    lb_ = {};
+    rb_ = {};
+  }
+}
+
 float Sample::DurationMs(std::size_t samples) const {
   return static_cast<float>(samples) / kSampleRate * 1000.0f;
 }
 
 float Sample::DurationMs() const { return DurationMs(DurationSamples()); }
 
-std::size_t Sample::DurationSamples() const { return lb_.size(); }
+std::size_t Sample::DurationSamples() const { return frames_; }
 
 }  // namespace soir
@@ -1,19 +1,130 @@
 #pragma once
 
+#include <absl/status/status.h>
+#include <absl/types/span.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "utils/mapped_file.hh"
+
 namespace soir {
 
+// Storage format of the data of samples in memory. Integer formats
+// take 2 or 3 bytes per frame and channel instead of 4, samples are
+// then decoded into floats by blocks while they play.
+enum class SampleFormat : uint32_t {
+  FLOAT32 = 0,
+  INT16 = 1,
+  INT24 = 2,
+};
+
+// Parses a format from its name: float32, int16 or int24.
+absl::Status ParseSampleFormat(const std::string& name, SampleFormat* format);
+
+// Name of a format, as parsed by ParseSampleFormat.
+const char* SampleFormatName(SampleFormat format);
+
+// Size of a value of a channel in the given format.
+std::size_t SampleFormatBytes(SampleFormat format);
+
+// Converts count values to or from the given format. Values are
+// clipped to [-1, 1] when stored as integers.
+void EncodeSamples(const float* in, std::size_t count, SampleFormat format,
+                   uint8_t* out);
+void DecodeSamples(const uint8_t* in, std::size_t count, SampleFormat format,
+                   float* out);
+
+// Frames of silence stored before and after each channel of a sample,
+// so that interpolation kernels can read around any position of the
+// sample without bounds checks.
+static constexpr int kSampleGuardFrames = 8;
+
+// Lays out planar data as stored by samples: each channel in the given
+// format surrounded by its guard frames.
+std::vector<uint8_t> EncodeChannels(const std::vector<float>& data,
+                                    int channels, SampleFormat format);
+
+// Size of the data of a sample as laid out by EncodeChannels.
+std::size_t EncodedSize(std::size_t frames, int channels,
+                        SampleFormat format);
+
 struct Sample {
+  Sample() = default;
+  Sample(Sample&&) = default;
+  Sample& operator=(Sample&&) = default;
+
+  // Channels point into the storage of the sample, it can't be
+  // copied.
+  Sample(const Sample&) = delete;
+  Sample& operator=(const Sample&) = delete;
+
   std::string path_;
   std::string name_;
-  std::vector<float> lb_;
-  std::vector<float> rb_;
+
+  // Planar audio data of the left and right channels, both point to
+  // the same data for mono samples. Only set for FLOAT32 samples,
+  // others have to be decoded with Decode(). The guard frames around
+  // the spans can be read.
+  absl::Span<const float> lb_;
+  absl::Span<const float> rb_;
+
+  // Sets planar data owned by the sample, stored in the given format.
+  void SetData(const std::vector<float>& data, int channels,
+               SampleFormat format = SampleFormat::FLOAT32);
+
+  // Sets data from a mapping of the sample cache, data points into the
+  // mapping and is laid out by EncodeChannels in the given format.
+  void SetData(std::unique_ptr<utils::MappedFile> mapping, const uint8_t* data,
+               std::size_t frames, int channels,
+               SampleFormat format = SampleFormat::FLOAT32);
+
+  // Releases the data, the sample is then empty.
+  void ClearData();
+
+  // Whether the data is mapped from the sample cache.
+  bool IsMapped() const { return mapping_ != nullptr; }
+
+  SampleFormat Format() const { return format_; }
+
+  // Decodes count frames of a channel starting at frame from, the
+  // right channel of mono samples is the left one. Frames of the guards
+  // can be decoded, from kSampleGuardFrames before the first frame up
+  // to kSampleGuardFrames after the last one.
+  void Decode(int channel, std::ptrdiff_t from, std::size_t count,
+              float* out) const;
+
+  // Touches all pages of the data so that playing the sample never
+  // faults, the data may be mapped.
+  void Prefault() const;
+
+  // Size of the data of all channels and their guards, in bytes.
+  std::size_t MemoryUsage() const;
+
+  // Number of channels stored, 1 for mono samples whose channels both
+  // point to the same data, 0 when there is no data.
+  int Channels() const { return channels_; }
 
   float DurationMs() const;
   float DurationMs(std::size_t samples) const;
   std::size_t DurationSamples() const;
+
+ private:
+  void SetChannels(const uint8_t* data, std::size_t frames, int channels,
+                   SampleFormat format);
+
+  int channels_ = 0;
+  std::size_t frames_ = 0;
+  SampleFormat format_ = SampleFormat::FLOAT32;
+  std::array<const uint8_t*, 2> channel_data_ = {};
+
+  // Owned data, laid out by EncodeChannels.
+  std::vector<uint8_t> data_;
+  std::unique_ptr<utils::MappedFile> mapping_;
 };
 
 }  // namespace soir
@@ -0,0 +1,265 @@
+#include "core/sample_cache.hh"
+
+#include <AudioFile.h>
+#include <absl/log/log.h>
+#include <absl/strings/str_format.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <utility>
+
+#include "core/common.hh"
+#include "utils/mapped_file.hh"
+
+namespace soir {
+
+namespace {
+
+// Mono samples are duplicated to stereo, we need to reduce the volume
+// to avoid clipping when playing them back.
+constexpr float kMonoToStereoVolume = 0.5f;
+
+// Layout of an entry: the header, the path of the audio file, then
+// the data as laid out by EncodeChannels aligned on a cache line. The
+// version has to be bumped whenever the layout or the decoding
+// changes.
+constexpr char kMagic[8] = {'S', 'O', 'I', 'R', 'S', 'M', 'P', 'L'};
+constexpr uint32_t kVersion = 3;
+constexpr size_t kDataAlignment = 64;
+
+struct EntryHeader {
+  char magic_[8];
+  uint32_t version_;
+  uint32_t channels_;
+  uint32_t format_;
+  uint32_t reserved_;
+  uint64_t frames_;
+  uint64_t size_;
+  int64_t mtime_;
+  uint64_t path_size_;
+};
+
+size_t DataOffset(size_t path_size) {
+  const size_t end = sizeof(EntryHeader) + path_size;
+  return (end + kDataAlignment - 1) / kDataAlignment * kDataAlignment;
+}
+
+// FNV-1a, stable across runs and builds unlike std::hash.
+uint64_t HashPath(const std::string& path) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : path) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+}  // namespace
+
+absl::Status SampleCache::Init(const std::string& directory,
+                               SampleFormat format) {
+  directory_ = directory;
+  format_ = format;
+  if (directory_.empty()) {
+    return absl::OkStatus();
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(directory_, ec);
+  if (ec) {
+    return absl::InternalError("Unable to create sample cache directory " +
+                               directory_ + ": " + ec.message());
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status SampleCache::Load(Sample* sample) {
+  if (directory_.empty()) {
+    std::vector<float> data;
+    int channels;
+    auto status = Decode(sample->path_, &data, &channels);
+    if (!status.ok()) {
+      return status;
+    }
+    sample->SetData(data, channels, format_);
+    return absl::OkStatus();
+  }
+
+  std::error_code ec;
+  Key key;
+  key.path_ = std::filesystem::absolute(sample->path_, ec).string();
+  key.size_ = std::filesystem::file_size(sample->path_, ec);
+  if (ec) {
+    return absl::InvalidArgumentError("Failed to load sample " +
+                                      sample->path_ + ": " + ec.message());
+  }
+  key.mtime_ = std::filesystem::last_write_time(sample->path_, ec)
+                   .time_since_epoch()
+                   .count();
+
+  if (LoadEntry(key, sample).ok()) {
+    return absl::OkStatus();
+  }
+
+  std::vector<float> data;
+  int channels;
+  auto status = Decode(sample->path_, &data, &channels);
+  if (!status.ok()) {
+    return status;
+  }
+
+  // Once written, the entry is mapped so that the decoded data is
+  // released and the pages are shared with other processes.
+  status = WriteEntry(key, data, channels);
+  if (status.ok()) {
+    status = LoadEntry(key, sample);
+  }
+  if (!status.ok()) {
+    LOG(WARNING) << "Unable to cache sample " << sample->path_ << ": "
+                 << status;
+    sample->SetData(data, channels, format_);
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status SampleCache::Decode(const std::string& path,
+                                 std::vector<float>* data, int* channels) {
+  AudioFile<float> audio_file;
+
+  if (!audio_file.load(path)) {
+    return absl::InvalidArgumentError("Failed to load sample " + path);
+  }
+  if (audio_file.getSampleRate() != kSampleRate) {
+    return absl::InvalidArgumentError(
+        "Only 48kHz sample rate is supported for now, sample=" + path);
+  }
+
+  *channels = audio_file.getNumChannels();
+  if (*channels != 1 && *channels != 2) {
+    return absl::InvalidArgumentError(
+        "Only mono or stereo samples are supported");
+  }
+
+  const size_t frames = audio_file.getNumSamplesPerChannel();
+  data->resize(frames * *channels);
+
+  for (int c = 0; c < *channels; ++c) {
+    std::memcpy(data->data() + c * frames, audio_file.samples[c].data(),
+                frames * sizeof(float));
+  }
+
+  if (*channels == 1) {
+    for (auto& v : *data) {
+      v *= kMonoToStereoVolume;
+    }
+  }
+
+  return absl::OkStatus();
+}
+
+// Entries of each format are kept apart, so that processes using
+// distinct formats don't keep rebuilding them.
+std::string SampleCache::EntryPath(const Key& key) const {
+  return absl::StrFormat("%s/%016x.%s.smp", directory_, HashPath(key.path_),
+                         SampleFormatName(format_));
+}
+
+absl::Status SampleCache::LoadEntry(const Key& key, Sample* sample) const {
+  auto mapping_or = utils::MappedFile::Open(EntryPath(key));
+  if (!mapping_or.ok()) {
+    return mapping_or.status();
+  }
+  auto mapping = std::move(*mapping_or);
+
+  EntryHeader header;
+  if (mapping->Size() < sizeof(header)) {
+    return absl::DataLossError("Truncated sample cache entry");
+  }
+  std::memcpy(&header, mapping->Data(), sizeof(header));
+
+  // Entries are overwritten when stale, so any mismatch is a miss:
+  // another version of the file, another file with the same hash or
+  // an older layout.
+  if (std::memcmp(header.magic_, kMagic, sizeof(kMagic)) != 0 ||
+      header.version_ != kVersion ||
+      header.format_ != static_cast<uint32_t>(format_) ||
+      header.size_ != key.size_ ||
+      header.mtime_ != key.mtime_ || header.path_size_ != key.path_.size() ||
+      (header.channels_ != 1 && header.channels_ != 2)) {
+    return absl::NotFoundError("Stale sample cache entry");
+  }
+  if (std::memcmp(mapping->Data() + sizeof(header), key.path_.data(),
+                  key.path_.size()) != 0) {
+    return absl::NotFoundError("Sample cache entry of another file");
+  }
+
+  const size_t offset = DataOffset(key.path_.size());
+  if (mapping->Size() !=
+      offset + EncodedSize(header.frames_, header.channels_, format_)) {
+    return absl::DataLossError("Truncated sample cache entry");
+  }
+
+  const auto* data = reinterpret_cast<const uint8_t*>(mapping->Data() + offset);
+  sample->SetData(std::move(mapping), data, header.frames_, header.channels_,
+                  format_);
+
+  return absl::OkStatus();
+}
+
+absl::Status SampleCache::WriteEntry(const Key& key,
+                                     const std::vector<float>& data,
+                                     int channels) const {
+  EntryHeader header;
+  std::memcpy(header.magic_, kMagic, sizeof(kMagic));
+  header.version_ = kVersion;
+  header.channels_ = channels;
+  header.format_ = static_cast<uint32_t>(format_);
+  header.reserved_ = 0;
+  header.frames_ = data.size() / channels;
+  header.size_ = key.size_;
+  header.mtime_ = key.mtime_;
+  header.path_size_ = key.path_.size();
+
+  const size_t offset = DataOffset(key.path_.size());
+  const std::string padding(offset - sizeof(header) - key.path_.size(), '\0');
+
+  const std::vector<uint8_t> encoded = EncodeChannels(data, channels, format_);
+
+  // Written aside then renamed, so that concurrent readers (possibly
+  // from other processes) never see a partial entry. Loader threads
+  // may write the same entry when packs share a file.
+  const std::string path = EntryPath(key);
+  const std::string tmp_path = absl::StrFormat(
+      "%s.%d.%x.tmp", path, getpid(),
+      std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+  std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(key.path_.data(), key.path_.size());
+  out.write(padding.data(), padding.size());
+  out.write(reinterpret_cast<const char*>(encoded.data()), encoded.size());
+  out.close();
+
+  std::error_code ec;
+  if (!out) {
+    std::filesystem::remove(tmp_path, ec);
+    return absl::InternalError("Unable to write " + tmp_path);
+  }
+
+  std::filesystem::rename(tmp_path, path, ec);
+  if (ec) {
+    std::filesystem::remove(tmp_path, ec);
+    return absl::InternalError("Unable to write " + path + ": " +
+                               ec.message());
+  }
+
+  return absl::OkStatus();
+}
+
+}  // namespace soir
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <absl/status/status.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "core/sample.hh"
+
+namespace soir {
+
+// On-disk cache of decoded samples, so that packs are loaded by
+// mapping cache files instead of decoding audio files. Entries hold
+// the 48kHz planar data of a sample in the storage format, they are
+// keyed by the path, modification time and size of the audio file and
+// rebuilt whenever one of them changes.
+class SampleCache {
+ public:
+  // An empty directory disables the cache, samples are then decoded
+  // in memory on each load. Samples are stored in the given format.
+  absl::Status Init(const std::string& directory,
+                    SampleFormat format = SampleFormat::FLOAT32);
+
+  // Loads the data of the sample from the audio file at its path,
+  // this can be called concurrently for distinct samples.
+  absl::Status Load(Sample* sample);
+
+  // Decodes an audio file into planar data, mono samples are scaled
+  // down so that they don't clip once played on both channels.
+  static absl::Status Decode(const std::string& path, std::vector<float>* data,
+                             int* channels);
+
+ private:
+  // Identifies the version of an audio file.
+  struct Key {
+    std::string path_;
+    uint64_t size_ = 0;
+    int64_t mtime_ = 0;
+  };
+
+  std::string EntryPath(const Key& key) const;
+  absl::Status LoadEntry(const Key& key, Sample* sample) const;
+  absl::Status WriteEntry(const Key& key, const std::vector<float>& data,
+                          int channels) const;
+
+  std::string directory_;
+  SampleFormat format_ = SampleFormat::FLOAT32;
+};
+
+}  // namespace soir
@@ -2,12 +2,74 @@
 
 #include <absl/log/log.h>
 #include <absl/strings/match.h>
+#include <absl/strings/str_cat.h>
+#include <absl/strings/str_join.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
+#include <set>
+#include <thread>
 
 namespace soir {
 
+namespace {
+
+constexpr auto kProgressInterval = std::chrono::milliseconds(100);
+
+// Render threads can't wake up the residency thread, so it polls for
+// their requests at this interval.
+constexpr auto kResidencyInterval = std::chrono::milliseconds(5);
+
+}  // namespace
+
+SampleManager::SampleManager()
+    : handles_(kMaxSampleHandles, nullptr),
+      slots_(std::make_unique<SampleSlot[]>(kMaxSampleHandles)) {}
+
+SampleManager::~SampleManager() {
+  {
+    std::lock_guard<std::mutex> lock(residency_mutex_);
+    stop_ = true;
+    residency_cv_.notify_one();
+  }
+  if (residency_thread_.joinable()) {
+    residency_thread_.join();
+  }
+}
+
 absl::Status SampleManager::Init(const utils::Config& config) {
+  prefault_ = config.GetOrDefault<bool>("dsp.mlock", false);
+  loader_threads_ = config.GetOrDefault<int>("dsp.sample_loader_threads", 0);
+
+  const int budget_mb = config.GetOrDefault<int>("dsp.sample_memory_mb", 0);
+  if (budget_mb < 0) {
+    return absl::InvalidArgumentError("dsp.sample_memory_mb must be >= 0");
+  }
+  lazy_ = budget_mb > 0;
+  budget_bytes_ = static_cast<std::size_t>(budget_mb) << 20;
+  if (lazy_) {
+    LOG(INFO) << "Loading samples on demand within " << budget_mb << "MB";
+    residency_thread_ = std::thread([this]() { ResidencyLoop(); });
+  }
+
+  SampleFormat format;
+  auto status = ParseSampleFormat(
+      config.GetOrDefault<std::string>("dsp.sample_format", "float32"),
+      &format);
+  if (!status.ok()) {
+    return status;
+  }
+
+  status = cache_.Init(
+      utils::Config::ExpandEnvironmentVariables(
+          config.GetOrDefault<std::string>("dsp.sample_cache_directory", "")),
+      format);
+  if (!status.ok()) {
+    return status;
+  }
+
   directory_ = utils::Config::ExpandEnvironmentVariables(
       config.GetOrDefault<std::string>("dsp.sample_directory", ""));
   if (directory_.empty()) {
@@ -23,48 +85,195 @@ absl::Status SampleManager::Init(const utils::Config& config) {
   auto packs =
       config.GetOrDefault<std::vector<std::string>>("dsp.sample_packs", {});
 
-  for (const auto& pack : packs) {
-    auto status = LoadPack(pack);
+  return LoadPacks(packs);
+}
+
+absl::Status SampleManager::LoadPack(const std::string& name) {
+  return LoadPacks({name});
+}
+
+absl::Status SampleManager::LoadPacks(const std::vector<std::string>& names) {
+  std::vector<std::pair<std::string, SamplePack>> packs;
+  std::vector<absl::Status> errors;
+
+  std::set<std::string> seen;
+  for (const auto& name : names) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (packs_.find(name) != packs_.end()) {
+        continue;
+      }
+    }
+    if (!seen.insert(name).second) {
+      continue;
+    }
+
+    LOG(INFO) << "Loading pack: " << name;
+
+    SamplePack pack;
+    auto status = pack.Init(directory_, directory_ + "/" + name + ".pack.json");
     if (!status.ok()) {
-      return status;
+      LOG(ERROR) << "Failed to load pack " << name << ": " << status;
+      errors.push_back(absl::Status(
+          status.code(), absl::StrCat(name, ": ", status.message())));
+      continue;
     }
+
+    packs.emplace_back(name, std::move(pack));
   }
 
-  return absl::OkStatus();
-}
+  // Samples of all packs are flattened so that loads are spread
+  // evenly whatever the size of each pack.
+  std::vector<Sample*> samples;
+  std::vector<size_t> owners;
+  for (size_t i = 0; i < packs.size(); ++i) {
+    for (Sample* sample : packs[i].second.GetSamples()) {
+      samples.push_back(sample);
+      owners.push_back(i);
+    }
+  }
 
-absl::Status SampleManager::LoadPack(const std::string& name) {
-  auto config_path = directory_ + "/" + name + ".pack.json";
+  // With a memory budget samples are loaded when first referenced.
+  std::vector<absl::Status> statuses(samples.size());
+  if (!lazy_) {
+    statuses = LoadSamples(samples);
+  }
 
-  LOG(INFO) << "Loading pack: " << name;
+  std::vector<bool> failed(packs.size(), false);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    if (statuses[i].ok()) {
+      continue;
+    }
+    const auto& pack_name = packs[owners[i]].first;
+    LOG(ERROR) << "Failed to load sample " << samples[i]->name_ << " of pack "
+               << pack_name << ": " << statuses[i];
+    errors.push_back(absl::Status(
+        statuses[i].code(), absl::StrCat(pack_name, "/", samples[i]->name_,
+                                         ": ", statuses[i].message())));
+    failed[owners[i]] = true;
+  }
+
+  for (size_t i = 0; i < packs.size(); ++i) {
+    auto& [name, pack] = packs[i];
+    if (failed[i]) {
+      continue;
+    }
+
+    if (lazy_) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      packs_.emplace(name, std::move(pack));
+      continue;
+    }
+
+    if (prefault_) {
+      pack.Prefault();
+    }
+
+    std::size_t bytes = 0;
+    for (const Sample* sample : pack.GetSamples()) {
+      bytes += sample->MemoryUsage();
+    }
 
-  {
     std::lock_guard<std::mutex> lock(mutex_);
-    if (packs_.find(name) != packs_.end()) {
-      return absl::OkStatus();
+    if (packs_.emplace(name, std::move(pack)).second) {
+      resident_bytes_ += bytes;
     }
   }
 
-  SamplePack pack;
+  if (errors.empty()) {
+    return absl::OkStatus();
+  }
 
-  auto status = pack.Init(directory_, config_path);
-  if (!status.ok()) {
-    LOG(ERROR) << "Failed to load pack " << name << ": " << status;
-    return status;
+  return absl::Status(errors.front().code(),
+                      absl::StrJoin(errors, "; ",
+                                    [](std::string* out, const auto& error) {
+                                      absl::StrAppend(out, error.message());
+                                    }));
+}
+
+void SampleManager::SetLoadProgress(SampleLoadProgress progress) {
+  progress_ = std::move(progress);
+}
+
+std::vector<absl::Status> SampleManager::LoadSamples(
+    const std::vector<Sample*>& samples) {
+  const int total = samples.size();
+  std::vector<absl::Status> statuses(total);
+  if (total == 0) {
+    return statuses;
   }
 
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    packs_[name] = std::move(pack);
+  int num_threads = loader_threads_;
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  num_threads = std::min(num_threads, total);
+
+  const auto start = std::chrono::steady_clock::now();
+
+  // Threads pick samples one at a time so that a few large files
+  // don't hold back the others, each sample's status and data are
+  // only written by the thread that picked it.
+  std::atomic<int> next = 0;
+  std::mutex mutex;
+  std::condition_variable done_cv;
+  int loaded = 0;
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < num_threads; ++t) {
+    threads.emplace_back([&]() {
+      for (int i = next++; i < total; i = next++) {
+        statuses[i] = cache_.Load(samples[i]);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (++loaded == total) {
+          done_cv.notify_one();
+        }
+      }
+    });
   }
 
-  return absl::OkStatus();
+  // Progress is reported from this thread at a bounded rate, so that
+  // a slow callback never stalls the loaders.
+  int reported = -1;
+  while (reported < total) {
+    int current;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      done_cv.wait_for(lock, kProgressInterval,
+                       [&]() { return loaded == total; });
+      current = loaded;
+    }
+
+    if (current != reported) {
+      if (progress_) {
+        progress_(current, total);
+      }
+      reported = current;
+    }
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start);
+  LOG(INFO) << "Loaded " << total << " samples in " << elapsed.count()
+            << "ms with " << num_threads << " threads";
+
+  return statuses;
 }
 
 SamplePack* SampleManager::GetPack(const std::string& name) {
   std::lock_guard<std::mutex> lock(mutex_);
 
-  return &packs_[name];
+  auto it = packs_.find(name);
+  if (it == packs_.end()) {
+    return nullptr;
+  }
+
+  return &it->second;
 }
 
 std::vector<std::string> SampleManager::GetPackNames() {
@@ -78,4 +287,199 @@ std::vector<std::string> SampleManager::GetPackNames() {
   return names;
 }
 
+SampleHandle SampleManager::GetSampleHandle(const std::string& pack,
+                                            const std::string& name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  const auto key = std::make_pair(pack, name);
+  auto it = resolved_.find(key);
+  if (it != resolved_.end()) {
+    return it->second;
+  }
+
+  // Misses are not cached as the pack may be loaded later on.
+  auto pack_it = packs_.find(pack);
+  if (pack_it == packs_.end()) {
+    return kInvalidSampleHandle;
+  }
+  Sample* sample = pack_it->second.GetSample(name);
+  if (sample == nullptr) {
+    return kInvalidSampleHandle;
+  }
+
+  SampleHandle handle;
+  auto sample_it = sample_handles_.find(sample);
+  if (sample_it != sample_handles_.end()) {
+    handle = sample_it->second;
+  } else {
+    handle = num_handles_.load(std::memory_order_relaxed);
+    if (handle >= kMaxSampleHandles) {
+      LOG(ERROR) << "Too many samples in use, unable to play " << name;
+      return kInvalidSampleHandle;
+    }
+
+    handles_[handle] = sample;
+    slots_[handle].state_.store(
+        lazy_ ? Residency::UNLOADED : Residency::RESIDENT);
+    sample_handles_[sample] = handle;
+    num_handles_.store(handle + 1, std::memory_order_release);
+  }
+
+  resolved_[key] = handle;
+
+  if (lazy_) {
+    RequestLoad(&slots_[handle]);
+
+    std::lock_guard<std::mutex> residency_lock(residency_mutex_);
+    residency_cv_.notify_one();
+  }
+
+  return handle;
+}
+
+Sample* SampleManager::GetSample(SampleHandle handle) const {
+  if (handle < 0 || handle >= num_handles_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+
+  return handles_[handle];
+}
+
+bool SampleManager::PinSample(SampleHandle handle) {
+  if (handle < 0 || handle >= num_handles_.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  SampleSlot& slot = slots_[handle];
+  slot.pins_.fetch_add(1);
+
+  if (slot.state_.load() == Residency::FAILED) {
+    slot.pins_.fetch_sub(1);
+    return false;
+  }
+
+  RequestLoad(&slot);
+  slot.last_use_.store(use_clock_.fetch_add(1, std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+
+  return true;
+}
+
+void SampleManager::UnpinSample(SampleHandle handle) {
+  SampleSlot& slot = slots_[handle];
+
+  slot.last_use_.store(use_clock_.fetch_add(1, std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+  slot.pins_.fetch_sub(1);
+}
+
+Sample* SampleManager::GetPinnedSample(SampleHandle handle, bool* failed) {
+  SampleSlot& slot = slots_[handle];
+
+  const Residency state = slot.state_.load();
+  *failed = state == Residency::FAILED;
+  if (state == Residency::RESIDENT) {
+    return handles_[handle];
+  }
+
+  // The sample may have been evicted right before it was pinned.
+  RequestLoad(&slot);
+
+  return nullptr;
+}
+
+std::size_t SampleManager::ResidentBytes() const {
+  return resident_bytes_.load(std::memory_order_relaxed);
+}
+
+void SampleManager::RequestLoad(SampleSlot* slot) {
+  Residency expected = Residency::UNLOADED;
+  slot->state_.compare_exchange_strong(expected, Residency::LOADING);
+}
+
+void SampleManager::ResidencyLoop() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(residency_mutex_);
+      residency_cv_.wait_for(lock, kResidencyInterval);
+      if (stop_) {
+        return;
+      }
+    }
+
+    LoadRequested();
+    EvictUnused();
+  }
+}
+
+void SampleManager::LoadRequested() {
+  const int num_handles = num_handles_.load(std::memory_order_acquire);
+
+  for (int handle = 0; handle < num_handles; ++handle) {
+    SampleSlot& slot = slots_[handle];
+    if (slot.state_.load() != Residency::LOADING) {
+      continue;
+    }
+
+    // Nothing else touches the data of the sample while it's LOADING.
+    Sample* sample = handles_[handle];
+    auto status = cache_.Load(sample);
+    if (!status.ok()) {
+      LOG(ERROR) << "Failed to load sample " << sample->name_ << ": "
+                 << status;
+      slot.state_.store(Residency::FAILED);
+      continue;
+    }
+
+    // Render threads must not fault on the data, it may be mapped.
+    sample->Prefault();
+
+    slot.bytes_ = sample->MemoryUsage();
+    resident_bytes_ += slot.bytes_;
+    slot.last_use_.store(use_clock_.fetch_add(1, std::memory_order_relaxed),
+                         std::memory_order_relaxed);
+    slot.state_.store(Residency::RESIDENT);
+  }
+}
+
+void SampleManager::EvictUnused() {
+  if (resident_bytes_.load() <= budget_bytes_) {
+    return;
+  }
+
+  const int num_handles = num_handles_.load(std::memory_order_acquire);
+
+  std::vector<std::pair<uint64_t, int>> candidates;
+  for (int handle = 0; handle < num_handles; ++handle) {
+    const SampleSlot& slot = slots_[handle];
+    if (slot.state_.load() == Residency::RESIDENT && slot.pins_.load() == 0) {
+      candidates.emplace_back(slot.last_use_.load(std::memory_order_relaxed),
+                              handle);
+    }
+  }
+  std::sort(candidates.begin(), candidates.end());
+
+  for (const auto& [_, handle] : candidates) {
+    if (resident_bytes_.load() <= budget_bytes_) {
+      break;
+    }
+
+    SampleSlot& slot = slots_[handle];
+    slot.state_.store(Residency::EVICTING);
+    if (slot.pins_.load() > 0) {
+      // Pinned since it was selected, it's in use again.
+      slot.state_.store(Residency::RESIDENT);
+      continue;
+    }
+
+    Sample* sample = handles_[handle];
+    LOG(INFO) << "Evicting sample " << sample->name_;
+
+    sample->ClearData();
+    resident_bytes_ -= slot.bytes_;
+    slot.bytes_ = 0;
+    slot.state_.store(Residency::UNLOADED);
+  }
+}
+
 }  // namespace soir
@@ -1,25 +1,155 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "core/sample_cache.hh"
 #include "core/sample_pack.hh"
 #include "utils/config.hh"
 
 namespace soir {
 
+// Stable integer identifier of a sample, resolved once from a pack
+// and a name so that playing it doesn't involve any string lookup.
+using SampleHandle = int;
+
+static constexpr SampleHandle kInvalidSampleHandle = -1;
+
+// Maximum number of distinct samples that can be given a handle.
+static constexpr int kMaxSampleHandles = 1 << 16;
+
+// Reports the number of samples loaded so far out of the total.
+using SampleLoadProgress = std::function<void(int loaded, int total)>;
+
+// Owns the sample packs and the data of their samples.
+//
+// Without a memory budget all samples are loaded when their pack is
+// and stay resident. With a budget (dsp.sample_memory_mb), packs only
+// load their configs and the data of a sample is loaded the first
+// time it is referenced, by a residency thread which also evicts the
+// least recently used samples once the budget is exceeded. Render
+// threads pin the data of the samples they play so that it's never
+// evicted under them, and never wait for a load.
 class SampleManager {
  public:
+  SampleManager();
+  ~SampleManager();
+
   absl::Status Init(const utils::Config& config);
-  absl::Status LoadPack(const std::string& path);
+
+  // Loads packs, the samples of all packs are decoded in parallel by
+  // dsp.sample_loader_threads threads (one per core if 0). A pack is
+  // added once all of its samples are loaded and prefaulted if
+  // dsp.mlock is set. Packs with failures are skipped and the errors
+  // of all of them are reported in the returned status.
+  absl::Status LoadPacks(const std::vector<std::string>& names);
+  absl::Status LoadPack(const std::string& name);
+
+  // Called from the thread loading packs, at most every 100ms and
+  // once all samples are loaded. Must be set before Init().
+  void SetLoadProgress(SampleLoadProgress progress);
 
   SamplePack* GetPack(const std::string& name);
   std::vector<std::string> GetPackNames();
 
+  // Resolves a sample of a pack by name, with the same matching as
+  // SamplePack::GetSample, into a handle valid for the lifetime of
+  // the manager. Resolutions are cached so that fuzzy matching is
+  // only done once per name. Returns kInvalidSampleHandle if there
+  // is no such sample. With a memory budget, this requests the load
+  // of the sample.
+  SampleHandle GetSampleHandle(const std::string& pack,
+                               const std::string& name);
+
+  // Lock-free, this can be called from the render threads. Returns
+  // nullptr for an unknown handle. With a memory budget the data of
+  // the sample may not be resident, see PinSample().
+  Sample* GetSample(SampleHandle handle) const;
+
+  // Lock-free and wait-free, for the render threads. Pins the data of
+  // a sample so that it's not evicted until UnpinSample() and requests
+  // its load if it's not resident. Returns false, without pinning, for
+  // unknown handles and samples which failed to load.
+  bool PinSample(SampleHandle handle);
+  void UnpinSample(SampleHandle handle);
+
+  // Returns a pinned sample once its data is resident, nullptr while
+  // it's loading or if it failed to load (failed is then set).
+  Sample* GetPinnedSample(SampleHandle handle, bool* failed);
+
+  // Memory used by the data of resident samples.
+  std::size_t ResidentBytes() const;
+
  private:
+  enum class Residency {
+    UNLOADED,
+    LOADING,
+    RESIDENT,
+    EVICTING,
+    FAILED,
+  };
+
+  // Residency of the data of a sample, indexed by handle. The data of
+  // a sample is only written by the residency thread while the sample
+  // is LOADING or EVICTING. Render threads increment pins_ before
+  // checking the state, and the residency thread moves to EVICTING
+  // before checking pins_, so a sample seen RESIDENT by a pinning
+  // thread is never evicted.
+  struct SampleSlot {
+    std::atomic<Residency> state_ = Residency::UNLOADED;
+    std::atomic<int> pins_ = 0;
+    std::atomic<uint64_t> last_use_ = 0;
+    std::size_t bytes_ = 0;
+  };
+
+  // Loads the data of the samples, returns the status of each.
+  std::vector<absl::Status> LoadSamples(const std::vector<Sample*>& samples);
+
+  void RequestLoad(SampleSlot* slot);
+
+  // Loads the requested samples and evicts unused ones while over
+  // budget, until the manager is destroyed.
+  void ResidencyLoop();
+  void LoadRequested();
+  void EvictUnused();
+
   std::string directory_;
+  bool prefault_ = false;
+  int loader_threads_ = 0;
+  SampleCache cache_;
+  SampleLoadProgress progress_;
 
   std::mutex mutex_;
   std::map<std::string, SamplePack> packs_;
+
+  // Interned samples, indexed by handle. Slots are written under the
+  // mutex before the count is published, and never change after.
+  std::vector<Sample*> handles_;
+  std::atomic<int> num_handles_ = 0;
+  std::map<const Sample*, SampleHandle> sample_handles_;
+  std::map<std::pair<std::string, std::string>, SampleHandle> resolved_;
+
+  // Residency of the samples by handle. Without a memory budget
+  // (lazy_ unset) samples are resident as soon as they have a handle.
+  // Requests from the render threads are picked up by polling, others
+  // wake up the residency thread.
+  bool lazy_ = false;
+  std::size_t budget_bytes_ = 0;
+  std::unique_ptr<SampleSlot[]> slots_;
+  std::atomic<uint64_t> use_clock_ = 0;
+  std::atomic<std::size_t> resident_bytes_ = 0;
+  std::thread residency_thread_;
+  std::mutex residency_mutex_;
+  std::condition_variable residency_cv_;
+  bool stop_ = false;
 };
 
 }  // namespace soir
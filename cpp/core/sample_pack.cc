@@ -1,13 +1,10 @@
 #include "core/sample_pack.hh"
 
-#include <AudioFile.h>
-#include <absl/log/log.h>
 #include <absl/strings/match.h>
 
 #include <cstdint>
 #include <mutex>
 
-#include "core/common.hh"
 #include "utils/config.hh"
 
 namespace soir {
@@ -31,40 +28,9 @@ absl::Status SamplePack::Init(const std::string& dir,
     s.name_ = sample_config.Get<std::string>("name");
     s.path_ = dir + "/" + sample_config.Get<std::string>("path");
 
-    AudioFile<float> audio_file;
-
-    if (!audio_file.load(s.path_)) {
-      return absl::InvalidArgumentError("Failed to load sample " + s.path_);
-    }
-    if (audio_file.getSampleRate() != kSampleRate) {
-      return absl::InvalidArgumentError(
-          "Only 48kHz sample rate is supported for now, sample=" + s.path_);
-    }
-
-    if (audio_file.getNumChannels() == 1) {
-      // Mono samples are duplicated to stereo, we need to reduce the volume
-      // to avoid clipping when playing them back.
-      static constexpr float kMonoToStereoVolume = 0.5f;
-      s.lb_ = audio_file.samples[0];
-      for (size_t i = 0; i < s.lb_.size(); i++) {
-        s.lb_[i] *= kMonoToStereoVolume;
-      }
-      s.rb_ = s.lb_;
-    } else if (audio_file.getNumChannels() == 2) {
-      s.lb_ = audio_file.samples[0];
-      s.rb_ = audio_file.samples[1];
-    } else {
-      return absl::InvalidArgumentError(
-          "Only mono or stereo samples are supported");
-    }
-
-    LOG(INFO) << "Loaded sample " << s.name_;
-
     samples_[s.name_] = std::move(s);
   }
 
-  LOG(INFO) << "Loaded " << samples_.size() << " samples";
-
   return absl::OkStatus();
 }
 
@@ -91,4 +57,18 @@ std::vector<std::string> SamplePack::GetSampleNames() const {
   return names;
 }
 
+std::vector<Sample*> SamplePack::GetSamples() {
+  std::vector<Sample*> samples;
+  for (auto& [_, sample] : samples_) {
+    samples.push_back(&sample);
+  }
+  return samples;
+}
+
+void SamplePack::Prefault() const {
+  for (const auto& [_, sample] : samples_) {
+    sample.Prefault();
+  }
+}
+
 }  // namespace soir
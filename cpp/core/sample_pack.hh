@@ -13,16 +13,25 @@ namespace soir {
 
 class SamplePack {
  public:
+  // Reads the pack config, samples are created with their name and
+  // path but their data is left to be loaded by the caller.
   absl::Status Init(const std::string& dir, const std::string& pack_config);
 
   // Do not provide a way to remove samples from a pack as it would be
   // unsafe in today's approach: the sample can be in-use in multiple
   // tracks and it's easier if we don't have to come up with
-  // complexity here.
+  // complexity here. Only the data of a sample can be released, by
+  // the SampleManager once it's not pinned by any voice.
 
   Sample* GetSample(const std::string& name);
   std::vector<std::string> GetSampleNames() const;
 
+  // All samples of the pack, ordered by name.
+  std::vector<Sample*> GetSamples();
+
+  // Touches the memory of all samples so that it is resident.
+  void Prefault() const;
+
  private:
   std::map<std::string, Sample> samples_;
 };
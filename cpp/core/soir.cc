@@ -1,9 +1,14 @@
 #include "core/soir.hh"
 
+#include <cmath>
+#include <utility>
+
 #include "absl/log/log.h"
 #include "absl/status/status.h"
+#include "audio/audio_recorder.hh"
 #include "bindings/rt.hh"
 #include "core/engine.hh"
+#include "core/time_source.hh"
 #include "rt/runtime.hh"
 
 namespace soir {
@@ -63,6 +68,10 @@ absl::Status Soir::Init(const std::string& config_path) {
   return absl::OkStatus();
 }
 
+void Soir::SetSampleLoadProgress(SampleLoadProgress progress) {
+  dsp_->GetSampleManager().SetLoadProgress(std::move(progress));
+}
+
 absl::Status Soir::Start() {
   if (!initialized_) {
     return absl::FailedPreconditionError("Soir not initialized");
@@ -134,4 +143,78 @@ absl::Status Soir::UpdateCode(const std::string& code) {
   return rt_->PushCodeUpdate(code);
 }
 
+absl::Status Soir::RenderOffline(const std::string& code, float seconds,
+                                 const std::string& path) {
+  if (!initialized_) {
+    return absl::FailedPreconditionError("Soir not initialized");
+  }
+
+  if (running_) {
+    return absl::FailedPreconditionError("Soir already running");
+  }
+
+  if (seconds <= 0.0f) {
+    return absl::InvalidArgumentError("Duration must be positive");
+  }
+
+  LOG(INFO) << "Rendering " << seconds << "s offline to " << path;
+
+  AudioRecorder recorder;
+  auto status = recorder.Init(path);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to initialize recorder: " << status;
+    return status;
+  }
+
+  // Start from a fixed point in time so that renders are
+  // reproducible.
+  VirtualTimeSource time_source(absl::UnixEpoch());
+
+  status = dsp_->StartOffline(&time_source);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to start DSP engine offline: " << status;
+    return status;
+  }
+
+  dsp_->RegisterConsumer(&recorder);
+
+  const uint64_t num_blocks = static_cast<uint64_t>(
+      std::ceil(seconds * kSampleRate / static_cast<float>(kBlockSize)));
+
+  const absl::Time started_at = absl::Now();
+
+  status = rt_->RunOffline(code, num_blocks, &time_source);
+  if (!status.ok()) {
+    LOG(ERROR) << "Offline rendering failed: " << status;
+  }
+
+  const absl::Duration elapsed = absl::Now() - started_at;
+
+  dsp_->RemoveConsumer(&recorder);
+
+  auto dsp_status = dsp_->Stop();
+  if (!dsp_status.ok()) {
+    LOG(ERROR) << "Failed to stop DSP engine: " << dsp_status;
+    if (status.ok()) {
+      status = dsp_status;
+    }
+  }
+
+  auto save_status = recorder.MaybeStop();
+  if (!save_status.ok()) {
+    LOG(ERROR) << "Failed to save offline render: " << save_status;
+    if (status.ok()) {
+      status = save_status;
+    }
+  }
+
+  // Engines can't be restarted once stopped.
+  initialized_ = false;
+
+  LOG(INFO) << "Rendered " << seconds << "s offline in " << elapsed << " ("
+            << seconds / absl::ToDoubleSeconds(elapsed) << "x real-time)";
+
+  return status;
+}
+
 }  // namespace soir
@@ -4,6 +4,7 @@
 #include <string>
 
 #include "absl/status/status.h"
+#include "core/sample_manager.hh"
 #include "utils/config.hh"
 
 namespace soir {
@@ -20,10 +21,20 @@ class Soir {
   ~Soir();
 
   absl::Status Init(const std::string& config_path);
+
+  // Reports the progress of sample packs loading during Init().
+  void SetSampleLoadProgress(SampleLoadProgress progress);
   absl::Status Start();
   absl::Status Stop();
   absl::Status UpdateCode(const std::string& code);
 
+  // Renders the given code for a duration to a WAV file, faster than
+  // real-time: blocks are rendered back to back in virtual time with
+  // no audio output. This is exclusive with Start() and the instance
+  // can't be started afterwards.
+  absl::Status RenderOffline(const std::string& code, float seconds,
+                             const std::string& path);
+
  private:
   std::unique_ptr<utils::Config> config_;
   std::unique_ptr<Engine> dsp_;
@@ -0,0 +1,24 @@
+#include "core/time_source.hh"
+
+namespace soir {
+
+absl::Time SystemTimeSource::Now() const { return absl::Now(); }
+
+VirtualTimeSource::VirtualTimeSource(absl::Time start) : start_(start) {}
+
+absl::Time VirtualTimeSource::Now() const {
+  const SampleTick ticks = ticks_.load(std::memory_order_acquire);
+
+  return start_ + absl::Microseconds((ticks * 1000000) / kSampleRate);
+}
+
+void VirtualTimeSource::Advance(SampleTick ticks) {
+  ticks_.fetch_add(ticks, std::memory_order_acq_rel);
+}
+
+TimeSource* GetSystemTimeSource() {
+  static SystemTimeSource source;
+  return &source;
+}
+
+}  // namespace soir
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <absl/time/clock.h>
+#include <absl/time/time.h>
+
+#include <atomic>
+
+#include "core/common.hh"
+
+namespace soir {
+
+// Where the engines get the current time from. Live sessions use the
+// system clock, offline renders use a virtual clock that only moves
+// forward as blocks are rendered so that sessions can be rendered
+// faster than real-time with the exact same scheduling.
+class TimeSource {
+ public:
+  virtual ~TimeSource() = default;
+
+  virtual absl::Time Now() const = 0;
+};
+
+class SystemTimeSource : public TimeSource {
+ public:
+  absl::Time Now() const override;
+};
+
+class VirtualTimeSource : public TimeSource {
+ public:
+  explicit VirtualTimeSource(absl::Time start);
+
+  absl::Time Now() const override;
+
+  // Moves the clock forward by the given number of samples.
+  void Advance(SampleTick ticks);
+
+ private:
+  const absl::Time start_;
+  std::atomic<SampleTick> ticks_ = 0;
+};
+
+// Shared instance used by default by the engines.
+TimeSource* GetSystemTimeSource();
+
+}  // namespace soir
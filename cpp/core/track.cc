@@ -55,6 +55,11 @@ absl::Status Track::Init(const Settings& settings,
     return status;
   }
 
+  // Everything used while rendering is allocated upfront.
+  trace_name_ = "track::render::" + inst_->GetName();
+  midi_stack_.Reserve(kMidiQueueCapacity);
+  block_.Reserve(kMidiQueueCapacity);
+
   fx_stack_ = std::make_unique<fx::FxStack>(controls_, vst_host_);
 
   status = fx_stack_->Init(settings_.fxs_);
@@ -66,35 +71,11 @@ absl::Status Track::Init(const Settings& settings,
   return absl::OkStatus();
 }
 
-absl::Status Track::Start() {
-  LOG(INFO) << "Starting track thread for: " << settings_.name_;
-
-  // Initialize thread state
-  stop_thread_ = false;
-  has_work_ = false;
-  work_done_ = true;
-
-  // Start the processing thread
-  thread_ = std::thread([this]() {
-    auto status = ProcessLoop();
-    if (!status.ok()) {
-      LOG(ERROR) << "Track processing thread failed: " << status;
-    }
-  });
-
-  return absl::OkStatus();
-}
-
 absl::Status Track::Stop() {
-  LOG(INFO) << "Stopping track thread for: " << settings_.name_;
+  LOG(INFO) << "Stopping track: " << settings_.name_;
 
-  if (thread_.joinable()) {
-    {
-      std::lock_guard<std::mutex> lock(work_mutex_);
-      stop_thread_ = true;
-      work_cv_.notify_one();
-    }
-    thread_.join();
+  if (!inst_) {
+    return absl::OkStatus();
   }
 
   return inst_->Stop();
@@ -141,6 +122,11 @@ const std::string& Track::GetTrackName() {
 
 Levels Track::GetLevels() const { return level_meter_.GetLevels(); }
 
+void Track::GetStats(TrackStats* stats) {
+  stats->render = render_stats_.Read();
+  fx_stack_->GetStats(&stats->fxs);
+}
+
 absl::Status Track::OpenVstFxEditor(const std::string& fx_name) {
   return fx_stack_->OpenVstEditor(fx_name);
 }
@@ -214,102 +200,75 @@ absl::Status Track::CloseVstInstEditor() {
   return status;
 }
 
-void Track::RenderAsync(SampleTick tick, const std::list<MidiEventAt>& events) {
-  std::lock_guard<std::mutex> lock(work_mutex_);
+void Track::Render(SampleTick tick, std::vector<MidiEventAt>* events) {
+  const int64_t start = DurationStats::NowNs();
 
-  current_tick_ = tick;
-  current_events_ = events;
+  // Only contended while the track is being fast-updated.
+  std::scoped_lock<std::mutex> lock(mutex_);
 
-  has_work_ = true;
-  work_done_ = false;
+  current_tick_ = tick;
+  track_buffer_.Reset();
 
-  work_cv_.notify_one();
-}
+  inst_->Schedule(events);
+  midi_stack_.TakeEvents(events);
+  midi_stack_.PopBlock(tick, kBlockSize, &block_);
 
-void Track::Join(AudioBuffer& output_buffer) {
   {
-    std::unique_lock<std::mutex> lock(work_mutex_);
-    done_cv_.wait(lock, [this]() { return work_done_ || stop_thread_; });
+    SOIR_TRACING_ZONE_COLOR_STR(trace_name_, SOIR_PINK);
+    inst_->Render(tick, block_, track_buffer_);
+  }
 
-    if (stop_thread_) {
-      return;
-    }
+  {
+    SOIR_TRACING_ZONE_COLOR("track::render::fx-stack", SOIR_PINK);
+    fx_stack_->Render(tick, track_buffer_, block_);
   }
 
+  render_stats_.Record(DurationStats::NowNs() - start);
+
+  level_meter_.Process(track_buffer_.GetChannel(kLeftChannel),
+                       track_buffer_.GetChannel(kRightChannel),
+                       track_buffer_.Size());
+}
+
+void Track::Join(AudioBuffer& output_buffer) {
   // Now mix the processed audio into the output buffer
   auto ilch = track_buffer_.GetChannel(kLeftChannel);
   auto irch = track_buffer_.GetChannel(kRightChannel);
   auto olch = output_buffer.GetChannel(kLeftChannel);
   auto orch = output_buffer.GetChannel(kRightChannel);
+  const int size = track_buffer_.Size();
 
-  {
-    std::scoped_lock<std::mutex> lock(mutex_);
-
-    {
-      for (int i = 0; i < track_buffer_.Size(); ++i) {
-        SampleTick current_tick = current_tick_ + i;
-
-        if (!settings_.muted_) {
-          const float vol = settings_.volume_.GetValue(current_tick);
-          const float pan = settings_.pan_.GetValue(current_tick);
-
-          auto lgain = vol * LeftPan(pan);
-          auto rgain = vol * RightPan(pan);
+  std::scoped_lock<std::mutex> lock(mutex_);
 
-          olch[i] += ilch[i] * lgain;
-          orch[i] += irch[i] * rgain;
-        }
-      }
-    }
+  if (settings_.muted_) {
+    return;
   }
-}
-
-absl::Status Track::ProcessLoop() {
-  SOIR_TRACING_ZONE_COLOR("track::process_loop", SOIR_PINK);
 
-  LOG(INFO) << "Track processing thread started for: " << settings_.name_;
+  auto& volume = settings_.volume_;
+  auto& pan = settings_.pan_;
 
-  while (true) {
-    {
-      std::unique_lock<std::mutex> lock(work_mutex_);
-      work_cv_.wait(lock, [this]() { return has_work_ || stop_thread_; });
+  // Most tracks have a constant volume and pan, their gains are then
+  // computed once for the block.
+  if (volume.IsConstant() && pan.IsConstant()) {
+    const float vol = volume.GetValue(current_tick_);
+    const float p = pan.GetValue(current_tick_);
+    const float lgain = vol * LeftPan(p);
+    const float rgain = vol * RightPan(p);
 
-      if (stop_thread_) {
-        break;
-      }
-
-      has_work_ = false;
-    }
-
-    {
-      track_buffer_.Reset();
-
-      {
-        std::string trace_name = "track::render::" + inst_->GetName();
-        SOIR_TRACING_ZONE_COLOR_STR(trace_name, SOIR_PINK);
-        inst_->Render(current_tick_, current_events_, track_buffer_);
-      }
-
-      {
-        SOIR_TRACING_ZONE_COLOR("track::render::fx-stack", SOIR_PINK);
-        fx_stack_->Render(current_tick_, track_buffer_, current_events_);
-      }
-
-      level_meter_.Process(track_buffer_.GetChannel(kLeftChannel),
-                           track_buffer_.GetChannel(kRightChannel),
-                           track_buffer_.Size());
-    }
-
-    {
-      std::lock_guard<std::mutex> lock(work_mutex_);
-      work_done_ = true;
-      done_cv_.notify_one();
+    for (int i = 0; i < size; ++i) {
+      olch[i] += ilch[i] * lgain;
+      orch[i] += irch[i] * rgain;
     }
+    return;
   }
 
-  LOG(INFO) << "Track processing thread stopped for: " << settings_.name_;
+  volume.Fill(current_tick_, size, volume_.data());
+  pan.Fill(current_tick_, size, pan_.data());
 
-  return absl::OkStatus();
+  for (int i = 0; i < size; ++i) {
+    olch[i] += ilch[i] * volume_[i] * LeftPan(pan_[i]);
+    orch[i] += irch[i] * volume_[i] * RightPan(pan_[i]);
+  }
 }
 
 }  // namespace soir
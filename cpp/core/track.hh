@@ -2,17 +2,18 @@
 
 #include <absl/status/status.h>
 
-#include <atomic>
-#include <condition_variable>
+#include <array>
 #include <libremidi/libremidi.hpp>
 #include <map>
 #include <mutex>
 #include <optional>
-#include <thread>
+#include <string>
+#include <vector>
 
 #include "audio/audio_buffer.hh"
 #include "core/common.hh"
 #include "core/controls.hh"
+#include "core/dsp_stats.hh"
 #include "core/level_meter.hh"
 #include "core/midi_stack.hh"
 #include "core/parameter.hh"
@@ -49,7 +50,6 @@ struct Track {
 
   absl::Status Init(const Settings& settings, SampleManager* sample_manager,
                     Controls* controls, vst::VstHost* vst_host);
-  absl::Status Start();
   absl::Status Stop();
 
   // If MaybeFastUpdate returns false, it means the track can't update
@@ -61,21 +61,26 @@ struct Track {
   const std::string& GetTrackName();
   Levels GetLevels() const;
 
+  // Render durations of the track (instrument and effects) and of
+  // each of its effects.
+  void GetStats(TrackStats* stats);
+
   absl::Status OpenVstFxEditor(const std::string& fx_name);
   absl::Status CloseVstFxEditor(const std::string& fx_name);
   absl::Status OpenVstInstEditor();
   absl::Status CloseVstInstEditor();
 
-  // Schedule an async render operation
-  void RenderAsync(SampleTick tick, const std::list<MidiEventAt>& events);
+  // Render the instrument and the FX stack of the track for the
+  // block starting at tick. This is called from one of the DSP
+  // workers, tracks are rendered in parallel. Events are moved to
+  // the track and the vector is left empty.
+  void Render(SampleTick tick, std::vector<MidiEventAt>* events);
 
-  // Wait for rendering to complete and mix the result into the output buffer
+  // Mix the result of the last render into the output buffer, this
+  // must be called once all tracks are rendered.
   void Join(AudioBuffer& output_buffer);
 
  private:
-  // Thread function for processing audio
-  absl::Status ProcessLoop();
-
   Controls* controls_;
   SampleManager* sample_manager_;
   vst::VstHost* vst_host_;
@@ -84,22 +89,22 @@ struct Track {
   Settings settings_;
   std::unique_ptr<inst::Instrument> inst_;
   std::unique_ptr<fx::FxStack> fx_stack_;
+
+  // Events received ahead of time wait in the stack until the block
+  // they are due in is rendered.
   MidiStack midi_stack_;
+  MidiBlock block_;
+  std::string trace_name_;
 
-  // Thread management
-  std::thread thread_;
-  std::mutex work_mutex_;
-  std::condition_variable work_cv_;
-  std::condition_variable done_cv_;
-  std::atomic<bool> stop_thread_ = false;
-  std::atomic<bool> has_work_ = false;
-  std::atomic<bool> work_done_ = false;
-
-  // Work parameters
-  SampleTick current_tick_;
-  std::list<MidiEventAt> current_events_;
+  // Result of the last render.
+  SampleTick current_tick_ = 0;
   AudioBuffer track_buffer_;
   LevelMeter level_meter_;
+  DurationStats render_stats_;
+
+  // Scratch buffers of Join.
+  std::array<float, kBlockSize> volume_;
+  std::array<float, kBlockSize> pan_;
   // inst_editor_window_ is declared last so it is the first member destroyed
   // by ~Track(). ~Track() calls Stop() before any member destructor runs;
   // Stop() calls inst_->Stop() which terminates the Wine host and unloads the
@@ -0,0 +1,213 @@
+#include "core/worker_pool.hh"
+
+#include <absl/log/log.h>
+
+#include <algorithm>
+
+#include "core/common.hh"
+#include "utils/realtime.hh"
+
+namespace soir {
+
+namespace {
+
+int NumCores() {
+  return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+void PinToCore(int core) {
+  auto status = utils::PinCurrentThread(core);
+  if (!status.ok()) {
+    LOG(WARNING) << "Unable to pin DSP worker: " << status;
+    return;
+  }
+
+  LOG(INFO) << "DSP worker pinned to core " << core;
+}
+
+}  // namespace
+
+bool WorkerPool::Queue::Push(const Job& job) {
+  const uint32_t tail = tail_.load(std::memory_order_relaxed);
+
+  if (tail - head_.load(std::memory_order_acquire) >= kQueueCapacity) {
+    return false;
+  }
+
+  jobs_[tail % kQueueCapacity] = job;
+  tail_.store(tail + 1, std::memory_order_release);
+
+  return true;
+}
+
+bool WorkerPool::Queue::Pop(Job* job) {
+  uint32_t head = head_.load(std::memory_order_acquire);
+
+  while (true) {
+    const uint32_t tail = tail_.load(std::memory_order_acquire);
+    if (static_cast<int32_t>(tail - head) <= 0) {
+      return false;
+    }
+
+    // The slot can't be overwritten until head moves past it as the
+    // producer never wraps over unconsumed jobs, so it is safe to
+    // read it before claiming it.
+    *job = jobs_[head % kQueueCapacity];
+
+    if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel,
+                                    std::memory_order_acquire)) {
+      return true;
+    }
+  }
+}
+
+WorkerPool::WorkerPool() {}
+
+WorkerPool::~WorkerPool() { Stop().IgnoreError(); }
+
+absl::Status WorkerPool::Start(int num_workers, bool pin) {
+  if (!threads_.empty()) {
+    return absl::FailedPreconditionError("Worker pool already started");
+  }
+
+  // The engine thread helps rendering while waiting for a batch so
+  // we keep one core for it.
+  if (num_workers <= 0) {
+    num_workers = std::max(1, NumCores() - 1);
+  }
+
+  LOG(INFO) << "Starting DSP worker pool with " << num_workers << " workers";
+
+  {
+    std::scoped_lock<std::mutex> lock(mutex_);
+    stop_ = false;
+  }
+
+  for (int i = 0; i < num_workers; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+
+  for (int i = 0; i < num_workers; ++i) {
+    threads_.emplace_back([this, i, pin]() { WorkerLoop(i, pin); });
+  }
+
+  return absl::OkStatus();
+}
+
+absl::Status WorkerPool::Stop() {
+  {
+    std::scoped_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_cv_.notify_all();
+
+  for (auto& thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+
+  threads_.clear();
+  queues_.clear();
+
+  return absl::OkStatus();
+}
+
+int WorkerPool::NumWorkers() const { return threads_.size(); }
+
+void WorkerPool::Submit(const Job& job) {
+  if (queues_.empty()) {
+    job.func_(job.arg_);
+    return;
+  }
+
+  pending_.fetch_add(1, std::memory_order_relaxed);
+
+  auto& queue = queues_[next_queue_];
+  next_queue_ = (next_queue_ + 1) % queues_.size();
+
+  if (!queue->Push(job)) {
+    job.func_(job.arg_);
+    pending_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+bool WorkerPool::RunOne(int first_queue) {
+  const int n = queues_.size();
+
+  for (int i = 0; i < n; ++i) {
+    Job job;
+
+    if (!queues_[(first_queue + i) % n]->Pop(&job)) {
+      continue;
+    }
+
+    job.func_(job.arg_);
+
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      std::scoped_lock<std::mutex> lock(mutex_);
+      done_cv_.notify_one();
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+void WorkerPool::Wait() {
+  SOIR_TRACING_ZONE_COLOR("dsp::workers-wait", SOIR_BLUE);
+
+  if (queues_.empty()) {
+    return;
+  }
+
+  {
+    std::scoped_lock<std::mutex> lock(mutex_);
+    batch_++;
+  }
+  work_cv_.notify_all();
+
+  // Help the workers instead of sleeping right away, most of the
+  // time the engine thread picks a few jobs itself.
+  while (RunOne(0)) {
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this]() {
+    return pending_.load(std::memory_order_acquire) == 0;
+  });
+}
+
+void WorkerPool::WorkerLoop(int index, bool pin) {
+  // Configured CPUs take precedence, otherwise core 0 is left to the
+  // engine thread and the rest of the system.
+  const auto& cpus = utils::GetRealtimeSettings().cpus_;
+  if (!cpus.empty()) {
+    PinToCore(cpus[index % cpus.size()]);
+  } else if (pin) {
+    PinToCore((index + 1) % NumCores());
+  }
+
+  utils::EnterRealtime("DSP workers");
+
+  uint64_t seen = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_cv_.wait(lock, [this, seen]() { return stop_ || batch_ != seen; });
+      if (stop_) {
+        break;
+      }
+      seen = batch_;
+    }
+
+    SOIR_TRACING_ZONE_COLOR("dsp::worker", SOIR_PINK);
+
+    while (RunOne(index)) {
+    }
+  }
+}
+
+}  // namespace soir
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <absl/status/status.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace soir {
+
+// Fixed-size pool of DSP workers used to render tracks in parallel.
+//
+// Each worker owns a bounded queue of jobs. The engine distributes
+// jobs round-robin across queues, then calls Wait() which wakes up
+// the workers once for the whole batch. A worker drains its own
+// queue first and then steals from the others, so an uneven track
+// load is spread across cores. The calling thread also steals jobs
+// while waiting, so a batch never needs more than one wake-up and
+// one completion signal.
+//
+// Submit() and Wait() must be called from a single thread (the DSP
+// engine thread).
+class WorkerPool {
+ public:
+  // A job is a plain function pointer and argument so that
+  // submitting work never allocates.
+  struct Job {
+    void (*func_)(void*) = nullptr;
+    void* arg_ = nullptr;
+  };
+
+  // Maximum number of pending jobs per worker queue, if a batch
+  // overflows a queue the job is executed inline by Submit().
+  static constexpr uint32_t kQueueCapacity = 256;
+
+  WorkerPool();
+  ~WorkerPool();
+
+  // Starts the pool with the given number of workers, if 0 the
+  // number of workers is inferred from the number of cores. Workers
+  // are pinned to distinct cores if pin is set, or to the CPUs of
+  // the real-time settings if any (see utils/realtime.hh).
+  absl::Status Start(int num_workers, bool pin);
+  absl::Status Stop();
+
+  void Submit(const Job& job);
+
+  // Wakes up the workers and blocks until all submitted jobs are
+  // done.
+  void Wait();
+
+  int NumWorkers() const;
+
+ private:
+  struct Queue {
+    bool Push(const Job& job);
+    bool Pop(Job* job);
+
+    Job jobs_[kQueueCapacity];
+    alignas(64) std::atomic<uint32_t> head_ = 0;
+    alignas(64) std::atomic<uint32_t> tail_ = 0;
+  };
+
+  void WorkerLoop(int index, bool pin);
+  bool RunOne(int first_queue);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> threads_;
+  int next_queue_ = 0;
+
+  // Number of jobs submitted but not yet completed.
+  alignas(64) std::atomic<int> pending_ = 0;
+
+  // Workers sleep on this until a new batch is published or the
+  // pool is stopped.
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  uint64_t batch_ = 0;
+  bool stop_ = false;
+};
+
+}  // namespace soir
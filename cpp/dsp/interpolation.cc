@@ -0,0 +1,52 @@
+#include "dsp/interpolation.hh"
+
+#include <array>
+#include <cmath>
+
+namespace soir {
+namespace dsp {
+
+namespace {
+
+using SincCoefficients = std::array<float, (kSincPhases + 1) * kSincTaps>;
+
+// Blackman window over the taps, 0 at their edges.
+float Blackman(float x) {
+  const float w = static_cast<float>(kSincTaps) / 2.0f;
+  return 0.42f + 0.5f * std::cos(M_PI * x / w) +
+         0.08f * std::cos(2.0f * M_PI * x / w);
+}
+
+SincCoefficients MakeSincTable() {
+  SincCoefficients table;
+
+  for (int p = 0; p <= kSincPhases; ++p) {
+    const float t = static_cast<float>(p) / kSincPhases;
+    float* coefficients = table.data() + p * kSincTaps;
+
+    // Normalized so that phases don't modulate the gain.
+    float sum = 0.0f;
+    for (int k = 0; k < kSincTaps; ++k) {
+      const float x = static_cast<float>(k - kInterpolationBefore) - t;
+      const float sinc =
+          x == 0.0f ? 1.0f : std::sin(M_PI * x) / static_cast<float>(M_PI * x);
+      coefficients[k] = sinc * Blackman(x);
+      sum += coefficients[k];
+    }
+    for (int k = 0; k < kSincTaps; ++k) {
+      coefficients[k] /= sum;
+    }
+  }
+
+  return table;
+}
+
+}  // namespace
+
+const float* SincTable() {
+  static const SincCoefficients table = MakeSincTable();
+  return table.data();
+}
+
+}  // namespace dsp
+}  // namespace soir
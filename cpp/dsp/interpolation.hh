@@ -0,0 +1,62 @@
+#pragma once
+
+namespace soir {
+namespace dsp {
+
+// Kernels interpolating a signal in between its samples: x points to
+// the sample at or before the position and t in [0, 1) is how far the
+// position is past it. Kernels read at most kInterpolationBefore
+// samples before x and kInterpolationAfter after it, the signal must
+// be padded accordingly.
+static constexpr int kInterpolationBefore = 3;
+static constexpr int kInterpolationAfter = 4;
+
+// Two points, cheapest but with audible images and aliasing once
+// pitched.
+struct LinearKernel {
+  float operator()(const float* x, float t) const {
+    return x[0] + (x[1] - x[0]) * t;
+  }
+};
+
+// Four points, third order Hermite (Catmull-Rom spline).
+struct HermiteKernel {
+  float operator()(const float* x, float t) const {
+    const float c1 = 0.5f * (x[1] - x[-1]);
+    const float c2 = x[-1] - 2.5f * x[0] + 2.0f * x[1] - 0.5f * x[2];
+    const float c3 = 0.5f * (x[2] - x[-1]) + 1.5f * (x[0] - x[1]);
+    return ((c3 * t + c2) * t + c1) * t + x[0];
+  }
+};
+
+// Eight points windowed sinc, band-limited to the Nyquist frequency of
+// the signal. Coefficients come from a polyphase table and are
+// interpolated linearly in between phases.
+static constexpr int kSincTaps = kInterpolationBefore + kInterpolationAfter + 1;
+static constexpr int kSincPhases = 256;
+
+// Coefficients of the phases, kSincTaps per phase for kSincPhases + 1
+// phases from t = 0 to t = 1 included.
+const float* SincTable();
+
+struct SincKernel {
+  float operator()(const float* x, float t) const {
+    const float phase = t * kSincPhases;
+    const int p = static_cast<int>(phase);
+    const float w = phase - static_cast<float>(p);
+    const float* a = table_ + p * kSincTaps;
+    const float* b = a + kSincTaps;
+    const float* s = x - kInterpolationBefore;
+
+    float y = 0.0f;
+    for (int k = 0; k < kSincTaps; ++k) {
+      y += s[k] * (a[k] + (b[k] - a[k]) * w);
+    }
+    return y;
+  }
+
+  const float* table_ = SincTable();
+};
+
+}  // namespace dsp
+}  // namespace soir
@@ -8,6 +8,7 @@
 #include "audio/audio_buffer.hh"
 #include "core/common.hh"
 #include "core/midi_event.hh"
+#include "core/midi_stack.hh"
 
 namespace soir {
 namespace fx {
@@ -27,7 +28,7 @@ struct Fx {
   virtual bool CanFastUpdate(const Settings& settings) = 0;
   virtual void FastUpdate(const Settings& settings) = 0;
   virtual void Render(SampleTick tick, AudioBuffer& buffer,
-                      const std::list<MidiEventAt>& events) = 0;
+                      const MidiBlock& events) = 0;
 };
 
 }  // namespace fx
@@ -18,6 +18,9 @@ absl::Status Chorus::Init(const Fx::Settings& settings) {
 
   ReloadParams();
 
+  // Delay lines are allocated here, rendering only updates them.
+  chorus_.Init(chorus_params_);
+
   return absl::OkStatus();
 }
 
@@ -56,25 +59,23 @@ void Chorus::ReloadParams() {
 }
 
 void Chorus::Render(SampleTick tick, AudioBuffer& buffer,
-                    const std::list<MidiEventAt>& /*events*/) {
+                    const MidiBlock& /*events*/) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   auto lch = buffer.GetChannel(kLeftChannel);
   auto rch = buffer.GetChannel(kRightChannel);
 
-  for (int i = 0; i < buffer.Size(); ++i) {
-    SampleTick current_tick = tick + i;
+  const int size = buffer.Size();
+  time_.Fill(tick, size, time_values_.data());
+  depth_.Fill(tick, size, depth_values_.data());
+  rate_.Fill(tick, size, rate_values_.data());
 
-    chorus_params_.time_ = time_.GetValue(current_tick);
-    chorus_params_.depth_ = depth_.GetValue(current_tick);
-    chorus_params_.rate_ = rate_.GetValue(current_tick);
+  for (int i = 0; i < size; ++i) {
+    chorus_params_.time_ = time_values_[i];
+    chorus_params_.depth_ = depth_values_[i];
+    chorus_params_.rate_ = rate_values_[i];
 
-    if (!initialized_) {
-      chorus_.Init(chorus_params_);
-      initialized_ = true;
-    } else {
-      chorus_.FastUpdate(chorus_params_);
-    }
+    chorus_.FastUpdate(chorus_params_);
 
     auto p = chorus_.Render(lch[i], rch[i]);
     lch[i] = p.first;
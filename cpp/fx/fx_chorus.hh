@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "core/parameter.hh"
 #include "dsp/chorus.hh"
 #include "fx.hh"
@@ -15,7 +17,7 @@ struct Chorus : public Fx {
   bool CanFastUpdate(const Fx::Settings& settings) override;
   void FastUpdate(const Fx::Settings& settings) override;
   void Render(SampleTick tick, AudioBuffer& buffer,
-              const std::list<MidiEventAt>& events) override;
+              const MidiBlock& events) override;
 
  private:
   void ReloadParams();
@@ -29,9 +31,12 @@ struct Chorus : public Fx {
   Parameter depth_;
   Parameter rate_;
 
+  std::array<float, kBlockSize> time_values_;
+  std::array<float, kBlockSize> depth_values_;
+  std::array<float, kBlockSize> rate_values_;
+
   dsp::Chorus::Parameters chorus_params_;
   dsp::Chorus chorus_;
-  bool initialized_ = false;
 };
 
 }  // namespace fx
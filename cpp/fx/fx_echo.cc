@@ -17,6 +17,12 @@ absl::Status Echo::Init(const Fx::Settings& settings) {
 
   ReloadParams();
 
+  // Delay lines are allocated here for the longest time (30
+  // seconds), rendering only updates their size.
+  params_.max_ = static_cast<int>(30.0f * kSampleRate);
+  delay_left_.Init(params_);
+  delay_right_.Init(params_);
+
   delay_left_.Reset();
   delay_right_.Reset();
 
@@ -61,33 +67,29 @@ void Echo::ReloadParams() {
 }
 
 void Echo::Render(SampleTick tick, AudioBuffer& buffer,
-                  const std::list<MidiEventAt>& /*events*/) {
+                  const MidiBlock& /*events*/) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   auto lch = buffer.GetChannel(kLeftChannel);
   auto rch = buffer.GetChannel(kRightChannel);
 
-  for (int i = 0; i < buffer.Size(); ++i) {
-    SampleTick current_tick = tick + i;
+  const int size = buffer.Size();
+  time_.Fill(tick, size, time_values_.data());
+  feedback_.Fill(tick, size, feedback_values_.data());
+  dry_.Fill(tick, size, dry_values_.data());
+  wet_.Fill(tick, size, wet_values_.data());
 
-    auto time_value = time_.GetValue(current_tick);
-    auto feedback_value = feedback_.GetValue(current_tick);
-    auto dry_value = dry_.GetValue(current_tick);
-    auto wet_value = wet_.GetValue(current_tick);
+  for (int i = 0; i < size; ++i) {
+    const float time_value = time_values_[i];
+    const float feedback_value = feedback_values_[i];
+    const float dry_value = dry_values_[i];
+    const float wet_value = wet_values_[i];
 
     // Calculate delay size in samples based on time
     params_.size_ = time_value * kSampleRate;
-    params_.max_ =
-        static_cast<int>(30.0f * kSampleRate);  // Max 30 second delay
-
-    if (!initialized_) {
-      delay_left_.Init(params_);
-      delay_right_.Init(params_);
-      initialized_ = true;
-    } else {
-      delay_left_.FastUpdate(params_);
-      delay_right_.FastUpdate(params_);
-    }
+
+    delay_left_.FastUpdate(params_);
+    delay_right_.FastUpdate(params_);
 
     // Read the current delayed samples
     float delayed_left = delay_left_.Read();
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "core/parameter.hh"
 #include "dsp/delay.hh"
 #include "fx.hh"
@@ -15,7 +17,7 @@ struct Echo : public Fx {
   bool CanFastUpdate(const Fx::Settings& settings) override;
   void FastUpdate(const Fx::Settings& settings) override;
   void Render(SampleTick tick, AudioBuffer& buffer,
-              const std::list<MidiEventAt>& events) override;
+              const MidiBlock& events) override;
 
  private:
   void ReloadParams();
@@ -30,7 +32,10 @@ struct Echo : public Fx {
   Parameter dry_;       // Dry level
   Parameter wet_;       // Wet level
 
-  bool initialized_ = false;
+  std::array<float, kBlockSize> time_values_;
+  std::array<float, kBlockSize> feedback_values_;
+  std::array<float, kBlockSize> dry_values_;
+  std::array<float, kBlockSize> wet_values_;
 
   dsp::Delay::Parameters params_;
   dsp::Delay delay_left_;
@@ -69,17 +69,36 @@ float mapToFrequency(float normalized) {
 }  // namespace
 
 void HPF::Render(SampleTick tick, AudioBuffer& buffer,
-                 const std::list<MidiEventAt>& /*events*/) {
+                 const MidiBlock& /*events*/) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   auto lch = buffer.GetChannel(kLeftChannel);
   auto rch = buffer.GetChannel(kRightChannel);
 
-  for (int i = 0; i < buffer.Size(); ++i) {
-    SampleTick current_tick = tick + i;
+  const int size = buffer.Size();
 
-    hpf_params_.cutoff_ = mapToFrequency(cutoff_.GetValue(current_tick));
-    hpf_params_.resonance_ = resonance_.GetValue(current_tick);
+  // Constant parameters are mapped once for the block instead of for
+  // each sample.
+  if (cutoff_.IsConstant() && resonance_.IsConstant()) {
+    hpf_params_.cutoff_ = mapToFrequency(cutoff_.GetValue(tick));
+    hpf_params_.resonance_ = resonance_.GetValue(tick);
+
+    hpf_left_.UpdateParameters(hpf_params_);
+    hpf_right_.UpdateParameters(hpf_params_);
+
+    for (int i = 0; i < size; ++i) {
+      lch[i] = hpf_left_.Process(lch[i]);
+      rch[i] = hpf_right_.Process(rch[i]);
+    }
+    return;
+  }
+
+  cutoff_.Fill(tick, size, cutoff_values_.data());
+  resonance_.Fill(tick, size, resonance_values_.data());
+
+  for (int i = 0; i < size; ++i) {
+    hpf_params_.cutoff_ = mapToFrequency(cutoff_values_[i]);
+    hpf_params_.resonance_ = resonance_values_[i];
 
     hpf_left_.UpdateParameters(hpf_params_);
     hpf_right_.UpdateParameters(hpf_params_);
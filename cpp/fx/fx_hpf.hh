@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "core/parameter.hh"
 #include "dsp/high_pass_filter.hh"
 #include "fx.hh"
@@ -15,7 +17,7 @@ struct HPF : public Fx {
   bool CanFastUpdate(const Fx::Settings& settings) override;
   void FastUpdate(const Fx::Settings& settings) override;
   void Render(SampleTick tick, AudioBuffer& buffer,
-              const std::list<MidiEventAt>& events) override;
+              const MidiBlock& events) override;
 
  private:
   void ReloadParams();
@@ -28,6 +30,9 @@ struct HPF : public Fx {
   Parameter cutoff_;
   Parameter resonance_;
 
+  std::array<float, kBlockSize> cutoff_values_;
+  std::array<float, kBlockSize> resonance_values_;
+
   dsp::HighPassFilter::Parameters hpf_params_;
   dsp::HighPassFilter hpf_left_;
   dsp::HighPassFilter hpf_right_;
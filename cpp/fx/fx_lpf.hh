@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "core/parameter.hh"
 #include "dsp/low_pass_filter.hh"
 #include "fx.hh"
@@ -15,7 +17,7 @@ struct LPF : public Fx {
   bool CanFastUpdate(const Fx::Settings& settings) override;
   void FastUpdate(const Fx::Settings& settings) override;
   void Render(SampleTick tick, AudioBuffer& buffer,
-              const std::list<MidiEventAt>& events) override;
+              const MidiBlock& events) override;
 
  private:
   void ReloadParams();
@@ -28,6 +30,9 @@ struct LPF : public Fx {
   Parameter cutoff_;
   Parameter resonance_;
 
+  std::array<float, kBlockSize> cutoff_values_;
+  std::array<float, kBlockSize> resonance_values_;
+
   dsp::LowPassFilter::Parameters lpf_params_;
   dsp::LowPassFilter lpf_left_;
   dsp::LowPassFilter lpf_right_;
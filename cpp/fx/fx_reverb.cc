@@ -16,6 +16,8 @@ absl::Status Reverb::Init(const Fx::Settings& settings) {
 
   ReloadParams();
 
+  // Filters are allocated here, rendering only updates them.
+  reverb_.Init(params_);
   reverb_.Reset();
 
   return absl::OkStatus();
@@ -57,30 +59,26 @@ void Reverb::ReloadParams() {
 }
 
 void Reverb::Render(SampleTick tick, AudioBuffer& buffer,
-                    const std::list<MidiEventAt>& /*events*/) {
+                    const MidiBlock& /*events*/) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   auto lch = buffer.GetChannel(kLeftChannel);
   auto rch = buffer.GetChannel(kRightChannel);
 
-  for (int i = 0; i < buffer.Size(); ++i) {
-    SampleTick current_tick = tick + i;
+  const int size = buffer.Size();
+  time_.Fill(tick, size, time_values_.data());
+  dry_.Fill(tick, size, dry_values_.data());
+  wet_.Fill(tick, size, wet_values_.data());
 
-    auto time = time_.GetValue(current_tick);
+  for (int i = 0; i < size; ++i) {
+    params_.time_ = time_values_[i];
 
-    params_.time_ = time;
-
-    if (!initialized_) {
-      reverb_.Init(params_);
-      initialized_ = true;
-    } else {
-      reverb_.UpdateParameters(params_);
-    }
+    reverb_.UpdateParameters(params_);
 
     auto p = reverb_.Process(lch[i], rch[i]);
 
-    auto wet = wet_.GetValue(current_tick);
-    auto dry = dry_.GetValue(current_tick);
+    const float wet = wet_values_[i];
+    const float dry = dry_values_[i];
 
     lch[i] = lch[i] * dry + p.first * wet;
     rch[i] = rch[i] * dry + p.second * wet;
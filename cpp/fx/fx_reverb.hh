@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "core/parameter.hh"
 #include "dsp/reverb.hh"
 #include "fx.hh"
@@ -15,7 +17,7 @@ struct Reverb : public Fx {
   bool CanFastUpdate(const Fx::Settings& settings) override;
   void FastUpdate(const Fx::Settings& settings) override;
   void Render(SampleTick tick, AudioBuffer& buffer,
-              const std::list<MidiEventAt>& events) override;
+              const MidiBlock& events) override;
 
  private:
   void ReloadParams();
@@ -29,7 +31,9 @@ struct Reverb : public Fx {
   Parameter dry_;
   Parameter wet_;
 
-  bool initialized_ = false;
+  std::array<float, kBlockSize> time_values_;
+  std::array<float, kBlockSize> dry_values_;
+  std::array<float, kBlockSize> wet_values_;
 
   dsp::Reverb::Parameters params_;
   dsp::Reverb reverb_;
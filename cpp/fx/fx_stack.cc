@@ -45,6 +45,7 @@ absl::Status FxStack::Init(const std::list<Fx::Settings> fx_settings) {
     if (!status.ok()) {
       order_.clear();
       fxs_.clear();
+      UpdateChain();
       return status;
     }
 
@@ -54,6 +55,8 @@ absl::Status FxStack::Init(const std::list<Fx::Settings> fx_settings) {
     LOG(INFO) << "Initialized FX '" << settings.name_ << "'";
   }
 
+  UpdateChain();
+
   return absl::OkStatus();
 }
 
@@ -89,11 +92,20 @@ void FxStack::FastUpdate(const std::list<Fx::Settings> fx_settings) {
 
   fxs_.swap(fxs);
   order_.swap(order);
+
+  UpdateChain();
 }
 
-void FxStack::Render(SampleTick tick, AudioBuffer& buffer,
-                     const std::list<MidiEventAt>& events) {
-  std::lock_guard<std::mutex> lock(mutex_);
+void FxStack::UpdateChain() {
+  chain_.clear();
+
+  for (auto it = stats_.begin(); it != stats_.end();) {
+    if (fxs_.find(it->first) == fxs_.end()) {
+      it = stats_.erase(it);
+    } else {
+      ++it;
+    }
+  }
 
   for (auto& name : order_) {
     auto fx = fxs_.find(name);
@@ -101,16 +113,47 @@ void FxStack::Render(SampleTick tick, AudioBuffer& buffer,
       continue;
     }
 
+    auto& stats = stats_[name];
+    if (stats == nullptr) {
+      stats = std::make_shared<DurationStats>();
+    }
+
+    chain_.push_back({fx->second.get(), "fx::" + name, stats.get()});
+  }
+
+  auto snapshot = std::make_shared<const StatsSet>(stats_);
+  std::lock_guard<std::mutex> stats_lock(stats_mutex_);
+  stats_snapshot_ = std::move(snapshot);
+}
+
+void FxStack::Render(SampleTick tick, AudioBuffer& buffer,
+                     const MidiBlock& events) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  for (auto& entry : chain_) {
     {
-      const std::string trace_name = "fx::" + name;
-      SOIR_TRACING_ZONE_COLOR_STR(trace_name, SOIR_ORANGE);
-      fx->second->Render(tick, buffer, events);
+      SOIR_TRACING_ZONE_COLOR_STR(entry.trace_name_, SOIR_ORANGE);
+      const int64_t start = DurationStats::NowNs();
+      entry.fx_->Render(tick, buffer, events);
+      entry.stats_->Record(DurationStats::NowNs() - start);
     }
 
     SOIR_TRACING_FRAME("fx::stack");
   }
 }
 
+void FxStack::GetStats(std::map<std::string, DurationSummary>* stats) {
+  std::shared_ptr<const StatsSet> snapshot;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    snapshot = stats_snapshot_;
+  }
+
+  for (const auto& [name, fx_stats] : *snapshot) {
+    (*stats)[name] = fx_stats->Read();
+  }
+}
+
 absl::StatusOr<FxVst*> FxStack::FindVstFx(const std::string& fx_name) {
   auto it = fxs_.find(fx_name);
   if (it == fxs_.end()) {
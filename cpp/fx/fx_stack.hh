@@ -5,10 +5,14 @@
 
 #include <list>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 #include "audio/audio_buffer.hh"
 #include "core/common.hh"
+#include "core/dsp_stats.hh"
 #include "core/parameter.hh"
 #include "fx.hh"
 
@@ -33,21 +37,48 @@ class FxStack {
   // It's simple enough for now though.
   bool CanFastUpdate(const std::list<Fx::Settings> fx_settings);
   void FastUpdate(const std::list<Fx::Settings> fx_settings);
-  void Render(SampleTick tick, AudioBuffer& buffer,
-              const std::list<MidiEventAt>& events);
+  void Render(SampleTick tick, AudioBuffer& buffer, const MidiBlock& events);
 
   absl::Status OpenVstEditor(const std::string& fx_name);
   absl::Status CloseVstEditor(const std::string& fx_name);
 
+  // Render durations of each effect, by name. This never takes the
+  // lock held while rendering.
+  void GetStats(std::map<std::string, DurationSummary>* stats);
+
  private:
   absl::StatusOr<FxVst*> FindVstFx(const std::string& fx_name);
 
+  // Rebuilds the chain out of the order of the effects, must be
+  // called with the lock held each time the order changes.
+  void UpdateChain();
+
   Controls* controls_;
   vst::VstHost* vst_host_;
 
   std::mutex mutex_;
   std::list<std::string> order_;
   std::map<std::string, std::unique_ptr<Fx>> fxs_;
+
+  // Effects in rendering order along with their tracing name and
+  // statistics, so that rendering doesn't need any lookup nor
+  // allocation. Statistics are kept across updates of an effect.
+  struct ChainEntry {
+    Fx* fx_;
+    std::string trace_name_;
+    DurationStats* stats_;
+  };
+  std::vector<ChainEntry> chain_;
+
+  // Statistics are shared with immutable snapshots of them by name,
+  // swapped in each time the chain changes (RCU-style): readers copy
+  // the current snapshot under stats_mutex_, which the DSP workers
+  // never take, and read it without holding any lock.
+  using StatsSet = std::map<std::string, std::shared_ptr<DurationStats>>;
+  StatsSet stats_;
+  std::mutex stats_mutex_;
+  std::shared_ptr<const StatsSet> stats_snapshot_ =
+      std::make_shared<StatsSet>();
 };
 
 }  // namespace fx
@@ -121,7 +121,7 @@ void FxVst::ReloadParams() {
 }
 
 void FxVst::Render(SampleTick tick, AudioBuffer& buffer,
-                   const std::list<MidiEventAt>& events) {
+                   const MidiBlock& events) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   if (!initialized_ || !plugin_) {
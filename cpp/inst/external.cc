@@ -6,6 +6,7 @@
 #include <nlohmann/json.hpp>
 
 #include "core/common.hh"
+#include "utils/realtime.hh"
 
 namespace {
 
@@ -62,7 +63,6 @@ void External::ProcessAudioInput() {
     return;
   }
 
-  std::vector<float> input_buffer(kBlockSize * audio_in_chans_);
   void* read_ptr;
   ma_uint32 frames_to_read = kBlockSize;
   ma_pcm_rb_acquire_read(&audio_ringbuffer_, &frames_to_read, &read_ptr);
@@ -71,29 +71,26 @@ void External::ProcessAudioInput() {
     return;
   }
 
-  memcpy(input_buffer.data(), read_ptr,
-         kBlockSize * audio_in_chans_ * sizeof(float));
-  ma_pcm_rb_commit_read(&audio_ringbuffer_, kBlockSize);
-
-  AudioBuffer output_buffer(kBlockSize);
-
-  int left_channel = channel_map_[0];
-  int right_channel = channel_map_[1];
-  float* left = output_buffer.GetChannel(kLeftChannel);
-  float* right = output_buffer.GetChannel(kRightChannel);
+  const float* input = static_cast<const float*>(read_ptr);
+  const int left_channel = channel_map_[0];
+  const int right_channel = channel_map_[1];
 
   for (int i = 0; i < kBlockSize; ++i) {
-    left[i] = input_buffer[i * audio_in_chans_ + left_channel];
-    right[i] = input_buffer[i * audio_in_chans_ + right_channel];
+    input_frames_[i * kNumChannels] = input[i * audio_in_chans_ + left_channel];
+    input_frames_[i * kNumChannels + 1] =
+        input[i * audio_in_chans_ + right_channel];
   }
 
-  {
-    std::lock_guard<std::mutex> lock(mutex_);
-    buffers_.push_back(output_buffer);
-  }
+  ma_pcm_rb_commit_read(&audio_ringbuffer_, kBlockSize);
+
+  // Blocks are dropped if the DSP thread doesn't keep up.
+  input_ring_.Write(input_frames_.data(), kBlockSize);
 }
 
-External::External() {
+External::External()
+    : input_ring_(kExternalInputBlocks * kBlockSize, kNumChannels),
+      input_frames_(kBlockSize * kNumChannels),
+      output_frames_(kBlockSize * kNumChannels) {
   audio_in_context_initialized_ = false;
   audio_in_device_initialized_ = false;
 }
@@ -376,7 +373,7 @@ void External::ScheduleMidiEvents(const absl::Time& block_at) {
       std::lock_guard<std::mutex> lock(mutex_);
       if (settings_midi_out_.has_value()) {
         for (auto& ev : events_at) {
-          midi_out_.send_message(ev.Msg());
+          midi_out_.send_message(ev.Bytes(), ev.Size());
         }
       }
     }
@@ -411,6 +408,8 @@ void External::WaitForInitialTick() {
 }
 
 absl::Status External::Run() {
+  utils::EnterRealtime("external clock");
+
   WaitForInitialTick();
 
   absl::Duration block_duration =
@@ -473,19 +472,31 @@ absl::Status External::Stop() {
   return absl::OkStatus();
 }
 
-void External::Render(SampleTick tick, const std::list<MidiEventAt>& events,
-                      AudioBuffer& buffer) {
+void External::Schedule(std::vector<MidiEventAt>* events) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  midi_stack_.TakeEvents(events);
+}
+
+void External::Render(SampleTick tick, const MidiBlock&, AudioBuffer& buffer) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   if (!current_tick_) {
     current_tick_ = tick;
   }
 
-  midi_stack_.AddEvents(events);
+  if (input_ring_.Available() < static_cast<size_t>(kBlockSize)) {
+    return;
+  }
+
+  input_ring_.Read(output_frames_.data(), kBlockSize);
 
-  if (!buffers_.empty()) {
-    buffer = buffers_.front();
-    buffers_.pop_front();
+  float* left = buffer.GetChannel(kLeftChannel);
+  float* right = buffer.GetChannel(kRightChannel);
+
+  for (int i = 0; i < kBlockSize; ++i) {
+    left[i] = output_frames_[i * kNumChannels];
+    right[i] = output_frames_[i * kNumChannels + 1];
   }
 }
 
@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "audio/audio_buffer.hh"
+#include "audio/audio_ring_buffer.hh"
 #include "core/midi_stack.hh"
 #include "inst/instrument.hh"
 
@@ -38,8 +39,10 @@ class External : public Instrument {
   absl::Status Run();
   absl::Status Stop();
 
-  void Render(SampleTick tick, const std::list<MidiEventAt>& events,
-              AudioBuffer& buffer);
+  // External devices are fed ahead of time from their own thread,
+  // so all events are taken as soon as the track receives them.
+  void Schedule(std::vector<MidiEventAt>* events);
+  void Render(SampleTick tick, const MidiBlock& events, AudioBuffer& buffer);
 
   static absl::Status GetMidiDevices(
       std::vector<std::pair<int, std::string>>* out);
@@ -67,7 +70,6 @@ class External : public Instrument {
   std::thread thread_;
   bool stop_ = false;
   std::vector<float> consumed_;
-  std::list<AudioBuffer> buffers_;
   SampleTick current_tick_ = 0;
 
   libremidi::midi_out midi_out_;
@@ -79,7 +81,13 @@ class External : public Instrument {
   bool audio_in_device_initialized_ = false;
   std::vector<int> channel_map_;
 
+  // Blocks of audio input are passed from the thread of the
+  // instrument to the DSP thread through a lock-free ring, with
+  // scratch buffers allocated upfront.
   void ProcessAudioInput();
+  audio::AudioRingBuffer input_ring_;
+  std::vector<float> input_frames_;
+  std::vector<float> output_frames_;
 
   static void AudioInputCallback(ma_device* device, void* output,
                                  const void* input, ma_uint32 frame_count);
@@ -96,7 +96,7 @@ void InstVst::ReloadParams() {
   }
 }
 
-void InstVst::Render(SampleTick tick, const std::list<MidiEventAt>& events,
+void InstVst::Render(SampleTick tick, const MidiBlock& events,
                      AudioBuffer& buffer) {
   std::lock_guard<std::mutex> lock(mutex_);
 
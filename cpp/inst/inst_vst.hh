@@ -20,7 +20,7 @@ class InstVst : public Instrument {
   absl::Status Init(const std::string& settings, SampleManager* sample_manager,
                     Controls* controls) override;
   absl::Status Stop() override;
-  void Render(SampleTick tick, const std::list<MidiEventAt>& events,
+  void Render(SampleTick tick, const MidiBlock& events,
               AudioBuffer& buffer) override;
   Type GetType() const override { return Type::VST; }
   std::string GetName() const override { return "VST:" + plugin_name_; }
@@ -2,10 +2,12 @@
 
 #include <absl/status/status.h>
 
-#include <list>
+#include <string>
+#include <vector>
 
 #include "core/common.hh"
 #include "core/midi_event.hh"
+#include "core/midi_stack.hh"
 
 namespace soir {
 
@@ -26,8 +28,18 @@ class Instrument {
   virtual absl::Status Init(const std::string& settings,
                             SampleManager* sample_manager,
                             Controls* controls) = 0;
-  virtual void Render(SampleTick, const std::list<MidiEventAt>&,
-                      AudioBuffer&) = 0;
+
+  // Renders the block starting at the given tick, events are the ones
+  // due in this block sorted by tick.
+  virtual void Render(SampleTick, const MidiBlock&, AudioBuffer&) = 0;
+
+  // Called with events as soon as they reach the track, before they
+  // are due. Instruments driving external devices need them ahead of
+  // time to compensate for the latency of the device, they can take
+  // the events out of the vector. The remaining ones are passed to
+  // Render in the block they are due.
+  virtual void Schedule(std::vector<MidiEventAt>*) {}
+
   virtual Type GetType() const = 0;
   virtual std::string GetName() const = 0;
 
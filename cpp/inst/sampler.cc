@@ -2,58 +2,289 @@
 
 #include <AudioFile.h>
 #include <absl/log/log.h>
+#include <absl/strings/str_format.h>
 
 #include <algorithm>
+#include <cmath>
 #include <cstdint>
 #include <filesystem>
+#include <utility>
 
 #include "utils/tools.hh"
 
 namespace soir {
 namespace inst {
 
-absl::Status Sampler::Init(const std::string&, SampleManager* sample_manager,
-                           Controls* controls) {
+Sampler::Sampler() {
+  for (int i = 0; i < kMaxVoices; ++i) {
+    voices_.free_[voices_.num_free_++] = kMaxVoices - 1 - i;
+  }
+}
+
+Sampler::~Sampler() {
+  for (int i = 0; i < voices_.num_active_; ++i) {
+    sample_manager_->UnpinSample(voices_.handle_[voices_.active_[i]]);
+  }
+}
+
+absl::Status Sampler::Init(const std::string& settings,
+                           SampleManager* sample_manager, Controls* controls) {
   sample_manager_ = sample_manager;
   controls_ = controls;
 
+  auto params = nlohmann::json::parse(settings, nullptr, false);
+
+  max_voices_ = kDefaultMaxVoices;
+  if (params.contains("max_voices") &&
+      params["max_voices"].is_number_integer()) {
+    const int max_voices = params["max_voices"].get<int>();
+    if (max_voices < 1 || max_voices > kMaxVoices) {
+      return absl::InvalidArgumentError(absl::StrFormat(
+          "max_voices must be in [1, %d], got %d", kMaxVoices, max_voices));
+    }
+    max_voices_ = max_voices;
+  }
+
+  steal_ = StealPolicy::OLDEST;
+  if (params.contains("steal") && params["steal"].is_string()) {
+    const auto steal = params["steal"].get<std::string>();
+    if (steal == "oldest") {
+      steal_ = StealPolicy::OLDEST;
+    } else if (steal == "quietest") {
+      steal_ = StealPolicy::QUIETEST;
+    } else if (steal == "retrigger") {
+      steal_ = StealPolicy::RETRIGGER;
+    } else {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Unknown voice stealing policy: %s", steal));
+    }
+  }
+
+  interpolation_ = Interpolation::LINEAR;
+  if (params.contains("interpolation") &&
+      params["interpolation"].is_string()) {
+    const auto interpolation = params["interpolation"].get<std::string>();
+    if (interpolation == "linear") {
+      interpolation_ = Interpolation::LINEAR;
+    } else if (interpolation == "hermite") {
+      interpolation_ = Interpolation::HERMITE;
+    } else if (interpolation == "sinc") {
+      interpolation_ = Interpolation::SINC;
+    } else {
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Unknown interpolation: %s", interpolation));
+    }
+  }
+
   return absl::OkStatus();
 }
 
-void Sampler::PlaySample(Sample* sample, const PlaySampleParameters& p) {
-  if (sample == nullptr) {
+int Sampler::CountPlaying(SampleHandle handle) const {
+  int count = 0;
+
+  for (int i = 0; i < voices_.num_active_; ++i) {
+    const int v = voices_.active_[i];
+
+    if (IsPlaying(v) &&
+        (handle == kInvalidSampleHandle || voices_.handle_[v] == handle)) {
+      ++count;
+    }
+  }
+
+  return count;
+}
+
+int Sampler::FindVictim(SampleHandle handle) const {
+  int victim = -1;
+
+  // Active voices are in trigger order, so the first candidate is the
+  // oldest one.
+  for (int i = 0; i < voices_.num_active_; ++i) {
+    const int v = voices_.active_[i];
+
+    if (!IsPlaying(v) ||
+        (handle != kInvalidSampleHandle && voices_.handle_[v] != handle)) {
+      continue;
+    }
+    if (steal_ != StealPolicy::QUIETEST) {
+      return v;
+    }
+    if (victim < 0 || voices_.level_[v] < voices_.level_[victim]) {
+      victim = v;
+    }
+  }
+
+  return victim;
+}
+
+void Sampler::FadeVoice(int v) {
+  if (v < 0 || !IsPlaying(v)) {
     return;
   }
 
+  // Pending voices are silent, there is nothing to fade.
+  if (voices_.sample_[v] == nullptr) {
+    voices_.removing_[v] = true;
+  } else {
+    voices_.fade_[v] = kSampleStealFadeSamples;
+  }
+}
+
+void Sampler::FreeVoice(int v) {
+  sample_manager_->UnpinSample(voices_.handle_[v]);
+  voices_.sample_[v] = nullptr;
+  voices_.free_[voices_.num_free_++] = v;
+}
+
+void Sampler::FreeFadingVoice() {
+  for (int i = 0; i < voices_.num_active_; ++i) {
+    const int v = voices_.active_[i];
+
+    if (!IsPlaying(v)) {
+      std::copy(voices_.active_.begin() + i + 1,
+                voices_.active_.begin() + voices_.num_active_,
+                voices_.active_.begin() + i);
+      --voices_.num_active_;
+
+      FreeVoice(v);
+      return;
+    }
+  }
+}
+
+bool Sampler::ResolveRange(const Sample* sample, float from, float to,
+                           float rate, int* start, int* end) {
   // We don't scale this to the rate, this is the window in which we look
   // for samples.
   int range = static_cast<int>(sample->DurationSamples());
-  int sstart = std::max(0, std::min(static_cast<int>(range * p.start_), range));
-  int ssend = std::max(0, std::min(static_cast<int>(range * p.end_), range));
+  *start = std::max(0, std::min(static_cast<int>(range * from), range));
+  *end = std::max(0, std::min(static_cast<int>(range * to), range));
 
   // Prevent glitches if the sample to play is too small. We might
   // need to find a better approach here, devices like elektron
   // machines can play in loop very short samples without glitch,
   // likely through some interpolation.
-  const float durationMs =
-      sample->DurationMs(std::abs(ssend - sstart)) * p.rate_;
-  if (durationMs <= kSampleMinimalDurationMs) {
+  const float durationMs = sample->DurationMs(std::abs(*end - *start)) * rate;
+  return durationMs > kSampleMinimalDurationMs;
+}
+
+bool Sampler::StartVoice(int v) {
+  int start;
+  int end;
+  const float rate = voices_.rate_[v];
+  if (!ResolveRange(voices_.sample_[v], voices_.from_[v], voices_.to_[v], rate,
+                    &start, &end)) {
+    return false;
+  }
+
+  voices_.pos_[v] = start;
+  voices_.end_[v] = end;
+  voices_.step_[v] = (start < end) ? rate : -rate;
+
+  return true;
+}
+
+void Sampler::StartPendingVoices() {
+  for (int i = 0; i < voices_.num_active_; ++i) {
+    const int v = voices_.active_[i];
+
+    if (voices_.sample_[v] != nullptr || voices_.removing_[v]) {
+      continue;
+    }
+
+    bool failed = false;
+    voices_.sample_[v] =
+        sample_manager_->GetPinnedSample(voices_.handle_[v], &failed);
+    if (voices_.sample_[v] != nullptr) {
+      voices_.removing_[v] = !StartVoice(v);
+    } else if (failed) {
+      voices_.removing_[v] = true;
+    }
+  }
+}
+
+void Sampler::PlaySample(SampleHandle handle, const PlaySampleParameters& p) {
+  // The sample stays pinned for the lifetime of the voice, even while
+  // it's pending.
+  if (!sample_manager_->PinSample(handle)) {
     return;
   }
 
-  auto ps = std::make_unique<PlayingSample>();
+  // The range of resident samples is checked upfront so that a range
+  // too short to be played doesn't steal other voices.
+  bool failed = false;
+  Sample* sample = sample_manager_->GetPinnedSample(handle, &failed);
+  int start;
+  int end;
+  if (failed || (sample != nullptr && !ResolveRange(sample, p.start_, p.end_,
+                                                    p.rate_, &start, &end))) {
+    sample_manager_->UnpinSample(handle);
+    return;
+  }
 
-  ps->start_ = sstart;
-  ps->end_ = ssend;
-  ps->pos_ = sstart;
-  ps->sample_ = sample;
-  ps->inc_ = (sstart < ssend) ? 1 : -1;
-  ps->pan_ = p.pan_;
-  ps->rate_ = p.rate_;
-  ps->amp_ = p.amp_;
+  // Chokes the voices of the same group.
+  if (p.choke_ != 0) {
+    for (int i = 0; i < voices_.num_active_; ++i) {
+      const int v = voices_.active_[i];
 
-  ps->pan_.SetRange(-1.0f, 1.0f);
-  ps->amp_.SetRange(0.0f, 1.0f);
+      if (voices_.choke_[v] == p.choke_) {
+        FadeVoice(v);
+      }
+    }
+  }
+
+  if (steal_ == StealPolicy::RETRIGGER) {
+    for (int i = 0; i < voices_.num_active_; ++i) {
+      const int v = voices_.active_[i];
+
+      if (voices_.handle_[v] == handle) {
+        FadeVoice(v);
+      }
+    }
+  }
+
+  // Makes room for the new voice within the polyphony limits of the
+  // sample and of the sampler, stolen voices fade out.
+  if (p.voices_ > 0) {
+    for (int playing = CountPlaying(handle); playing >= p.voices_; --playing) {
+      FadeVoice(FindVictim(handle));
+    }
+  }
+  for (int playing = CountPlaying(kInvalidSampleHandle);
+       playing >= max_voices_; --playing) {
+    FadeVoice(FindVictim(kInvalidSampleHandle));
+  }
+
+  // All slots can still be taken by fading voices, in which case the
+  // oldest one is cut to keep a hard ceiling on the number of voices.
+  if (voices_.num_free_ == 0) {
+    FreeFadingVoice();
+  }
+
+  const int v = voices_.free_[--voices_.num_free_];
+  voices_.active_[voices_.num_active_++] = v;
+
+  voices_.handle_[v] = handle;
+  voices_.sample_[v] = sample;
+  voices_.from_[v] = p.start_;
+  voices_.to_[v] = p.end_;
+  voices_.rate_[v] = p.rate_;
+  voices_.removing_[v] = false;
+  if (sample != nullptr) {
+    StartVoice(v);
+  }
+  voices_.fade_[v] = 0;
+  voices_.choke_[v] = p.choke_;
+
+  // The voice isn't rendered yet, it is considered at full level so
+  // that it isn't the first one to be stolen.
+  voices_.level_[v] = 1.0f;
+
+  voices_.pan_[v] = p.pan_;
+  voices_.amp_[v] = p.amp_;
+
+  voices_.pan_[v].SetRange(-1.0f, 1.0f);
+  voices_.amp_[v].SetRange(0.0f, 1.0f);
 
   // This is for the envelope to prevent glitches.
 
@@ -62,133 +293,114 @@ void Sampler::PlaySample(Sample* sample, const PlaySampleParameters& p) {
   const float decayMs = 0.0f;
   const float level = 1.0f;
 
-  absl::Status status = ps->wrapper_.Init(attackMs, decayMs, releaseMs, level);
+  auto& wrapper = voices_.wrapper_[v];
+  wrapper.Reset();
+  absl::Status status = wrapper.Init(attackMs, decayMs, releaseMs, level);
   if (status != absl::OkStatus()) {
     LOG(WARNING) << "Failed to initialize envelope in play sample: " << status;
   }
 
-  ps->wrapper_.NoteOn();
+  wrapper.NoteOn();
 
   // This is for the envelope controlled by the user.
 
-  status = ps->env_.Init(p.attack_, p.decay_, p.release_, p.level_);
+  auto& env = voices_.env_[v];
+  env.Reset();
+  status = env.Init(p.attack_, p.decay_, p.release_, p.level_);
   if (status != absl::OkStatus()) {
     LOG(WARNING) << "Failed to initialize envelope in play sample: " << status;
   }
-  ps->env_.NoteOn();
-
-  playing_[sample].push_back(std::move(ps));
+  env.NoteOn();
 }
 
-void Sampler::StopSample(Sample* sample) {
-  if (sample == nullptr) {
-    return;
-  }
-
-  auto it = playing_.find(sample);
-
-  if (it == playing_.end()) {
-    return;
-  }
-
-  if (!it->second.empty()) {
-    auto ps = it->second.back().get();
-
-    ps->wrapper_.NoteOff();
-  }
-}
-
-Sample* Sampler::GetSample(const std::string& pack, const std::string& name) {
-  auto sample_pack = sample_manager_->GetPack(pack);
-  if (sample_pack == nullptr) {
-    return nullptr;
+void Sampler::StopSample(SampleHandle handle) {
+  // Stops the last triggered voice of the sample, pending voices are
+  // dropped as they never started.
+  for (int i = voices_.num_active_ - 1; i >= 0; --i) {
+    const int v = voices_.active_[i];
+
+    if (voices_.handle_[v] == handle && IsPlaying(v)) {
+      if (voices_.sample_[v] == nullptr) {
+        voices_.removing_[v] = true;
+      } else {
+        voices_.wrapper_[v].NoteOff();
+      }
+      return;
+    }
   }
-
-  return sample_pack->GetSample(name);
 }
 
-void Sampler::PlaySampleParameters::FromJson(Controls* controls,
-                                             const nlohmann::json& json,
-                                             PlaySampleParameters* p) {
+void Sampler::PlaySampleParameters::FromPayload(
+    Controls* controls, const SamplerPlayPayload& payload,
+    PlaySampleParameters* p) {
   // Offsets
-  if (json.contains("start")) {
-    p->start_ = json["start"].get<double>();
-  }
-  if (json.contains("end")) {
-    p->end_ = json["end"].get<double>();
-  }
+  p->start_ = payload.start_;
+  p->end_ = payload.end_;
 
   // Pan
-  if (json.contains("pan")) {
-    if (json["pan"].is_string()) {
-      p->pan_.SetControl(controls, json["pan"].get<std::string>());
-    } else {
-      p->pan_.SetConstant(json["pan"].get<double>());
-    }
+  if (payload.pan_.control_ != kInvalidControlId) {
+    p->pan_.SetControl(controls, payload.pan_.control_);
+  } else {
+    p->pan_.SetConstant(payload.pan_.value_);
   }
 
   // Playback rate
-  if (json.contains("rate")) {
-    p->rate_ = json["rate"].get<double>();
-
-    // This is a trick, if the rate is negative, we want to play the
-    // sample backward. As we already handle inverted start/end to do
-    // so, we re-use the same mecanism here to not have to fiddle too
-    // much with the rendering which is already complex.
-    if (p->rate_ < 0.0f) {
-      float swap = p->start_;
-
-      p->start_ = p->end_;
-      p->end_ = swap;
-
-      p->rate_ = -p->rate_;
-    }
+  p->rate_ = payload.rate_;
+
+  // This is a trick, if the rate is negative, we want to play the
+  // sample backward. As we already handle inverted start/end to do
+  // so, we re-use the same mecanism here to not have to fiddle too
+  // much with the rendering which is already complex.
+  if (p->rate_ < 0.0f) {
+    std::swap(p->start_, p->end_);
+    p->rate_ = -p->rate_;
   }
 
   // Envelope
-  if (json.contains("attack")) {
-    p->attack_ = json["attack"].get<double>();
-  }
-  if (json.contains("decay")) {
-    p->decay_ = json["decay"].get<double>();
-  }
-  if (json.contains("level")) {
-    p->level_ = json["level"].get<double>();
-  }
-  if (json.contains("release")) {
-    p->release_ = json["release"].get<double>();
-  }
+  p->attack_ = payload.attack_;
+  p->decay_ = payload.decay_;
+  p->level_ = payload.level_;
+  p->release_ = payload.release_;
 
   // Amplitude
-  if (json.contains("amp")) {
-    if (json["amp"].is_string()) {
-      p->amp_.SetControl(controls, json["amp"].get<std::string>());
-    } else {
-      p->amp_.SetConstant(json["amp"].get<double>());
-    }
+  if (payload.amp_.control_ != kInvalidControlId) {
+    p->amp_.SetControl(controls, payload.amp_.control_);
+  } else {
+    p->amp_.SetConstant(payload.amp_.value_);
   }
+
+  // Polyphony
+  p->voices_ = payload.voices_;
+  p->choke_ = payload.choke_;
 }
 
 void Sampler::HandleSysex(const MidiSysexInstruction& sysex) {
-  auto params = nlohmann::json::parse(sysex.json_payload, nullptr, false);
-
-  auto pack = params["pack"].get<std::string>();
-  auto name = params["name"].get<std::string>();
-
   switch (sysex.type) {
     case MidiSysexType::SAMPLER_PLAY: {
+      SamplerPlayPayload payload;
+      if (!payload.Decode(sysex.payload, sysex.payload_size)) {
+        LOG(WARNING) << "Invalid sample play payload";
+        break;
+      }
+
       PlaySampleParameters p;
-      PlaySampleParameters::FromJson(controls_, params, &p);
+      PlaySampleParameters::FromPayload(controls_, payload, &p);
 
       p.pan_.SetRange(-1.0f, 1.0f);
       p.amp_.SetRange(0.0f, 1.0f);
 
-      PlaySample(GetSample(pack, name), p);
+      PlaySample(payload.sample_, p);
       break;
     }
 
     case MidiSysexType::SAMPLER_STOP: {
-      StopSample(GetSample(pack, name));
+      SamplerStopPayload payload;
+      if (!payload.Decode(sysex.payload, sysex.payload_size)) {
+        LOG(WARNING) << "Invalid sample stop payload";
+        break;
+      }
+
+      StopSample(payload.sample_);
       break;
     }
 
@@ -198,117 +410,264 @@ void Sampler::HandleSysex(const MidiSysexInstruction& sysex) {
   }
 }
 
-void Sampler::ProcessMidiEvents(SampleTick tick) {
-  std::list<MidiEventAt> events_at;
+void Sampler::ProcessMidiEvent(const MidiEventAt& event_at) {
+  auto type = event_at.Type();
 
-  midi_stack_.EventsAtTick(tick, events_at);
+  switch (type) {
+    case libremidi::message_type::SYSTEM_EXCLUSIVE: {
+      MidiSysexInstruction sysex;
+      if (!sysex.ParseFromBytes(event_at.Bytes() + 1, event_at.Size() - 1)) {
+        LOG(WARNING) << "Failed to parse sysex message in sampler";
+        break;
+      }
 
-  // Process MIDI events.
-  //
-  // For now we don't have timing information in MIDI events so we
-  // don't split this code in a dedicated function as the two logics
-  // (midi/DSP) will be interleaved at some point.
-  for (auto event_at : events_at) {
-    auto msg = event_at.Msg();
-    auto type = msg.get_message_type();
+      HandleSysex(sysex);
 
-    switch (type) {
-      case libremidi::message_type::SYSTEM_EXCLUSIVE: {
-        MidiSysexInstruction sysex;
-        if (!sysex.ParseFromBytes(msg.bytes.data() + 1, msg.bytes.size() - 1)) {
-          LOG(WARNING) << "Failed to parse sysex message in sampler";
-          break;
-        }
+      break;
+    }
+
+    default:
+      break;
+  };
+}
 
-        HandleSysex(sysex);
+void Sampler::RenderSpan(SampleTick tick, int from, int to, float* left_chan,
+                         float* right_chan) {
+  for (int i = 0; i < voices_.num_active_; ++i) {
+    const int v = voices_.active_[i];
 
-        break;
-      }
+    if (!voices_.removing_[v] && voices_.sample_[v] != nullptr) {
+      RenderVoice(v, tick, from, to, left_chan, right_chan);
+    }
+  }
+}
+
+void Sampler::RenderVoice(int v, SampleTick tick, int from, int to,
+                          float* left_chan, float* right_chan) {
+  const Sample* sample = voices_.sample_[v];
+  const float pos = voices_.pos_[v];
+  const float step = voices_.step_[v];
+  const float speed = std::fabs(step);
+
+  // Number of output samples until the position moves past the end
+  // of the sample (the voice ends on that one), and until it gets
+  // close enough to the end that the wrapper has to be released so
+  // that we do not glitch at the end of the sample.
+  const float distance = std::fabs(voices_.end_[v] - pos);
+  const float until_end = std::ceil(distance / speed);
+  const float until_release =
+      std::ceil((distance - kSampleMinimalSmoothingSamples) / speed);
+
+  int count = to - from;
+  bool ended = false;
+  if (until_end <= count) {
+    count = std::max(1, static_cast<int>(until_end));
+    ended = true;
+  }
+  const int release_at = static_cast<int>(
+      std::clamp(until_release, 0.0f, static_cast<float>(count)));
+
+  float* gain = gain_.data();
+  float* env = env_.data();
+  float* left_gain = left_gain_.data();
+  float* right_gain = right_gain_.data();
+
+  // Gains of the span: both envelopes, the amplitude and the pan.
+  auto& wrapper = voices_.wrapper_[v];
+  wrapper.Fill(gain, release_at);
+  if (release_at < count) {
+    wrapper.NoteOff();
+    wrapper.Fill(gain + release_at, count - release_at);
+  }
+
+  voices_.env_[v].Fill(env, count);
+
+  // The amplitude and pan are filled in place of the channel gains.
+  voices_.amp_[v].Fill(tick + from, count, left_gain);
+  voices_.pan_[v].Fill(tick + from, count, right_gain);
+  for (int i = 0; i < count; ++i) {
+    gain[i] *= env[i] * left_gain[i];
+
+    const float p = right_gain[i];
+    left_gain[i] = LeftPan(p);
+    right_gain[i] = RightPan(p);
+  }
+
+  // Stolen voices fade out linearly and end once silent.
+  const int fade = voices_.fade_[v];
+  if (fade > 0) {
+    const int n = std::min(count, fade);
+    for (int i = 0; i < n; ++i) {
+      gain[i] *= static_cast<float>(fade - i) / kSampleStealFadeSamples;
+    }
+    count = n;
+    voices_.fade_[v] = fade - n;
+    ended = ended || voices_.fade_[v] == 0;
+  }
 
-      default:
-        continue;
-    };
+  // The voice ends on the first silent sample.
+  for (int i = 0; i < count; ++i) {
+    if (gain[i] == 0.0f) {
+      count = i + 1;
+      ended = true;
+      break;
+    }
+  }
+
+  float* left = left_chan + from;
+  float* right = right_chan + from;
+
+  if (sample->Format() == SampleFormat::FLOAT32) {
+    MixFrames(sample->lb_.data(), sample->rb_.data(), sample->Channels(), 0,
+              pos, step, 0, count, left, right);
+  } else {
+    MixDecodedFrames(sample, pos, step, count, left, right);
   }
+
+  voices_.pos_[v] = pos + count * step;
+  voices_.level_[v] = gain[count - 1];
+  voices_.removing_[v] = ended;
 }
 
-float Sampler::Interpolate(const std::vector<float>& v, float pos) {
-  // Here the goal is to find an interpolated value between two
-  // samples. We are using a linear interpolation for now but we could
-  // use a more complex interpolation method in the future.
+void Sampler::MixFrames(const float* lb, const float* rb, int channels,
+                        int base, float pos, float step, int from, int to,
+                        float* left, float* right) {
+  switch (interpolation_) {
+    case Interpolation::HERMITE:
+      MixInterpolated(dsp::HermiteKernel(), lb, rb, channels, base, pos, step,
+                      from, to, left, right);
+      break;
+    case Interpolation::SINC:
+      MixInterpolated(dsp::SincKernel(), lb, rb, channels, base, pos, step,
+                      from, to, left, right);
+      break;
+    default:
+      MixInterpolated(dsp::LinearKernel(), lb, rb, channels, base, pos, step,
+                      from, to, left, right);
+      break;
+  }
+}
 
-  float v0 = v[static_cast<int>(pos) % v.size()];
-  float v1 = v[(static_cast<int>(pos) + 1) % v.size()];
+template <typename Kernel>
+void Sampler::MixInterpolated(const Kernel& kernel, const float* lb,
+                              const float* rb, int channels, int base,
+                              float pos, float step, int from, int to,
+                              float* left, float* right) {
+  const float* gain = gain_.data();
+  const float* left_gain = left_gain_.data();
+  const float* right_gain = right_gain_.data();
+
+  // The position is derived from the start of the span so there is no
+  // dependency in between iterations, and kernels read the guards of
+  // the sample past its edges so there are no bounds checks.
+  if (channels == 1) {
+    // Mono samples are interpolated once and fanned out to both sides
+    // through the pan gains.
+    for (int i = from; i < to; ++i) {
+      const float p = std::max(pos + i * step, 0.0f);
+      const int i0 = static_cast<int>(p);
+      const float t = p - static_cast<float>(i0);
+
+      const float m = kernel(lb + i0 - base, t) * gain[i];
+
+      left[i] += m * left_gain[i];
+      right[i] += m * right_gain[i];
+    }
+  } else {
+    for (int i = from; i < to; ++i) {
+      const float p = std::max(pos + i * step, 0.0f);
+      const int i0 = static_cast<int>(p);
+      const float t = p - static_cast<float>(i0);
 
-  float w1 = pos - static_cast<int>(pos);
-  float w0 = 1.0f - w1;
+      const float l = kernel(lb + i0 - base, t);
+      const float r = kernel(rb + i0 - base, t);
 
-  return v0 * w0 + v1 * w1;
+      left[i] += l * gain[i] * left_gain[i];
+      right[i] += r * gain[i] * right_gain[i];
+    }
+  }
 }
 
-void Sampler::Render(SampleTick tick, const std::list<MidiEventAt>& events,
-                     AudioBuffer& buffer) {
-  midi_stack_.AddEvents(events);
+void Sampler::MixDecodedFrames(const Sample* sample, float pos, float step,
+                               int count, float* left, float* right) {
+  const int frames = static_cast<int>(sample->DurationSamples());
+
+  // Output samples per chunk so that the frames they read, including
+  // the ones around the positions read by the kernels, fit in the
+  // scratch buffers.
+  const int chunk = 1 + static_cast<int>((kScratchFrames - dsp::kSincTaps - 1) /
+                                         std::fabs(step));
+
+  for (int from = 0; from < count; from += chunk) {
+    const int to = std::min(count, from + chunk);
+
+    const float first = pos + from * step;
+    const float end = pos + (to - 1) * step;
+    const int lo =
+        std::clamp(static_cast<int>(std::min(first, end)), 0, frames);
+    const int hi =
+        std::clamp(static_cast<int>(std::max(first, end)), lo, frames);
+
+    // The guards of the sample are decoded along with its frames.
+    const int size =
+        hi - lo + 1 + dsp::kInterpolationBefore + dsp::kInterpolationAfter;
+    sample->Decode(0, lo - dsp::kInterpolationBefore, size,
+                   left_frames_.data());
+    if (sample->Channels() > 1) {
+      sample->Decode(1, lo - dsp::kInterpolationBefore, size,
+                     right_frames_.data());
+    }
+
+    MixFrames(left_frames_.data() + dsp::kInterpolationBefore,
+              right_frames_.data() + dsp::kInterpolationBefore,
+              sample->Channels(), lo, pos, step, from, to, left, right);
+  }
+}
+
+void Sampler::ReleaseVoices() {
+  int kept = 0;
+
+  for (int i = 0; i < voices_.num_active_; ++i) {
+    const int v = voices_.active_[i];
 
+    if (voices_.removing_[v]) {
+      FreeVoice(v);
+    } else {
+      voices_.active_[kept++] = v;
+    }
+  }
+
+  voices_.num_active_ = kept;
+}
+
+void Sampler::Render(SampleTick tick, const MidiBlock& events,
+                     AudioBuffer& buffer) {
   float* left_chan = buffer.GetChannel(kLeftChannel);
   float* right_chan = buffer.GetChannel(kRightChannel);
+  const int size = buffer.Size();
+
+  StartPendingVoices();
+
+  // Render contiguous spans of samples in between events, so that
+  // each event is processed exactly at its tick.
+  size_t next = 0;
+  int from = 0;
+  while (from < size) {
+    while (next < events.Size() && events.Offset(next) <= from) {
+      ProcessMidiEvent(events.At(next));
+      ++next;
+    }
 
-  std::set<PlayingSample*> remove;
-
-  for (int i = 0; i < buffer.Size(); ++i) {
-    const SampleTick current_tick = tick + i;
-
-    ProcessMidiEvents(current_tick);
-
-    float left = left_chan[i];
-    float right = right_chan[i];
-
-    for (auto& [sample, list] : playing_) {
-      for (auto& ps : list) {
-        if (ps->removing_) {
-          continue;
-        }
-
-        // Trigger a note-off if we are near the very end of the
-        // sample ; this is to ensure we do not glitch at the end of
-        // the sample.
-        if ((ps->inc_ > 0 &&
-             ps->pos_ + kSampleMinimalSmoothingSamples >= ps->end_) ||
-            (ps->inc_ < 0 &&
-             ps->pos_ - kSampleMinimalSmoothingSamples <= ps->end_)) {
-          ps->wrapper_.NoteOff();
-        }
-
-        const float wrapper_env = ps->wrapper_.GetNextEnvelope();
-        const float user_env = ps->env_.GetNextEnvelope();
-        const float amp = ps->amp_.GetValue(current_tick);
-        const float env = wrapper_env * user_env * amp;
-        const float pan = ps->pan_.GetValue(current_tick);
-
-        left += Interpolate(ps->sample_->lb_, ps->pos_) * env * LeftPan(pan);
-        right += Interpolate(ps->sample_->rb_, ps->pos_) * env * RightPan(pan);
-
-        // Update the position of the sample taking into account the rate
-        // of playback.
-        ps->pos_ += static_cast<float>(ps->inc_) * ps->rate_;
-
-        if (env == 0.0f || (ps->inc_ > 0 && (ps->pos_ >= ps->end_)) ||
-            (ps->inc_ < 0 && (ps->pos_ <= ps->end_))) {
-          ps->removing_ = true;
-          remove.insert(ps.get());
-        }
-      }
+    int to = size;
+    if (next < events.Size()) {
+      to = std::min(size, events.Offset(next));
     }
 
-    left_chan[i] = left;
-    right_chan[i] = right;
+    RenderSpan(tick, from, to, left_chan, right_chan);
+    from = to;
   }
 
-  for (auto ps : remove) {
-    playing_[ps->sample_].remove_if(
-        [ps](const std::unique_ptr<PlayingSample>& p) {
-          return p.get() == ps;
-        });
-  }
+  ReleaseVoices();
 }
 
 }  // namespace inst
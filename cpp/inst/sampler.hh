@@ -2,9 +2,8 @@
 
 #include <absl/status/status.h>
 
+#include <array>
 #include <libremidi/libremidi.hpp>
-#include <list>
-#include <map>
 #include <memory>
 #include <nlohmann/json.hpp>
 
@@ -17,6 +16,7 @@
 #include "core/parameter.hh"
 #include "core/sample_manager.hh"
 #include "core/sample_pack.hh"
+#include "dsp/interpolation.hh"
 #include "inst/instrument.hh"
 #include "utils/config.hh"
 
@@ -32,19 +32,42 @@ static constexpr float kSampleMinimalDurationMs = 2 * kSampleMinimalSmoothingMs;
 static constexpr int kSampleMinimalSmoothingSamples =
     kSampleMinimalDurationMs * kSampleRate / 1000;
 
+// Stolen and choked voices are faded out linearly over this duration
+// instead of being cut.
+static constexpr float kSampleStealFadeMs = 5.0f;
+static constexpr int kSampleStealFadeSamples =
+    kSampleStealFadeMs * kSampleRate / 1000;
+
 // This is the main class that will handle the rendering of the samples
 class Sampler : public Instrument {
  public:
+  Sampler();
+  ~Sampler();
+
   absl::Status Init(const std::string& settings, SampleManager* sample_manager,
                     Controls* controls);
-  void Render(SampleTick tick, const std::list<MidiEventAt>&, AudioBuffer&);
+  void Render(SampleTick tick, const MidiBlock& events, AudioBuffer& buffer);
   Type GetType() const { return Type::SAMPLER; }
   std::string GetName() const { return "Sampler"; }
 
  private:
-  void ProcessMidiEvents(SampleTick tick);
+  void ProcessMidiEvent(const MidiEventAt& event);
   void HandleSysex(const MidiSysexInstruction& sysex);
 
+  // How a voice is selected to make room for a new one once a
+  // polyphony limit is reached.
+  enum class StealPolicy {
+    // The voice triggered first is stolen.
+    OLDEST,
+    // The voice with the lowest gain at the end of the last rendered
+    // block is stolen.
+    QUIETEST,
+    // A new voice of a sample replaces the voices of the same sample
+    // still playing, falls back to the oldest voice when the sampler
+    // is full.
+    RETRIGGER,
+  };
+
   // Parameters for PlaySample
   struct PlaySampleParameters {
     float start_ = 0.0f;
@@ -57,46 +80,191 @@ class Sampler : public Instrument {
     float release_ = 0.0f;
     Parameter amp_ = 1.0f;
 
-    static void FromJson(Controls* controls, const nlohmann::json& v,
-                         PlaySampleParameters* p);
+    // Maximum number of voices of the sample playing at once, 0 for no
+    // limit other than the one of the sampler.
+    int voices_ = 0;
+
+    // Starting a voice fades out all the voices of the same choke
+    // group (e.g. a closed hi-hat cutting an open one), 0 for none.
+    int choke_ = 0;
+
+    static void FromPayload(Controls* controls,
+                            const SamplerPlayPayload& payload,
+                            PlaySampleParameters* p);
   };
 
-  void PlaySample(Sample* sp, const PlaySampleParameters& p);
-  void StopSample(Sample* s);
-  Sample* GetSample(const std::string& pack, const std::string& name);
-  float Interpolate(const std::vector<float>& v, float pos);
+  // Samples which aren't resident yet are played by a silent voice
+  // which starts once they are, see SampleManager::PinSample.
+  void PlaySample(SampleHandle handle, const PlaySampleParameters& p);
+  void StopSample(SampleHandle handle);
 
-  // We only support MONO audio for now.
-  struct PlayingSample {
-    float pos_;
-    Sample* sample_;
-    bool removing_ = false;
+  // Maximum number of voices allocated on a sampler, this is a hard
+  // ceiling: fading voices count against it while the polyphony limit
+  // only counts playing voices.
+  static constexpr int kMaxVoices = 256;
 
-    int start_;
-    int end_;
-    int inc_;
-    Parameter pan_;
-    float rate_;
-    Parameter amp_;
+  // Kernel used to read samples in between their frames, from the
+  // cheapest to the least aliasing when playing at another rate.
+  enum class Interpolation {
+    LINEAR,
+    HERMITE,
+    SINC,
+  };
+
+  // Polyphony limit when not set in the settings of the sampler.
+  static constexpr int kDefaultMaxVoices = 64;
+
+  // Voices in structure-of-arrays layout: the state of all voices is
+  // kept in contiguous arrays indexed by voice, and voices are
+  // recycled through a free list so that triggering a note never
+  // allocates.
+  struct Voices {
+    std::array<SampleHandle, kMaxVoices> handle_ = {};
+
+    // Pinned sample of the voice, null while the voice is pending: its
+    // sample isn't resident yet and it waits silently for it.
+    std::array<Sample*, kMaxVoices> sample_ = {};
+
+    // Playback range as fractions of the sample, resolved into
+    // positions once the sample is resident.
+    std::array<float, kMaxVoices> from_ = {};
+    std::array<float, kMaxVoices> to_ = {};
+    std::array<float, kMaxVoices> rate_ = {};
+
+    std::array<float, kMaxVoices> pos_ = {};
+    std::array<float, kMaxVoices> end_ = {};
+
+    // Signed increment of the position per output sample, negative
+    // when playing backward.
+    std::array<float, kMaxVoices> step_ = {};
+
+    std::array<bool, kMaxVoices> removing_ = {};
+
+    // Remaining samples of the fade out of a stolen or choked voice,
+    // 0 when the voice is not fading.
+    std::array<int, kMaxVoices> fade_ = {};
+
+    // Gain of the voice at the end of the last rendered block, used
+    // to find the quietest voice.
+    std::array<float, kMaxVoices> level_ = {};
+
+    std::array<int, kMaxVoices> choke_ = {};
+    std::array<Parameter, kMaxVoices> pan_;
+    std::array<Parameter, kMaxVoices> amp_;
 
     // This ADSR envelope is used to avoid glitches at the beginning
     // and at the end of samples, which is utils with raw data where
     // there is directly something starting with a non-zero value in
     // the first or the last sample.
-    ADSR wrapper_;
+    std::array<ADSR, kMaxVoices> wrapper_;
 
     // This ADSR envelope is on top of the previous one and is
     // controlled by the live code.
-    ADSR env_;
+    std::array<ADSR, kMaxVoices> env_;
+
+    // Playing voices in trigger order, and free voices.
+    std::array<int, kMaxVoices> active_;
+    int num_active_ = 0;
+    std::array<int, kMaxVoices> free_;
+    int num_free_ = 0;
   };
 
-  // We handle playing multiple times the same sample, we can remove
-  // then from the list when they are done or in a FIFO mode if the
-  // user triggers a midi note off.
-  std::map<Sample*, std::list<std::unique_ptr<PlayingSample>>> playing_;
-  SampleManager* sample_manager_;
-  Controls* controls_;
-  MidiStack midi_stack_;
+  // Whether a voice is playing, as opposed to fading out or done.
+  bool IsPlaying(int voice) const {
+    return !voices_.removing_[voice] && voices_.fade_[voice] == 0;
+  }
+
+  // Number of playing voices of the sample, or of all samples if
+  // handle is kInvalidSampleHandle.
+  int CountPlaying(SampleHandle handle) const;
+
+  // Selects a playing voice to steal according to the policy, among
+  // the voices of the sample or all voices if handle is
+  // kInvalidSampleHandle. Returns -1 if there is none.
+  int FindVictim(SampleHandle handle) const;
+
+  // Resolves a playback range given as fractions of a sample into
+  // positions, returns false if it's too short to be played.
+  static bool ResolveRange(const Sample* sample, float from, float to,
+                           float rate, int* start, int* end);
+
+  // Sets the playback positions of a voice from its range once its
+  // sample is resident, returns false if the range is too short to be
+  // played.
+  bool StartVoice(int voice);
+
+  // Starts the pending voices whose sample became resident, and drops
+  // the ones whose sample can't be loaded.
+  void StartPendingVoices();
+
+  // Unpins the sample of a voice and returns it to the free list.
+  void FreeVoice(int voice);
+
+  // Starts fading out a voice, it keeps its slot until it is done.
+  void FadeVoice(int voice);
+
+  // Immediately frees the oldest voice which is fading out or done,
+  // this is only needed when all slots are taken.
+  void FreeFadingVoice();
+
+  // Renders all playing voices over [from, to) of the block, voices
+  // which are done are flagged as removing and released at the end
+  // of the block.
+  void RenderSpan(SampleTick tick, int from, int to, float* left_chan,
+                  float* right_chan);
+
+  // Renders a voice over [from, to) of the block: its gains are
+  // computed for the whole span first, then it is interpolated and
+  // mixed into the output in a single loop over contiguous buffers.
+  void RenderVoice(int voice, SampleTick tick, int from, int to,
+                   float* left_chan, float* right_chan);
+
+  // Interpolates frames of a voice with the kernel of the sampler and
+  // mixes them with the gains of the span over [from, to). lb and rb
+  // hold the frames of the sample from base, with the frames around
+  // them read by the kernels.
+  void MixFrames(const float* lb, const float* rb, int channels, int base,
+                 float pos, float step, int from, int to, float* left,
+                 float* right);
+
+  template <typename Kernel>
+  void MixInterpolated(const Kernel& kernel, const float* lb, const float* rb,
+                       int channels, int base, float pos, float step,
+                       int from, int to, float* left, float* right);
+
+  // Same as MixFrames for samples stored as integers: the frames are
+  // decoded by chunks into the scratch buffers just ahead of the
+  // position, then mixed.
+  void MixDecodedFrames(const Sample* sample, float pos, float step,
+                        int count, float* left, float* right);
+
+  // Releases voices flagged as removing, keeping the trigger order
+  // of the others.
+  void ReleaseVoices();
+
+  Voices voices_;
+
+  // Settings of the sampler.
+  int max_voices_ = kDefaultMaxVoices;
+  StealPolicy steal_ = StealPolicy::OLDEST;
+  Interpolation interpolation_ = Interpolation::LINEAR;
+
+  // Scratch buffers of RenderVoice.
+  std::array<float, kBlockSize> gain_;
+  std::array<float, kBlockSize> env_;
+  std::array<float, kBlockSize> left_gain_;
+  std::array<float, kBlockSize> right_gain_;
+
+  // Frames decoded from samples stored as integers. Voices are
+  // rendered one after the other so they share the same buffers,
+  // sized for a block at the original rate and the frames around it
+  // read by the kernels.
+  static constexpr int kScratchFrames = kBlockSize + dsp::kSincTaps;
+  std::array<float, kScratchFrames> left_frames_;
+  std::array<float, kScratchFrames> right_frames_;
+
+  SampleManager* sample_manager_ = nullptr;
+  Controls* controls_ = nullptr;
 };
 
 }  // namespace inst
@@ -10,6 +10,7 @@
 #include <nlohmann/json.hpp>
 
 #include "bindings/rt.hh"
+#include "core/controls.hh"
 #include "core/midi_event.hh"
 
 namespace py = pybind11;
@@ -31,7 +32,7 @@ absl::Status Runtime::Init(const utils::Config& config, Engine* dsp) {
   LOG(INFO) << "Initializing runtime";
 
   dsp_ = dsp;
-  current_time_ = absl::Now();
+  current_time_ = time_source_->Now();
   SetBPM(config.GetOrDefault<uint16_t>("live.initial_bpm", 120));
 
   Beat();
@@ -95,6 +96,89 @@ uint64_t Runtime::MicroBeatToBeat(MicroBeat beat) const {
   return beat / kOneBeat;
 }
 
+void Runtime::SetupInterpreter() {
+  py::module_ sys = py::module_::import("sys");
+  py::module_ rt_mod = py::module_::import("soir.rt");
+
+  LOG(INFO) << "Python version: " << std::string(py::str(sys.attr("version")));
+
+  // Setup the initial feedback loop for controls.
+  py::exec("soir.rt._ctrls.update_loop_()", rt_mod.attr("__dict__"));
+}
+
+bool Runtime::RunCallback(std::set<Cb, Cb>::iterator next,
+                          absl::Time at_time) {
+  SOIR_TRACING_ZONE_COLOR("rt::callback", SOIR_GREEN);
+
+  // This is set before the callback is executed so that it can
+  // retrieve accurate timing information.
+  current_time_ = at_time;
+  current_beat_ = next->at;
+
+  try {
+    next->func();
+  } catch (py::error_already_set& e) {
+    if (e.matches(PyExc_SystemExit)) {
+      LOG(INFO) << "Received SystemExit, stopping runtime";
+      return false;
+    }
+    LOG(ERROR) << "Python error: " << e.what();
+  }
+
+  schedule_.erase(next);
+
+  return true;
+}
+
+bool Runtime::EvalCode(const std::string& code) {
+  SOIR_TRACING_ZONE_COLOR("rt:code", SOIR_GREEN);
+
+  py::module_ rt_mod = py::module_::import("soir.rt");
+
+  auto now = time_source_->Now();
+
+  // We do not update current_time_ here: this would delay all
+  // subsequent callbacks by the time it took to apply the code
+  // update. Current time is not available to the Python engine so
+  // it's fine. Current beat is however, and we do want to keep it
+  // accurate so that the Python engine can use it to schedule
+  // events while padding to beat new loop creations with
+  // alignment.
+  current_beat_ += Runtime::DurationToMicroBeat(now - current_time_);
+
+  try {
+    // We set the last evaluated code at the last moment so that
+    // inspection of code can be done only when it is actually
+    // executed.
+    last_evaluated_code_ = code;
+
+    {
+      SOIR_TRACING_ZONE_COLOR("rt::code::exec", SOIR_GREEN);
+      py::exec(code.c_str(), rt_mod.attr("__dict__"));
+    }
+
+    // Maybe here we can have some sort of post-execution hook
+    // that can be used to do some cleanup or other operations.
+    {
+      SOIR_TRACING_ZONE_COLOR("rt::code::hook", SOIR_GREEN);
+      py::exec("soir.rt._internals.post_eval_()", rt_mod.attr("__dict__"));
+      py::exec("soir.rt._ctrls.post_eval_()", rt_mod.attr("__dict__"));
+      py::exec("soir.rt._system.post_eval_()", rt_mod.attr("__dict__"));
+    }
+
+  } catch (py::error_already_set& e) {
+    if (e.matches(PyExc_SystemExit)) {
+      LOG(INFO) << "Received SystemExit, stopping runtime";
+      return false;
+    }
+    LOG(ERROR) << "Python error: " << e.what();
+  }
+
+  SOIR_TRACING_FRAME("rt::frame");
+
+  return true;
+}
+
 absl::Status Runtime::Run() {
   SOIR_TRACING_ZONE_COLOR("rt::run", SOIR_GREEN);
 
@@ -106,13 +190,7 @@ absl::Status Runtime::Run() {
   // Python thread state.
   py::gil_scoped_acquire acquire;
 
-  py::module_ sys = py::module_::import("sys");
-  py::module_ rt_mod = py::module_::import("soir.rt");
-
-  LOG(INFO) << "Python version: " << std::string(py::str(sys.attr("version")));
-
-  // Setup the initial feedback loop for controls.
-  py::exec("soir.rt._ctrls.update_loop_()", rt_mod.attr("__dict__"));
+  SetupInterpreter();
 
   while (true) {
     // We assume there is always at least one callback in the queue
@@ -142,24 +220,9 @@ absl::Status Runtime::Run() {
 
     // Process next callback if time has passed.
     if (at_time <= absl::Now()) {
-      SOIR_TRACING_ZONE_COLOR("rt::callback", SOIR_GREEN);
-
-      // This is set before the callback is executed so that it can
-      // retrieve accurate timing information.
-      current_time_ = at_time;
-      current_beat_ = next->at;
-
-      try {
-        next->func();
-      } catch (py::error_already_set& e) {
-        if (e.matches(PyExc_SystemExit)) {
-          LOG(INFO) << "Received SystemExit, stopping runtime";
-          return absl::OkStatus();
-        }
-        LOG(ERROR) << "Python error: " << e.what();
+      if (!RunCallback(next, at_time)) {
+        return absl::OkStatus();
       }
-
-      schedule_.erase(next);
     }
 
     // Code updates are performed in a second time, after the temporal
@@ -167,48 +230,9 @@ absl::Status Runtime::Run() {
     // code update takes 10ms to be applied, but not OK if it's a kick
     // event for example.
     if (!code.empty()) {
-      SOIR_TRACING_ZONE_COLOR("rt:code", SOIR_GREEN);
-
-      auto now = absl::Now();
-
-      // We do not update current_time_ here: this would delay all
-      // subsequent callbacks by the time it took to apply the code
-      // update. Current time is not available to the Python engine so
-      // it's fine. Current beat is however, and we do want to keep it
-      // accurate so that the Python engine can use it to schedule
-      // events while padding to beat new loop creations with
-      // alignment.
-      current_beat_ += Runtime::DurationToMicroBeat(now - current_time_);
-
-      try {
-        // We set the last evaluated code at the last moment so that
-        // inspection of code can be done only when it is actually
-        // executed.
-        last_evaluated_code_ = code;
-
-        {
-          SOIR_TRACING_ZONE_COLOR("rt::code::exec", SOIR_GREEN);
-          py::exec(code.c_str(), rt_mod.attr("__dict__"));
-        }
-
-        // Maybe here we can have some sort of post-execution hook
-        // that can be used to do some cleanup or other operations.
-        {
-          SOIR_TRACING_ZONE_COLOR("rt::code::hook", SOIR_GREEN);
-          py::exec("soir.rt._internals.post_eval_()", rt_mod.attr("__dict__"));
-          py::exec("soir.rt._ctrls.post_eval_()", rt_mod.attr("__dict__"));
-          py::exec("soir.rt._system.post_eval_()", rt_mod.attr("__dict__"));
-        }
-
-      } catch (py::error_already_set& e) {
-        if (e.matches(PyExc_SystemExit)) {
-          LOG(INFO) << "Received SystemExit, stopping runtime";
-          return absl::OkStatus();
-        }
-        LOG(ERROR) << "Python error: " << e.what();
+      if (!EvalCode(code)) {
+        return absl::OkStatus();
       }
-
-      SOIR_TRACING_FRAME("rt::frame");
     }
 
     UpdateSnapshot();
@@ -222,12 +246,58 @@ absl::Status Runtime::Run() {
   return absl::OkStatus();
 }
 
+absl::Status Runtime::RunOffline(const std::string& code, uint64_t num_blocks,
+                                 VirtualTimeSource* time_source) {
+  SOIR_TRACING_ZONE_COLOR("rt::run-offline", SOIR_GREEN);
+
+  LOG(INFO) << "Rendering " << num_blocks << " blocks offline";
+
+  py::gil_scoped_acquire acquire;
+
+  // Everything runs from this thread in virtual time: callbacks due
+  // before a block are executed, then the block is rendered and the
+  // clock moves forward, there is no waiting at any point.
+  time_source_ = time_source;
+  current_time_ = time_source_->Now();
+
+  SetupInterpreter();
+
+  bool running = EvalCode(code);
+
+  for (uint64_t block = 0; running && block < num_blocks; ++block) {
+    while (true) {
+      auto next = schedule_.begin();
+      auto at_time = Runtime::MicroBeatToTime(next->at);
+
+      if (at_time > time_source_->Now()) {
+        break;
+      }
+
+      if (!RunCallback(next, at_time)) {
+        running = false;
+        break;
+      }
+    }
+
+    dsp_->RenderBlock();
+    time_source->Advance(kBlockSize);
+  }
+
+  schedule_.clear();
+  time_source_ = GetSystemTimeSource();
+
+  return absl::OkStatus();
+}
+
 float Runtime::SetBPM(float bpm) {
   LOG(INFO) << "Setting BPM to " << bpm;
 
   bpm_ = bpm;
   beat_us_ = 60.0 / bpm_ * 1000000.0;
 
+  // Modulators synced to the tempo follow it.
+  dsp_->GetControls()->SetBPM(bpm_);
+
   return bpm_;
 }
 
@@ -245,39 +315,72 @@ void Runtime::MidiNoteOn(const std::string& track, uint8_t channel,
                          uint8_t note, uint8_t velocity) {
   auto message = libremidi::channel_events::note_on(channel, note, velocity);
 
-  dsp_->PushMidiEvent(MidiEventAt(track, message, current_time_));
+  PushMidiEvent(track, message);
 }
 
 void Runtime::MidiNoteOff(const std::string& track, uint8_t channel,
                           uint8_t note, uint8_t velocity) {
   auto message = libremidi::channel_events::note_off(channel, note, velocity);
 
-  dsp_->PushMidiEvent(MidiEventAt(track, message, current_time_));
+  PushMidiEvent(track, message);
 }
 
 void Runtime::MidiCC(const std::string& track, uint8_t channel, uint8_t cc,
                      uint8_t value) {
   auto message = libremidi::channel_events::control_change(channel, cc, value);
 
-  dsp_->PushMidiEvent(MidiEventAt(track, message, current_time_));
+  PushMidiEvent(track, message);
 }
 
 void Runtime::MidiSysex(const std::string& track, MidiSysexType instruction,
-                        const std::string& json_payload) {
-  MidiSysexInstruction inst;
-  inst.type = instruction;
-  inst.json_payload = json_payload;
-
-  std::string inst_serialized = inst.SerializeToBytes();
+                        const std::string& payload) {
+  // The payload is already encoded in the binary layout of the
+  // instruction type, see core/midi_sysex.hh.
+  const std::string inst_serialized =
+      MidiSysexInstruction::Serialize(instruction, payload);
+
+  // Events are stored inline in the queues of the DSP threads, larger
+  // instructions can't go through.
+  if (1 + inst_serialized.size() > kMaxMidiEventSize) {
+    LOG(WARNING) << "Sysex instruction too large (" << inst_serialized.size()
+                 << " bytes), dropping it";
+    return;
+  }
 
   libremidi::midi_bytes bytes;
+  bytes.reserve(1 + inst_serialized.size());
 
   bytes.push_back(static_cast<char>(libremidi::message_type::SYSTEM_EXCLUSIVE));
   bytes.insert(bytes.begin() + 1, inst_serialized.begin(),
                inst_serialized.end());
 
-  dsp_->PushMidiEvent(
-      MidiEventAt(track, libremidi::message(bytes, 0), current_time_));
+  PushMidiEvent(track, libremidi::message(bytes, 0));
+}
+
+void Runtime::PushMidiEvent(const std::string& track,
+                            const libremidi::message& message) {
+  // IDs of removed tracks are reused by new ones.
+  const uint64_t version = dsp_->GetTrackIdsVersion();
+  if (version != track_ids_version_) {
+    track_ids_.clear();
+    track_ids_version_ = version;
+  }
+
+  auto it = track_ids_.find(track);
+
+  if (it == track_ids_.end()) {
+    auto id = dsp_->GetTrackId(track);
+
+    // Events of unknown tracks are dropped, this is the same
+    // behavior as the DSP side when a track is removed.
+    if (!id.ok()) {
+      return;
+    }
+
+    it = track_ids_.emplace(track, *id).first;
+  }
+
+  dsp_->PushMidiEvent(MidiEventAt(it->second, message, current_time_));
 }
 
 std::string Runtime::GetCode() const { return last_evaluated_code_; }
@@ -378,6 +481,36 @@ void Runtime::UpdateSnapshot() {
       {"rms_right", lvl.rms_right},
   };
 
+  auto duration_to_json = [](const DurationSummary& d) -> nlohmann::json {
+    return {
+        {"count", d.count},   {"last_us", d.last_us}, {"mean_us", d.mean_us},
+        {"p50_us", d.p50_us}, {"p99_us", d.p99_us},   {"max_us", d.max_us},
+    };
+  };
+
+  auto stats = dsp_->GetDspStats();
+  auto& jdsp = j["dsp"];
+  jdsp["block_us"] = stats.block_us;
+  jdsp["render"] = duration_to_json(stats.render);
+  jdsp["load"] = stats.load;
+  jdsp["load_avg"] = stats.load_avg;
+  jdsp["deadline_misses"] = stats.deadline_misses;
+  jdsp["underruns"] = stats.underruns;
+  jdsp["overruns"] = stats.overruns;
+  jdsp["realtime_priority"] = stats.realtime_priority;
+  jdsp["realtime_threads"] = stats.realtime_threads;
+  jdsp["cpu_affinity"] = stats.cpu_affinity;
+  jdsp["memory_locked"] = stats.memory_locked;
+  auto& jdsp_tracks = jdsp["tracks"] = nlohmann::json::object();
+  for (const auto& [name, track] : stats.tracks) {
+    auto& jtrack = jdsp_tracks[name];
+    jtrack["render"] = duration_to_json(track.render);
+    auto& jfxs = jtrack["fxs"] = nlohmann::json::object();
+    for (const auto& [fx_name, fx] : track.fxs) {
+      jfxs[fx_name] = duration_to_json(fx);
+    }
+  }
+
   std::scoped_lock lock(snapshot_mutex_);
   snapshot_json_ = j.dump();
 }
@@ -4,12 +4,14 @@
 #include <absl/time/time.h>
 
 #include <condition_variable>
+#include <map>
 #include <memory>
 #include <mutex>
 
 #include "core/common.hh"
 #include "core/engine.hh"
 #include "core/midi_sysex.hh"
+#include "core/time_source.hh"
 #include "utils/config.hh"
 
 namespace soir {
@@ -62,6 +64,13 @@ class Runtime {
 
   absl::Status Run();
 
+  // Evaluates the code and runs the session for the given number of
+  // blocks in virtual time, rendering each block synchronously on the
+  // DSP engine (which must be started with Engine::StartOffline). This
+  // is called instead of Start()/Stop() and returns once done.
+  absl::Status RunOffline(const std::string& code, uint64_t num_blocks,
+                          VirtualTimeSource* time_source);
+
   // This is called from another thread to evaluate a piece of Python
   // code coming from clients. Code is queued to be executed from the
   // Run() loop.
@@ -98,9 +107,19 @@ class Runtime {
  private:
   void UpdateSnapshot();
 
+  // Helpers shared by the real-time and offline loops, they must be
+  // called with the GIL held. Callbacks and code evaluations return
+  // false if the Python code requested to exit.
+  void SetupInterpreter();
+  bool RunCallback(std::set<Cb, Cb>::iterator next, absl::Time at_time);
+  bool EvalCode(const std::string& code);
+  void PushMidiEvent(const std::string& track,
+                     const libremidi::message& message);
+
   std::thread thread_;
 
   Engine* dsp_;
+  TimeSource* time_source_ = GetSystemTimeSource();
 
   // Updated by the Python thread only.
   uint64_t last_cb_id_ = 0;
@@ -115,6 +134,8 @@ class Runtime {
   bool running_ = false;
 
   // Lockless as only accessed from the Python thread.
+  std::map<std::string, TrackId> track_ids_;
+  uint64_t track_ids_version_ = 0;
   MicroBeat current_beat_ = 0;
   absl::Time current_time_;
   float bpm_ = 120.0;
@@ -5,6 +5,8 @@
 #include <chrono>
 #include <thread>
 
+#include "audio/audio_buffer.hh"
+
 namespace soir {
 
 TEST(AudioOutputTest, Initialization) {
@@ -27,4 +29,19 @@ TEST(AudioOutputTest, StartStop) {
   EXPECT_TRUE(stop_status.ok());
 }
 
+TEST(AudioOutputTest, WaitForSpace) {
+  audio::AudioOutput output;
+
+  auto init_status = output.Init(48000, 2, 512);
+  ASSERT_TRUE(init_status.ok());
+
+  AudioBuffer buffer(512);
+  ASSERT_TRUE(output.PushAudioBuffer(buffer).ok());
+  EXPECT_EQ(output.BufferedFrames(), 512);
+
+  // The device isn't started so nothing is consumed.
+  EXPECT_TRUE(output.WaitForSpace(512, absl::Milliseconds(1)));
+  EXPECT_FALSE(output.WaitForSpace(256, absl::Milliseconds(1)));
+}
+
 }  // namespace soir
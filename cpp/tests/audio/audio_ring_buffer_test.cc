@@ -0,0 +1,108 @@
+#include "audio/audio_ring_buffer.hh"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace soir {
+
+TEST(AudioRingBufferTest, CapacityIsPowerOfTwo) {
+  audio::AudioRingBuffer ring(1000, 2);
+
+  EXPECT_EQ(ring.Capacity(), 1024);
+  EXPECT_EQ(ring.Channels(), 2);
+  EXPECT_EQ(ring.Available(), 0);
+}
+
+TEST(AudioRingBufferTest, WriteReadWrap) {
+  audio::AudioRingBuffer ring(8, 2);
+
+  std::vector<float> in(12);
+  for (size_t i = 0; i < in.size(); ++i) {
+    in[i] = static_cast<float>(i);
+  }
+  std::vector<float> out(12);
+
+  // Moves the indices close to the end so the next write wraps.
+  EXPECT_EQ(ring.Write(in.data(), 6), 6);
+  EXPECT_EQ(ring.Read(out.data(), 6), 6);
+
+  EXPECT_EQ(ring.Write(in.data(), 6), 6);
+  EXPECT_EQ(ring.Available(), 6);
+  EXPECT_EQ(ring.Read(out.data(), 6), 6);
+
+  EXPECT_EQ(in, out);
+  EXPECT_EQ(ring.Underruns(), 0);
+  EXPECT_EQ(ring.Overruns(), 0);
+}
+
+TEST(AudioRingBufferTest, UnderrunOverrun) {
+  audio::AudioRingBuffer ring(4, 2);
+
+  std::vector<float> frames(2 * 8);
+
+  EXPECT_EQ(ring.Read(frames.data(), 1), 0);
+  EXPECT_EQ(ring.Underruns(), 1);
+
+  EXPECT_EQ(ring.Write(frames.data(), 8), 4);
+  EXPECT_EQ(ring.Overruns(), 1);
+
+  EXPECT_EQ(ring.Read(frames.data(), 8), 4);
+  EXPECT_EQ(ring.Underruns(), 2);
+}
+
+// One thread writes an increasing sequence in chunks of varying
+// sizes while another reads it back in different chunk sizes, the
+// reader must see every frame exactly once and in order.
+TEST(AudioRingBufferTest, ConcurrentProducerConsumer) {
+  constexpr int kChannels = 2;
+  constexpr size_t kTotalFrames = 1 << 20;
+
+  audio::AudioRingBuffer ring(256, kChannels);
+
+  std::thread producer([&ring]() {
+    std::vector<float> chunk(97 * kChannels);
+    size_t next = 0;
+
+    while (next < kTotalFrames) {
+      const size_t n = std::min<size_t>(1 + next % 97, kTotalFrames - next);
+      for (size_t i = 0; i < n; ++i) {
+        chunk[i * kChannels] = static_cast<float>((next + i) % 65536);
+        chunk[i * kChannels + 1] = -static_cast<float>((next + i) % 65536);
+      }
+      const size_t written = ring.Write(chunk.data(), n);
+      if (written == 0) {
+        std::this_thread::yield();
+      }
+      next += written;
+    }
+  });
+
+  std::vector<float> chunk(61 * kChannels);
+  size_t next = 0;
+  bool ordered = true;
+
+  while (next < kTotalFrames) {
+    const size_t n = ring.Read(chunk.data(), 1 + next % 61);
+    for (size_t i = 0; i < n; ++i) {
+      const float expected = static_cast<float>((next + i) % 65536);
+      if (chunk[i * kChannels] != expected ||
+          chunk[i * kChannels + 1] != -expected) {
+        ordered = false;
+      }
+    }
+    if (n == 0) {
+      std::this_thread::yield();
+    }
+    next += n;
+  }
+
+  producer.join();
+
+  EXPECT_TRUE(ordered);
+  EXPECT_EQ(next, kTotalFrames);
+  EXPECT_EQ(ring.Available(), 0);
+}
+
+}  // namespace soir
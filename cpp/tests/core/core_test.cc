@@ -1,9 +1,18 @@
 #include <gtest/gtest.h>
 
+#include <array>
+#include <list>
+#include <thread>
+#include <vector>
+
 #include "core/adsr.hh"
+#include "core/controls.hh"
+#include "core/dsp_stats.hh"
 #include "core/midi_event.hh"
 #include "core/midi_stack.hh"
+#include "core/midi_sysex.hh"
 #include "core/parameter.hh"
+#include "core/time_source.hh"
 
 namespace soir {
 
@@ -19,6 +28,89 @@ TEST(MidiStackTest, Creation) {
   EXPECT_TRUE(true);
 }
 
+namespace {
+
+MidiEventAt NoteAt(SampleTick tick, uint8_t note) {
+  libremidi::message msg;
+  msg.bytes = {0x90, note, 100};
+
+  MidiEventAt event(1, msg, absl::Now());
+  event.SetTick(tick);
+  return event;
+}
+
+}  // namespace
+
+TEST(MidiStackTest, PopBlockOffsets) {
+  MidiStack stack;
+  MidiBlock block;
+
+  std::vector<MidiEventAt> events = {NoteAt(1100, 3), NoteAt(1030, 2),
+                                     NoteAt(1600, 4), NoteAt(900, 1)};
+  stack.TakeEvents(&events);
+  EXPECT_TRUE(events.empty());
+
+  stack.PopBlock(1024, 512, &block);
+
+  ASSERT_EQ(block.Size(), 3);
+  EXPECT_EQ(block.Start(), 1024);
+
+  // Late events are due at the beginning of the block.
+  EXPECT_EQ(block.At(0).Bytes()[1], 1);
+  EXPECT_EQ(block.Offset(0), 0);
+  EXPECT_EQ(block.At(1).Bytes()[1], 2);
+  EXPECT_EQ(block.Offset(1), 6);
+  EXPECT_EQ(block.At(2).Bytes()[1], 3);
+  EXPECT_EQ(block.Offset(2), 76);
+
+  stack.PopBlock(1536, 512, &block);
+
+  ASSERT_EQ(block.Size(), 1);
+  EXPECT_EQ(block.Offset(0), 64);
+
+  stack.PopBlock(2048, 512, &block);
+  EXPECT_TRUE(block.Empty());
+}
+
+TEST(MidiStackTest, SameTickKeepsOrder) {
+  MidiStack stack;
+  MidiBlock block;
+
+  stack.AddEvents(std::list<MidiEventAt>{NoteAt(10, 1), NoteAt(10, 2)});
+  stack.AddEvents(std::vector<MidiEventAt>{NoteAt(5, 0), NoteAt(10, 3)});
+  stack.PopBlock(0, 512, &block);
+
+  ASSERT_EQ(block.Size(), 4);
+  for (size_t i = 0; i < block.Size(); ++i) {
+    EXPECT_EQ(block.At(i).Bytes()[1], i);
+  }
+}
+
+TEST(MidiEventTest, InlineBytes) {
+  MidiEventAt note(1, libremidi::channel_events::note_on(3, 60, 100),
+                   absl::Now());
+  ASSERT_EQ(note.Size(), 3);
+  EXPECT_EQ(note.Type(), libremidi::message_type::NOTE_ON);
+  EXPECT_EQ(note.Channel(), 3);
+  EXPECT_EQ(note.Bytes()[1], 60);
+
+  // Copies don't share the bytes.
+  MidiEventAt copy = note;
+  EXPECT_EQ(copy.Bytes()[2], 100);
+  EXPECT_NE(copy.Bytes(), note.Bytes());
+
+  std::vector<uint8_t> sysex(kMaxMidiEventSize + 1, 0);
+  sysex[0] = 0xF0;
+  MidiEventAt too_large(1, sysex.data(), sysex.size(), absl::Now());
+  EXPECT_EQ(too_large.Size(), 0);
+  EXPECT_EQ(too_large.Type(), libremidi::message_type::INVALID);
+
+  MidiEventAt largest(1, sysex.data(), kMaxMidiEventSize, absl::Now());
+  EXPECT_EQ(largest.Size(), kMaxMidiEventSize);
+  EXPECT_EQ(largest.Type(), libremidi::message_type::SYSTEM_EXCLUSIVE);
+  EXPECT_EQ(largest.Channel(), 0);
+}
+
 TEST(ParameterTest, ConstantValue) {
   Parameter p(0.5f);
   EXPECT_FLOAT_EQ(p.GetValue(0), 0.5f);
@@ -31,4 +123,372 @@ TEST(ParameterTest, WithRange) {
   EXPECT_FLOAT_EQ(p.GetValue(0), 1.0f);
 }
 
+TEST(ParameterTest, FillConstant) {
+  Parameter p(0.5f, 0.0f, 1.0f);
+  p.SetConstant(1.5f);
+  EXPECT_TRUE(p.IsConstant());
+
+  std::vector<float> values(kBlockSize, 0.0f);
+  p.Fill(0, kBlockSize, values.data());
+  for (float v : values) {
+    EXPECT_FLOAT_EQ(v, 1.0f);
+  }
+}
+
+// Filled values of a knob are the ones read tick by tick.
+TEST(ParameterTest, FillKnob) {
+  Controls controls;
+  const ControlId id = 3;
+  ASSERT_TRUE(controls.Register(id, "knob").ok());
+
+  Parameter p(0.0f, 0.0f, 0.75f);
+  p.SetControl(&controls, id);
+  EXPECT_FALSE(p.IsConstant());
+
+  const SampleTick start = 100;
+  controls.GetControl(id)->SetTargetValue(start, 1.0f);
+
+  std::vector<float> values(kBlockSize);
+  p.Fill(start - 10, kBlockSize, values.data());
+  for (int i = 0; i < kBlockSize; ++i) {
+    EXPECT_FLOAT_EQ(values[i], p.GetValue(start - 10 + i)) << i;
+  }
+  EXPECT_FLOAT_EQ(values.back(), 0.75f);
+}
+
+TEST(MidiSysexTest, SamplerPlayRoundTrip) {
+  SamplerPlayPayload play;
+  play.sample_ = 42;
+  play.start_ = 0.25f;
+  play.rate_ = -2.0f;
+  play.release_ = 0.5f;
+  play.pan_ = {7, 0.0f};
+  play.amp_ = {-1, 0.8f};
+  play.choke_ = 3;
+
+  const std::string bytes = MidiSysexInstruction::Serialize(
+      MidiSysexType::SAMPLER_PLAY, play.Encode());
+
+  MidiSysexInstruction inst;
+  ASSERT_TRUE(inst.ParseFromBytes(
+      reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()));
+  EXPECT_EQ(inst.type, MidiSysexType::SAMPLER_PLAY);
+  ASSERT_EQ(inst.payload_size, SamplerPlayPayload::kSize);
+
+  SamplerPlayPayload decoded;
+  ASSERT_TRUE(decoded.Decode(inst.payload, inst.payload_size));
+  EXPECT_EQ(decoded.sample_, 42);
+  EXPECT_FLOAT_EQ(decoded.start_, 0.25f);
+  EXPECT_FLOAT_EQ(decoded.end_, 1.0f);
+  EXPECT_FLOAT_EQ(decoded.rate_, -2.0f);
+  EXPECT_FLOAT_EQ(decoded.release_, 0.5f);
+  EXPECT_EQ(decoded.pan_.control_, 7);
+  EXPECT_EQ(decoded.amp_.control_, -1);
+  EXPECT_FLOAT_EQ(decoded.amp_.value_, 0.8f);
+  EXPECT_EQ(decoded.voices_, 0);
+  EXPECT_EQ(decoded.choke_, 3);
+
+  // Truncated payloads are rejected.
+  EXPECT_FALSE(decoded.Decode(inst.payload, inst.payload_size - 1));
+}
+
+TEST(MidiSysexTest, RejectsOtherVersions) {
+  std::string bytes = MidiSysexInstruction::Serialize(
+      MidiSysexType::SAMPLER_STOP, SamplerStopPayload().Encode());
+  bytes[1] = kMidiSysexVersion + 1;
+
+  MidiSysexInstruction inst;
+  EXPECT_FALSE(inst.ParseFromBytes(
+      reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size()));
+}
+
+TEST(MidiSysexTest, ControlsUpdateRoundTrip) {
+  const std::string payload =
+      ControlsUpdatePayload::Encode({{0, 1, 0.5f}, {3, 7, -1.0f}});
+
+  ControlsUpdatePayload update;
+  ASSERT_TRUE(update.Decode(reinterpret_cast<const uint8_t*>(payload.data()),
+                            payload.size()));
+  ASSERT_EQ(update.Size(), 2);
+
+  ControlsUpdatePayload::Pair pair;
+  update.Get(1, &pair);
+  EXPECT_EQ(pair.control_, 3);
+  EXPECT_EQ(pair.generation_, 7);
+  EXPECT_FLOAT_EQ(pair.value_, -1.0f);
+
+  EXPECT_FALSE(update.Decode(reinterpret_cast<const uint8_t*>(payload.data()),
+                             payload.size() - 4));
+}
+
+namespace {
+
+MidiEventAt UpdateAt(SampleTick tick,
+                     const std::vector<ControlsUpdatePayload::Pair>& pairs) {
+  const std::string inst = MidiSysexInstruction::Serialize(
+      MidiSysexType::UPDATE_CONTROLS, ControlsUpdatePayload::Encode(pairs));
+
+  libremidi::message msg;
+  msg.bytes = {0xF0};
+  msg.bytes.insert(msg.bytes.end(), inst.begin(), inst.end());
+
+  MidiEventAt event(kInternalControlsTrackId, msg, absl::Now());
+  event.SetTick(tick);
+  return event;
+}
+
+}  // namespace
+
+TEST(ControlsTest, UpdateById) {
+  Controls controls;
+
+  const ControlId cutoff = 0;
+  const ControlId res = 1;
+  ASSERT_TRUE(controls.Register(cutoff, "cutoff").ok());
+  ASSERT_TRUE(controls.Register(res, "res").ok());
+  EXPECT_EQ(controls.GetControlId("cutoff"), cutoff);
+  EXPECT_EQ(controls.GetControlId("unknown"), kInvalidControlId);
+  EXPECT_NE(controls.GetControl(cutoff), nullptr);
+  EXPECT_EQ(controls.GetControl(res + 1), nullptr);
+  EXPECT_FALSE(controls.Register(kMaxControls, "too-far").ok());
+
+  std::vector<MidiEventAt> events = {
+      UpdateAt(0, {{cutoff, controls.GetGeneration(cutoff), 0.5f},
+                   {res, controls.GetGeneration(res), 0.25f}})};
+  controls.TakeEvents(&events);
+  controls.Update(0);
+
+  const SampleTick later = kSampleRate;
+  EXPECT_FLOAT_EQ(controls.GetControl(cutoff)->GetValue(later), 0.5f);
+  EXPECT_FLOAT_EQ(controls.GetControl(res)->GetValue(later), 0.25f);
+
+  Parameter p;
+  p.SetControl(&controls, res);
+  EXPECT_FLOAT_EQ(p.GetValue(later), 0.25f);
+
+  // Unknown controls are constants.
+  p.SetControl(&controls, res + 1);
+  EXPECT_FLOAT_EQ(p.GetValue(later), 0.0f);
+}
+
+// Released controls keep their value until their ID is given to
+// another control, parameters referring to them then hold the last
+// value they read and still report the name of the control.
+TEST(ControlsTest, ReleaseAndReuse) {
+  Controls controls;
+  ASSERT_TRUE(controls.Register(0, "lfo").ok());
+  controls.GetControl(0)->SetTargetValue(0, 0.5f);
+
+  Parameter p(0.1f);
+  p.SetControl(&controls, "lfo");
+  EXPECT_FALSE(p.IsConstant());
+  EXPECT_EQ(std::get<std::string>(p.Raw()), "lfo");
+
+  const SampleTick later = kSampleRate;
+  controls.Release(0);
+  EXPECT_EQ(controls.GetControl(0), nullptr);
+  EXPECT_EQ(controls.GetControlId("lfo"), kInvalidControlId);
+  EXPECT_FLOAT_EQ(p.GetValue(later), 0.5f);
+  EXPECT_EQ(std::get<std::string>(p.Raw()), "lfo");
+
+  // Registering the same name again under the same ID is a no-op.
+  ASSERT_TRUE(controls.Register(1, "env").ok());
+  const uint32_t generation = controls.GetGeneration(1);
+  ASSERT_TRUE(controls.Register(1, "env").ok());
+  EXPECT_EQ(controls.GetGeneration(1), generation);
+
+  ASSERT_TRUE(controls.Register(0, "ramp").ok());
+  EXPECT_TRUE(p.IsConstant());
+  EXPECT_FLOAT_EQ(p.GetValue(later), 0.5f);
+  EXPECT_EQ(std::get<std::string>(p.Raw()), "lfo");
+
+  std::array<float, 4> values;
+  p.Fill(later, values.size(), values.data());
+  for (float value : values) {
+    EXPECT_FLOAT_EQ(value, 0.5f);
+  }
+
+  // Parameters set up after the reuse refer to the new control.
+  p.SetControl(&controls, "ramp");
+  EXPECT_EQ(std::get<std::string>(p.Raw()), "ramp");
+}
+
+// A reused ID starts from 0, updates still queued for the control
+// which had it before are dropped.
+TEST(ControlsTest, ReusedIdStartsFromScratch) {
+  Controls controls;
+  const SampleTick later = kSampleRate;
+
+  ASSERT_TRUE(controls.Register(0, "lfo").ok());
+  const uint32_t lfo = controls.GetGeneration(0);
+  std::vector<MidiEventAt> events = {UpdateAt(0, {{0, lfo, 0.5f}})};
+  controls.TakeEvents(&events);
+  controls.Update(0);
+  EXPECT_FLOAT_EQ(controls.GetControl(0)->GetValue(later), 0.5f);
+
+  controls.Release(0);
+  ASSERT_TRUE(controls.Register(0, "ramp").ok());
+  const uint32_t ramp = controls.GetGeneration(0);
+  EXPECT_NE(ramp, lfo);
+
+  events = {UpdateAt(later, {{0, lfo, 0.75f}})};
+  controls.TakeEvents(&events);
+  controls.Update(later);
+  EXPECT_FLOAT_EQ(controls.GetControl(0)->GetValue(later), 0.0f);
+  EXPECT_FLOAT_EQ(controls.GetControl(0)->GetValue(2 * later), 0.0f);
+
+  events = {UpdateAt(2 * later, {{0, ramp, 0.25f}})};
+  controls.TakeEvents(&events);
+  controls.Update(2 * later);
+  EXPECT_FLOAT_EQ(controls.GetControl(0)->GetValue(2 * later), 0.0f);
+  EXPECT_FLOAT_EQ(controls.GetControl(0)->GetValue(3 * later), 0.25f);
+}
+
+// Reads don't lock, they see the updates of another thread in order.
+TEST(ControlsTest, ConcurrentReadsAndUpdates) {
+  Control control;
+  constexpr int kUpdates = 20000;
+  constexpr SampleTick kEnd = (kUpdates + 1) * kSampleRate;
+
+  std::thread writer([&control]() {
+    for (int i = 1; i <= kUpdates; ++i) {
+      control.SetTargetValue(i * kSampleRate / kControlsFrequencyUpdate, i);
+    }
+  });
+
+  float last = 0.0f;
+  while (last < kUpdates) {
+    const float value = control.GetValue(kEnd);
+    ASSERT_GE(value, last);
+    last = value;
+  }
+  writer.join();
+
+  EXPECT_FLOAT_EQ(control.GetValue(kEnd), kUpdates);
+}
+
+// Controls used to jump at each update as the progress of their ramps
+// was an integer division. Rising targets must give rising values, and
+// a step must be reached without overshooting.
+TEST(ControlsTest, InterpolatesMonotonicallyBetweenUpdates) {
+  constexpr SampleTick kPeriod = kSampleRate / kControlsFrequencyUpdate;
+  const std::vector<float> targets = {1.0f, 3.0f, 3.5f, 6.0f, 6.0f, 6.0f};
+
+  for (Smoothing smoothing :
+       {Smoothing::LINEAR, Smoothing::ONE_POLE, Smoothing::CUBIC}) {
+    Control control;
+    control.SetSmoothing(smoothing);
+
+    std::vector<float> values;
+    for (std::size_t u = 0; u < targets.size(); ++u) {
+      control.SetTargetValue(u * kPeriod, targets[u]);
+      for (SampleTick i = 0; i < kPeriod; ++i) {
+        values.push_back(control.GetValue(u * kPeriod + i));
+      }
+    }
+
+    for (std::size_t i = 1; i < values.size(); ++i) {
+      EXPECT_GE(values[i], values[i - 1]) << static_cast<int>(smoothing);
+      EXPECT_LE(values[i], 6.0f) << static_cast<int>(smoothing);
+    }
+
+    // Ramps move within the first update, they don't wait for the next.
+    EXPECT_GT(values[kPeriod / 2], 0.1f) << static_cast<int>(smoothing);
+  }
+
+  // Linear ramps reach their target at the next update.
+  Control control;
+  control.SetTargetValue(0, 1.0f);
+  EXPECT_FLOAT_EQ(control.GetValue(kPeriod / 4), 0.25f);
+  EXPECT_FLOAT_EQ(control.GetValue(kPeriod / 2), 0.5f);
+  EXPECT_FLOAT_EQ(control.GetValue(kPeriod), 1.0f);
+}
+
+// Ramps are the values read tick by tick, before, during and after
+// the interpolation.
+TEST(ControlsTest, RampMatchesValues) {
+  constexpr SampleTick kPeriod = kSampleRate / kControlsFrequencyUpdate;
+
+  for (Smoothing smoothing :
+       {Smoothing::LINEAR, Smoothing::ONE_POLE, Smoothing::CUBIC}) {
+    Control control;
+    control.SetSmoothing(smoothing);
+    control.SetTargetValue(1000, 2.0f);
+    control.SetTargetValue(1000 + kPeriod, -1.0f);
+
+    std::vector<float> ramp(8 * kPeriod);
+    const SampleTick start = 1000 + kPeriod - 100;
+    control.Ramp(start, ramp.size(), ramp.data());
+    for (std::size_t i = 0; i < ramp.size(); ++i) {
+      EXPECT_NEAR(ramp[i], control.GetValue(start + i), 1e-5f)
+          << static_cast<int>(smoothing) << " " << i;
+    }
+    EXPECT_FLOAT_EQ(ramp.back(), -1.0f);
+  }
+
+  Smoothing smoothing;
+  EXPECT_TRUE(ParseSmoothing("one_pole", &smoothing).ok());
+  EXPECT_EQ(smoothing, Smoothing::ONE_POLE);
+  EXPECT_FALSE(ParseSmoothing("quintic", &smoothing).ok());
+}
+
+TEST(TimeSourceTest, VirtualAdvancesWithTicks) {
+  VirtualTimeSource source(absl::UnixEpoch());
+  EXPECT_EQ(source.Now(), absl::UnixEpoch());
+
+  source.Advance(kSampleRate);
+  EXPECT_EQ(source.Now(), absl::UnixEpoch() + absl::Seconds(1));
+
+  source.Advance(kSampleRate / 2);
+  EXPECT_EQ(source.Now(), absl::UnixEpoch() + absl::Milliseconds(1500));
+}
+
+TEST(DurationStatsTest, Empty) {
+  DurationStats stats;
+  auto summary = stats.Read();
+
+  EXPECT_EQ(summary.count, 0);
+  EXPECT_EQ(summary.max_us, 0.0f);
+}
+
+TEST(DurationStatsTest, Percentiles) {
+  DurationStats stats;
+
+  // 99 fast renders and a slow one.
+  for (int i = 0; i < 99; ++i) {
+    stats.Record(100000);
+  }
+  stats.Record(5000000);
+
+  auto summary = stats.Read();
+
+  EXPECT_EQ(summary.count, 100);
+  EXPECT_FLOAT_EQ(summary.last_us, 5000.0f);
+  EXPECT_FLOAT_EQ(summary.max_us, 5000.0f);
+  EXPECT_NEAR(summary.mean_us, 149.0f, 0.01f);
+
+  // Percentiles are bucket bounds, within a quarter of octave.
+  EXPECT_GE(summary.p50_us, 100.0f);
+  EXPECT_LE(summary.p50_us, 120.0f);
+  EXPECT_GE(summary.p99_us, 100.0f);
+  EXPECT_LE(summary.p99_us, 120.0f);
+}
+
+TEST(DurationStatsTest, Tail) {
+  DurationStats stats;
+
+  for (int i = 0; i < 90; ++i) {
+    stats.Record(10000);
+  }
+  for (int i = 0; i < 10; ++i) {
+    stats.Record(2000000);
+  }
+
+  auto summary = stats.Read();
+
+  EXPECT_LE(summary.p50_us, 12.0f);
+  EXPECT_GE(summary.p99_us, 2000.0f);
+  EXPECT_LE(summary.p99_us, 2000.0f);
+}
+
 }  // namespace soir
@@ -1,7 +1,21 @@
 #include "core/engine.hh"
 
+#include <AudioFile.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#include "audio/audio_buffer.hh"
+#include "core/controls.hh"
+#include "core/midi_sysex.hh"
+#include "core/modulator.hh"
+#include "core/sample_manager.hh"
+#include "utils/rt_alloc.hh"
+
 namespace soir {
 namespace {
 
@@ -19,6 +33,54 @@ constexpr const char* kTestConfig = R"({
   }
 })";
 
+class CountingConsumer : public SampleConsumer {
+ public:
+  absl::Status PushAudioBuffer(AudioBuffer& buffer) override {
+    blocks_++;
+    return absl::OkStatus();
+  }
+
+  int blocks_ = 0;
+};
+
+// Writes a pack with a single sample a few blocks long and returns a
+// test config which loads it.
+std::string PackTestConfig() {
+  const auto dir = std::filesystem::temp_directory_path() / "soir-engine";
+  std::filesystem::create_directories(dir);
+
+  AudioFile<float> audio_file;
+  audio_file.setNumChannels(1);
+  audio_file.setNumSamplesPerChannel(4 * kBlockSize);
+  audio_file.setSampleRate(kSampleRate);
+  for (auto& value : audio_file.samples[0]) {
+    value = 0.5f;
+  }
+  audio_file.save((dir / "one.wav").string());
+
+  std::ofstream pack(dir / "test.pack.json");
+  pack << R"({"samples": [{"name": "one", "path": "one.wav"}]})";
+  pack.close();
+
+  return R"({"dsp": {"enable_output": false, "enable_streaming": false,)"
+         R"( "streaming_port": 5001, "sample_directory": ")" +
+         dir.string() +
+         R"(", "sample_packs": ["test"]}, "vst": {"scan_at_startup": false}})";
+}
+
+MidiEventAt SysexEvent(TrackId track, MidiSysexType type,
+                       const std::string& payload, absl::Time at) {
+  const std::string serialized =
+      MidiSysexInstruction::Serialize(type, payload);
+
+  libremidi::midi_bytes bytes;
+  bytes.push_back(
+      static_cast<unsigned char>(libremidi::message_type::SYSTEM_EXCLUSIVE));
+  bytes.insert(bytes.end(), serialized.begin(), serialized.end());
+
+  return MidiEventAt(track, libremidi::message(bytes, 0), at);
+}
+
 }  // namespace
 
 TEST(EngineTest, Construction) {
@@ -72,4 +134,306 @@ TEST(EngineTest, GetControls) {
   EXPECT_NE(controls, nullptr);
 }
 
+TEST(EngineTest, TrackIdsAreStable) {
+  Engine engine;
+  utils::Config config(kTestConfig);
+
+  auto init_status = engine.Init(config);
+  ASSERT_TRUE(init_status.ok());
+
+  auto controls_id = engine.GetTrackId(std::string(kInternalControls));
+  ASSERT_TRUE(controls_id.ok());
+  EXPECT_EQ(*controls_id, kInternalControlsTrackId);
+
+  EXPECT_FALSE(engine.GetTrackId("bass").ok());
+
+  Track::Settings bass;
+  bass.name_ = "bass";
+  bass.instrument_ = inst::Type::SAMPLER;
+
+  Track::Settings drums;
+  drums.name_ = "drums";
+  drums.instrument_ = inst::Type::SAMPLER;
+
+  ASSERT_TRUE(engine.SetupTracks({bass}).ok());
+  auto bass_id = engine.GetTrackId("bass");
+  ASSERT_TRUE(bass_id.ok());
+  EXPECT_NE(*bass_id, kInternalControlsTrackId);
+
+  ASSERT_TRUE(engine.SetupTracks({drums, bass}).ok());
+  auto drums_id = engine.GetTrackId("drums");
+  ASSERT_TRUE(drums_id.ok());
+  EXPECT_NE(*drums_id, *bass_id);
+  EXPECT_EQ(*engine.GetTrackId("bass"), *bass_id);
+
+  // Removed tracks lose their ID, late events are still routed to
+  // their queue and dropped there.
+  const uint64_t version = engine.GetTrackIdsVersion();
+  ASSERT_TRUE(engine.SetupTracks({drums}).ok());
+  EXPECT_NE(engine.GetTrackIdsVersion(), version);
+  EXPECT_FALSE(engine.GetTrackId("bass").ok());
+  EXPECT_EQ(*engine.GetTrackId("drums"), *drums_id);
+
+  // The ID isn't reused before a block dropped these events.
+  ASSERT_TRUE(engine.SetupTracks({drums, bass}).ok());
+  EXPECT_NE(*engine.GetTrackId("bass"), *bass_id);
+
+  // Events for unknown IDs are ignored.
+  engine.PushMidiEvent(MidiEventAt(
+      kMaxTracks, libremidi::channel_events::note_on(1, 60, 100), absl::Now()));
+  engine.PushMidiEvent(MidiEventAt(
+      *bass_id, libremidi::channel_events::note_on(1, 60, 100), absl::Now()));
+
+  EXPECT_TRUE(engine.Stop().ok());
+}
+
+// More tracks than kMaxTracks come and go over a session, the IDs of
+// removed tracks are reused once a block was rendered without them.
+TEST(EngineTest, TrackIdsAreReused) {
+  Engine engine;
+  utils::Config config(kTestConfig);
+
+  auto init_status = engine.Init(config);
+  ASSERT_TRUE(init_status.ok());
+
+  VirtualTimeSource time_source(absl::UnixEpoch());
+  auto start_status = engine.StartOffline(&time_source);
+  ASSERT_TRUE(start_status.ok()) << start_status.message();
+
+  TrackId previous_id = kInternalControlsTrackId;
+  for (int i = 0; i < 2 * kMaxTracks; ++i) {
+    Track::Settings track;
+    track.name_ = "track-" + std::to_string(i);
+    track.instrument_ = inst::Type::SAMPLER;
+
+    ASSERT_TRUE(engine.SetupTracks({track}).ok()) << track.name_;
+    auto id = engine.GetTrackId(track.name_);
+    ASSERT_TRUE(id.ok());
+    EXPECT_NE(*id, previous_id);
+    previous_id = *id;
+
+    engine.RenderBlock();
+    time_source.Advance(kBlockSize);
+  }
+
+  EXPECT_TRUE(engine.Stop().ok());
+}
+
+TEST(EngineTest, RenderOffline) {
+  Engine engine;
+  utils::Config config(kTestConfig);
+
+  auto init_status = engine.Init(config);
+  ASSERT_TRUE(init_status.ok());
+
+  VirtualTimeSource time_source(absl::UnixEpoch());
+  auto start_status = engine.StartOffline(&time_source);
+  ASSERT_TRUE(start_status.ok()) << start_status.message();
+
+  CountingConsumer consumer;
+  engine.RegisterConsumer(&consumer);
+
+  for (int i = 0; i < 100; ++i) {
+    engine.RenderBlock();
+    time_source.Advance(kBlockSize);
+  }
+
+  engine.RemoveConsumer(&consumer);
+  EXPECT_EQ(consumer.blocks_, 100);
+
+  // Offline rendering has no deadline to miss.
+  auto stats = engine.GetDspStats();
+  EXPECT_EQ(stats.render.count, 100);
+  EXPECT_EQ(stats.deadline_misses, 0);
+  EXPECT_GT(stats.block_us, 0.0f);
+
+  EXPECT_TRUE(engine.Stop().ok());
+}
+
+// Tracks are set up and read from another thread while blocks are
+// rendered back to back, the renderer never waits on them and
+// tracks removed along the way are released safely.
+TEST(EngineTest, SetupTracksWhileRendering) {
+  Engine engine;
+  utils::Config config(kTestConfig);
+
+  auto init_status = engine.Init(config);
+  ASSERT_TRUE(init_status.ok());
+
+  VirtualTimeSource time_source(absl::UnixEpoch());
+  auto start_status = engine.StartOffline(&time_source);
+  ASSERT_TRUE(start_status.ok()) << start_status.message();
+
+  Track::Settings bass;
+  bass.name_ = "bass";
+  bass.instrument_ = inst::Type::SAMPLER;
+  bass.fxs_ = {{"lpf", "{}", fx::Type::LPF}};
+
+  Track::Settings drums;
+  drums.name_ = "drums";
+  drums.instrument_ = inst::Type::SAMPLER;
+
+  Track::Settings drums_chorus = drums;
+  drums_chorus.fxs_ = {{"chorus", "{}", fx::Type::CHORUS}};
+
+  std::atomic<bool> done = false;
+  std::thread renderer([&]() {
+    while (!done.load()) {
+      engine.RenderBlock();
+      time_source.Advance(kBlockSize);
+    }
+  });
+
+  for (int i = 0; i < 50; ++i) {
+    ASSERT_TRUE(engine.SetupTracks({bass, drums}).ok());
+    ASSERT_TRUE(engine.SetupTracks({bass}).ok());
+    ASSERT_TRUE(engine.SetupTracks({bass, drums_chorus}).ok());
+
+    std::list<Track::Settings> tracks;
+    ASSERT_TRUE(engine.GetTracks(&tracks).ok());
+    EXPECT_EQ(tracks.size(), 2);
+    EXPECT_EQ(engine.GetAllTrackLevels().size(), 2);
+    EXPECT_EQ(engine.GetDspStats().tracks.size(), 2);
+  }
+
+  done.store(true);
+  renderer.join();
+
+  std::list<Track::Settings> tracks;
+  ASSERT_TRUE(engine.GetTracks(&tracks).ok());
+  ASSERT_EQ(tracks.size(), 2);
+  EXPECT_EQ(tracks.front().name_, "bass");
+  EXPECT_EQ(tracks.back().fxs_.size(), 1);
+
+  auto stats = engine.GetDspStats();
+  EXPECT_EQ(stats.tracks["bass"].fxs.count("lpf"), 1);
+  EXPECT_EQ(stats.tracks["drums"].fxs.count("chorus"), 1);
+
+  EXPECT_TRUE(engine.Stop().ok());
+}
+
+// Renders a session with a few tracks, each with a full FX chain and
+// a steady stream of MIDI events, and checks the DSP path doesn't
+// allocate once warmed up.
+TEST(EngineTest, RenderWithoutAllocations) {
+  if (!utils::RtAllocCheckEnabled()) {
+    GTEST_SKIP() << "Requires a build with SOIR_RT_ALLOC_CHECK";
+  }
+
+  Engine engine;
+  utils::Config config(PackTestConfig());
+
+  auto init_status = engine.Init(config);
+  ASSERT_TRUE(init_status.ok()) << init_status.message();
+
+  const SampleHandle sample =
+      engine.GetSampleManager().GetSampleHandle("test", "one");
+  ASSERT_NE(sample, kInvalidSampleHandle);
+
+  // Pan is updated from Python, amp is modulated on the DSP side.
+  Controls* controls = engine.GetControls();
+  ASSERT_TRUE(controls->Register(0, "pan").ok());
+  ASSERT_TRUE(controls->Register(1, "amp").ok());
+  const uint32_t pan_generation = controls->GetGeneration(0);
+  const uint32_t amp_generation = controls->GetGeneration(1);
+
+  VirtualTimeSource time_source(absl::UnixEpoch());
+  auto start_status = engine.StartOffline(&time_source);
+  ASSERT_TRUE(start_status.ok()) << start_status.message();
+
+  std::list<Track::Settings> tracks;
+  for (int i = 0; i < 8; ++i) {
+    Track::Settings track;
+    track.name_ = "track-" + std::to_string(i);
+    track.instrument_ = inst::Type::SAMPLER;
+    track.fxs_ = {{"chorus", "{}", fx::Type::CHORUS},
+                  {"reverb", "{}", fx::Type::REVERB},
+                  {"lpf", "{}", fx::Type::LPF},
+                  {"hpf", "{}", fx::Type::HPF}};
+    tracks.push_back(track);
+  }
+  ASSERT_TRUE(engine.SetupTracks(tracks).ok());
+
+  std::vector<TrackId> ids;
+  for (auto& track : tracks) {
+    auto id = engine.GetTrackId(track.name_);
+    ASSERT_TRUE(id.ok());
+    ids.push_back(*id);
+  }
+
+  // Events are built outside of the DSP path, only their processing
+  // is checked for allocations.
+  auto render_blocks = [&](int num_blocks) {
+    for (int i = 0; i < num_blocks; ++i) {
+      const absl::Time now = time_source.Now();
+
+      ControlsUpdatePayload::Pair pan = {0, pan_generation,
+                                         (i % 16) / 8.0f - 1.0f};
+      engine.PushMidiEvent(SysexEvent(kInternalControlsTrackId,
+                                      MidiSysexType::UPDATE_CONTROLS,
+                                      ControlsUpdatePayload::Encode({pan}),
+                                      now));
+
+      if (i % 8 == 0) {
+        ControlModulatorPayload amp;
+        amp.control_ = 1;
+        amp.generation_ = amp_generation;
+        amp.type_ = static_cast<int32_t>(i % 16 == 0 ? ModulatorType::LFO
+                                                     : ModulatorType::ENVELOPE);
+        amp.rate_ = 2.0f;
+        amp.low_ = 0.25f;
+        amp.attack_ = 0.01f;
+        amp.decay_ = 0.01f;
+        amp.sustain_ = 0.5f;
+        amp.release_ = 0.01f;
+        amp.gate_ = 0.05f;
+        engine.PushMidiEvent(SysexEvent(kInternalControlsTrackId,
+                                        MidiSysexType::CONTROL_MODULATOR,
+                                        amp.Encode(), now));
+      }
+
+      for (size_t t = 0; t < ids.size(); ++t) {
+        for (int j = 0; j < 4; ++j) {
+          engine.PushMidiEvent(MidiEventAt(
+              ids[t], libremidi::channel_events::note_on(1, 60 + j, 100),
+              now + absl::Microseconds(2000 * j)));
+        }
+
+        // Limited voices on half of the tracks, a choke group on the
+        // others, so that voices get stolen and faded out.
+        SamplerPlayPayload play;
+        play.sample_ = sample;
+        play.release_ = 0.01f;
+        play.pan_ = {0, 0.0f};
+        play.amp_ = {1, 0.0f};
+        play.voices_ = t % 2 == 0 ? 2 : 0;
+        play.choke_ = t % 2 == 0 ? 0 : 1;
+        for (int j = 0; j < 2; ++j) {
+          engine.PushMidiEvent(SysexEvent(ids[t], MidiSysexType::SAMPLER_PLAY,
+                                          play.Encode(),
+                                          now + absl::Microseconds(3000 * j)));
+        }
+
+        if (i % 4 == 3) {
+          SamplerStopPayload stop;
+          stop.sample_ = sample;
+          engine.PushMidiEvent(SysexEvent(ids[t], MidiSysexType::SAMPLER_STOP,
+                                          stop.Encode(), now));
+        }
+      }
+
+      engine.RenderBlock();
+      time_source.Advance(kBlockSize);
+    }
+  };
+
+  render_blocks(16);
+  const uint64_t allocations = utils::RtAllocCount();
+  render_blocks(500);
+
+  EXPECT_EQ(utils::RtAllocCount(), allocations);
+
+  EXPECT_TRUE(engine.Stop().ok());
+}
+
 }  // namespace soir
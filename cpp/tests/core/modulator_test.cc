@@ -0,0 +1,302 @@
+#include "core/modulator.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <set>
+#include <vector>
+
+#include "core/controls.hh"
+#include "core/midi_sysex.hh"
+
+namespace soir {
+
+namespace {
+
+constexpr float kBlockSeconds = static_cast<float>(kBlockSize) / kSampleRate;
+
+// Values of a modulator over the given number of blocks.
+std::vector<float> Evaluate(Modulator* modulator, int blocks,
+                            float bpm = 120.0f) {
+  std::array<float, kBlockSize> scratch;
+  std::vector<float> values;
+  for (int i = 0; i < blocks; ++i) {
+    values.push_back(modulator->Next(bpm, scratch.data()));
+  }
+  return values;
+}
+
+int Blocks(float seconds) {
+  return static_cast<int>(std::ceil(seconds / kBlockSeconds));
+}
+
+MidiEventAt ModulatorEvent(const ControlModulatorPayload& payload,
+                           SampleTick tick) {
+  const std::string inst = MidiSysexInstruction::Serialize(
+      MidiSysexType::CONTROL_MODULATOR, payload.Encode());
+
+  libremidi::message msg;
+  msg.bytes = {0xF0};
+  msg.bytes.insert(msg.bytes.end(), inst.begin(), inst.end());
+  MidiEventAt event(kInternalControlsTrackId, msg, absl::Now());
+  event.SetTick(tick);
+  return event;
+}
+
+}  // namespace
+
+TEST(ModulatorTest, PayloadRoundTrip) {
+  ControlModulatorPayload payload;
+  payload.control_ = 12;
+  payload.generation_ = 3;
+  payload.type_ = static_cast<int32_t>(ModulatorType::ENVELOPE);
+  payload.retrigger_ = 0;
+  payload.low_ = -2.0f;
+  payload.gate_ = 0.5f;
+
+  const std::string bytes = payload.Encode();
+  ASSERT_EQ(bytes.size(), ControlModulatorPayload::kSize);
+
+  ControlModulatorPayload decoded;
+  ASSERT_TRUE(decoded.Decode(reinterpret_cast<const uint8_t*>(bytes.data()),
+                             bytes.size()));
+  EXPECT_EQ(decoded.control_, 12);
+  EXPECT_EQ(decoded.generation_, 3);
+  EXPECT_EQ(decoded.type_, payload.type_);
+  EXPECT_EQ(decoded.retrigger_, 0);
+  EXPECT_FLOAT_EQ(decoded.low_, -2.0f);
+  EXPECT_FLOAT_EQ(decoded.sustain_, 1.0f);
+  EXPECT_FLOAT_EQ(decoded.gate_, 0.5f);
+
+  EXPECT_FALSE(decoded.Decode(
+      reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size() - 1));
+}
+
+TEST(ModulatorTest, LFO) {
+  ControlModulatorPayload settings;
+  settings.type_ = static_cast<int32_t>(ModulatorType::LFO);
+  settings.shape_ = dsp::LFO::SINE;
+  settings.rate_ = 2.0f;
+  settings.low_ = 1.0f;
+  settings.high_ = 3.0f;
+
+  Modulator modulator;
+  modulator.Init(settings);
+  const auto values = Evaluate(&modulator, Blocks(1.0f));
+
+  // Starts from the middle, rising.
+  EXPECT_GT(values[0], 2.0f);
+  EXPECT_LT(values[0], 2.2f);
+
+  const auto [min, max] = std::minmax_element(values.begin(), values.end());
+  EXPECT_NEAR(*min, 1.0f, 0.01f);
+  EXPECT_NEAR(*max, 3.0f, 0.01f);
+
+  // Synced, 1 cycle per beat at 120 BPM is 2Hz.
+  settings.sync_ = 1;
+  settings.rate_ = 1.0f;
+  Modulator synced;
+  synced.Init(settings);
+  const auto synced_values = Evaluate(&synced, Blocks(1.0f));
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    EXPECT_NEAR(synced_values[i], values[i], 1e-4f) << i;
+  }
+}
+
+TEST(ModulatorTest, Ramp) {
+  ControlModulatorPayload settings;
+  settings.type_ = static_cast<int32_t>(ModulatorType::RAMP);
+  settings.start_ = 1.0f;
+  settings.end_ = 0.0f;
+  settings.duration_ = 0.5f;
+
+  Modulator modulator;
+  modulator.Init(settings);
+  const auto values = Evaluate(&modulator, Blocks(1.0f));
+
+  for (std::size_t i = 1; i < values.size(); ++i) {
+    EXPECT_LE(values[i], values[i - 1]);
+  }
+  EXPECT_NEAR(values[Blocks(0.25f) - 1], 0.5f, 0.02f);
+  EXPECT_FLOAT_EQ(values.back(), 0.0f);
+
+  // Updating the settings without retriggering keeps the position.
+  settings.retrigger_ = 0;
+  settings.end_ = 2.0f;
+  modulator.Init(settings);
+  EXPECT_FLOAT_EQ(Evaluate(&modulator, 1)[0], 2.0f);
+}
+
+TEST(ModulatorTest, Envelope) {
+  ControlModulatorPayload settings;
+  settings.type_ = static_cast<int32_t>(ModulatorType::ENVELOPE);
+  settings.attack_ = 0.1f;
+  settings.decay_ = 0.1f;
+  settings.sustain_ = 0.5f;
+  settings.release_ = 0.1f;
+  settings.gate_ = 0.5f;
+  settings.low_ = 0.0f;
+  settings.high_ = 10.0f;
+
+  Modulator modulator;
+  modulator.Init(settings);
+  const auto values = Evaluate(&modulator, Blocks(1.0f));
+
+  EXPECT_GT(*std::max_element(values.begin(), values.end()), 9.5f);
+  EXPECT_NEAR(values[Blocks(0.4f)], 5.0f, 1e-3f);
+  EXPECT_FLOAT_EQ(values.back(), 0.0f);
+}
+
+// Stages of 0s are instant: the envelope starts at the sustain level
+// without attack nor decay, and drops to 0 without release.
+TEST(ModulatorTest, EnvelopeZeroStages) {
+  ControlModulatorPayload settings;
+  settings.type_ = static_cast<int32_t>(ModulatorType::ENVELOPE);
+  settings.attack_ = 0.0f;
+  settings.decay_ = 0.0f;
+  settings.sustain_ = 0.5f;
+  settings.release_ = 0.0f;
+  settings.gate_ = 0.5f;
+  settings.low_ = 0.0f;
+  settings.high_ = 10.0f;
+
+  Modulator modulator;
+  modulator.Init(settings);
+  const auto values = Evaluate(&modulator, Blocks(1.0f));
+
+  const int gate = Blocks(0.5f) - 1;
+  for (int i = 0; i < gate; ++i) {
+    EXPECT_FLOAT_EQ(values[i], 5.0f) << i;
+  }
+  for (std::size_t i = gate; i < values.size(); ++i) {
+    EXPECT_FLOAT_EQ(values[i], 0.0f) << i;
+  }
+
+  // Without decay the attack goes straight to the sustain level.
+  settings.attack_ = 0.1f;
+  Modulator attack;
+  attack.Init(settings);
+  const auto attack_values = Evaluate(&attack, Blocks(0.4f));
+  EXPECT_LT(attack_values[0], 2.0f);
+  EXPECT_FLOAT_EQ(attack_values.back(), 5.0f);
+
+  // Without attack the decay starts from the top.
+  settings.attack_ = 0.0f;
+  settings.decay_ = 0.1f;
+  Modulator decay;
+  decay.Init(settings);
+  const auto decay_values = Evaluate(&decay, Blocks(0.4f));
+  EXPECT_GT(decay_values[0], 9.0f);
+  EXPECT_FLOAT_EQ(decay_values.back(), 5.0f);
+}
+
+// The release starts from the level of the envelope when the gate
+// falls, even with a sustain level of 0 while still decaying.
+TEST(ModulatorTest, EnvelopeReleaseFromCurrentLevel) {
+  ControlModulatorPayload settings;
+  settings.type_ = static_cast<int32_t>(ModulatorType::ENVELOPE);
+  settings.attack_ = 0.0f;
+  settings.decay_ = 1.0f;
+  settings.sustain_ = 0.0f;
+  settings.release_ = 0.1f;
+  settings.gate_ = 0.2f;
+  settings.low_ = 0.0f;
+  settings.high_ = 10.0f;
+
+  Modulator modulator;
+  modulator.Init(settings);
+  const auto values = Evaluate(&modulator, Blocks(1.0f));
+
+  const int gate = Blocks(0.2f) - 1;
+  EXPECT_NEAR(values[gate - 1], 8.0f, 0.2f);
+  for (int i = gate; i < Blocks(0.3f) - 1; ++i) {
+    EXPECT_LT(values[i], values[i - 1]) << i;
+  }
+  for (std::size_t i = Blocks(0.3f); i < values.size(); ++i) {
+    EXPECT_FLOAT_EQ(values[i], 0.0f) << i;
+  }
+}
+
+TEST(ModulatorTest, SampleAndHold) {
+  ControlModulatorPayload settings;
+  settings.type_ = static_cast<int32_t>(ModulatorType::SAMPLE_HOLD);
+  settings.rate_ = 4.0f;
+  settings.low_ = -1.0f;
+  settings.high_ = 1.0f;
+
+  Modulator modulator;
+  modulator.Init(settings);
+  const auto values = Evaluate(&modulator, Blocks(2.0f));
+
+  std::set<float> distinct(values.begin(), values.end());
+  EXPECT_GE(distinct.size(), 7);
+  EXPECT_LE(distinct.size(), 9);
+  for (float v : values) {
+    EXPECT_GE(v, -1.0f);
+    EXPECT_LE(v, 1.0f);
+  }
+}
+
+// Modulated controls move without any update from Python, until their
+// modulator is removed or the control released.
+TEST(ModulatorTest, ModulatesControls) {
+  Controls controls;
+  ASSERT_TRUE(controls.Register(0, "ramp").ok());
+
+  ControlModulatorPayload settings;
+  settings.control_ = 0;
+  settings.generation_ = controls.GetGeneration(0);
+  settings.type_ = static_cast<int32_t>(ModulatorType::RAMP);
+  settings.start_ = 0.0f;
+  settings.end_ = 1.0f;
+  settings.duration_ = 10 * kBlockSeconds;
+
+  // Modulators of other generations are ignored.
+  ControlModulatorPayload stale = settings;
+  stale.generation_ += 1;
+  stale.end_ = -1.0f;
+
+  std::vector<MidiEventAt> events = {ModulatorEvent(stale, 0),
+                                     ModulatorEvent(settings, 0)};
+  controls.TakeEvents(&events);
+
+  float last = 0.0f;
+  for (int i = 0; i < 10; ++i) {
+    const SampleTick tick = i * kBlockSize;
+    controls.Update(tick);
+
+    // The control reaches the value of each block at its end.
+    const Control* control = controls.GetControl(0);
+    EXPECT_NEAR(control->GetValue(tick + kBlockSize), (i + 1) / 10.0f, 1e-5f);
+    EXPECT_GE(control->GetValue(tick + kBlockSize / 2), last);
+    last = control->GetValue(tick + kBlockSize);
+  }
+  EXPECT_NEAR(controls.GetValue(0), 0.9f, 1e-5f);
+
+  // Without modulator the control stays where it is.
+  ControlModulatorPayload none;
+  none.control_ = 0;
+  none.generation_ = settings.generation_;
+  events = {ModulatorEvent(none, 10 * kBlockSize)};
+  controls.TakeEvents(&events);
+  controls.Update(10 * kBlockSize);
+  controls.Update(11 * kBlockSize);
+  EXPECT_FLOAT_EQ(controls.GetControl(0)->GetValue(20 * kBlockSize), 1.0f);
+
+  // Released controls lose their modulator, the next control of the
+  // ID starts from 0.
+  events = {ModulatorEvent(settings, 12 * kBlockSize)};
+  controls.TakeEvents(&events);
+  controls.Update(12 * kBlockSize);
+  EXPECT_NEAR(controls.GetControl(0)->GetValue(13 * kBlockSize), 0.1f,
+              1e-5f);
+  controls.Release(0);
+  ASSERT_TRUE(controls.Register(0, "other").ok());
+  controls.Update(13 * kBlockSize);
+  controls.Update(14 * kBlockSize);
+  EXPECT_FLOAT_EQ(controls.GetControl(0)->GetValue(20 * kBlockSize), 0.0f);
+}
+
+}  // namespace soir
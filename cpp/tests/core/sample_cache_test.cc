@@ -0,0 +1,198 @@
+#include "core/sample_cache.hh"
+
+#include <AudioFile.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "core/common.hh"
+
+namespace soir {
+
+namespace {
+
+// Writes an audio file whose channel c holds the values (c + 1) * i.
+std::string WriteAudioFile(const std::string& name, int channels,
+                           int num_samples) {
+  const auto dir = std::filesystem::temp_directory_path() / "soir-cache-test";
+  std::filesystem::create_directories(dir);
+
+  AudioFile<float> audio_file;
+  audio_file.setNumChannels(channels);
+  audio_file.setNumSamplesPerChannel(num_samples);
+  audio_file.setSampleRate(kSampleRate);
+  for (int c = 0; c < channels; ++c) {
+    for (int i = 0; i < num_samples; ++i) {
+      audio_file.samples[c][i] = (c + 1) * i / 1000.0f;
+    }
+  }
+
+  const auto path = (dir / name).string();
+  audio_file.save(path);
+  return path;
+}
+
+std::string CacheDirectory() {
+  const auto dir =
+      std::filesystem::temp_directory_path() / "soir-cache-test" / "cache";
+  std::filesystem::remove_all(dir);
+  return dir.string();
+}
+
+}  // namespace
+
+TEST(SampleCacheTest, DecodesWithoutCache) {
+  SampleCache cache;
+  ASSERT_TRUE(cache.Init("").ok());
+
+  Sample sample;
+  sample.path_ = WriteAudioFile("mono.wav", 1, 100);
+  ASSERT_TRUE(cache.Load(&sample).ok());
+
+  EXPECT_FALSE(sample.IsMapped());
+  ASSERT_EQ(sample.DurationSamples(), 100);
+
+  // Mono samples are stored once and scaled down.
+  EXPECT_EQ(sample.Channels(), 1);
+  EXPECT_EQ(sample.MemoryUsage(),
+            (100 + 2 * kSampleGuardFrames) * sizeof(float));
+  EXPECT_EQ(sample.lb_.data(), sample.rb_.data());
+  EXPECT_FLOAT_EQ(sample.lb_[50], 0.5f * 0.05f);
+}
+
+TEST(SampleCacheTest, MapsCachedSamples) {
+  SampleCache cache;
+  ASSERT_TRUE(cache.Init(CacheDirectory()).ok());
+
+  Sample first;
+  first.path_ = WriteAudioFile("stereo.wav", 2, 1000);
+  ASSERT_TRUE(cache.Load(&first).ok());
+
+  // The sample is mapped from its entry as soon as it is written.
+  EXPECT_TRUE(first.IsMapped());
+
+  Sample second;
+  second.path_ = first.path_;
+  ASSERT_TRUE(cache.Load(&second).ok());
+
+  EXPECT_TRUE(second.IsMapped());
+  EXPECT_EQ(second.Channels(), 2);
+  ASSERT_EQ(second.DurationSamples(), 1000);
+  EXPECT_FLOAT_EQ(second.lb_[500], 0.5f);
+  EXPECT_FLOAT_EQ(second.rb_[500], 1.0f);
+
+  // Channels are surrounded by silence.
+  EXPECT_EQ(second.lb_.data()[-kSampleGuardFrames], 0.0f);
+  EXPECT_EQ(second.rb_.data()[1000 + kSampleGuardFrames - 1], 0.0f);
+
+  // Moving a sample keeps its data.
+  Sample moved = std::move(second);
+  EXPECT_FLOAT_EQ(moved.rb_[999], 2 * 0.999f);
+}
+
+TEST(SampleCacheTest, InvalidatesChangedFiles) {
+  SampleCache cache;
+  ASSERT_TRUE(cache.Init(CacheDirectory()).ok());
+
+  Sample sample;
+  sample.path_ = WriteAudioFile("changed.wav", 1, 100);
+  ASSERT_TRUE(cache.Load(&sample).ok());
+  EXPECT_EQ(sample.DurationSamples(), 100);
+
+  WriteAudioFile("changed.wav", 1, 200);
+
+  Sample reloaded;
+  reloaded.path_ = sample.path_;
+  ASSERT_TRUE(cache.Load(&reloaded).ok());
+  EXPECT_TRUE(reloaded.IsMapped());
+  EXPECT_EQ(reloaded.DurationSamples(), 200);
+
+  // The previous mapping stays valid for the voices still using it.
+  EXPECT_EQ(sample.DurationSamples(), 100);
+  EXPECT_FLOAT_EQ(sample.lb_[99], 0.5f * 0.099f);
+}
+
+// Samples stored as integers take less memory and decode to values
+// close to their float originals, with or without the cache.
+TEST(SampleCacheTest, StoresIntegerFormats) {
+  constexpr int kLength = 400;
+  const auto path = WriteAudioFile("formats.wav", 2, kLength);
+
+  Sample original;
+  original.path_ = path;
+  SampleCache float_cache;
+  ASSERT_TRUE(float_cache.Init("").ok());
+  ASSERT_TRUE(float_cache.Load(&original).ok());
+
+  struct Case {
+    SampleFormat format_;
+    std::size_t bytes_;
+    float max_error_;
+  };
+
+  for (const std::string& directory : {std::string(), CacheDirectory()}) {
+    for (const auto& c : {Case{SampleFormat::INT16, 2, 1.0f / 32767},
+                          Case{SampleFormat::INT24, 3, 1.0f / 8388607}}) {
+      SampleCache cache;
+      ASSERT_TRUE(cache.Init(directory, c.format_).ok());
+
+      Sample sample;
+      sample.path_ = path;
+      ASSERT_TRUE(cache.Load(&sample).ok());
+
+      EXPECT_EQ(sample.Format(), c.format_);
+      EXPECT_EQ(sample.IsMapped(), !directory.empty());
+      EXPECT_EQ(sample.DurationSamples(), kLength);
+      EXPECT_EQ(sample.MemoryUsage(),
+                2 * (kLength + 2 * kSampleGuardFrames) * c.bytes_);
+      EXPECT_TRUE(sample.lb_.empty());
+
+      // Values of the file stay within range, so the only error is the
+      // rounding to the nearest step.
+      std::vector<float> decoded(kLength);
+      for (int ch = 0; ch < 2; ++ch) {
+        const auto& expected = ch == 0 ? original.lb_ : original.rb_;
+        sample.Decode(ch, 0, kLength, decoded.data());
+
+        double signal = 0.0;
+        double noise = 0.0;
+        for (int i = 0; i < kLength; ++i) {
+          const float error = decoded[i] - expected[i];
+          EXPECT_LE(std::fabs(error), c.max_error_ * 0.5f + 1e-9f) << i;
+          signal += expected[i] * expected[i];
+          noise += error * error;
+        }
+        EXPECT_GT(10.0 * std::log10(signal / noise),
+                  c.format_ == SampleFormat::INT16 ? 80.0 : 120.0);
+      }
+
+      // Decoding from the middle of a sample, and its guards.
+      float value;
+      sample.Decode(1, 123, 1, &value);
+      EXPECT_NEAR(value, original.rb_[123], c.max_error_);
+
+      std::vector<float> guards(2 * kSampleGuardFrames, 1.0f);
+      sample.Decode(0, -kSampleGuardFrames, kSampleGuardFrames,
+                    guards.data());
+      sample.Decode(0, kLength, kSampleGuardFrames,
+                    guards.data() + kSampleGuardFrames);
+      for (float guard : guards) {
+        EXPECT_EQ(guard, 0.0f);
+      }
+    }
+  }
+}
+
+TEST(SampleCacheTest, FailsOnMissingFiles) {
+  SampleCache cache;
+  ASSERT_TRUE(cache.Init(CacheDirectory()).ok());
+
+  Sample sample;
+  sample.path_ = "/nonexistent/sample.wav";
+  EXPECT_FALSE(cache.Load(&sample).ok());
+}
+
+}  // namespace soir
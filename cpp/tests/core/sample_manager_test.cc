@@ -0,0 +1,229 @@
+#include "core/sample_manager.hh"
+
+#include <AudioFile.h>
+#include <absl/status/statusor.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "core/common.hh"
+#include "utils/config.hh"
+
+namespace soir {
+
+namespace {
+
+// Writes a pack with a single mono sample of the given length, loads
+// it in the sample manager and returns the handle of the sample.
+absl::StatusOr<SampleHandle> LoadTestPack(SampleManager* sample_manager,
+                                          int num_samples) {
+  const auto dir = std::filesystem::temp_directory_path() / "soir-manager";
+  std::filesystem::create_directories(dir);
+
+  AudioFile<float> audio_file;
+  audio_file.setNumChannels(1);
+  audio_file.setNumSamplesPerChannel(num_samples);
+  audio_file.setSampleRate(kSampleRate);
+  audio_file.save((dir / "one.wav").string());
+
+  std::ofstream pack(dir / "test.pack.json");
+  pack << R"({"samples": [{"name": "one", "path": "one.wav"}]})";
+  pack.close();
+
+  utils::Config config(R"({"dsp": {"sample_directory": ")" + dir.string() +
+                       R"(", "sample_packs": ["test"]}})");
+
+  auto status = sample_manager->Init(config);
+  if (!status.ok()) {
+    return status;
+  }
+
+  return sample_manager->GetSampleHandle("test", "one");
+}
+
+// Frames of the samples of the lazy pack, 600kB each once loaded.
+constexpr int kLazyFrames = 150000;
+
+// Initializes the manager with a 1MB budget over a pack of three mono
+// samples "a", "b" and "c" whose values are all 1.0.
+absl::Status InitLazyPack(SampleManager* sample_manager) {
+  const auto dir = std::filesystem::temp_directory_path() / "soir-manager-lazy";
+  std::filesystem::create_directories(dir);
+
+  AudioFile<float> audio_file;
+  audio_file.setNumChannels(1);
+  audio_file.setNumSamplesPerChannel(kLazyFrames);
+  audio_file.setSampleRate(kSampleRate);
+  for (int i = 0; i < kLazyFrames; ++i) {
+    audio_file.samples[0][i] = 1.0f;
+  }
+  for (const std::string name : {"a", "b", "c"}) {
+    audio_file.save((dir / (name + ".wav")).string());
+  }
+
+  std::ofstream pack(dir / "lazy.pack.json");
+  pack << R"({"samples": [{"name": "a", "path": "a.wav"},)"
+       << R"( {"name": "b", "path": "b.wav"},)"
+       << R"( {"name": "c", "path": "c.wav"}]})";
+  pack.close();
+
+  return sample_manager->Init(
+      utils::Config(R"({"dsp": {"sample_directory": ")" + dir.string() +
+                    R"(", "sample_memory_mb": 1, "sample_packs": ["lazy"]}})"));
+}
+
+// Pins a sample and waits for it to be resident.
+Sample* WaitForSample(SampleManager* sample_manager, SampleHandle handle) {
+  if (!sample_manager->PinSample(handle)) {
+    return nullptr;
+  }
+
+  for (int i = 0; i < 1000; ++i) {
+    bool failed = false;
+    Sample* sample = sample_manager->GetPinnedSample(handle, &failed);
+    if (sample != nullptr || failed) {
+      return sample;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TEST(SampleManagerTest, SampleHandles) {
+  SampleManager sample_manager;
+
+  auto one = LoadTestPack(&sample_manager, 400);
+  ASSERT_TRUE(one.ok());
+
+  const SampleHandle handle = *one;
+  ASSERT_NE(handle, kInvalidSampleHandle);
+  EXPECT_EQ(sample_manager.GetSample(handle),
+            sample_manager.GetPack("test")->GetSample("one"));
+
+  // Fuzzy matches resolve to the same handle as the exact name.
+  EXPECT_EQ(sample_manager.GetSampleHandle("test", "one"), handle);
+  EXPECT_EQ(sample_manager.GetSampleHandle("test", "hard-one"), handle);
+
+  EXPECT_EQ(sample_manager.GetSampleHandle("test", "two"),
+            kInvalidSampleHandle);
+  EXPECT_EQ(sample_manager.GetSampleHandle("nope", "one"),
+            kInvalidSampleHandle);
+  EXPECT_EQ(sample_manager.GetSample(kInvalidSampleHandle), nullptr);
+  EXPECT_EQ(sample_manager.GetSample(handle + 1), nullptr);
+  EXPECT_EQ(sample_manager.GetPack("nope"), nullptr);
+}
+
+TEST(SampleManagerTest, LoadPacksInParallel) {
+  const auto dir = std::filesystem::temp_directory_path() / "soir-packs";
+  std::filesystem::create_directories(dir);
+
+  // Sample i of a pack is i + 1 frames long, so that each one can be
+  // told apart once loaded.
+  constexpr int kNumSamples = 50;
+  for (const std::string pack : {"a", "b"}) {
+    std::ofstream config(dir / (pack + ".pack.json"));
+    config << R"({"samples": [)";
+    for (int i = 0; i < kNumSamples; ++i) {
+      const std::string file = pack + std::to_string(i) + ".wav";
+
+      AudioFile<float> audio_file;
+      audio_file.setNumChannels(1);
+      audio_file.setNumSamplesPerChannel(i + 1);
+      audio_file.setSampleRate(kSampleRate);
+      audio_file.save((dir / file).string());
+
+      config << (i ? ", " : "") << R"({"name": "s)" << i << R"(", "path": ")"
+             << file << R"("})";
+    }
+    config << "]}";
+  }
+
+  std::ofstream broken(dir / "broken.pack.json");
+  broken << R"({"samples": [{"name": "x", "path": "missing.wav"}]})";
+  broken.close();
+
+  utils::Config config(R"({"dsp": {"sample_directory": ")" + dir.string() +
+                       R"(", "sample_loader_threads": 4, )"
+                       R"("sample_packs": ["a", "broken", "b", "nope"]}})");
+
+  SampleManager sample_manager;
+
+  std::vector<std::pair<int, int>> progress;
+  sample_manager.SetLoadProgress([&progress](int loaded, int total) {
+    progress.emplace_back(loaded, total);
+  });
+
+  auto status = sample_manager.Init(config);
+
+  // Errors of all packs are reported, the valid ones are loaded.
+  EXPECT_FALSE(status.ok());
+  EXPECT_NE(status.message().find("nope"), std::string::npos);
+  EXPECT_NE(status.message().find("broken/x"), std::string::npos);
+  EXPECT_EQ(sample_manager.GetPack("broken"), nullptr);
+  EXPECT_EQ(sample_manager.GetPackNames(),
+            (std::vector<std::string>{"a", "b"}));
+
+  for (const std::string pack : {"a", "b"}) {
+    for (int i = 0; i < kNumSamples; ++i) {
+      Sample* sample =
+          sample_manager.GetPack(pack)->GetSample("s" + std::to_string(i));
+      ASSERT_NE(sample, nullptr);
+      EXPECT_EQ(sample->DurationSamples(), i + 1);
+    }
+  }
+
+  ASSERT_FALSE(progress.empty());
+  EXPECT_EQ(progress.back(), std::make_pair(2 * kNumSamples + 1,
+                                            2 * kNumSamples + 1));
+  for (size_t i = 1; i < progress.size(); ++i) {
+    EXPECT_GT(progress[i].first, progress[i - 1].first);
+  }
+}
+
+TEST(SampleManagerTest, LazyLoadingWithinBudget) {
+  SampleManager sample_manager;
+  ASSERT_TRUE(InitLazyPack(&sample_manager).ok());
+
+  // Nothing is loaded until referenced.
+  EXPECT_EQ(sample_manager.ResidentBytes(), 0);
+
+  const SampleHandle a = sample_manager.GetSampleHandle("lazy", "a");
+  const SampleHandle b = sample_manager.GetSampleHandle("lazy", "b");
+  const SampleHandle c = sample_manager.GetSampleHandle("lazy", "c");
+
+  Sample* sample_a = WaitForSample(&sample_manager, a);
+  ASSERT_NE(sample_a, nullptr);
+  EXPECT_EQ(sample_a->DurationSamples(), kLazyFrames);
+  EXPECT_NE(WaitForSample(&sample_manager, b), nullptr);
+  sample_manager.UnpinSample(b);
+
+  // Pinned samples are kept even over budget, the least recently used
+  // unpinned ones are evicted.
+  EXPECT_NE(WaitForSample(&sample_manager, c), nullptr);
+  for (int i = 0; i < 1000 && sample_manager.ResidentBytes() > (1 << 20);
+       ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(sample_manager.ResidentBytes(), 2 * sample_a->MemoryUsage());
+  EXPECT_FLOAT_EQ(sample_a->lb_[kLazyFrames - 1], 0.5f);
+
+  // Evicted samples are loaded again on their next use.
+  sample_manager.UnpinSample(a);
+  sample_manager.UnpinSample(c);
+  Sample* sample_b = WaitForSample(&sample_manager, b);
+  ASSERT_NE(sample_b, nullptr);
+  EXPECT_EQ(sample_b->DurationSamples(), kLazyFrames);
+  sample_manager.UnpinSample(b);
+
+  EXPECT_FALSE(sample_manager.PinSample(kInvalidSampleHandle));
+}
+
+}  // namespace soir
@@ -0,0 +1,70 @@
+#include "core/worker_pool.hh"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+namespace soir {
+
+namespace {
+
+void Increment(void* arg) {
+  static_cast<std::atomic<int>*>(arg)->fetch_add(1);
+}
+
+}  // namespace
+
+TEST(WorkerPoolTest, StartStop) {
+  WorkerPool pool;
+
+  EXPECT_TRUE(pool.Start(2, false).ok());
+  EXPECT_EQ(pool.NumWorkers(), 2);
+  EXPECT_TRUE(pool.Stop().ok());
+  EXPECT_EQ(pool.NumWorkers(), 0);
+}
+
+TEST(WorkerPoolTest, RunsEachJobOnce) {
+  WorkerPool pool;
+  ASSERT_TRUE(pool.Start(4, false).ok());
+
+  std::vector<std::atomic<int>> counters(64);
+
+  for (int batch = 0; batch < 1000; ++batch) {
+    for (auto& counter : counters) {
+      pool.Submit({&Increment, &counter});
+    }
+    pool.Wait();
+  }
+
+  for (auto& counter : counters) {
+    EXPECT_EQ(counter.load(), 1000);
+  }
+}
+
+TEST(WorkerPoolTest, OverflowRunsInline) {
+  WorkerPool pool;
+  ASSERT_TRUE(pool.Start(1, false).ok());
+
+  std::atomic<int> counter = 0;
+  const int n = WorkerPool::kQueueCapacity * 2;
+
+  for (int i = 0; i < n; ++i) {
+    pool.Submit({&Increment, &counter});
+  }
+  pool.Wait();
+
+  EXPECT_EQ(counter.load(), n);
+}
+
+TEST(WorkerPoolTest, NotStartedRunsInline) {
+  WorkerPool pool;
+  std::atomic<int> counter = 0;
+
+  pool.Submit({&Increment, &counter});
+  EXPECT_EQ(counter.load(), 1);
+
+  pool.Wait();
+}
+
+}  // namespace soir
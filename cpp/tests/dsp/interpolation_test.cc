@@ -0,0 +1,79 @@
+#include "dsp/interpolation.hh"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+namespace soir {
+namespace dsp {
+
+namespace {
+
+// Largest error of a kernel interpolating a sine of the given
+// frequency, relative to the sample rate, in between its samples.
+template <typename Kernel>
+float MaxSineError(const Kernel& kernel, float frequency) {
+  std::vector<float> x(256);
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    x[i] = std::sin(2.0f * M_PI * frequency * i);
+  }
+
+  float error = 0.0f;
+  for (int i = 16; i < 240; ++i) {
+    for (float t = 0.0f; t < 1.0f; t += 0.125f) {
+      const float expected = std::sin(2.0f * M_PI * frequency * (i + t));
+      error = std::max(error, std::fabs(kernel(&x[i], t) - expected));
+    }
+  }
+  return error;
+}
+
+}  // namespace
+
+TEST(InterpolationTest, ExactOnSamples) {
+  const float x[] = {0.3f, -0.2f, 0.9f, 0.1f, -0.7f, 0.5f, 0.4f, -0.1f, 0.8f};
+  const float* at = x + kInterpolationBefore;
+
+  EXPECT_FLOAT_EQ(LinearKernel()(at, 0.0f), at[0]);
+  EXPECT_FLOAT_EQ(HermiteKernel()(at, 0.0f), at[0]);
+  EXPECT_NEAR(SincKernel()(at, 0.0f), at[0], 1e-6f);
+}
+
+TEST(InterpolationTest, ExactOnRamps) {
+  std::vector<float> x(16);
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    x[i] = 0.5f * i - 2.0f;
+  }
+
+  for (float t = 0.0f; t < 1.0f; t += 0.1f) {
+    const float expected = 0.5f * (8 + t) - 2.0f;
+    EXPECT_NEAR(LinearKernel()(&x[8], t), expected, 1e-5f) << t;
+    EXPECT_NEAR(HermiteKernel()(&x[8], t), expected, 1e-5f) << t;
+  }
+}
+
+TEST(InterpolationTest, SincPhasesHaveUnitGain) {
+  const float* table = SincTable();
+  for (int p = 0; p <= kSincPhases; ++p) {
+    float sum = 0.0f;
+    for (int k = 0; k < kSincTaps; ++k) {
+      sum += table[p * kSincTaps + k];
+    }
+    EXPECT_NEAR(sum, 1.0f, 1e-5f) << p;
+  }
+}
+
+// Higher order kernels follow a high frequency sine much closer.
+TEST(InterpolationTest, KernelsQuality) {
+  const float linear = MaxSineError(LinearKernel(), 0.2f);
+  const float hermite = MaxSineError(HermiteKernel(), 0.2f);
+  const float sinc = MaxSineError(SincKernel(), 0.2f);
+
+  EXPECT_LT(hermite, linear);
+  EXPECT_LT(sinc, hermite);
+  EXPECT_LT(sinc, 0.02f);
+}
+
+}  // namespace dsp
+}  // namespace soir
@@ -1,21 +1,109 @@
 #include "inst/sampler.hh"
 
+#include <AudioFile.h>
+#include <absl/status/statusor.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
 #include "core/controls.hh"
+#include "core/midi_sysex.hh"
 #include "core/sample_manager.hh"
 
 namespace soir {
 namespace inst {
 
+namespace {
+
+// Writes a pack with a single mono sample of the given length whose
+// values are all 1.0, loads it in the sample manager and returns the
+// handle of the sample.
+absl::StatusOr<SampleHandle> LoadTestPack(SampleManager* sample_manager,
+                                          int num_samples) {
+  const auto dir = std::filesystem::temp_directory_path() / "soir-sampler";
+  std::filesystem::create_directories(dir);
+
+  AudioFile<float> audio_file;
+  audio_file.setNumChannels(1);
+  audio_file.setNumSamplesPerChannel(num_samples);
+  audio_file.setSampleRate(kSampleRate);
+  for (int i = 0; i < num_samples; ++i) {
+    audio_file.samples[0][i] = 1.0f;
+  }
+  audio_file.save((dir / "one.wav").string());
+
+  std::ofstream pack(dir / "test.pack.json");
+  pack << R"({"samples": [{"name": "one", "path": "one.wav"}]})";
+  pack.close();
+
+  utils::Config config(R"({"dsp": {"sample_directory": ")" + dir.string() +
+                       R"(", "sample_packs": ["test"]}})");
+
+  auto status = sample_manager->Init(config);
+  if (!status.ok()) {
+    return status;
+  }
+
+  return sample_manager->GetSampleHandle("test", "one");
+}
+
+MidiEventAt SysexEvent(MidiSysexType type, const std::string& payload) {
+  const std::string serialized =
+      MidiSysexInstruction::Serialize(type, payload);
+
+  libremidi::midi_bytes bytes;
+  bytes.push_back(
+      static_cast<unsigned char>(libremidi::message_type::SYSTEM_EXCLUSIVE));
+  bytes.insert(bytes.end(), serialized.begin(), serialized.end());
+
+  return MidiEventAt(1, libremidi::message(bytes, 0), absl::Now());
+}
+
+MidiEventAt PlayEvent(const SamplerPlayPayload& play) {
+  return SysexEvent(MidiSysexType::SAMPLER_PLAY, play.Encode());
+}
+
+SamplerPlayPayload Play(SampleHandle sample, float amp = 1.0f) {
+  SamplerPlayPayload play;
+  play.sample_ = sample;
+  play.amp_.value_ = amp;
+  return play;
+}
+
+// Renders a block with the given play events, all triggered at the
+// start of the block, and returns the left channel value at offset.
+float RenderBlock(Sampler* sampler, SampleTick tick,
+                  const std::vector<SamplerPlayPayload>& plays, int offset) {
+  MidiBlock events;
+  events.Reset(tick);
+  for (const auto& play : plays) {
+    auto event = PlayEvent(play);
+    event.SetTick(tick);
+    events.Push(event);
+  }
+
+  AudioBuffer buffer(kBlockSize);
+  buffer.Reset();
+  sampler->Render(tick, events, buffer);
+
+  return buffer.GetChannel(kLeftChannel)[offset];
+}
+
+}  // namespace
+
 TEST(SamplerTest, Creation) {
   Sampler sampler;
   EXPECT_TRUE(true);
 }
 
 TEST(SamplerTest, Initialization) {
-  Sampler sampler;
   SampleManager sample_manager;
+  Sampler sampler;
   Controls controls;
 
   auto status = sampler.Init("", &sample_manager, &controls);
@@ -27,5 +115,533 @@ TEST(SamplerTest, GetType) {
   EXPECT_EQ(sampler.GetType(), Type::SAMPLER);
 }
 
+// Plays a short sample twice, overlapping, and checks the voices
+// sum up, release and free their slot once done.
+TEST(SamplerTest, PlayOverlappingVoices) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  auto one = LoadTestPack(&sample_manager, 2000);
+  ASSERT_TRUE(one.ok());
+  ASSERT_TRUE(sampler.Init("", &sample_manager, &controls).ok());
+
+  MidiBlock events;
+  events.Reset(0);
+  events.Push(PlayEvent(Play(*one)));
+  auto second = PlayEvent(Play(*one));
+  second.SetTick(100);
+  events.Push(second);
+
+  AudioBuffer buffer(kBlockSize);
+  buffer.Reset();
+  sampler.Render(0, events, buffer);
+
+  const float* left = buffer.GetChannel(kLeftChannel);
+  const float* right = buffer.GetChannel(kRightChannel);
+
+  // Mono samples are played at half volume on both sides, once the
+  // smoothing attack is done.
+  EXPECT_NEAR(left[80], 0.5f, 1e-3f);
+  EXPECT_NEAR(right[80], 0.5f, 1e-3f);
+  EXPECT_NEAR(left[300], 1.0f, 1e-3f);
+  EXPECT_FLOAT_EQ(left[0], right[0]);
+
+  // The first voice ends after 2000 samples, the second 100 later,
+  // both fading out instead of cutting.
+  MidiBlock empty;
+  float last = 1.0f;
+  for (int block = 1; block < 8; ++block) {
+    empty.Reset(block * kBlockSize);
+    buffer.Reset();
+    sampler.Render(block * kBlockSize, empty, buffer);
+
+    for (int i = 0; i < kBlockSize; ++i) {
+      const SampleTick tick = block * kBlockSize + i;
+      if (tick > 2100) {
+        EXPECT_EQ(left[i], 0.0f) << tick;
+      } else if (tick > 2040) {
+        EXPECT_LE(left[i], last + 1e-6f) << tick;
+        last = left[i];
+      }
+    }
+  }
+}
+
+// Stereo samples keep their channels apart, mono ones are rendered on
+// both sides from the same data.
+TEST(SamplerTest, StereoAndMonoSamples) {
+  const auto dir = std::filesystem::temp_directory_path() / "soir-stereo";
+  std::filesystem::create_directories(dir);
+
+  AudioFile<float> audio_file;
+  audio_file.setNumChannels(2);
+  audio_file.setNumSamplesPerChannel(2000);
+  audio_file.setSampleRate(kSampleRate);
+  for (int i = 0; i < 2000; ++i) {
+    audio_file.samples[0][i] = 1.0f;
+    audio_file.samples[1][i] = -0.5f;
+  }
+  audio_file.save((dir / "stereo.wav").string());
+
+  AudioFile<float> mono_file;
+  mono_file.setNumChannels(1);
+  mono_file.setNumSamplesPerChannel(2000);
+  mono_file.setSampleRate(kSampleRate);
+  for (int i = 0; i < 2000; ++i) {
+    mono_file.samples[0][i] = 1.0f;
+  }
+  mono_file.save((dir / "mono.wav").string());
+
+  std::ofstream pack(dir / "test.pack.json");
+  pack << R"({"samples": [{"name": "stereo", "path": "stereo.wav"},)"
+       << R"( {"name": "mono", "path": "mono.wav"}]})";
+  pack.close();
+
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  ASSERT_TRUE(sample_manager
+                  .Init(utils::Config(R"({"dsp": {"sample_directory": ")" +
+                                      dir.string() +
+                                      R"(", "sample_packs": ["test"]}})"))
+                  .ok());
+  ASSERT_TRUE(sampler.Init("", &sample_manager, &controls).ok());
+
+  const SampleHandle stereo = sample_manager.GetSampleHandle("test", "stereo");
+  const SampleHandle mono = sample_manager.GetSampleHandle("test", "mono");
+  EXPECT_EQ(sample_manager.GetSample(stereo)->Channels(), 2);
+  EXPECT_EQ(sample_manager.GetSample(mono)->Channels(), 1);
+
+  MidiBlock events;
+  events.Reset(0);
+  auto play = Play(stereo);
+  play.pan_.value_ = 0.5f;
+  events.Push(PlayEvent(play));
+
+  AudioBuffer buffer(kBlockSize);
+  buffer.Reset();
+  sampler.Render(0, events, buffer);
+
+  EXPECT_NEAR(buffer.GetChannel(kLeftChannel)[300], 0.5f, 1e-3f);
+  EXPECT_NEAR(buffer.GetChannel(kRightChannel)[300], -0.5f, 1e-3f);
+
+  // The mono voice starts after the stereo one has ended.
+  MidiBlock empty;
+  for (int block = 1; block < 8; ++block) {
+    empty.Reset(block * kBlockSize);
+    buffer.Reset();
+    sampler.Render(block * kBlockSize, empty, buffer);
+  }
+
+  events.Reset(8 * kBlockSize);
+  play = Play(mono);
+  play.pan_.value_ = -0.5f;
+  auto event = PlayEvent(play);
+  event.SetTick(8 * kBlockSize);
+  events.Push(event);
+
+  buffer.Reset();
+  sampler.Render(8 * kBlockSize, events, buffer);
+
+  EXPECT_NEAR(buffer.GetChannel(kLeftChannel)[300], 0.5f, 1e-3f);
+  EXPECT_NEAR(buffer.GetChannel(kRightChannel)[300], 0.25f, 1e-3f);
+}
+
+// Samples stored as integers are decoded by chunks while they play,
+// at any rate and direction and with any interpolation they sound
+// like their float originals.
+TEST(SamplerTest, IntegerSamplesMatchFloat) {
+  const auto dir = std::filesystem::temp_directory_path() / "soir-formats";
+  std::filesystem::create_directories(dir);
+
+  constexpr int kLength = 20000;
+  AudioFile<float> audio_file;
+  audio_file.setNumChannels(2);
+  audio_file.setNumSamplesPerChannel(kLength);
+  audio_file.setSampleRate(kSampleRate);
+  for (int i = 0; i < kLength; ++i) {
+    audio_file.samples[0][i] = 0.9f * std::sin(i * 0.05f);
+    audio_file.samples[1][i] = 0.7f * std::cos(i * 0.011f);
+  }
+  audio_file.save((dir / "sine.wav").string());
+
+  std::ofstream pack(dir / "test.pack.json");
+  pack << R"({"samples": [{"name": "sine", "path": "sine.wav"}]})";
+  pack.close();
+
+  struct Case {
+    float rate_;
+    float start_;
+    float end_;
+  };
+
+  // Renders a voice of the sample stored in the given format, returns
+  // both channels of all blocks.
+  auto render = [&dir](const std::string& format,
+                       const std::string& interpolation, const Case& c) {
+    SampleManager sample_manager;
+    Sampler sampler;
+    Controls controls;
+
+    std::vector<float> output;
+    if (!sample_manager
+             .Init(utils::Config(R"({"dsp": {"sample_directory": ")" +
+                                 dir.string() + R"(", "sample_format": ")" +
+                                 format + R"(", "sample_packs": ["test"]}})"))
+             .ok() ||
+        !sampler
+             .Init(R"({"interpolation": ")" + interpolation + R"("})",
+                   &sample_manager, &controls)
+             .ok()) {
+      return output;
+    }
+
+    auto play = Play(sample_manager.GetSampleHandle("test", "sine"));
+    play.rate_ = c.rate_;
+    play.start_ = c.start_;
+    play.end_ = c.end_;
+
+    AudioBuffer buffer(kBlockSize);
+    for (int block = 0; block < 8; ++block) {
+      MidiBlock events;
+      events.Reset(block * kBlockSize);
+      if (block == 0) {
+        events.Push(PlayEvent(play));
+      }
+
+      buffer.Reset();
+      sampler.Render(block * kBlockSize, events, buffer);
+      for (int ch : {kLeftChannel, kRightChannel}) {
+        const float* data = buffer.GetChannel(ch);
+        output.insert(output.end(), data, data + kBlockSize);
+      }
+    }
+    return output;
+  };
+
+  for (const std::string interpolation : {"linear", "hermite", "sinc"}) {
+    for (const auto& c : {Case{1.0f, 0.0f, 1.0f}, Case{0.73f, 0.1f, 1.0f},
+                          Case{2.6f, 0.0f, 1.0f}, Case{1.3f, 1.0f, 0.0f}}) {
+      const auto expected = render("float32", interpolation, c);
+      const auto int16 = render("int16", interpolation, c);
+      const auto int24 = render("int24", interpolation, c);
+      ASSERT_EQ(expected.size(), 2 * 8 * kBlockSize);
+      ASSERT_EQ(int16.size(), expected.size());
+      ASSERT_EQ(int24.size(), expected.size());
+
+      for (std::size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_NEAR(int16[i], expected[i], 1e-4f)
+            << interpolation << " " << c.rate_ << " " << i;
+        EXPECT_NEAR(int24[i], expected[i], 1e-6f)
+            << interpolation << " " << c.rate_ << " " << i;
+      }
+    }
+  }
+}
+
+// Voices are recycled: triggering more notes than the pool holds
+// over time never runs out of voices.
+TEST(SamplerTest, VoicesAreRecycled) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  auto one = LoadTestPack(&sample_manager, 400);
+  ASSERT_TRUE(one.ok());
+  ASSERT_TRUE(sampler.Init("", &sample_manager, &controls).ok());
+
+  AudioBuffer buffer(kBlockSize);
+  MidiBlock events;
+
+  for (int block = 0; block < 1000; ++block) {
+    const SampleTick tick = block * kBlockSize;
+
+    events.Reset(tick);
+    auto event = PlayEvent(Play(*one));
+    event.SetTick(tick);
+    events.Push(event);
+
+    buffer.Reset();
+    sampler.Render(tick, events, buffer);
+
+    EXPECT_NEAR(buffer.GetChannel(kLeftChannel)[200], 0.5f, 1e-3f) << block;
+  }
+}
+
+namespace {
+
+// Frames of the samples of the lazy pack, 600kB each once loaded.
+constexpr int kLazyFrames = 150000;
+
+// Initializes the manager with a 1MB budget over a pack of three mono
+// samples "a", "b" and "c" whose values are all 1.0.
+absl::Status InitLazyPack(SampleManager* sample_manager) {
+  const auto dir = std::filesystem::temp_directory_path() / "soir-lazy";
+  std::filesystem::create_directories(dir);
+
+  AudioFile<float> audio_file;
+  audio_file.setNumChannels(1);
+  audio_file.setNumSamplesPerChannel(kLazyFrames);
+  audio_file.setSampleRate(kSampleRate);
+  for (int i = 0; i < kLazyFrames; ++i) {
+    audio_file.samples[0][i] = 1.0f;
+  }
+  for (const std::string name : {"a", "b", "c"}) {
+    audio_file.save((dir / (name + ".wav")).string());
+  }
+
+  std::ofstream pack(dir / "lazy.pack.json");
+  pack << R"({"samples": [{"name": "a", "path": "a.wav"},)"
+       << R"( {"name": "b", "path": "b.wav"},)"
+       << R"( {"name": "c", "path": "c.wav"}]})";
+  pack.close();
+
+  return sample_manager->Init(
+      utils::Config(R"({"dsp": {"sample_directory": ")" + dir.string() +
+                    R"(", "sample_memory_mb": 1, "sample_packs": ["lazy"]}})"));
+}
+
+}  // namespace
+
+// A sample which isn't resident yet is played by a silent voice which
+// starts from the beginning of the sample once it's loaded.
+TEST(SamplerTest, PendingVoiceStartsLate) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  ASSERT_TRUE(InitLazyPack(&sample_manager).ok());
+  ASSERT_TRUE(sampler.Init("", &sample_manager, &controls).ok());
+
+  const SampleHandle a = sample_manager.GetSampleHandle("lazy", "a");
+
+  float value = RenderBlock(&sampler, 0, {Play(a)}, 200);
+  int block = 1;
+  for (; value == 0.0f && block < 1000; ++block) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    value = RenderBlock(&sampler, block * kBlockSize, {}, 200);
+  }
+
+  EXPECT_NEAR(value, 0.5f, 1e-3f);
+
+  // The voice keeps its sample resident while it plays.
+  bool failed = false;
+  ASSERT_TRUE(sample_manager.PinSample(a));
+  EXPECT_NE(sample_manager.GetPinnedSample(a, &failed), nullptr);
+  sample_manager.UnpinSample(a);
+}
+
+TEST(SamplerTest, PlayAndStop) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  auto one = LoadTestPack(&sample_manager, kSampleRate);
+  ASSERT_TRUE(one.ok());
+  ASSERT_TRUE(sampler.Init("", &sample_manager, &controls).ok());
+
+  EXPECT_NEAR(RenderBlock(&sampler, 0, {Play(*one)}, 200), 0.5f, 1e-3f);
+
+  SamplerStopPayload stop_payload;
+  stop_payload.sample_ = *one;
+
+  MidiBlock events;
+  events.Reset(kBlockSize);
+  auto stop = SysexEvent(MidiSysexType::SAMPLER_STOP, stop_payload.Encode());
+  stop.SetTick(kBlockSize);
+  events.Push(stop);
+
+  AudioBuffer buffer(kBlockSize);
+  buffer.Reset();
+  sampler.Render(kBlockSize, events, buffer);
+
+  EXPECT_EQ(RenderBlock(&sampler, 2 * kBlockSize, {}, 200), 0.0f);
+}
+
+TEST(SamplerTest, AmpFromControl) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  auto one = LoadTestPack(&sample_manager, kSampleRate);
+  ASSERT_TRUE(one.ok());
+  ASSERT_TRUE(sampler.Init("", &sample_manager, &controls).ok());
+
+  // The voice starts once the control is done ramping up from 0.
+  const ControlId amp = 0;
+  ASSERT_TRUE(controls.Register(amp, "amp").ok());
+  controls.GetControl(amp)->SetTargetValue(0, 0.5f);
+
+  auto play = Play(*one);
+  play.amp_ = {amp, 0.0f};
+
+  RenderBlock(&sampler, kBlockSize, {play}, 0);
+  EXPECT_NEAR(RenderBlock(&sampler, 2 * kBlockSize, {}, 200), 0.25f, 1e-3f);
+}
+
+TEST(SamplerTest, InvalidSettings) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  EXPECT_TRUE(sampler.Init(R"({"max_voices": 8, "steal": "quietest"})",
+                           &sample_manager, &controls)
+                  .ok());
+  EXPECT_FALSE(
+      sampler.Init(R"({"max_voices": 0})", &sample_manager, &controls).ok());
+  EXPECT_FALSE(
+      sampler.Init(R"({"max_voices": 1000})", &sample_manager, &controls)
+          .ok());
+  EXPECT_FALSE(
+      sampler.Init(R"({"steal": "newest"})", &sample_manager, &controls).ok());
+  EXPECT_TRUE(sampler.Init(R"({"interpolation": "sinc"})", &sample_manager,
+                           &controls)
+                  .ok());
+  EXPECT_FALSE(sampler.Init(R"({"interpolation": "cubic"})", &sample_manager,
+                            &controls)
+                   .ok());
+}
+
+// Past the polyphony limit of the sampler the oldest voice fades out
+// over a few milliseconds instead of being cut.
+TEST(SamplerTest, MaxVoicesStealsOldest) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  auto one = LoadTestPack(&sample_manager, kSampleRate);
+  ASSERT_TRUE(one.ok());
+  ASSERT_TRUE(
+      sampler.Init(R"({"max_voices": 2})", &sample_manager, &controls).ok());
+
+  EXPECT_NEAR(RenderBlock(&sampler, 0, {Play(*one), Play(*one)}, 200), 1.0f,
+              1e-3f);
+
+  // The third voice steals the first one.
+  MidiBlock events;
+  events.Reset(kBlockSize);
+  auto event = PlayEvent(Play(*one));
+  event.SetTick(kBlockSize);
+  events.Push(event);
+
+  AudioBuffer buffer(kBlockSize);
+  buffer.Reset();
+  sampler.Render(kBlockSize, events, buffer);
+
+  const float* left = buffer.GetChannel(kLeftChannel);
+  float last = left[0];
+  for (int i = 1; i < kSampleStealFadeSamples; ++i) {
+    EXPECT_LE(std::fabs(left[i] - last), 0.01f) << i;
+    last = left[i];
+  }
+  EXPECT_NEAR(left[kSampleStealFadeSamples + 100], 1.0f, 1e-3f);
+
+  EXPECT_NEAR(RenderBlock(&sampler, 2 * kBlockSize, {}, 200), 1.0f, 1e-3f);
+}
+
+TEST(SamplerTest, MaxVoicesStealsQuietest) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  auto one = LoadTestPack(&sample_manager, kSampleRate);
+  ASSERT_TRUE(one.ok());
+  ASSERT_TRUE(sampler
+                  .Init(R"({"max_voices": 2, "steal": "quietest"})",
+                        &sample_manager, &controls)
+                  .ok());
+
+  EXPECT_NEAR(RenderBlock(&sampler, 0, {Play(*one), Play(*one, 0.2f)}, 200),
+              0.6f, 1e-3f);
+
+  // The quiet voice is stolen even though it is the most recent.
+  RenderBlock(&sampler, kBlockSize, {Play(*one)}, 0);
+  EXPECT_NEAR(RenderBlock(&sampler, 2 * kBlockSize, {}, 200), 1.0f, 1e-3f);
+}
+
+TEST(SamplerTest, SampleVoicesLimit) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  auto one = LoadTestPack(&sample_manager, kSampleRate);
+  ASSERT_TRUE(one.ok());
+  ASSERT_TRUE(sampler.Init("", &sample_manager, &controls).ok());
+
+  auto mono = Play(*one);
+  mono.voices_ = 1;
+  EXPECT_NEAR(RenderBlock(&sampler, 0, {mono}, 200), 0.5f, 1e-3f);
+  RenderBlock(&sampler, kBlockSize, {mono}, 0);
+  EXPECT_NEAR(RenderBlock(&sampler, 2 * kBlockSize, {}, 200), 0.5f, 1e-3f);
+
+  // Other voices of the sample without a limit are not affected.
+  RenderBlock(&sampler, 3 * kBlockSize, {Play(*one)}, 0);
+  EXPECT_NEAR(RenderBlock(&sampler, 4 * kBlockSize, {}, 200), 1.0f, 1e-3f);
+}
+
+TEST(SamplerTest, Retrigger) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  auto one = LoadTestPack(&sample_manager, kSampleRate);
+  ASSERT_TRUE(one.ok());
+  ASSERT_TRUE(sampler
+                  .Init(R"({"steal": "retrigger"})", &sample_manager,
+                        &controls)
+                  .ok());
+
+  for (int block = 0; block < 8; ++block) {
+    RenderBlock(&sampler, block * kBlockSize, {Play(*one)}, 0);
+  }
+  EXPECT_NEAR(RenderBlock(&sampler, 8 * kBlockSize, {}, 200), 0.5f, 1e-3f);
+}
+
+TEST(SamplerTest, ChokeGroups) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  auto one = LoadTestPack(&sample_manager, kSampleRate);
+  ASSERT_TRUE(one.ok());
+  ASSERT_TRUE(sampler.Init("", &sample_manager, &controls).ok());
+
+  auto open = Play(*one);
+  open.choke_ = 1;
+  auto closed = Play(*one, 0.2f);
+  closed.choke_ = 1;
+  auto other = Play(*one);
+  other.choke_ = 2;
+
+  EXPECT_NEAR(RenderBlock(&sampler, 0, {open, other}, 200), 1.0f, 1e-3f);
+
+  // The closed voice chokes the open one but not the other group.
+  RenderBlock(&sampler, kBlockSize, {closed}, 0);
+  EXPECT_NEAR(RenderBlock(&sampler, 2 * kBlockSize, {}, 200), 0.6f, 1e-3f);
+}
+
+// However many notes are triggered at once, the number of voices
+// never goes past the hard ceiling.
+TEST(SamplerTest, VoicesAreBounded) {
+  SampleManager sample_manager;
+  Sampler sampler;
+  Controls controls;
+
+  auto one = LoadTestPack(&sample_manager, kSampleRate);
+  ASSERT_TRUE(one.ok());
+  ASSERT_TRUE(
+      sampler.Init(R"({"max_voices": 16})", &sample_manager, &controls).ok());
+
+  std::vector<SamplerPlayPayload> plays(1000, Play(*one));
+  RenderBlock(&sampler, 0, plays, 0);
+  RenderBlock(&sampler, kBlockSize, plays, 0);
+
+  // Only the last voices triggered remain after the fade.
+  EXPECT_NEAR(RenderBlock(&sampler, 2 * kBlockSize, {}, 200),
+              0.5f * 16, 1e-2f);
+}
+
 }  // namespace inst
 }  // namespace soir
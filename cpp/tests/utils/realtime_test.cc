@@ -0,0 +1,49 @@
+#include "utils/realtime.hh"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+namespace soir {
+
+TEST(RealtimeTest, DefaultSchedulerIsNoop) {
+  utils::SetRealtimeSettings({});
+
+  std::thread thread([]() { utils::EnterRealtime("test"); });
+  thread.join();
+
+  EXPECT_EQ(utils::RealtimeThreadCount(), 0);
+}
+
+// Whether the priority is granted depends on the privileges of the
+// process, either way the thread keeps running and the count goes
+// back to zero once it exits.
+TEST(RealtimeTest, FallbackWhenUnprivileged) {
+  utils::RealtimeSettings settings;
+  settings.priority_ = 10;
+  utils::SetRealtimeSettings(settings);
+
+  bool ran = false;
+  std::thread thread([&ran]() {
+    utils::EnterRealtime("test");
+    ran = true;
+  });
+  thread.join();
+
+  EXPECT_TRUE(ran);
+  EXPECT_EQ(utils::RealtimeThreadCount(), 0);
+
+  utils::SetRealtimeSettings({});
+}
+
+TEST(RealtimeTest, Prefault) {
+  std::vector<float> samples(1 << 20, 1.0f);
+
+  utils::Prefault(samples.data(), samples.size() * sizeof(float));
+  utils::Prefault(nullptr, 0);
+
+  EXPECT_EQ(samples.back(), 1.0f);
+}
+
+}  // namespace soir
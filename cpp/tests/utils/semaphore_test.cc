@@ -0,0 +1,36 @@
+#include "utils/semaphore.hh"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+namespace soir {
+
+TEST(SemaphoreTest, TimesOutWithoutPost) {
+  utils::Semaphore semaphore;
+  EXPECT_FALSE(semaphore.WaitFor(absl::Milliseconds(1)));
+}
+
+TEST(SemaphoreTest, PostsAreCounted) {
+  utils::Semaphore semaphore;
+  semaphore.Post();
+  semaphore.Post();
+
+  EXPECT_TRUE(semaphore.WaitFor(absl::Milliseconds(1)));
+  EXPECT_TRUE(semaphore.WaitFor(absl::Milliseconds(1)));
+  EXPECT_FALSE(semaphore.WaitFor(absl::Milliseconds(1)));
+}
+
+TEST(SemaphoreTest, WakesUpWaiter) {
+  utils::Semaphore semaphore;
+  std::atomic<bool> woken = false;
+
+  std::thread waiter([&]() { woken = semaphore.WaitFor(absl::Seconds(10)); });
+  semaphore.Post();
+  waiter.join();
+
+  EXPECT_TRUE(woken);
+}
+
+}  // namespace soir
@@ -0,0 +1,57 @@
+#include "utils/mapped_file.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace soir {
+namespace utils {
+
+absl::StatusOr<std::unique_ptr<MappedFile>> MappedFile::Open(
+    const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return absl::NotFoundError("Unable to open " + path + ": " +
+                               std::strerror(errno));
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return absl::InternalError("Unable to stat " + path + ": " +
+                               std::strerror(errno));
+  }
+
+  const size_t size = static_cast<size_t>(st.st_size);
+  if (size == 0) {
+    close(fd);
+    return absl::InvalidArgumentError("Unable to map empty file " + path);
+  }
+
+  void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+  // The mapping stays valid once the descriptor is closed.
+  close(fd);
+
+  if (data == MAP_FAILED) {
+    return absl::InternalError("Unable to map " + path + ": " +
+                               std::strerror(errno));
+  }
+
+  return std::unique_ptr<MappedFile>(
+      new MappedFile(static_cast<const uint8_t*>(data), size));
+}
+
+MappedFile::MappedFile(const uint8_t* data, size_t size)
+    : data_(data), size_(size) {}
+
+MappedFile::~MappedFile() {
+  munmap(const_cast<uint8_t*>(data_), size_);
+}
+
+}  // namespace utils
+}  // namespace soir
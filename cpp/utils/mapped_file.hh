@@ -0,0 +1,37 @@
+#pragma once
+
+#include <absl/status/statusor.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace soir {
+namespace utils {
+
+// Read-only memory mapping of a whole file. Pages are loaded lazily
+// by the kernel and shared with any other process mapping the same
+// file.
+class MappedFile {
+ public:
+  static absl::StatusOr<std::unique_ptr<MappedFile>> Open(
+      const std::string& path);
+
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const uint8_t* Data() const { return data_; }
+  size_t Size() const { return size_; }
+
+ private:
+  MappedFile(const uint8_t* data, size_t size);
+
+  const uint8_t* data_;
+  size_t size_;
+};
+
+}  // namespace utils
+}  // namespace soir
@@ -0,0 +1,166 @@
+#include "utils/realtime.hh"
+
+#include <absl/log/log.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <set>
+
+namespace soir {
+namespace utils {
+
+namespace {
+
+// Enough for the deepest DSP call stacks we have.
+constexpr size_t kPrefaultStackSize = 256 * 1024;
+
+RealtimeSettings settings;
+std::atomic<int> realtime_threads = 0;
+std::atomic<bool> memory_locked = false;
+
+std::mutex warned_mutex;
+std::set<std::string> warned;
+
+size_t PageSize() {
+#ifdef __linux__
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+  return 4096;
+#endif
+}
+
+void PrefaultStack() {
+  volatile char stack[kPrefaultStackSize];
+
+  for (size_t i = 0; i < kPrefaultStackSize; i += PageSize()) {
+    stack[i] = 0;
+  }
+}
+
+// Decrements the number of real-time threads when the thread which
+// entered real-time exits.
+struct RealtimeThread {
+  bool realtime_ = false;
+
+  ~RealtimeThread() {
+    if (realtime_) {
+      realtime_threads.fetch_sub(1, std::memory_order_relaxed);
+    }
+  }
+};
+
+thread_local RealtimeThread current_thread;
+
+}  // namespace
+
+void SetRealtimeSettings(const RealtimeSettings& s) { settings = s; }
+
+const RealtimeSettings& GetRealtimeSettings() { return settings; }
+
+void EnterRealtime(const std::string& name) {
+  if (settings.mlock_) {
+    PrefaultStack();
+  }
+
+  if (settings.priority_ <= 0 || current_thread.realtime_) {
+    return;
+  }
+
+#ifdef __linux__
+  const int min = sched_get_priority_min(SCHED_FIFO);
+  const int max = sched_get_priority_max(SCHED_FIFO);
+
+  sched_param param = {};
+  param.sched_priority = std::clamp(settings.priority_, min, max);
+
+  const int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (rc != 0) {
+    std::scoped_lock<std::mutex> lock(warned_mutex);
+    if (warned.insert(name).second) {
+      LOG(WARNING) << "Unable to run " << name << " with real-time priority "
+                   << param.sched_priority << ", staying on the default "
+                   << "scheduler: " << std::strerror(rc);
+    }
+    return;
+  }
+
+  current_thread.realtime_ = true;
+  realtime_threads.fetch_add(1, std::memory_order_relaxed);
+
+  LOG(INFO) << "Running " << name << " with real-time priority "
+            << param.sched_priority;
+#else
+  std::scoped_lock<std::mutex> lock(warned_mutex);
+  if (warned.insert(name).second) {
+    LOG(INFO) << "Real-time priority is not supported on this platform";
+  }
+#endif
+}
+
+int RealtimeThreadCount() {
+  return realtime_threads.load(std::memory_order_relaxed);
+}
+
+absl::Status PinCurrentThread(int cpu) {
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+
+  int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+  if (rc != 0) {
+    return absl::ErrnoToStatus(rc, "Unable to pin thread to CPU " +
+                                       std::to_string(cpu));
+  }
+
+  return absl::OkStatus();
+#else
+  (void)cpu;
+  return absl::UnimplementedError(
+      "Thread pinning is not supported on this platform");
+#endif
+}
+
+absl::Status LockMemory() {
+#ifdef __linux__
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    return absl::ErrnoToStatus(errno, "Unable to lock memory");
+  }
+
+  memory_locked.store(true, std::memory_order_relaxed);
+
+  return absl::OkStatus();
+#else
+  return absl::UnimplementedError(
+      "Memory locking is not supported on this platform");
+#endif
+}
+
+bool MemoryLocked() { return memory_locked.load(std::memory_order_relaxed); }
+
+void Prefault(const void* data, size_t size) {
+  if (data == nullptr || size == 0) {
+    return;
+  }
+
+  auto bytes = static_cast<const volatile char*>(data);
+  const size_t page = PageSize();
+
+  for (size_t i = 0; i < size; i += page) {
+    (void)bytes[i];
+  }
+  (void)bytes[size - 1];
+}
+
+}  // namespace utils
+}  // namespace soir
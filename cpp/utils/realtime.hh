@@ -0,0 +1,56 @@
+#pragma once
+
+#include <absl/status/status.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace soir {
+namespace utils {
+
+// Scheduling of the threads running DSP code, so that they are not
+// preempted mid-block by the rest of the system (Python GC, other
+// processes, ...).
+struct RealtimeSettings {
+  // SCHED_FIFO priority (1-99) of the DSP threads, 0 keeps them on
+  // the default scheduler.
+  int priority_ = 0;
+
+  // CPUs the DSP workers are pinned to (round-robin), ideally
+  // isolated from the scheduler. Empty uses the default placement.
+  std::vector<int> cpus_;
+
+  // Locks the memory of the process so that the DSP never hits a
+  // page fault, sample memory is prefaulted as it is loaded.
+  bool mlock_ = false;
+};
+
+// Sets the process-wide settings, this must be called before any of
+// the DSP threads is started.
+void SetRealtimeSettings(const RealtimeSettings& settings);
+const RealtimeSettings& GetRealtimeSettings();
+
+// Switches the calling thread to the real-time scheduler at the
+// configured priority and prefaults its stack. If the process isn't
+// allowed to (no CAP_SYS_NICE nor rtprio limit), the thread stays on
+// the default scheduler and a warning is logged once per name.
+void EnterRealtime(const std::string& name);
+
+// Number of threads currently running with the real-time priority.
+int RealtimeThreadCount();
+
+// Pins the calling thread to the given CPU.
+absl::Status PinCurrentThread(int cpu);
+
+// Locks current and future memory of the process, and returns
+// whether it is locked.
+absl::Status LockMemory();
+bool MemoryLocked();
+
+// Touches each page of the given memory so that it is resident
+// before the DSP reads it.
+void Prefault(const void* data, size_t size);
+
+}  // namespace utils
+}  // namespace soir
@@ -0,0 +1,88 @@
+#include "utils/rt_alloc.hh"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace soir {
+namespace utils {
+
+namespace {
+
+// Plain thread-local integer: it must be usable from operator new
+// without any lazy initialization.
+thread_local int rt_depth = 0;
+
+std::atomic<uint64_t> rt_allocs = 0;
+std::atomic<bool> rt_abort = false;
+
+}  // namespace
+
+RtScope::RtScope() { ++rt_depth; }
+
+RtScope::~RtScope() { --rt_depth; }
+
+bool RtAllocCheckEnabled() {
+#ifdef SOIR_RT_ALLOC_CHECK
+  return true;
+#else
+  return false;
+#endif  // SOIR_RT_ALLOC_CHECK
+}
+
+uint64_t RtAllocCount() { return rt_allocs.load(std::memory_order_relaxed); }
+
+void SetRtAllocAbort(bool abort) {
+  rt_abort.store(abort, std::memory_order_relaxed);
+}
+
+namespace internal {
+
+void OnAllocation(std::size_t size) {
+  if (rt_depth == 0) {
+    return;
+  }
+
+  rt_allocs.fetch_add(1, std::memory_order_relaxed);
+
+  if (rt_abort.load(std::memory_order_relaxed)) {
+    // No logging library here, it would allocate and re-enter.
+    std::fprintf(stderr, "Allocation of %zu bytes on the DSP path\n", size);
+    std::abort();
+  }
+}
+
+}  // namespace internal
+
+}  // namespace utils
+}  // namespace soir
+
+#ifdef SOIR_RT_ALLOC_CHECK
+
+// Replacements of the global allocation functions, the nothrow and
+// array versions of the standard library forward to these. Aligned
+// versions are not replaced and are not tracked.
+
+void* operator new(std::size_t size) {
+  soir::utils::internal::OnAllocation(size);
+
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+
+  return p;
+}
+
+void* operator new[](std::size_t size) { return operator new(size); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+
+void operator delete[](void* p) noexcept { std::free(p); }
+
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif  // SOIR_RT_ALLOC_CHECK
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+
+namespace soir {
+namespace utils {
+
+// Marks the current thread as running real-time code (the rendering
+// of a DSP block) for the lifetime of the scope, scopes can be
+// nested. Code within a scope must not allocate.
+//
+// When built with SOIR_RT_ALLOC_CHECK, the global operator new is
+// hooked to count allocations made from within a scope and to
+// optionally abort on the first one. Otherwise this is a no-op and
+// the count always stays at zero.
+class RtScope {
+ public:
+  RtScope();
+  ~RtScope();
+
+  RtScope(const RtScope&) = delete;
+  RtScope& operator=(const RtScope&) = delete;
+};
+
+// Whether the allocation tripwire was built in.
+bool RtAllocCheckEnabled();
+
+// Number of allocations made from within a RtScope, on any thread,
+// since the start of the process.
+uint64_t RtAllocCount();
+
+// Aborts the process on the first allocation made from within a
+// RtScope, this is meant to get a stack trace in a debugger.
+void SetRtAllocAbort(bool abort);
+
+}  // namespace utils
+}  // namespace soir
@@ -0,0 +1,74 @@
+#include "utils/semaphore.hh"
+
+#if defined(_WIN32)
+#include <windows.h>
+
+#include <climits>
+#elif !defined(__APPLE__)
+#include <time.h>
+#endif
+
+#include <cerrno>
+#include <cstdint>
+
+namespace soir {
+namespace utils {
+
+#if defined(__APPLE__)
+
+Semaphore::Semaphore() : semaphore_(dispatch_semaphore_create(0)) {}
+
+Semaphore::~Semaphore() { dispatch_release(semaphore_); }
+
+void Semaphore::Post() { dispatch_semaphore_signal(semaphore_); }
+
+bool Semaphore::WaitFor(absl::Duration timeout) {
+  const dispatch_time_t deadline =
+      dispatch_time(DISPATCH_TIME_NOW, absl::ToInt64Nanoseconds(timeout));
+  return dispatch_semaphore_wait(semaphore_, deadline) == 0;
+}
+
+#elif defined(_WIN32)
+
+Semaphore::Semaphore()
+    : semaphore_(CreateSemaphore(nullptr, 0, LONG_MAX, nullptr)) {}
+
+Semaphore::~Semaphore() { CloseHandle(semaphore_); }
+
+void Semaphore::Post() { ReleaseSemaphore(semaphore_, 1, nullptr); }
+
+bool Semaphore::WaitFor(absl::Duration timeout) {
+  const DWORD ms = static_cast<DWORD>(absl::ToInt64Milliseconds(timeout));
+  return WaitForSingleObject(semaphore_, ms) == WAIT_OBJECT_0;
+}
+
+#else
+
+Semaphore::Semaphore() { sem_init(&semaphore_, 0, 0); }
+
+Semaphore::~Semaphore() { sem_destroy(&semaphore_); }
+
+void Semaphore::Post() { sem_post(&semaphore_); }
+
+bool Semaphore::WaitFor(absl::Duration timeout) {
+  constexpr int64_t kNsPerSecond = 1000000000;
+
+  // POSIX semaphores only take an absolute deadline.
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  const int64_t ns = deadline.tv_nsec + absl::ToInt64Nanoseconds(timeout);
+  deadline.tv_sec += ns / kNsPerSecond;
+  deadline.tv_nsec = ns % kNsPerSecond;
+
+  while (sem_timedwait(&semaphore_, &deadline) != 0) {
+    if (errno != EINTR) {
+      return false;
+    }
+  }
+  return true;
+}
+
+#endif
+
+}  // namespace utils
+}  // namespace soir
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <absl/time/time.h>
+
+#if defined(__APPLE__)
+#include <dispatch/dispatch.h>
+#elif !defined(_WIN32)
+#include <semaphore.h>
+#endif
+
+namespace soir {
+namespace utils {
+
+// Counting semaphore backed by the one of the platform. Posting never
+// blocks nor takes a lock, so it can be signaled from a real-time
+// thread (e.g. the audio device callback) to wake up a waiter.
+class Semaphore {
+ public:
+  Semaphore();
+  ~Semaphore();
+
+  Semaphore(const Semaphore&) = delete;
+  Semaphore& operator=(const Semaphore&) = delete;
+
+  void Post();
+
+  // Waits until the semaphore is posted, returns false if the
+  // timeout expired first.
+  bool WaitFor(absl::Duration timeout);
+
+ private:
+#if defined(__APPLE__)
+  dispatch_semaphore_t semaphore_;
+#elif defined(_WIN32)
+  void* semaphore_;
+#else
+  sem_t semaphore_;
+#endif
+};
+
+}  // namespace utils
+}  // namespace soir
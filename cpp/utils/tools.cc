@@ -4,10 +4,6 @@
 
 namespace soir {
 
-float LeftPan(float pan) { return pan > 0.0f ? (1.0f - pan) : 1.0f; }
-
-float RightPan(float pan) { return pan < 0.0f ? (1.0f + pan) : 1.0f; }
-
 float Bipolar(float unipolar) { return (unipolar - 0.5f) * 2.0f; }
 
 float Unipolar(float bipolar) { return (bipolar + 1.0f) / 2.0f; }
@@ -4,8 +4,15 @@ namespace soir {
 
 static constexpr float kPi = 3.14159265358979323846f;
 
-float LeftPan(const float pan);
-float RightPan(const float pan);
+// Pan laws are inlined as they are evaluated for each sample.
+inline float LeftPan(const float pan) {
+  return pan > 0.0f ? (1.0f - pan) : 1.0f;
+}
+
+inline float RightPan(const float pan) {
+  return pan < 0.0f ? (1.0f + pan) : 1.0f;
+}
+
 float Bipolar(const float value);
 float Unipolar(const float value);
 float Fabs(const float value);
@@ -5,6 +5,7 @@
 #include <libremidi/message.hpp>
 
 #include "core/midi_event.hh"
+#include "core/midi_stack.hh"
 #include "pluginterfaces/gui/iplugview.h"
 #include "pluginterfaces/vst/ivstaudioprocessor.h"
 #include "pluginterfaces/vst/ivstmessage.h"
@@ -303,14 +304,13 @@ absl::Status VstPlugin::Deactivate() {
   return absl::OkStatus();
 }
 
-void VstPlugin::PopulateEventList(SampleTick block_start_tick,
-                                  const std::list<MidiEventAt>& events) {
+void VstPlugin::PopulateEventList(const MidiBlock& events) {
   input_events_.Clear();
   output_events_.Clear();
 
-  for (const auto& midi_event : events) {
-    const auto& msg = midi_event.Msg();
-    if (msg.bytes.empty()) {
+  for (size_t i = 0; i < events.Size(); ++i) {
+    const auto& msg = events.At(i);
+    if (msg.Size() == 0) {
       continue;
     }
 
@@ -318,21 +318,16 @@ void VstPlugin::PopulateEventList(SampleTick block_start_tick,
     vst_event.busIndex = 0;
     vst_event.ppqPosition = 0;
     vst_event.flags = Event::kIsLive;
+    vst_event.sampleOffset = static_cast<int32>(events.Offset(i));
 
-    SampleTick offset = midi_event.Tick() - block_start_tick;
-    if (offset < 0) {
-      offset = 0;
-    }
-    vst_event.sampleOffset = static_cast<int32>(offset);
-
-    auto status = msg.get_message_type();
-    auto channel = static_cast<int16>(msg.get_channel());
+    auto status = msg.Type();
+    auto channel = static_cast<int16>(msg.Channel());
 
     if (status == libremidi::message_type::NOTE_ON) {
       vst_event.type = Event::kNoteOnEvent;
       vst_event.noteOn.channel = channel;
-      vst_event.noteOn.pitch = static_cast<int16>(msg.bytes[1]);
-      vst_event.noteOn.velocity = static_cast<float>(msg.bytes[2]) / 127.0f;
+      vst_event.noteOn.pitch = static_cast<int16>(msg.Bytes()[1]);
+      vst_event.noteOn.velocity = static_cast<float>(msg.Bytes()[2]) / 127.0f;
       vst_event.noteOn.tuning = 0.0f;
       vst_event.noteOn.length = 0;
       vst_event.noteOn.noteId = -1;
@@ -340,17 +335,17 @@ void VstPlugin::PopulateEventList(SampleTick block_start_tick,
     } else if (status == libremidi::message_type::NOTE_OFF) {
       vst_event.type = Event::kNoteOffEvent;
       vst_event.noteOff.channel = channel;
-      vst_event.noteOff.pitch = static_cast<int16>(msg.bytes[1]);
-      vst_event.noteOff.velocity = static_cast<float>(msg.bytes[2]) / 127.0f;
+      vst_event.noteOff.pitch = static_cast<int16>(msg.Bytes()[1]);
+      vst_event.noteOff.velocity = static_cast<float>(msg.Bytes()[2]) / 127.0f;
       vst_event.noteOff.noteId = -1;
       vst_event.noteOff.tuning = 0.0f;
       input_events_.addEvent(vst_event);
     } else if (status == libremidi::message_type::POLY_PRESSURE) {
       vst_event.type = Event::kPolyPressureEvent;
       vst_event.polyPressure.channel = channel;
-      vst_event.polyPressure.pitch = static_cast<int16>(msg.bytes[1]);
+      vst_event.polyPressure.pitch = static_cast<int16>(msg.Bytes()[1]);
       vst_event.polyPressure.pressure =
-          static_cast<float>(msg.bytes[2]) / 127.0f;
+          static_cast<float>(msg.Bytes()[2]) / 127.0f;
       vst_event.polyPressure.noteId = -1;
       input_events_.addEvent(vst_event);
     }
@@ -358,7 +353,7 @@ void VstPlugin::PopulateEventList(SampleTick block_start_tick,
 }
 
 void VstPlugin::Process(SampleTick tick, AudioBuffer& buffer,
-                        const std::list<MidiEventAt>& events) {
+                        const MidiBlock& events) {
   std::lock_guard<std::mutex> lock(mutex_);
 
   if (!activated_ || !processor_) {
@@ -376,7 +371,7 @@ void VstPlugin::Process(SampleTick tick, AudioBuffer& buffer,
     std::copy(right_in, right_in + size, input_right_.begin());
   }
 
-  PopulateEventList(tick, events);
+  PopulateEventList(events);
 
   process_data_.numSamples = size;
   processor_->process(process_data_);
@@ -24,7 +24,7 @@
 
 namespace soir {
 
-class MidiEventAt;  // Forward declaration to avoid heavy libremidi include.
+class MidiBlock;  // Forward declaration to avoid heavy libremidi include.
 
 namespace vst {
 
@@ -72,8 +72,7 @@ class VstPlugin {
   absl::Status Activate(int sample_rate, int block_size);
   absl::Status Deactivate();
 
-  void Process(SampleTick tick, AudioBuffer& buffer,
-               const std::list<MidiEventAt>& events);
+  void Process(SampleTick tick, AudioBuffer& buffer, const MidiBlock& events);
 
   VstPluginType GetType() const { return type_; }
 
@@ -96,8 +95,7 @@ class VstPlugin {
   absl::Status LoadState(const std::vector<uint8_t>& state);
 
  private:
-  void PopulateEventList(SampleTick block_start_tick,
-                         const std::list<MidiEventAt>& events);
+  void PopulateEventList(const MidiBlock& events);
 
   std::mutex mutex_;
   VstPluginType type_ = VstPluginType::kVstFx;
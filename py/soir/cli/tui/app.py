@@ -121,7 +121,22 @@ class SoirTuiApp(App[None]):
     def _start_engine(self) -> None:
         """Worker to start the Soir engine (runs in thread)."""
         try:
-            success, message = self.engine_manager.initialize_session(self.session_path)
+            command_shell = self.query_one(CommandShellWidget)
+            last_step = -1
+
+            def on_sample_progress(loaded: int, total: int) -> None:
+                nonlocal last_step
+                step = loaded * 10 // total
+                if step != last_step:
+                    last_step = step
+                    self.call_from_thread(
+                        command_shell.write_output,
+                        f"Loading samples: {loaded}/{total}",
+                    )
+
+            success, message = self.engine_manager.initialize_session(
+                self.session_path, on_sample_progress
+            )
 
             if success:
                 cfg = self.engine_manager.config
@@ -7,6 +7,7 @@ providing a clean interface for the TUI to interact with the C++ engine.
 import os
 import sys
 import threading
+from collections.abc import Callable
 from pathlib import Path
 from typing import Any
 
@@ -78,7 +79,11 @@ class EngineManager:
         self._saved_stdout_fd: int | None = None
         self._saved_stderr_fd: int | None = None
 
-    def initialize_session(self, session_path: Path) -> tuple[bool, str]:
+    def initialize_session(
+        self,
+        session_path: Path,
+        on_sample_progress: Callable[[int, int], None] | None = None,
+    ) -> tuple[bool, str]:
         """Initialize the engine and watcher from a session directory.
 
         Changes the working directory to session_path and starts the
@@ -87,6 +92,8 @@ class EngineManager:
         Args:
             session_path: Path to the session directory containing
                 etc/config.json and var/log/.
+            on_sample_progress: Called while sample packs are loaded with
+                the number of samples loaded and the total.
 
         Returns:
             Tuple of (success, message) where success is True if
@@ -114,7 +121,7 @@ class EngineManager:
                 self.config = Config.load_from_path(cfg_path)
                 self.soir = bindings.Soir()
 
-                if not self.soir.init(cfg_path):
+                if not self.soir.init(cfg_path, on_sample_progress):
                     error_msg = "Failed to initialize Soir engine"
                     logging.error(error_msg)
                     return False, error_msg
@@ -29,6 +29,8 @@ class InfoPanelWidget(Static):
     level_right = reactive(0.0)
     peak_left = reactive(0.0)
     peak_right = reactive(0.0)
+    dsp_load = reactive(0.0)
+    deadline_misses = reactive(0)
 
     def __init__(self, session_path: Path) -> None:
         """Initialize the info panel widget.
@@ -138,6 +140,9 @@ class InfoPanelWidget(Static):
             f"[{_COLOR_TEXT}]{self.current_bpm:.1f}[/{_COLOR_TEXT}]",
             f"[{_COLOR_TEXT_DIM}]beat[/{_COLOR_TEXT_DIM}]    "
             f"[{_COLOR_TEXT}]{self.current_beat}[/{_COLOR_TEXT}]",
+            f"[{_COLOR_TEXT_DIM}]dsp[/{_COLOR_TEXT_DIM}]     "
+            f"[{_COLOR_TEXT}]{self.dsp_load * 100:.0f}%[/{_COLOR_TEXT}] "
+            f"[{_COLOR_TEXT_DIM}]{self.deadline_misses} late[/{_COLOR_TEXT_DIM}]",
         ]
 
         # Level meters with dB readout
@@ -173,6 +178,11 @@ class InfoPanelWidget(Static):
         self.current_bpm = info.get("bpm", 0.0)
         self.current_beat = int(info.get("beat", 0))
 
+        dsp = info.get("dsp")
+        if dsp:
+            self.dsp_load = dsp["load_avg"]
+            self.deadline_misses = dsp["deadline_misses"]
+
         levels = info.get("master_levels")
         if levels:
             self.level_left = levels["peak_left"]
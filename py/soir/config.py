@@ -105,7 +105,18 @@ class Config(BaseModel):
         block_size: int = Field(default=4096)
         audio_output_device: str = Field(default="")
         sample_directory: str = Field(default="")
+        sample_cache_directory: str = Field(default="")
         sample_packs: list[str] = Field(default_factory=list)
+        sample_loader_threads: int = Field(default=0)
+        sample_memory_mb: int = Field(default=0)
+        sample_format: str = Field(default="float32")
+        workers: int = Field(default=0)
+        pin_workers: bool = Field(default=True)
+        clock: str = Field(default="device")
+        prerender_blocks: int = Field(default=3)
+        realtime_priority: int = Field(default=0)
+        cpu_affinity: list[int] = Field(default_factory=list)
+        mlock: bool = Field(default=False)
 
     class CastConfig(BaseModel):
         """Cast configuration."""
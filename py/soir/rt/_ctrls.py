@@ -1,13 +1,20 @@
+import collections
 import enum
-import json
-import math
+import struct
 from collections.abc import Callable
 
 from soir._bindings.rt import (
     controls_get_frequency_update_,
+    controls_get_max_,
+    controls_get_max_update_pairs_,
     get_bpm_,
+    get_control_value_,
+    midi_sysex_control_modulator_,
     midi_sysex_update_controls_,
+    register_control_,
+    release_control_,
     schedule_,
+    set_control_smoothing_,
 )
 from soir.rt import _internals, errors
 
@@ -22,14 +29,40 @@ eval_id_ = 0
 in_update_loop_ = False
 controls_registry_: dict[str, Control_] = {}
 
+# IDs of the controls in the DSP controls table. Fresh IDs are used
+# until the table is full, then released IDs are reused oldest first,
+# so that the slot of a deleted control stays untouched for as long as
+# possible.
+max_controls_ = controls_get_max_()
+next_id_ = 0
+free_ids_: collections.deque[int] = collections.deque()
+
 
 def _reset() -> None:
     """Helper to reset controls state for unit tests mostly."""
-    global eval_id_, in_update_loop_
+    global eval_id_, in_update_loop_, next_id_
+
+    for ctrl in controls_registry_.values():
+        release_control_(ctrl.id_)
 
     eval_id_ = 0
     in_update_loop_ = False
     controls_registry_.clear()
+    next_id_ = 0
+    free_ids_.clear()
+
+
+def allocate_id_(name: str) -> int:
+    """Allocate the ID of a new control."""
+    global next_id_
+
+    if next_id_ < max_controls_:
+        next_id_ += 1
+        return next_id_ - 1
+    if free_ids_:
+        return free_ids_.popleft()
+
+    raise errors.TooManyControlsException(name)
 
 
 # This may need to be adjusted to prevent overloading the RT engine,
@@ -38,6 +71,36 @@ def _reset() -> None:
 frequency_ = controls_get_frequency_update_()
 tick_sec_ = 1 / frequency_
 
+# Binary layout of the controls update payload, see
+# cpp/core/midi_sysex.hh: a count followed by (control ID, generation,
+# value) pairs, little-endian.
+UPDATE_HEADER_ = struct.Struct("<I")
+UPDATE_PAIR_ = "iIf"
+
+# Updates are split in chunks that fit in a single MIDI event.
+max_update_pairs_ = controls_get_max_update_pairs_()
+
+# Binary layout of the control modulator payload, see
+# ControlModulatorPayload in cpp/core/midi_sysex.hh.
+MODULATOR_ = struct.Struct("<iIiiii12f")
+
+
+class Modulator_(enum.IntEnum):
+    """Native modulators, see ModulatorType in cpp/core/modulator.hh."""
+
+    NONE = 0
+    LFO = 1
+    RAMP = 2
+    ENVELOPE = 3
+    SAMPLE_HOLD = 4
+
+
+# Shapes of LFOs, see dsp::LFO::Type.
+SHAPES_ = {"saw": 0, "tri": 1, "sine": 2}
+
+# How the DSP side ramps between two values of a control.
+SMOOTHINGS_ = ("linear", "one_pole", "cubic")
+
 
 def assert_in_update_loop() -> None:
     """Assert that we are in the update loop."""
@@ -49,8 +112,13 @@ class Control_:
     """Base class for a control.
 
     Publicly documented in ctrls.Control.
+
+    Native controls are evaluated by a modulator on the DSP side, they
+    aren't part of the update loop.
     """
 
+    native_: bool = False
+
     class Scope(enum.Enum):
         """Scope of the control."""
 
@@ -58,7 +126,10 @@ class Control_:
         LIVE = 1
         LOOP = 2
 
-    def __init__(self, name: str) -> None:
+    def __init__(self, name: str, smoothing: str = "linear") -> None:
+        if smoothing not in SMOOTHINGS_:
+            raise ValueError("smoothing must be one of 'linear', 'one_pole' or 'cubic'")
+
         self.name_ = name
         self.tick_: float = 0
         self.value_: float = 0
@@ -68,9 +139,25 @@ class Control_:
         # updating it performs a smooth-transition, or a no-op if
         # parameters are the same. This is a two-line to handle all
         # kinds of updates without having to do complex state updates.
-        if name in controls_registry_:
-            self.tick_ = controls_registry_[name].tick_
-            self.value_ = controls_registry_[name].value_
+        previous = controls_registry_.get(name)
+        if previous:
+            self.id_: int = previous.id_
+            self.gen_: int = previous.gen_
+            self.tick_ = previous.tick_
+            self.value_ = previous.value_
+        else:
+            # Stable ID of the control in the DSP controls table, used
+            # to refer to it in binary messages.
+            self.id_ = allocate_id_(name)
+            self.gen_ = register_control_(self.id_, name)
+
+        # Native controls of the same kind carry on from where the
+        # previous one was, others restart.
+        self.retrigger_ = type(previous) is not type(self)
+
+        set_control_smoothing_(self.id_, smoothing)
+        if not self.native_:
+            self.modulate_(Modulator_.NONE)
 
         # We need to keep the func scope here so that we know how to
         # clean up the resource when it's not around anymore.
@@ -94,6 +181,30 @@ class Control_:
     def __repr__(self) -> str:
         return f"[{self.name_}={self.get()}]"
 
+    def modulate_(self, modulator: Modulator_, **fields: float) -> None:
+        """Set the modulator of the control on the DSP side."""
+        payload = MODULATOR_.pack(
+            self.id_,
+            self.gen_,
+            modulator,
+            int(fields.get("shape", 0)),
+            int(fields.get("sync", False)),
+            int(self.retrigger_),
+            fields.get("rate", 0.0),
+            fields.get("phase", 0.0),
+            fields.get("low", 0.0),
+            fields.get("high", 1.0),
+            fields.get("start", 0.0),
+            fields.get("end", 0.0),
+            fields.get("duration", 0.0),
+            fields.get("attack", 0.0),
+            fields.get("decay", 0.0),
+            fields.get("sustain", 1.0),
+            fields.get("release", 0.0),
+            fields.get("gate", 0.0),
+        )
+        midi_sysex_control_modulator_(payload)
+
     def get(self) -> float:
         return self.value_
 
@@ -110,55 +221,143 @@ class Control_:
 
 
 class LFO_(Control_):
-    """A simple LFO parameter."""
+    """A LFO parameter, evaluated on the DSP side."""
+
+    native_ = True
 
     def __init__(
-        self, name: str, rate: float, intensity: float, low: float, high: float
+        self,
+        name: str,
+        rate: float,
+        intensity: float,
+        low: float,
+        high: float,
+        shape: str = "sine",
+        phase: float = 0.0,
+        sync: bool = False,
+        smoothing: str = "linear",
     ):
-        super().__init__(name)
+        super().__init__(name, smoothing)
+
+        # The intensity narrows the range around its center.
+        center = (low + high) / 2
+        half = (high - low) / 2 * intensity
+
+        self.modulate_(
+            Modulator_.LFO,
+            shape=SHAPES_[shape],
+            sync=sync,
+            rate=rate,
+            phase=phase,
+            low=center - half,
+            high=center + half,
+        )
 
-        self.rate_ = rate
-        self.intensity_ = intensity
-        self.low_ = low
-        self.high_ = high
+    def get(self) -> float:
+        return get_control_value_(self.id_)
 
     def fwd(self) -> None:
-        assert_in_update_loop()
+        pass
 
-        v = (
-            math.sin(self.tick_ * 2 * math.pi * self.rate_) * self.intensity_ + 1.0
-        ) / 2.0
 
-        self.value_ = self.low_ + (self.high_ - self.low_) * v
-        self.tick_ += tick_sec_
+class Linear_(Control_):
+    """A linear parameter, evaluated on the DSP side."""
 
+    native_ = True
 
-class Linear_(Control_):
-    """A linear parameter."""
+    def __init__(
+        self,
+        name: str,
+        start: float,
+        end: float,
+        duration: float,
+        sync: bool = False,
+        smoothing: str = "linear",
+    ):
+        super().__init__(name, smoothing)
 
-    def __init__(self, name: str, start: float, end: float, duration: float):
-        super().__init__(name)
+        self.modulate_(
+            Modulator_.RAMP, sync=sync, start=start, end=end, duration=duration
+        )
+
+    def get(self) -> float:
+        return get_control_value_(self.id_)
+
+    def fwd(self) -> None:
+        pass
+
+
+class Env_(Control_):
+    """An ADSR envelope parameter, evaluated on the DSP side."""
 
-        self.start_ = start
-        self.end_ = end
-        self.duration_ = duration
+    native_ = True
 
-        self.value_ = start
+    def __init__(
+        self,
+        name: str,
+        attack: float,
+        decay: float,
+        sustain: float,
+        release: float,
+        gate: float,
+        low: float,
+        high: float,
+        sync: bool = False,
+        smoothing: str = "linear",
+    ):
+        super().__init__(name, smoothing)
+
+        self.modulate_(
+            Modulator_.ENVELOPE,
+            sync=sync,
+            attack=attack,
+            decay=decay,
+            sustain=sustain,
+            release=release,
+            gate=gate,
+            low=low,
+            high=high,
+        )
+
+    def get(self) -> float:
+        return get_control_value_(self.id_)
 
     def fwd(self) -> None:
-        assert_in_update_loop()
+        pass
+
 
-        self.value_ = self.start_ + (self.end_ - self.start_) * (
-            self.tick_ / self.duration_
+class SampleHold_(Control_):
+    """A sample and hold parameter, evaluated on the DSP side."""
+
+    native_ = True
+
+    def __init__(
+        self,
+        name: str,
+        rate: float,
+        low: float,
+        high: float,
+        sync: bool = False,
+        smoothing: str = "linear",
+    ):
+        super().__init__(name, smoothing)
+
+        self.modulate_(
+            Modulator_.SAMPLE_HOLD, sync=sync, rate=rate, low=low, high=high
         )
-        self.tick_ += tick_sec_
+
+    def get(self) -> float:
+        return get_control_value_(self.id_)
+
+    def fwd(self) -> None:
+        pass
 
 
 class Val_(Control_):
     """A value parameter."""
 
-    def __init__(self, name: str, value: float):
-        super().__init__(name)
+    def __init__(self, name: str, value: float, smoothing: str = "linear"):
+        super().__init__(name, smoothing)
 
         self.value_ = value
 
@@ -172,8 +371,10 @@ class Val_(Control_):
 class Func_(Control_):
     """A function parameter."""
 
-    def __init__(self, name: str, func: Callable[[], float]):
-        super().__init__(name)
+    def __init__(
+        self, name: str, func: Callable[[], float], smoothing: str = "linear"
+    ):
+        super().__init__(name, smoothing)
 
         self.callable_ = func
         self.value_ = self.callable_()
@@ -195,15 +396,24 @@ def update_loop_() -> None:
     global in_update_loop_
     in_update_loop_ = True
 
-    payload: dict[str, dict[str, float]] = {"knobs": {}}
+    values: list[float] = []
 
     # We sort by alphabetical order to ensure that dependencies are
     # correctly resolved.
-    for name, ctrl in dict(sorted(controls_registry_.items())).items():
+    for _, ctrl in sorted(controls_registry_.items()):
+        if ctrl.native_:
+            continue
         ctrl.fwd()
-        payload["knobs"][name] = ctrl.get()
-
-    midi_sysex_update_controls_(json.dumps(payload))
+        values.extend((ctrl.id_, ctrl.gen_, ctrl.get()))
+
+    chunk = 3 * max_update_pairs_
+    for i in range(0, len(values), chunk):
+        pairs = values[i : i + chunk]
+        count = len(pairs) // 3
+        payload = UPDATE_HEADER_.pack(count) + struct.pack(
+            f"<{UPDATE_PAIR_ * count}", *pairs
+        )
+        midi_sysex_update_controls_(payload)
 
     next_at = (1 / frequency_) * get_bpm_() / 60
     schedule_(next_at, update_loop_)
@@ -259,7 +469,11 @@ def post_eval_() -> None:
                 delete.append(name)
                 continue
 
+    # The DSP side stops updating released controls, parameters still
+    # referring to them hold their last value until their ID is reused.
     for d in delete:
+        release_control_(controls_registry_[d].id_)
+        free_ids_.append(controls_registry_[d].id_)
         del controls_registry_[d]
 
     eval_id_ += 1
@@ -1,9 +1,17 @@
 import json
+import struct
+from typing import Any
 
 from soir.rt._ctrls import (
     Control_,
 )
 
+# Binary layouts of the sysex payloads decoded by the DSP engine, they
+# must be kept in sync with cpp/core/midi_sysex.hh (all little-endian,
+# parameters are a control ID followed by a constant value).
+SAMPLER_PLAY_ = struct.Struct("<i7fifif2i")
+SAMPLER_STOP_ = struct.Struct("<i")
+
 
 class ControlEncoder(json.JSONEncoder):
     """Custom JSON encoder that serializes Control objects to their names.
@@ -29,3 +37,43 @@ def serialize_parameters(params: dict[str, object] | None) -> str:
     if params is None:
         return "{}"
     return json.dumps(params, cls=ControlEncoder)
+
+
+def serialize_parameter(value: float | Control_) -> tuple[int, float]:
+    """Helper to serialize a parameter as a control ID or a constant."""
+    if isinstance(value, Control_):
+        return value.id_, 0.0
+    return -1, float(value)
+
+
+def serialize_sample_play(params: dict[str, Any]) -> bytes:
+    """Helper to serialize the parameters of a sample to play.
+
+    This is the binary counterpart of serialize_parameters for the DSP
+    hot path: the payload is decoded in place on the DSP side, without
+    parsing nor allocating.
+    """
+    pan_control, pan_value = serialize_parameter(params["pan"])
+    amp_control, amp_value = serialize_parameter(params["amp"])
+
+    return SAMPLER_PLAY_.pack(
+        params["sample"],
+        params["start"],
+        params["end"],
+        params["rate"],
+        params["attack"],
+        params["decay"],
+        params["level"],
+        params["release"],
+        pan_control,
+        pan_value,
+        amp_control,
+        amp_value,
+        params["voices"],
+        params["choke"],
+    )
+
+
+def serialize_sample_stop(params: dict[str, Any]) -> bytes:
+    """Helper to serialize the parameters of a sample to stop."""
+    return SAMPLER_STOP_.pack(params["sample"])
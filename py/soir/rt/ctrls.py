@@ -15,7 +15,7 @@ class Control(_ctrls.Control_):
     A control computes a value to the Soir engine about 100 times per
     second via the `Control.fwd()` call, this value is then
     interpolated by the C++ engine to provide a smooth transition
-    between values.
+    between values, see the smoothing argument of the helpers.
 
     The Control class is not meant to be created directly unless you
     want to implement your own control, helpers are available to
@@ -74,37 +74,150 @@ class Control(_ctrls.Control_):
 
 
 def mk_lfo(
-    name: str, rate: float, intensity: float = 1.0, low: float = -1.0, high: float = 1.0
+    name: str,
+    rate: float,
+    intensity: float = 1.0,
+    low: float = -1.0,
+    high: float = 1.0,
+    shape: str = "sine",
+    phase: float = 0.0,
+    sync: bool = False,
+    smoothing: str = "linear",
 ) -> None:
     """Create a new LFO parameter.
 
+    The LFO is evaluated by the engine, it starts from the middle of
+    its range, rising.
+
     @public
 
     Args:
         name: The name of the parameter.
-        rate: The rate of the LFO in seconds.
+        rate: The rate of the LFO in Hz, or in cycles per beat if synced.
         intensity: The intensity of the LFO.
         low: The minimum value of the LFO (defaults to -1.0).
         high: The maximum value of the LFO (defaults to 1.0).
+        shape: The shape of the LFO, 'sine' (default), 'tri' or 'saw'.
+        phase: Offset of the LFO in cycles (defaults to 0.0).
+        sync: Whether the rate follows the tempo (defaults to False).
+        smoothing: How the engine ramps between two values of the
+            control: 'linear' (default), 'one_pole' (exponential, no
+            corners but lags) or 'cubic' (follows the slope of the
+            previous ramp, without overshooting).
     """
-    _ctrls.LFO_(name, rate, intensity, low, high)
+    if shape not in _ctrls.SHAPES_:
+        raise ValueError("shape must be one of 'sine', 'tri' or 'saw'")
+
+    _ctrls.LFO_(name, rate, intensity, low, high, shape, phase, sync, smoothing)
 
 
-def mk_linear(name: str, start: float, end: float, duration: float) -> None:
+def mk_linear(
+    name: str,
+    start: float,
+    end: float,
+    duration: float,
+    sync: bool = False,
+    smoothing: str = "linear",
+) -> None:
     """Create a new linear parameter.
 
+    The transition is evaluated by the engine, the parameter holds its
+    end value once done.
+
     @public
 
     Args:
         name: The name of the parameter.
         start: The start value.
         end: The end value.
-        duration: The duration of the transition in seconds.
+        duration: The duration of the transition in seconds, or in
+            beats if synced.
+        sync: Whether the duration follows the tempo (defaults to False).
+        smoothing: How the engine ramps between two values of the
+            control: 'linear' (default), 'one_pole' (exponential, no
+            corners but lags) or 'cubic' (follows the slope of the
+            previous ramp, without overshooting).
+    """
+    _ctrls.Linear_(name, start, end, duration, sync, smoothing)
+
+
+def mk_env(
+    name: str,
+    attack: float,
+    decay: float,
+    sustain: float,
+    release: float,
+    gate: float,
+    low: float = 0.0,
+    high: float = 1.0,
+    sync: bool = False,
+    smoothing: str = "linear",
+) -> None:
+    """Create a new ADSR envelope parameter.
+
+    The envelope is evaluated by the engine, it goes from low to high
+    then to its sustain level, and is released after the gate.
+
+    @public
+
+    Args:
+        name: The name of the parameter.
+        attack: The attack time in seconds, or in beats if synced.
+        decay: The decay time in seconds, or in beats if synced.
+        sustain: The sustain level, between 0.0 and 1.0.
+        release: The release time in seconds, or in beats if synced.
+        gate: The time before release in seconds, or in beats if synced.
+        low: The minimum value of the envelope (defaults to 0.0).
+        high: The maximum value of the envelope (defaults to 1.0).
+        sync: Whether times follow the tempo (defaults to False).
+        smoothing: How the engine ramps between two values of the
+            control: 'linear' (default), 'one_pole' (exponential, no
+            corners but lags) or 'cubic' (follows the slope of the
+            previous ramp, without overshooting).
     """
-    _ctrls.Linear_(name, start, end, duration)
+    if min(attack, decay, release, gate) < 0:
+        raise ValueError("attack, decay, release and gate must not be negative")
+    if not 0.0 <= sustain <= 1.0:
+        raise ValueError("sustain must be between 0.0 and 1.0")
+
+    _ctrls.Env_(
+        name, attack, decay, sustain, release, gate, low, high, sync, smoothing
+    )
+
+
+def mk_sample_hold(
+    name: str,
+    rate: float,
+    low: float = -1.0,
+    high: float = 1.0,
+    sync: bool = False,
+    smoothing: str = "linear",
+) -> None:
+    """Create a new sample and hold parameter.
+
+    The parameter takes random values evaluated by the engine, each
+    held for a period of the rate.
 
+    @public
 
-def mk_val(name: str, value: float) -> None:
+    Args:
+        name: The name of the parameter.
+        rate: The rate of new values in Hz, or per beat if synced.
+        low: The minimum value of the parameter (defaults to -1.0).
+        high: The maximum value of the parameter (defaults to 1.0).
+        sync: Whether the rate follows the tempo (defaults to False).
+        smoothing: How the engine ramps between two values of the
+            control: 'linear' (default), 'one_pole' (exponential, no
+            corners but lags) or 'cubic' (follows the slope of the
+            previous ramp, without overshooting).
+    """
+    if rate <= 0:
+        raise ValueError("rate must be positive")
+
+    _ctrls.SampleHold_(name, rate, low, high, sync, smoothing)
+
+
+def mk_val(name: str, value: float, smoothing: str = "linear") -> None:
     """Create a new value parameter.
 
     @public
@@ -112,11 +225,17 @@ def mk_val(name: str, value: float) -> None:
     Args:
         name: The name of the parameter.
         value: The value.
+        smoothing: How the engine ramps between two values of the
+            control: 'linear' (default), 'one_pole' (exponential, no
+            corners but lags) or 'cubic' (follows the slope of the
+            previous ramp, without overshooting).
     """
-    _ctrls.Val_(name, value)
+    _ctrls.Val_(name, value, smoothing)
 
 
-def mk_func(name: str, func: Callable[[], float]) -> None:
+def mk_func(
+    name: str, func: Callable[[], float], smoothing: str = "linear"
+) -> None:
     """Create a new function parameter.
 
     @public
@@ -124,8 +243,12 @@ def mk_func(name: str, func: Callable[[], float]) -> None:
     Args:
         name: The name of the parameter.
         func: The function to compute the value.
+        smoothing: How the engine ramps between two values of the
+            control: 'linear' (default), 'one_pole' (exponential, no
+            corners but lags) or 'cubic' (follows the slope of the
+            previous ramp, without overshooting).
     """
-    _ctrls.Func_(name, func)
+    _ctrls.Func_(name, func, smoothing)
 
 
 def layout() -> list[Control]:
@@ -66,6 +66,17 @@ class ControlNotFoundException(SoirException):
     """
 
 
+class TooManyControlsException(SoirException):
+    """Raised when creating more controls than the engine supports.
+
+    @public
+
+    Controls are stored in a fixed size table on the engine side, this
+    exception is raised when all of its slots are used. Controls which
+    aren't defined anymore free their slot at the next evaluation.
+    """
+
+
 class ConfigurationError(SoirException):
     """Raised when there is a configuration error.
 
@@ -20,20 +20,21 @@ def kick(beats=4):
 
 """
 
-import json
 from collections.abc import Callable
 from dataclasses import dataclass
 from typing import Any
 
 from soir._bindings.rt import (
     get_packs_,
+    get_sample_handle_,
     get_samples_,
     midi_sysex_sample_play_,
     midi_sysex_sample_stop_,
     schedule_,
 )
 from soir.rt._helpers import (
-    serialize_parameters,
+    serialize_sample_play,
+    serialize_sample_stop,
 )
 from soir.rt._internals import (
     assert_in_loop,
@@ -78,6 +79,23 @@ class Sampler:
             pack_name: The name of the sample pack to use.
         """
         self.pack_name_ = pack_name
+        self.handles_: dict[str, int] = {}
+
+    def _handle(self, name: str) -> int:
+        """Resolves a sample name into the handle used to play it, this
+        is only done once per name and lets the engine skip any name
+        lookup when playing the sample.
+
+        Returns:
+            The handle of the sample, or -1 if there is no such sample.
+        """
+        handle = self.handles_.get(name)
+        if handle is None:
+            handle = get_sample_handle_(self.pack_name_, name)
+            if handle < 0:
+                return -1
+            self.handles_[name] = handle
+        return handle  # type: ignore[no-any-return]
 
     def play(
         self,
@@ -92,6 +110,8 @@ class Sampler:
         release: float = 0.0,
         rate: float = 1.0,
         amp: float = 1.0,
+        voices: int = 0,
+        choke: int = 0,
     ) -> None:
         """Plays a sample by its given name. If there is no exact
         match, attempts to find one that contains the name (for
@@ -113,12 +133,21 @@ class Sampler:
             level: The sustain level in the [0.0, 1.0] range.
             rate: The playback rate of the sample.
             amp: The amplitude of the sample.
+            voices: The maximum number of voices of this sample playing at
+                once, older ones are stolen past it. 0 for no limit other
+                than the one of the track.
+            choke: The choke group of the sample, playing it fades out the
+                other samples of the same group (e.g. a closed hi-hat
+                cutting an open one). 0 for none.
         """
         loop = assert_in_loop()
 
+        handle = self._handle(name)
+        if handle < 0:
+            return
+
         params = {
-            "pack": self.pack_name_,
-            "name": name,
+            "sample": handle,
             "start": start,
             "end": end,
             "pan": pan,
@@ -128,13 +157,15 @@ class Sampler:
             "release": release,
             "rate": rate,
             "amp": amp,
+            "voices": voices,
+            "choke": choke,
         }
 
         track = loop.track
 
         schedule_(
             loop.current_offset,
-            lambda: midi_sysex_sample_play_(track, serialize_parameters(params)),
+            lambda: midi_sysex_sample_play_(track, serialize_sample_play(params)),
         )
 
     def stop(self, name: str) -> None:
@@ -151,16 +182,19 @@ class Sampler:
         """
         loop = assert_in_loop()
 
+        handle = self._handle(name)
+        if handle < 0:
+            return
+
         params = {
-            "pack": self.pack_name_,
-            "name": name,
+            "sample": handle,
         }
 
         track = loop.track
 
         schedule_(
             loop.current_offset,
-            lambda: midi_sysex_sample_stop_(track, json.dumps(params)),
+            lambda: midi_sysex_sample_stop_(track, serialize_sample_stop(params)),
         )
 
 
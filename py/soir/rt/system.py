@@ -8,6 +8,7 @@ from dataclasses import dataclass
 from soir._bindings.rt import (
     get_audio_in_devices_,
     get_audio_out_devices_,
+    get_dsp_stats_,
     get_midi_out_devices_,
     set_force_kill_at_shutdown_,
 )
@@ -39,6 +40,86 @@ class AudioDeviceInfo:
     channels: int
 
 
+@dataclass
+class DurationStats:
+    """Statistics of rendering durations, in microseconds.
+
+    @public
+
+    Percentiles are approximated from a histogram and are within
+    about 20% of the actual value.
+
+    Attributes:
+        count: Number of recorded renderings.
+        last_us: Duration of the last rendering.
+        mean_us: Mean duration.
+        p50_us: Median duration.
+        p99_us: 99th percentile of durations.
+        max_us: Maximum duration.
+    """
+
+    count: int
+    last_us: float
+    mean_us: float
+    p50_us: float
+    p99_us: float
+    max_us: float
+
+
+@dataclass
+class TrackDspStats:
+    """Rendering statistics of a track.
+
+    @public
+
+    Attributes:
+        render: Durations of the track rendering (instrument and effects).
+        fxs: Durations of each effect of the track, by name.
+    """
+
+    render: DurationStats
+    fxs: dict[str, DurationStats]
+
+
+@dataclass
+class DspStats:
+    """Rendering statistics of the DSP engine.
+
+    @public
+
+    A block of audio has to be rendered in less than its duration to
+    keep up with real-time: a load above 1.0 means the engine is late
+    and the audio device is likely to glitch.
+
+    Attributes:
+        block_us: Duration of a block of audio.
+        render: Durations of the rendering of blocks.
+        load: Last render duration over the block duration.
+        load_avg: Load averaged over about a second.
+        deadline_misses: Number of blocks rendered later than their duration.
+        underruns: Number of times the audio device ran out of samples.
+        overruns: Number of rendered blocks dropped by the audio device.
+        realtime_priority: Configured real-time priority of DSP threads.
+        realtime_threads: Number of DSP threads running with it.
+        cpu_affinity: CPUs the DSP workers are pinned to.
+        memory_locked: Whether the memory of the process is locked.
+        tracks: Rendering statistics of each track, by name.
+    """
+
+    block_us: float
+    render: DurationStats
+    load: float
+    load_avg: float
+    deadline_misses: int
+    underruns: int
+    overruns: int
+    realtime_priority: int
+    realtime_threads: int
+    cpu_affinity: list[int]
+    memory_locked: bool
+    tracks: dict[str, TrackDspStats]
+
+
 def record(file_path: str) -> bool:
     """Record audio to a WAV file.
 
@@ -101,6 +182,39 @@ def get_midi_out_devices() -> list[tuple[int, str]]:
     return result
 
 
+def get_dsp_stats() -> DspStats:
+    """Get the rendering statistics of the DSP engine.
+
+    @public
+
+    Returns:
+        The load of the engine, its missed deadlines and the render
+        durations of blocks, tracks and effects.
+    """
+    raw = get_dsp_stats_()
+    tracks = {
+        name: TrackDspStats(
+            render=DurationStats(**t["render"]),
+            fxs={fx: DurationStats(**d) for fx, d in t["fxs"].items()},
+        )
+        for name, t in raw["tracks"].items()
+    }
+    return DspStats(
+        block_us=raw["block_us"],
+        render=DurationStats(**raw["render"]),
+        load=raw["load"],
+        load_avg=raw["load_avg"],
+        deadline_misses=raw["deadline_misses"],
+        underruns=raw["underruns"],
+        overruns=raw["overruns"],
+        realtime_priority=raw["realtime_priority"],
+        realtime_threads=raw["realtime_threads"],
+        cpu_affinity=raw["cpu_affinity"],
+        memory_locked=raw["memory_locked"],
+        tracks=tracks,
+    )
+
+
 def set_force_kill_at_shutdown(flag: bool) -> None:
     """Sends a kill signal to the Python thread at exit.
 
@@ -175,6 +175,9 @@ def mk_sampler(
     volume: float | Control = 1.0,
     pan: float | Control = 0.0,
     fxs: dict[str, Fx] | None = None,
+    max_voices: int = 64,
+    steal: str = "oldest",
+    interpolation: str = "linear",
 ) -> Track:
     """Creates a new sampler track.
 
@@ -185,8 +188,27 @@ def mk_sampler(
         volume (float | Control): The volume in the [0.0, 1.0] range. Defaults to 1.0.
         pan (float | Control): The pan in the [-1.0, 1.0] range. Defaults to 0.0.
         fxs: The effects to apply to the track, as an ordered dict.
+        max_voices: The maximum number of voices playing at once in [1, 256].
+        steal: How a voice is stolen past max_voices: 'oldest', 'quietest'
+            or 'retrigger' (a sample replaces its own voices). Stolen voices
+            quickly fade out.
+        interpolation: How samples are read when pitched: 'linear' (cheapest),
+            'hermite' or 'sinc' (least aliasing, most CPU).
     """
-    return mk("sampler", muted, volume, pan, fxs, extra={})
+    if max_voices < 1 or max_voices > 256:
+        raise ValueError("max_voices must be in [1, 256]")
+    if steal not in ["oldest", "quietest", "retrigger"]:
+        raise ValueError("steal must be one of 'oldest', 'quietest' or 'retrigger'")
+    if interpolation not in ["linear", "hermite", "sinc"]:
+        raise ValueError("interpolation must be one of 'linear', 'hermite' or 'sinc'")
+
+    extra: dict[str, Any] = {
+        "max_voices": max_voices,
+        "steal": steal,
+        "interpolation": interpolation,
+    }
+
+    return mk("sampler", muted, volume, pan, fxs, extra=extra)
 
 
 def mk_external(
@@ -21,12 +21,27 @@ def controls():
     ctrls.mk_linear("c2", 0.5, 2.0, 8.0)
 
 
-log(str(ctrls.layout()))
+log(str([c.name() for c in ctrls.layout()]))
 """
         )
 
         time.sleep(1)
-        self.assertTrue(self.engine.wait_for_notification("[[c1=0], [c2=0.5]]"))
+        self.assertTrue(self.engine.wait_for_notification("['c1', 'c2']"))
+
+    def test_controls_native_value(self) -> None:
+        """Test that native controls read the value of the engine."""
+        self.engine.push_code(
+            """
+ctrls.mk_linear("c1", 0.25, 0.25, 1.0)
+ctrls.mk_env("c2", 0.0, 0.0, 0.5, 0.0, 100.0, high=2.0)
+
+@loop(beats=1)
+def helloop():
+    log(f"values:{ctrl('c1').get():.2f},{ctrl('c2').get():.2f}")
+"""
+        )
+
+        self.assertTrue(self.engine.wait_for_notification("values:0.25,1.00"))
 
     def test_controls_global(self) -> None:
         """Test creating controls at global scope."""
@@ -37,7 +52,7 @@ log(str(ctrls.layout()))
 """
         )
 
-        self.assertTrue(self.engine.wait_for_notification("[[c1=0]]"))
+        self.assertTrue(self.engine.wait_for_notification("[[c1="))
 
     def test_controls_global_deletion(self) -> None:
         """Test that global controls are deleted when not recreated."""
@@ -48,7 +63,7 @@ log(str(ctrls.layout()))
 """
         )
 
-        self.assertTrue(self.engine.wait_for_notification("[[c1=0]]"))
+        self.assertTrue(self.engine.wait_for_notification("[[c1="))
 
         self.engine.push_code("log('empty-eval')")
         self.assertTrue(self.engine.wait_for_notification("empty-eval"))
@@ -74,7 +89,7 @@ def setup():
 """
         )
 
-        self.assertTrue(self.engine.wait_for_notification("[[c1=0]]"))
+        self.assertTrue(self.engine.wait_for_notification("[[c1="))
 
         self.engine.push_code(
             """
@@ -109,7 +124,7 @@ def setup():
 """
         )
 
-        self.assertTrue(self.engine.wait_for_notification("[[c1=0]]"))
+        self.assertTrue(self.engine.wait_for_notification("[[c1="))
 
         self.engine.push_code(
             """
@@ -140,7 +155,7 @@ def helloop():
 """
         )
 
-        self.assertTrue(self.engine.wait_for_notification("[[c1=0]]"))
+        self.assertTrue(self.engine.wait_for_notification("[[c1="))
 
         self.engine.push_code(
             """
@@ -177,7 +192,7 @@ def helloop():
 """
         )
 
-        self.assertTrue(self.engine.wait_for_notification("[[c1=0]]"))
+        self.assertTrue(self.engine.wait_for_notification("[[c1="))
 
         self.engine.push_code(
             """
@@ -227,3 +242,75 @@ def helloop():
 
         self.assertTrue(self.engine.wait_for_notification("[[c1=0.5]]"))
         self.assertTrue(self.engine.wait_for_notification("[[c1=0.8]]"))
+
+    def test_controls_fresh_ids_first(self) -> None:
+        """Test that IDs of deleted controls aren't reused right away."""
+        self.engine.push_code(
+            """
+from soir.rt import _ctrls
+
+ctrls.mk_val("c1", 0.5)
+log(f"c1:{_ctrls.controls_registry_['c1'].id_}")
+"""
+        )
+
+        self.assertTrue(self.engine.wait_for_notification("c1:0"))
+
+        self.engine.push_code("log('empty-eval')")
+        self.assertTrue(self.engine.wait_for_notification("empty-eval"))
+
+        self.engine.push_code(
+            """
+from soir.rt import _ctrls
+
+ctrls.mk_val("c2", 0.5)
+log(f"c2:{_ctrls.controls_registry_['c2'].id_}")
+"""
+        )
+
+        self.assertTrue(self.engine.wait_for_notification("c2:1"))
+
+    def test_controls_too_many(self) -> None:
+        """Test that IDs are reused once the controls table is full."""
+        self.engine.push_code(
+            """
+from soir.rt import _ctrls
+
+_ctrls.max_controls_ = 2
+
+ctrls.mk_val("c1", 0.1)
+ctrls.mk_val("c2", 0.2)
+try:
+    ctrls.mk_val("c3", 0.3)
+    log("c3:created")
+except errors.TooManyControlsException:
+    log("c3:too-many")
+"""
+        )
+
+        self.assertTrue(self.engine.wait_for_notification("c3:too-many"))
+
+        # Deleting c1 gives its ID back.
+        self.engine.push_code(
+            """
+ctrls.mk_val("c2", 0.2)
+log('c1-deleted')
+"""
+        )
+
+        self.assertTrue(self.engine.wait_for_notification("c1-deleted"))
+
+        self.engine.push_code(
+            """
+from soir.rt import _ctrls
+
+ctrls.mk_val("c2", 0.2)
+ctrls.mk_val("c3", 0.3)
+c3 = _ctrls.controls_registry_["c3"]
+log(f"c3:{c3.id_},{c3.gen_ > 1}")
+
+_ctrls.max_controls_ = _ctrls.controls_get_max_()
+"""
+        )
+
+        self.assertTrue(self.engine.wait_for_notification("c3:0,True"))
@@ -0,0 +1,75 @@
+"""Integration tests for offline rendering (Soir.render_offline())."""
+
+import json
+import shutil
+import tempfile
+import time
+import unittest
+from pathlib import Path
+
+import soundfile as sf  # type: ignore[import-untyped]
+from soir._bindings import Soir, logging
+
+from .base import _STANDALONE_TEST_CONFIG
+
+
+class TestOfflineRender(unittest.TestCase):
+    """Test rendering sessions faster than real-time."""
+
+    def setUp(self) -> None:
+        """Write a config with audio output disabled."""
+        self.temp_dir = tempfile.mkdtemp()
+        self.config_path = Path(self.temp_dir) / "config.json"
+        self.config_path.write_text(json.dumps(_STANDALONE_TEST_CONFIG))
+
+        logging.init(
+            str(Path(self.temp_dir) / "logs"),
+            max_files=100,
+            verbose=False,
+            redirect_stdio=False,
+        )
+
+    def tearDown(self) -> None:
+        """Clean up the temporary directory."""
+        shutil.rmtree(self.temp_dir, ignore_errors=True)
+
+    def test_render_faster_than_realtime(self) -> None:
+        """Test that 10 seconds are rendered to a WAV in less than 10 seconds."""
+        output = Path(self.temp_dir) / "offline.wav"
+
+        soir = Soir()
+        self.assertTrue(soir.init(str(self.config_path)))
+
+        started_at = time.monotonic()
+        self.assertTrue(
+            soir.render_offline(
+                """
+tracks.setup({
+  'sp': tracks.mk('sampler')
+})
+""",
+                10.0,
+                str(output),
+            )
+        )
+        elapsed = time.monotonic() - started_at
+
+        self.assertLess(elapsed, 10.0)
+        self.assertTrue(output.exists())
+
+        info = sf.info(output)
+        self.assertEqual(info.samplerate, 48000)
+        self.assertEqual(info.channels, 2)
+        self.assertGreaterEqual(info.frames, 10 * 48000)
+
+    def test_render_requires_stopped_engine(self) -> None:
+        """Test that a started engine can't render offline."""
+        soir = Soir()
+        self.assertTrue(soir.init(str(self.config_path)))
+        self.assertTrue(soir.start())
+
+        self.assertFalse(
+            soir.render_offline("", 1.0, str(Path(self.temp_dir) / "x.wav"))
+        )
+
+        self.assertTrue(soir.stop())
@@ -0,0 +1,223 @@
+"""Integration tests for the sampler (sampler module)."""
+
+import os
+import shutil
+import tempfile
+import unittest
+from collections.abc import Callable
+from typing import Any, ClassVar
+from unittest.mock import patch
+
+from soir.rt import sampler
+from soir.rt._helpers import SAMPLER_PLAY_, SAMPLER_STOP_
+
+from .base import SoirSessionTestCase
+from .test_samples import create_test_audio_file
+
+
+class FakeLoop:
+    """Stands for the loop a sampler is played from."""
+
+    track = "sp"
+    current_offset = 0.5
+
+
+class TestSamplerPayloads(unittest.TestCase):
+    """Test what the sampler sends to the engine, with the bindings mocked."""
+
+    def setUp(self) -> None:
+        """Mock the bindings used by the sampler."""
+        self.handles = {"kick": 3, "snare": 7}
+        self.lookups: list[str] = []
+        self.plays: list[tuple[str, bytes]] = []
+        self.stops: list[tuple[str, bytes]] = []
+        self.offsets: list[float] = []
+
+        def get_sample_handle(pack: str, name: str) -> int:
+            self.assertEqual(pack, "test")
+            self.lookups.append(name)
+            return self.handles.get(name, -1)
+
+        def schedule(offset: float, cb: Callable[[], None]) -> None:
+            self.offsets.append(offset)
+            cb()
+
+        for name, mock in [
+            ("assert_in_loop", FakeLoop),
+            ("get_sample_handle_", get_sample_handle),
+            ("schedule_", schedule),
+            ("midi_sysex_sample_play_", lambda t, p: self.plays.append((t, p))),
+            ("midi_sysex_sample_stop_", lambda t, p: self.stops.append((t, p))),
+        ]:
+            patcher = patch(f"soir.rt.sampler.{name}", mock)
+            patcher.start()
+            self.addCleanup(patcher.stop)
+
+        self.sp = sampler.Sampler("test")
+
+    def played(self, i: int = -1) -> tuple[Any, ...]:
+        track, payload = self.plays[i]
+        self.assertEqual(track, "sp")
+        return SAMPLER_PLAY_.unpack(payload)
+
+    def test_play_parameters(self) -> None:
+        """Voice parameters end up in the payload in place."""
+        self.sp.play(
+            "snare",
+            start=0.25,
+            end=0.75,
+            pan=-0.5,
+            attack=0.125,
+            decay=0.25,
+            level=0.5,
+            release=2.0,
+            rate=1.5,
+            amp=0.75,
+        )
+
+        self.assertEqual(self.offsets, [0.5])
+        (
+            sample,
+            start,
+            end,
+            rate,
+            attack,
+            decay,
+            level,
+            release,
+            pan_control,
+            pan,
+            amp_control,
+            amp,
+            voices,
+            choke,
+        ) = self.played()
+        self.assertEqual(sample, 7)
+        self.assertEqual((start, end, rate), (0.25, 0.75, 1.5))
+        self.assertEqual((attack, decay, level, release), (0.125, 0.25, 0.5, 2.0))
+        self.assertEqual((pan_control, pan), (-1, -0.5))
+        self.assertEqual((amp_control, amp), (-1, 0.75))
+        self.assertEqual((voices, choke), (0, 0))
+
+    def test_play_voices_and_choke(self) -> None:
+        """Voice limit and choke group are sent along with the sample."""
+        self.sp.play("kick", voices=2)
+        self.sp.play("snare", choke=1)
+        self.sp.play("kick", voices=1, choke=1)
+
+        self.assertEqual(
+            [(p[0], p[-2], p[-1]) for p in map(self.played, range(3))],
+            [(3, 2, 0), (7, 0, 1), (3, 1, 1)],
+        )
+
+    def test_handles_are_cached(self) -> None:
+        """Names are only resolved once per sampler."""
+        for _ in range(3):
+            self.sp.play("kick")
+            self.sp.stop("kick")
+
+        self.assertEqual(self.lookups, ["kick"])
+        self.assertEqual(len(self.plays), 3)
+        self.assertEqual(len(self.stops), 3)
+
+    def test_unknown_sample(self) -> None:
+        """Unknown samples are not played nor cached."""
+        self.sp.play("clap")
+        self.sp.stop("clap")
+        self.sp.play("clap")
+
+        self.assertEqual(self.plays, [])
+        self.assertEqual(self.stops, [])
+        self.assertEqual(self.offsets, [])
+        self.assertEqual(self.lookups, ["clap", "clap", "clap"])
+
+    def test_stop(self) -> None:
+        """Stopping a sample sends its handle."""
+        self.sp.stop("snare")
+
+        self.assertEqual(self.offsets, [0.5])
+        track, payload = self.stops[0]
+        self.assertEqual(track, "sp")
+        self.assertEqual(SAMPLER_STOP_.unpack(payload), (7,))
+
+
+class TestSampler(SoirSessionTestCase):
+    """Test the sampler against the samples loaded by the engine."""
+
+    sample_dir: ClassVar[str]
+
+    @classmethod
+    def setUpClass(cls) -> None:
+        """Create a sample pack for the engine to load."""
+        cls.sample_dir = tempfile.mkdtemp()
+        for name in ["kick", "snare"]:
+            create_test_audio_file(os.path.join(cls.sample_dir, f"{name}.wav"))
+        with open(os.path.join(cls.sample_dir, "test.pack.json"), "w") as f:
+            f.write(
+                '{"samples": [{"name": "kick", "path": "kick.wav"},'
+                ' {"name": "snare", "path": "snare.wav"}]}'
+            )
+        cls.config_overrides = {
+            "sample_directory": cls.sample_dir,
+            "sample_packs": ["test"],
+        }
+
+    @classmethod
+    def tearDownClass(cls) -> None:
+        """Remove the sample pack."""
+        shutil.rmtree(cls.sample_dir, ignore_errors=True)
+
+    def test_handles(self) -> None:
+        """Handles are stable, distinct and shared by samplers of a pack."""
+        self.engine.push_code(
+            """
+s1 = sampler.new('test')
+s2 = sampler.new('test')
+k = s1._handle('kick')
+s = s1._handle('snare')
+log(f"handles:{k >= 0},{s >= 0},{k != s},{k == s2._handle('kick')}")
+log(f"missing:{s1._handle('clap')}")
+"""
+        )
+
+        self.assertTrue(
+            self.engine.wait_for_notification("handles:True,True,True,True")
+        )
+        self.assertTrue(self.engine.wait_for_notification("missing:-1"))
+
+    def test_unknown_pack(self) -> None:
+        """Samplers can't be created for packs which aren't loaded."""
+        self.engine.push_code(
+            """
+try:
+    sampler.new('nonexistent')
+    log("result:no_exception")
+except errors.SamplePackNotFoundException:
+    log("result:exception_raised")
+"""
+        )
+
+        self.assertTrue(self.engine.wait_for_notification("result:exception_raised"))
+
+    def test_play_voices_and_choke(self) -> None:
+        """Samples play with voice limits and choke groups."""
+        self.engine.push_code(
+            """
+tracks.setup({
+  'sp': tracks.mk('sampler')
+})
+
+s = sampler.new('test')
+
+@loop(track='sp', beats=1)
+def drums():
+    s.play('kick', voices=1)
+    s.play('kick', voices=1)
+    s.play('snare', choke=1)
+    s.play('kick', choke=1, pan=-0.5, amp=0.5)
+    s.stop('snare')
+    log("played")
+"""
+        )
+
+        self.assertTrue(self.engine.wait_for_notification("played"))
@@ -39,3 +39,20 @@ log("OK")
         """
         )
         self.assertTrue(self.engine.wait_for_notification("OK"))
+
+    def test_dsp_stats(self) -> None:
+        """Test that system.get_dsp_stats() reports the engine load."""
+        self.engine.push_code(
+            """
+tracks.setup({
+    'drums': tracks.mk('sampler'),
+})
+
+s = system.get_dsp_stats()
+if s.block_us > 0 and s.render.count > 0 and 'drums' in s.tracks:
+    log(f"OK {s.load_avg:.3f} {s.deadline_misses}")
+else:
+    log("KO")
+        """
+        )
+        self.assertTrue(self.engine.wait_for_notification("OK"))
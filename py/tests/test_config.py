@@ -18,6 +18,17 @@ class TestConfig(unittest.TestCase):
         """Test AudioConfig with default values."""
         config = Config(dsp=Config.DspConfig(), live=Config.LiveConfig())
         self.assertEqual(config.dsp.block_size, 4096)
+        self.assertEqual(config.dsp.realtime_priority, 0)
+        self.assertEqual(config.dsp.cpu_affinity, [])
+        self.assertFalse(config.dsp.mlock)
+        self.assertEqual(config.dsp.sample_cache_directory, "")
+        self.assertEqual(config.dsp.sample_loader_threads, 0)
+        self.assertEqual(config.dsp.sample_memory_mb, 0)
+        self.assertEqual(config.dsp.sample_format, "float32")
+        self.assertEqual(config.dsp.workers, 0)
+        self.assertTrue(config.dsp.pin_workers)
+        self.assertEqual(config.dsp.clock, "device")
+        self.assertEqual(config.dsp.prerender_blocks, 3)
         self.assertEqual(config.live.directory, ".")
 
     def test_app_config_from_json(self) -> None:
@@ -0,0 +1,143 @@
+"""Tests for the binary payloads of the sampler sysex instructions."""
+
+import struct
+import unittest
+
+from soir.rt._ctrls import Control_
+from soir.rt._helpers import (
+    SAMPLER_PLAY_,
+    SAMPLER_STOP_,
+    serialize_sample_play,
+    serialize_sample_stop,
+)
+
+# Sizes of SamplerPlayPayload and SamplerStopPayload, see
+# cpp/core/midi_sysex.hh.
+SAMPLER_PLAY_SIZE = 56
+SAMPLER_STOP_SIZE = 4
+
+
+def make_control(control_id: int) -> Control_:
+    """Control which isn't registered, only its ID is serialized."""
+    control = Control_.__new__(Control_)
+    control.id_ = control_id
+    control.name_ = f"c{control_id}"
+    return control
+
+
+def make_params(**overrides: object) -> dict[str, object]:
+    params: dict[str, object] = {
+        "sample": 3,
+        "start": 0.25,
+        "end": 0.75,
+        "rate": 2.0,
+        "attack": 0.5,
+        "decay": 0.125,
+        "level": 0.8,
+        "release": 1.5,
+        "pan": -0.5,
+        "amp": 1.0,
+        "voices": 4,
+        "choke": 2,
+    }
+    params.update(overrides)
+    return params
+
+
+class TestSerializeSamplePlay(unittest.TestCase):
+    """Test cases for serialize_sample_play."""
+
+    def test_size(self) -> None:
+        """The payload has the size the DSP side expects."""
+        self.assertEqual(SAMPLER_PLAY_.size, SAMPLER_PLAY_SIZE)
+        self.assertEqual(len(serialize_sample_play(make_params())), SAMPLER_PLAY_SIZE)
+
+    def test_round_trip(self) -> None:
+        """Fields are encoded in the order of SamplerPlayPayload."""
+        payload = serialize_sample_play(make_params())
+
+        (
+            sample,
+            start,
+            end,
+            rate,
+            attack,
+            decay,
+            level,
+            release,
+            pan_control,
+            pan_value,
+            amp_control,
+            amp_value,
+            voices,
+            choke,
+        ) = SAMPLER_PLAY_.unpack(payload)
+
+        self.assertEqual(sample, 3)
+        self.assertEqual(start, 0.25)
+        self.assertEqual(end, 0.75)
+        self.assertEqual(rate, 2.0)
+        self.assertEqual(attack, 0.5)
+        self.assertEqual(decay, 0.125)
+        self.assertAlmostEqual(level, 0.8, places=6)
+        self.assertEqual(release, 1.5)
+        self.assertEqual((pan_control, pan_value), (-1, -0.5))
+        self.assertEqual((amp_control, amp_value), (-1, 1.0))
+        self.assertEqual(voices, 4)
+        self.assertEqual(choke, 2)
+
+    def test_little_endian(self) -> None:
+        """The sample handle comes first, little-endian."""
+        payload = serialize_sample_play(make_params(sample=0x01020304))
+        self.assertEqual(payload[:4], b"\x04\x03\x02\x01")
+
+    def test_controls(self) -> None:
+        """Controls are encoded by ID, without a constant value."""
+        payload = serialize_sample_play(
+            make_params(pan=make_control(7), amp=make_control(12))
+        )
+
+        fields = SAMPLER_PLAY_.unpack(payload)
+        self.assertEqual(fields[8:12], (7, 0.0, 12, 0.0))
+
+    def test_truncated(self) -> None:
+        """Truncated or padded payloads don't decode."""
+        payload = serialize_sample_play(make_params())
+
+        with self.assertRaises(struct.error):
+            SAMPLER_PLAY_.unpack(payload[:-1])
+        with self.assertRaises(struct.error):
+            SAMPLER_PLAY_.unpack(payload + b"\x00")
+
+    def test_out_of_range(self) -> None:
+        """Integers which don't fit the layout are rejected."""
+        with self.assertRaises(struct.error):
+            serialize_sample_play(make_params(sample=2**31))
+        with self.assertRaises(struct.error):
+            serialize_sample_play(make_params(voices=-(2**31) - 1))
+
+
+class TestSerializeSampleStop(unittest.TestCase):
+    """Test cases for serialize_sample_stop."""
+
+    def test_size(self) -> None:
+        """The payload has the size the DSP side expects."""
+        self.assertEqual(SAMPLER_STOP_.size, SAMPLER_STOP_SIZE)
+        self.assertEqual(len(serialize_sample_stop({"sample": 3})), SAMPLER_STOP_SIZE)
+
+    def test_round_trip(self) -> None:
+        """The sample handle round-trips, including invalid ones."""
+        for sample in (0, 3, -1, 2**31 - 1):
+            payload = serialize_sample_stop({"sample": sample})
+            self.assertEqual(SAMPLER_STOP_.unpack(payload), (sample,))
+
+    def test_truncated(self) -> None:
+        """Truncated payloads don't decode."""
+        payload = serialize_sample_stop({"sample": 3})
+
+        with self.assertRaises(struct.error):
+            SAMPLER_STOP_.unpack(payload[:-1])
+
+
+if __name__ == "__main__":
+    unittest.main()